@@ -165,6 +165,21 @@ static int binder_set_stop_on_user_error(const char *val,
 module_param_call(stop_on_user_error, binder_set_stop_on_user_error,
 	param_get_int, &binder_stop_on_user_error, 0644);
 
+#ifdef CONFIG_SAMSUNG_FREECESS
+/*
+ * One-way transactions to a frozen app are held (they stay on its todo list
+ * anyway) and coalesced by (node, code) instead of being reported one by one.
+ * A single report is sent per freeze epoch, once freecess_defer_txns of them
+ * are pending, the deferral table overflows or freecess_defer_ms after the
+ * first one was held, whichever comes first. freecess_defer_txns = 0 reports
+ * every transaction as before.
+ */
+static uint binder_freecess_defer_txns = 64;
+module_param_named(freecess_defer_txns, binder_freecess_defer_txns, uint, 0644);
+static uint binder_freecess_defer_ms = 500;
+module_param_named(freecess_defer_ms, binder_freecess_defer_ms, uint, 0644);
+#endif
+
 #define binder_debug(mask, x...) \
 	do { \
 		if (binder_debug_mask & mask) \
@@ -553,9 +568,42 @@ struct binder_priority {
  * @inner_lock:           can nest under outer_lock and/or node lock
  * @outer_lock:           no nesting under innor or node lock
  *                        Lock order: 1) outer, 2) node, 3) inner
+ * @freecess_defer:       one-way transactions held while frozen
+ *                        (protected by @inner_lock)
  *
  * Bookkeeping structure for binder processes
  */
+#ifdef CONFIG_SAMSUNG_FREECESS
+#define FREECESS_DEFER_ENTRIES	16
+
+struct freecess_defer_entry {
+	int node_debug_id;
+	u32 code;
+	u32 count;
+	char rpcname[INTERFACETOKEN_BUFF_SIZE];
+};
+
+/**
+ * struct freecess_defer - one-way transactions held while frozen
+ * @proc:     the frozen binder_proc
+ * @work:     sends the report freecess_defer_ms after the first transaction
+ * @total:    transactions held in this epoch
+ * @nr:       valid entries in @entry
+ * @reported: the aggregated report of this epoch was sent
+ * @entry:    held transactions coalesced by (node, code)
+ *
+ * An epoch ends when the app talks to binder again, i.e. was thawed.
+ */
+struct freecess_defer {
+	struct binder_proc *proc;
+	struct delayed_work work;
+	u32 total;
+	int nr;
+	bool reported;
+	struct freecess_defer_entry entry[FREECESS_DEFER_ENTRIES];
+};
+#endif
+
 struct binder_proc {
 	struct hlist_node proc_node;
 	struct rb_root threads;
@@ -590,6 +638,9 @@ struct binder_proc {
 	struct binder_context *context;
 	spinlock_t inner_lock;
 	spinlock_t outer_lock;
+#ifdef CONFIG_SAMSUNG_FREECESS
+	struct freecess_defer *freecess_defer;
+#endif
 };
 
 enum {
@@ -3031,17 +3082,187 @@ static struct binder_node *binder_get_node_refs_for_txn(
 // 2) Make sure that the invalid address issue is not occuring (j=9, j+=2)
 // 3) Java layer uses 2 bytes char. And only the first byte has the data. (p+=2)
 // 4) Parcel::writeInterfaceToken() in frameworks/native/libs/binder/Parcel.cpp
+static void freecess_get_interface_token(struct binder_transaction_data *tr,
+					 struct binder_transaction *t,
+					 int skip_bytes, char *buf)
+{
+	char buf_user[INTERFACETOKEN_BUFF_SIZE] = {0};
+	char *p = NULL;
+	int i = 0;
+	int j = 0;
+
+	if (0 == copy_from_user(buf_user, (const void __user *)(uintptr_t)tr->data.ptr.buffer,
+		min_t(binder_size_t, tr->data_size, INTERFACETOKEN_BUFF_SIZE - 2))) {
+		p = &buf_user[skip_bytes];
+		i = 0;
+		j = skip_bytes + 1;
+		while (i < INTERFACETOKEN_BUFF_SIZE && j < t->buffer->data_size && *p != '\0') {
+			buf[i++] = *p;
+			j += 2;
+			p += 2;
+		}
+		if (i == INTERFACETOKEN_BUFF_SIZE) buf[i-1] = '\0';
+	}
+}
+
+static struct freecess_defer_entry *
+freecess_defer_find(struct freecess_defer *defer, int node_debug_id, u32 code)
+{
+	int i;
+
+	for (i = 0; i < defer->nr; i++)
+		if (defer->entry[i].node_debug_id == node_debug_id &&
+		    defer->entry[i].code == code)
+			return &defer->entry[i];
+
+	return NULL;
+}
+
+/*
+ * Pick the most frequent held transaction for the report of this epoch.
+ * Returns false if there is nothing to report. Called under the inner lock.
+ */
+static bool freecess_defer_report(struct freecess_defer *defer,
+				  struct freecess_defer_entry *report)
+{
+	struct freecess_defer_entry *e;
+	int i;
+
+	if (defer->reported || !defer->nr)
+		return false;
+
+	defer->reported = true;
+	e = &defer->entry[0];
+	for (i = 1; i < defer->nr; i++)
+		if (defer->entry[i].count > e->count)
+			e = &defer->entry[i];
+	*report = *e;
+
+	return true;
+}
+
+/* freecess_defer_ms passed since the first transaction was held */
+static void freecess_defer_work_fn(struct work_struct *work)
+{
+	struct freecess_defer *defer = container_of(to_delayed_work(work),
+						    struct freecess_defer, work);
+	struct binder_proc *proc = defer->proc;
+	struct freecess_defer_entry report;
+	bool due;
+
+	binder_inner_proc_lock(proc);
+	due = freecess_defer_report(defer, &report);
+	binder_inner_proc_unlock(proc);
+
+	if (due) {
+		freecess_stat_inc(FREECESS_STAT_BINDER_AGGREGATED);
+		binder_report(proc->tsk, report.code, report.rpcname, TF_ONE_WAY);
+	}
+}
+
+static struct freecess_defer *freecess_defer_get(struct binder_proc *proc)
+{
+	struct freecess_defer *defer = READ_ONCE(proc->freecess_defer);
+
+	if (defer)
+		return defer;
+
+	defer = kzalloc(sizeof(*defer), GFP_KERNEL);
+	if (!defer)
+		return NULL;
+	defer->proc = proc;
+	INIT_DELAYED_WORK(&defer->work, freecess_defer_work_fn);
+
+	binder_inner_proc_lock(proc);
+	if (!proc->freecess_defer) {
+		proc->freecess_defer = defer;
+		defer = NULL;
+	}
+	binder_inner_proc_unlock(proc);
+	kfree(defer);
+
+	return proc->freecess_defer;
+}
+
+/*
+ * Hold a one-way transaction to the frozen @proc. Returns true and fills
+ * @report with the most frequent held transaction when the aggregated report
+ * of this epoch is due. Otherwise the first transaction of an epoch arms
+ * @defer->work, which reports after freecess_defer_ms.
+ */
+static bool freecess_defer_oneway(struct binder_proc *proc,
+				  struct freecess_defer *defer,
+				  int node_debug_id, u32 code,
+				  const char *rpcname,
+				  struct freecess_defer_entry *report)
+{
+	struct freecess_defer_entry *e;
+	bool overflow = false;
+	bool due = false;
+	bool first;
+
+	binder_inner_proc_lock(proc);
+	first = !defer->total++;
+
+	e = freecess_defer_find(defer, node_debug_id, code);
+	if (e) {
+		e->count++;
+		freecess_stat_inc(FREECESS_STAT_BINDER_COALESCED);
+	} else if (defer->nr < FREECESS_DEFER_ENTRIES) {
+		e = &defer->entry[defer->nr++];
+		e->node_debug_id = node_debug_id;
+		e->code = code;
+		e->count = 1;
+		strlcpy(e->rpcname, rpcname, INTERFACETOKEN_BUFF_SIZE);
+	} else {
+		overflow = true;
+	}
+
+	if (overflow || defer->total >= binder_freecess_defer_txns)
+		due = freecess_defer_report(defer, report);
+	binder_inner_proc_unlock(proc);
+
+	if (first && !due)
+		mod_delayed_work(system_wq, &defer->work,
+				 msecs_to_jiffies(binder_freecess_defer_ms));
+
+	if (overflow)
+		freecess_stat_inc(FREECESS_STAT_BINDER_OVERFLOW);
+	if (!due)
+		freecess_stat_inc(FREECESS_STAT_BINDER_DEFERRED);
+
+	return due;
+}
+
+/* @proc runs binder again, so it was thawed: start a new epoch */
+static void freecess_defer_thawed(struct binder_proc *proc)
+{
+	struct freecess_defer *defer = READ_ONCE(proc->freecess_defer);
+
+	if (likely(!defer || !READ_ONCE(defer->total)))
+		return;
+
+	binder_inner_proc_lock(proc);
+	defer->total = 0;
+	defer->nr = 0;
+	defer->reported = false;
+	binder_inner_proc_unlock(proc);
+	cancel_delayed_work(&defer->work);
+
+	freecess_stat_inc(FREECESS_STAT_BINDER_EPOCH);
+}
+
 static void freecess_async_binder_report(struct binder_proc *proc,
 						struct binder_proc *target_proc,
 						struct binder_transaction_data *tr,
 						struct binder_transaction *t)
 {
-	char buf_user[INTERFACETOKEN_BUFF_SIZE] = {0};
 	char buf[INTERFACETOKEN_BUFF_SIZE] = {0};
-	char *p = NULL;
-	int i = 0;
-	int j = 0;
+	struct freecess_defer_entry report;
+	struct freecess_defer *defer;
 	int skip_bytes = 8;
+	int node_debug_id;
+	bool new_entry;
 
 	if (!proc || !target_proc || !tr || !t)
 		return;
@@ -3054,27 +3275,37 @@ static void freecess_async_binder_report(struct binder_proc *proc,
 	else if (freecess_fw_version == 2)
 		skip_bytes = 16;
 
-	if ((tr->flags & TF_ONE_WAY) && target_proc
+	if (!((tr->flags & TF_ONE_WAY) && target_proc
 		&& target_proc->tsk && target_proc->tsk->cred
 		&& (target_proc->tsk->cred->euid.val > 10000)
-		&& (proc->pid != target_proc->pid)) {
-		if (thread_group_is_frozen(target_proc->tsk)) {
-			if (t->buffer->data_size > skip_bytes) {
-				if (0 == copy_from_user(buf_user, (const void __user *)(uintptr_t)tr->data.ptr.buffer,
-					min_t(binder_size_t, tr->data_size, INTERFACETOKEN_BUFF_SIZE - 2))) {
-					p = &buf_user[skip_bytes];
-					i = 0;
-					j = skip_bytes + 1;
-					while (i < INTERFACETOKEN_BUFF_SIZE && j < t->buffer->data_size && *p != '\0') {
-						buf[i++] = *p;
-						j += 2;
-						p += 2;
-					}
-					if (i == INTERFACETOKEN_BUFF_SIZE) buf[i-1] = '\0';
-				}
-				binder_report(target_proc->tsk, tr->code, buf, tr->flags & TF_ONE_WAY);
-			}
-		}
+		&& (proc->pid != target_proc->pid)))
+		return;
+
+	if (!thread_group_is_frozen(target_proc->tsk) ||
+	    t->buffer->data_size <= skip_bytes)
+		return;
+
+	defer = binder_freecess_defer_txns ?
+		freecess_defer_get(target_proc) : NULL;
+	if (!defer) {
+		freecess_get_interface_token(tr, t, skip_bytes, buf);
+		binder_report(target_proc->tsk, tr->code, buf, tr->flags & TF_ONE_WAY);
+		return;
+	}
+
+	/* the interface token is only needed for a new (node, code) pair */
+	node_debug_id = t->buffer->target_node->debug_id;
+	binder_inner_proc_lock(target_proc);
+	new_entry = !freecess_defer_find(defer, node_debug_id, tr->code);
+	binder_inner_proc_unlock(target_proc);
+	if (new_entry)
+		freecess_get_interface_token(tr, t, skip_bytes, buf);
+
+	if (freecess_defer_oneway(target_proc, defer, node_debug_id, tr->code,
+				  buf, &report)) {
+		freecess_stat_inc(FREECESS_STAT_BINDER_AGGREGATED);
+		binder_report(target_proc->tsk, report.code, report.rpcname,
+			      tr->flags & TF_ONE_WAY);
 	}
 }
 
@@ -4873,6 +5104,12 @@ static void binder_free_proc(struct binder_proc *proc)
 		kfree(device);
 	}
 	binder_alloc_deferred_release(&proc->alloc);
+#ifdef CONFIG_SAMSUNG_FREECESS
+	if (proc->freecess_defer) {
+		cancel_delayed_work_sync(&proc->freecess_defer->work);
+		kfree(proc->freecess_defer);
+	}
+#endif
 	put_task_struct(proc->tsk);
 	put_cred(proc->cred);
 	binder_stats_deleted(BINDER_STAT_PROC);
@@ -5280,6 +5517,10 @@ static long binder_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 
 	binder_selftest_alloc(&proc->alloc);
 
+#ifdef CONFIG_SAMSUNG_FREECESS
+	freecess_defer_thawed(proc);
+#endif
+
 	trace_binder_ioctl(cmd, arg);
 
 	ret = wait_event_interruptible(binder_user_error_wait, binder_stop_on_user_error < 2);
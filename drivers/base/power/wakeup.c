@@ -20,6 +20,7 @@
 #endif
 #include <linux/pm_wakeirq.h>
 #include <linux/types.h>
+#include <uapi/linux/wakeup_stats.h>
 #include <trace/events/power.h>
 
 #include "power.h"
@@ -107,6 +108,187 @@ static struct wakeup_source deleted_ws = {
 	.lock =  __SPIN_LOCK_UNLOCKED(deleted_ws.lock),
 };
 
+/*
+ * Statistics kept up to date on every deactivation, so that readers copy a
+ * fixed amount of data instead of walking all wakeup sources:
+ *
+ * - ws_top: the WAKEUP_STATS_TOP_N sources with the most total active time.
+ * - ws_period: the sources with the most active time in the current period,
+ *   kept with the space-saving algorithm. When full, a new source replaces
+ *   the last one and inherits its time as an upper bound of the error.
+ * - ws_snapshots: ring of closed periods. A period is closed lazily by the
+ *   first deactivation or read after ws_period_ms, so no timer wakes the
+ *   system for it.
+ *
+ * All protected by ws_stats_lock, which nests inside wakeup_source.lock.
+ */
+struct ws_stats_entry {
+	struct wakeup_source *ws;
+	char name[WAKEUP_STATS_NAME_LEN];
+	ktime_t time;
+	unsigned int count;
+};
+
+static DEFINE_SPINLOCK(ws_stats_lock);
+static struct ws_stats_entry ws_top[WAKEUP_STATS_TOP_N];
+static int ws_top_nr;
+static struct ws_stats_entry ws_period[WAKEUP_STATS_TOP_N];
+static int ws_period_nr;
+static ktime_t ws_period_start;
+static ktime_t ws_period_time;
+static unsigned int ws_period_count;
+static struct wakeup_stats_snapshot ws_snapshots[WAKEUP_STATS_NR_SNAPSHOTS];
+static u64 ws_snapshot_seq;
+static u32 ws_period_ms = 60 * MSEC_PER_SEC;
+
+static int ws_stats_find(struct ws_stats_entry *e, int nr,
+			 struct wakeup_source *ws)
+{
+	int i;
+
+	for (i = 0; i < nr; i++)
+		if (e[i].ws == ws)
+			return i;
+
+	return -1;
+}
+
+/* Keeps @e sorted by decreasing time after e[i].time grew */
+static void ws_stats_sift_up(struct ws_stats_entry *e, int i)
+{
+	struct ws_stats_entry tmp;
+
+	while (i > 0 && ktime_compare(e[i].time, e[i - 1].time) > 0) {
+		tmp = e[i - 1];
+		e[i - 1] = e[i];
+		e[i] = tmp;
+		i--;
+	}
+}
+
+static void ws_stats_set(struct ws_stats_entry *e, struct wakeup_source *ws)
+{
+	e->ws = ws;
+	strlcpy(e->name, ws->name ? ws->name : "", sizeof(e->name));
+}
+
+static void ws_top_update(struct wakeup_source *ws)
+{
+	int i = ws_stats_find(ws_top, ws_top_nr, ws);
+
+	if (i < 0) {
+		if (ws_top_nr < WAKEUP_STATS_TOP_N)
+			i = ws_top_nr++;
+		else if (ktime_compare(ws->total_time,
+				       ws_top[WAKEUP_STATS_TOP_N - 1].time) > 0)
+			i = WAKEUP_STATS_TOP_N - 1;
+		else
+			return;
+		ws_stats_set(&ws_top[i], ws);
+	}
+
+	ws_top[i].time = ws->total_time;
+	ws_top[i].count = ws->active_count;
+	ws_stats_sift_up(ws_top, i);
+}
+
+static void ws_period_close(ktime_t now)
+{
+	struct wakeup_stats_snapshot *snap;
+	int i;
+
+	if (ktime_ms_delta(now, ws_period_start) < ws_period_ms)
+		return;
+
+	snap = &ws_snapshots[ws_snapshot_seq++ % WAKEUP_STATS_NR_SNAPSHOTS];
+	memset(snap, 0, sizeof(*snap));
+	snap->seq = ws_snapshot_seq;
+	snap->start_ns = ktime_to_ns(ws_period_start);
+	snap->end_ns = ktime_to_ns(now);
+	snap->active_time_ns = ktime_to_ns(ws_period_time);
+	snap->active_count = ws_period_count;
+	snap->nr_sources = ws_period_nr;
+	for (i = 0; i < ws_period_nr; i++) {
+		memcpy(snap->sources[i].name, ws_period[i].name,
+		       WAKEUP_STATS_NAME_LEN);
+		snap->sources[i].active_time_ns = ktime_to_ns(ws_period[i].time);
+		snap->sources[i].active_count = ws_period[i].count;
+	}
+
+	ws_period_nr = 0;
+	ws_period_start = now;
+	ws_period_time = ktime_set(0, 0);
+	ws_period_count = 0;
+}
+
+static void ws_period_add(struct wakeup_source *ws, ktime_t duration)
+{
+	int i = ws_stats_find(ws_period, ws_period_nr, ws);
+
+	if (i < 0) {
+		if (ws_period_nr < WAKEUP_STATS_TOP_N) {
+			i = ws_period_nr++;
+			ws_period[i].time = ktime_set(0, 0);
+		} else {
+			i = WAKEUP_STATS_TOP_N - 1;
+		}
+		ws_stats_set(&ws_period[i], ws);
+		ws_period[i].count = 0;
+	}
+
+	ws_period[i].time = ktime_add(ws_period[i].time, duration);
+	ws_period[i].count++;
+	ws_stats_sift_up(ws_period, i);
+
+	ws_period_time = ktime_add(ws_period_time, duration);
+	ws_period_count++;
+}
+
+/* Called with ws->lock held when an activation of @ws ended at @now */
+static void wakeup_source_stats_update(struct wakeup_source *ws,
+				       ktime_t duration, ktime_t now)
+{
+	spin_lock(&ws_stats_lock);
+	if (!ws->stats_detached) {
+		ws_period_close(now);
+		ws_period_add(ws, duration);
+		ws_top_update(ws);
+	}
+	spin_unlock(&ws_stats_lock);
+}
+
+static void wakeup_source_stats_attach(struct wakeup_source *ws)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ws_stats_lock, flags);
+	ws->stats_detached = false;
+	spin_unlock_irqrestore(&ws_stats_lock, flags);
+}
+
+/* @ws is going away, forget pointers to it */
+static void wakeup_source_stats_detach(struct wakeup_source *ws)
+{
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&ws_stats_lock, flags);
+	ws->stats_detached = true;
+
+	i = ws_stats_find(ws_top, ws_top_nr, ws);
+	if (i >= 0) {
+		ws_top_nr--;
+		memmove(&ws_top[i], &ws_top[i + 1],
+			(ws_top_nr - i) * sizeof(ws_top[0]));
+	}
+
+	/* keep its time in the period, it is just no longer matched */
+	i = ws_stats_find(ws_period, ws_period_nr, ws);
+	if (i >= 0)
+		ws_period[i].ws = NULL;
+	spin_unlock_irqrestore(&ws_stats_lock, flags);
+}
+
 /**
  * wakeup_source_prepare - Prepare a new wakeup source for initialization.
  * @ws: Wakeup source to prepare.
@@ -227,6 +409,8 @@ void wakeup_source_add(struct wakeup_source *ws)
 	setup_timer(&ws->timer, pm_wakeup_timer_fn, (unsigned long)ws);
 	ws->active = false;
 
+	wakeup_source_stats_attach(ws);
+
 	spin_lock_irqsave(&events_lock, flags);
 	list_add_rcu(&ws->entry, &wakeup_sources);
 	spin_unlock_irqrestore(&events_lock, flags);
@@ -247,6 +431,7 @@ void wakeup_source_remove(struct wakeup_source *ws)
 	spin_lock_irqsave(&events_lock, flags);
 	list_del_rcu(&ws->entry);
 	spin_unlock_irqrestore(&events_lock, flags);
+	wakeup_source_stats_detach(ws);
 	synchronize_srcu(&wakeup_srcu);
 
 	del_timer_sync(&ws->timer);
@@ -276,6 +461,7 @@ static void wakeup_source_remove_async(struct wakeup_source *ws)
 	spin_lock_irqsave(&events_lock, flags);
 	list_del_rcu(&ws->entry);
 	spin_unlock_irqrestore(&events_lock, flags);
+	wakeup_source_stats_detach(ws);
 }
 
 /**
@@ -819,6 +1005,8 @@ static void wakeup_source_deactivate(struct wakeup_source *ws)
 	if (ws->autosleep_enabled)
 		update_prevent_sleep_time(ws, now);
 
+	wakeup_source_stats_update(ws, duration, now);
+
 	/*
 	 * Increment the counter of registered wakeup events and decrement the
 	 * couter of wakeup events in progress simultaneously.
@@ -1248,12 +1436,103 @@ static const struct file_operations wakeup_sources_stats_fops = {
 	.release = single_release,
 };
 
+static ssize_t wakeup_sources_top_read(struct file *file, char __user *buf,
+				       size_t count, loff_t *ppos)
+{
+	struct wakeup_stats_source *recs;
+	unsigned long flags;
+	ktime_t now;
+	ssize_t ret;
+	int i, nr;
+
+	recs = kcalloc(WAKEUP_STATS_TOP_N, sizeof(*recs), GFP_KERNEL);
+	if (!recs)
+		return -ENOMEM;
+
+	spin_lock_irqsave(&ws_stats_lock, flags);
+	now = ktime_get();
+	nr = ws_top_nr;
+	for (i = 0; i < nr; i++) {
+		struct wakeup_source *ws = ws_top[i].ws;
+		ktime_t time = ws_top[i].time;
+
+		/* racy, but a stale view of an activation is fine here */
+		if (ws->active) {
+			time = ktime_add(time, ktime_sub(now, ws->last_time));
+			recs[i].flags = WAKEUP_STATS_ACTIVE;
+		}
+		memcpy(recs[i].name, ws_top[i].name, WAKEUP_STATS_NAME_LEN);
+		recs[i].active_time_ns = ktime_to_ns(time);
+		recs[i].active_count = ws_top[i].count;
+	}
+	spin_unlock_irqrestore(&ws_stats_lock, flags);
+
+	ret = simple_read_from_buffer(buf, count, ppos, recs,
+				      nr * sizeof(*recs));
+	kfree(recs);
+
+	return ret;
+}
+
+static const struct file_operations wakeup_sources_top_fops = {
+	.owner = THIS_MODULE,
+	.read = wakeup_sources_top_read,
+	.llseek = default_llseek,
+};
+
+static ssize_t wakeup_sources_snapshots_read(struct file *file,
+					     char __user *buf, size_t count,
+					     loff_t *ppos)
+{
+	struct wakeup_stats_snapshot *snaps;
+	unsigned long flags;
+	ssize_t ret;
+	u64 seq;
+	int i, nr;
+
+	snaps = kmalloc_array(WAKEUP_STATS_NR_SNAPSHOTS, sizeof(*snaps),
+			      GFP_KERNEL);
+	if (!snaps)
+		return -ENOMEM;
+
+	spin_lock_irqsave(&ws_stats_lock, flags);
+	ws_period_close(ktime_get());
+	nr = min_t(u64, ws_snapshot_seq, WAKEUP_STATS_NR_SNAPSHOTS);
+	seq = ws_snapshot_seq - nr;
+	for (i = 0; i < nr; i++, seq++)
+		snaps[i] = ws_snapshots[seq % WAKEUP_STATS_NR_SNAPSHOTS];
+	spin_unlock_irqrestore(&ws_stats_lock, flags);
+
+	ret = simple_read_from_buffer(buf, count, ppos, snaps,
+				      nr * sizeof(*snaps));
+	kfree(snaps);
+
+	return ret;
+}
+
+static const struct file_operations wakeup_sources_snapshots_fops = {
+	.owner = THIS_MODULE,
+	.read = wakeup_sources_snapshots_read,
+	.llseek = default_llseek,
+};
+
 static int __init wakeup_sources_init(void)
 {
+	ws_period_start = ktime_get();
 #ifdef CONFIG_DEBUG_FS
 	debugfs_create_file("wakeup_sources", S_IRUGO, NULL, NULL, &wakeup_sources_stats_fops);
+	debugfs_create_file("wakeup_sources_top", S_IRUGO, NULL, NULL,
+			    &wakeup_sources_top_fops);
+	debugfs_create_file("wakeup_sources_snapshots", S_IRUGO, NULL, NULL,
+			    &wakeup_sources_snapshots_fops);
+	debugfs_create_u32("wakeup_sources_period_ms", S_IRUGO | S_IWUSR, NULL,
+			   &ws_period_ms);
 #elif defined(CONFIG_PROC_FS)
 	proc_create("wakelocks", S_IRUGO, NULL, &wakeup_sources_stats_fops);
+	proc_create("wakeup_sources_top", S_IRUGO, NULL,
+		    &wakeup_sources_top_fops);
+	proc_create("wakeup_sources_snapshots", S_IRUGO, NULL,
+		    &wakeup_sources_snapshots_fops);
 #endif
 	return 0;
 }
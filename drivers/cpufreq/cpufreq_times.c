@@ -472,6 +472,41 @@ void cpufreq_acct_update_power(struct task_struct *p, cputime_t cputime)
 	rcu_read_unlock();
 }
 
+/**
+ * cpufreq_times_cpu_index - index of the current frequency of a cpu
+ * @cpu: the cpu
+ *
+ * Returns the index in the frequency table of @cpu of the frequency it
+ * last switched to, or -1 if @cpu has no table yet. Cheap enough to be
+ * called when accounting cputime.
+ */
+int cpufreq_times_cpu_index(int cpu)
+{
+	struct cpu_freqs *freqs = all_freqs[cpu];
+
+	return freqs ? READ_ONCE(freqs->last_index) : -1;
+}
+
+/* number of entries in the frequency table of @cpu */
+unsigned int cpufreq_times_cpu_states(int cpu)
+{
+	struct cpu_freqs *freqs = all_freqs[cpu];
+
+	return freqs ? freqs->max_state : 0;
+}
+
+/* frequency of entry @index of the table of @cpu, 0 if there is none */
+unsigned int cpufreq_times_cpu_freq(int cpu, unsigned int index)
+{
+	struct cpu_freqs *freqs = all_freqs[cpu];
+
+	if (!freqs || index >= freqs->max_state ||
+	    freqs->freq_table[index] == CPUFREQ_ENTRY_INVALID)
+		return 0;
+
+	return freqs->freq_table[index];
+}
+
 void cpufreq_times_create_policy(struct cpufreq_policy *policy)
 {
 	int cpu, index;
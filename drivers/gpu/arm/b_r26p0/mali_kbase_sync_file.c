@@ -166,6 +166,10 @@ kbase_sync_fence_out_trigger(struct kbase_jd_atom *katom, int result)
 
 	kbase_sync_fence_out_remove(katom);
 
+	/* MALI_SEC_INTEGRATION */
+	if (!result && katom->kctx->kbdev->vendor_callbacks->frame_done)
+		katom->kctx->kbdev->vendor_callbacks->frame_done(katom->kctx->kbdev);
+
 	return (result != 0) ? BASE_JD_EVENT_JOB_CANCELLED : BASE_JD_EVENT_DONE;
 }
 
@@ -1362,6 +1362,70 @@ static ssize_t set_polling_speed(struct device *dev, struct device_attribute *at
 	return count;
 }
 
+static ssize_t show_frame_governor(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	ssize_t ret = 0;
+	unsigned long flags;
+	struct gpu_frame_gov gov;
+	struct exynos_context *platform = (struct exynos_context *)pkbdev->platform_context;
+
+	if (!platform)
+		return -ENODEV;
+
+	spin_lock_irqsave(&platform->gpu_dvfs_spinlock, flags);
+	gov = platform->frame.gov;
+	spin_unlock_irqrestore(&platform->gpu_dvfs_spinlock, flags);
+
+	ret += snprintf(buf+ret, PAGE_SIZE-ret, "target_frame_us %u\n", gov.target_frame_us);
+	ret += snprintf(buf+ret, PAGE_SIZE-ret, "headroom %u\n", gov.headroom);
+	ret += snprintf(buf+ret, PAGE_SIZE-ret, "mif_slack %u\n", gov.mif_slack);
+	ret += snprintf(buf+ret, PAGE_SIZE-ret, "down_hold %u\n", gov.down_hold);
+	ret += snprintf(buf+ret, PAGE_SIZE-ret, "frame_period_us %u\n", gov.frame_period_us);
+	ret += snprintf(buf+ret, PAGE_SIZE-ret, "frames %llu\n", gov.frames);
+	ret += snprintf(buf+ret, PAGE_SIZE-ret, "late_frames %llu\n", gov.late_frames);
+	ret += snprintf(buf+ret, PAGE_SIZE-ret, "frames_total %ld", atomic_long_read(&platform->frame.total));
+
+	if (ret < PAGE_SIZE - 1) {
+		ret += snprintf(buf+ret, PAGE_SIZE-ret, "\n");
+	} else {
+		buf[PAGE_SIZE-2] = '\n';
+		buf[PAGE_SIZE-1] = '\0';
+		ret = PAGE_SIZE-1;
+	}
+
+	return ret;
+}
+
+/* "<target_frame_us> <headroom> <mif_slack> <down_hold>", target 0 is auto */
+static ssize_t set_frame_governor(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+	unsigned int target_frame_us, headroom, mif_slack, down_hold;
+	unsigned long flags;
+	struct exynos_context *platform = (struct exynos_context *)pkbdev->platform_context;
+
+	if (!platform)
+		return -ENODEV;
+
+	if (sscanf(buf, "%u %u %u %u", &target_frame_us, &headroom, &mif_slack, &down_hold) != 4) {
+		GPU_LOG(DVFS_WARNING, DUMMY, 0u, 0u, "%s: invalid value\n", __func__);
+		return -ENOENT;
+	}
+
+	if ((headroom < 10) || (headroom > 100) || (mif_slack > 100)) {
+		GPU_LOG(DVFS_WARNING, DUMMY, 0u, 0u, "%s: out of range (%u %u)\n", __func__, headroom, mif_slack);
+		return -ENOENT;
+	}
+
+	spin_lock_irqsave(&platform->gpu_dvfs_spinlock, flags);
+	platform->frame.gov.target_frame_us = target_frame_us;
+	platform->frame.gov.headroom = headroom;
+	platform->frame.gov.mif_slack = mif_slack;
+	platform->frame.gov.down_hold = down_hold;
+	spin_unlock_irqrestore(&platform->gpu_dvfs_spinlock, flags);
+
+	return count;
+}
+
 static ssize_t show_tmu(struct device *dev, struct device_attribute *attr, char *buf)
 {
 	ssize_t ret = 0;
@@ -1818,6 +1882,7 @@ DEVICE_ATTR(highspeed_load, S_IRUGO|S_IWUSR, show_highspeed_load, set_highspeed_
 DEVICE_ATTR(highspeed_delay, S_IRUGO|S_IWUSR, show_highspeed_delay, set_highspeed_delay);
 DEVICE_ATTR(wakeup_lock, S_IRUGO|S_IWUSR, show_wakeup_lock, set_wakeup_lock);
 DEVICE_ATTR(polling_speed, S_IRUGO|S_IWUSR, show_polling_speed, set_polling_speed);
+DEVICE_ATTR(frame_governor, S_IRUGO|S_IWUSR, show_frame_governor, set_frame_governor);
 DEVICE_ATTR(throttling1, S_IRUGO|S_IWUSR, show_gpu_throttling1, set_gpu_throttling1);
 DEVICE_ATTR(throttling2, S_IRUGO|S_IWUSR, show_gpu_throttling2, set_gpu_throttling2);
 DEVICE_ATTR(throttling3, S_IRUGO|S_IWUSR, show_gpu_throttling3, set_gpu_throttling3);
@@ -2504,6 +2569,11 @@ int gpu_create_sysfs_file(struct device *dev)
 		goto out;
 	}
 
+	if (device_create_file(dev, &dev_attr_frame_governor)) {
+		GPU_LOG(DVFS_ERROR, DUMMY, 0u, 0u, "couldn't create sysfs file [frame_governor]\n");
+		goto out;
+	}
+
 	if (device_create_file(dev, &dev_attr_throttling1)) {
 		GPU_LOG(DVFS_ERROR, DUMMY, 0u, 0u, "couldn't create sysfs file [throttling1]\n");
 		goto out;
@@ -2644,6 +2714,7 @@ void gpu_remove_sysfs_file(struct device *dev)
 	device_remove_file(dev, &dev_attr_highspeed_delay);
 	device_remove_file(dev, &dev_attr_wakeup_lock);
 	device_remove_file(dev, &dev_attr_polling_speed);
+	device_remove_file(dev, &dev_attr_frame_governor);
 	device_remove_file(dev, &dev_attr_throttling1);
 	device_remove_file(dev, &dev_attr_throttling2);
 	device_remove_file(dev, &dev_attr_throttling3);
@@ -0,0 +1,177 @@
+/* drivers/gpu/arm/.../platform/gpu_dvfs_frame_gov.c
+ *
+ * Copyright 2011 by S.LSI. Samsung Electronics Inc.
+ * San#24, Nongseo-Dong, Giheung-Gu, Yongin, Korea
+ *
+ * Samsung SoC Mali-T Series DVFS driver
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software FoundatIon.
+ */
+
+/**
+ * @file gpu_dvfs_frame_gov.c
+ * Frame governor: picks the lowest clock that finishes a frame's GPU work
+ * within the frame deadline.
+ *
+ * The work of a frame is estimated as busy time times clock, so it is in
+ * kHz*us (thousands of cycles). It rises to a new sample at once and decays
+ * by a quarter per window, so a heavy frame is never planned with a stale
+ * light estimate. Windows without frames (compute, idle) fall back to
+ * scaling the clock with utilization.
+ */
+
+#include "gpu_dvfs_frame_gov.h"
+
+#ifdef __KERNEL__
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/string.h>
+#define frame_gov_div(a, b)	div64_u64(a, b)
+#else
+#include <string.h>
+#define frame_gov_div(a, b)	((a) / (b))
+#endif
+
+void gpu_frame_gov_reset(struct gpu_frame_gov *gov)
+{
+	gov->frame_work = 0;
+	gov->frame_period_us = 0;
+	gov->down_count = 0;
+}
+
+void gpu_frame_gov_init(struct gpu_frame_gov *gov)
+{
+	memset(gov, 0, sizeof(*gov));
+	gov->headroom = GPU_FRAME_GOV_DEFAULT_HEADROOM;
+	gov->mif_slack = GPU_FRAME_GOV_DEFAULT_MIF_SLACK;
+	gov->down_hold = GPU_FRAME_GOV_DEFAULT_DOWN_HOLD;
+}
+
+int gpu_frame_gov_set_table(struct gpu_frame_gov *gov, const u32 *clock,
+			    int nr_levels)
+{
+	int i;
+
+	if (nr_levels <= 0 || nr_levels > GPU_FRAME_GOV_MAX_LEVELS)
+		return -1;
+
+	for (i = 0; i < nr_levels; i++)
+		gov->clock[i] = clock[i];
+	gov->nr_levels = nr_levels;
+	gpu_frame_gov_reset(gov);
+
+	return 0;
+}
+
+static void gpu_frame_gov_update(struct gpu_frame_gov *gov,
+				 u64 frame_work, u32 frame_period_us)
+{
+	if (frame_work >= gov->frame_work)
+		gov->frame_work = frame_work;
+	else
+		gov->frame_work -= (gov->frame_work - frame_work) >> 2;
+
+	if (!gov->frame_period_us)
+		gov->frame_period_us = frame_period_us;
+	else if (frame_period_us >= gov->frame_period_us)
+		gov->frame_period_us += (frame_period_us - gov->frame_period_us) >> 2;
+	else
+		gov->frame_period_us -= (gov->frame_period_us - frame_period_us) >> 2;
+}
+
+/**
+ * gpu_frame_gov_next_step - decide the level for the next window
+ * @gov:	governor state
+ * @sample:	the window that just ended
+ * @step:	current level
+ * @max_step:	level of the highest clock allowed
+ * @min_step:	level of the lowest clock allowed
+ * @mif_step:	returns the level whose MIF floor should be requested
+ *
+ * Returns the next level, between @max_step and @min_step.
+ */
+int gpu_frame_gov_next_step(struct gpu_frame_gov *gov,
+			    const struct gpu_frame_gov_sample *sample,
+			    int step, int max_step, int min_step,
+			    int *mif_step)
+{
+	u32 util = sample->utilization > 100 ? 100 : sample->utilization;
+	u32 headroom = gov->headroom ? gov->headroom : 100;
+	u32 deadline = 0;
+	u64 work, need;
+	int target;
+
+	if (!gov->nr_levels)
+		return step;
+	if (max_step < 0)
+		max_step = 0;
+	if (min_step >= gov->nr_levels)
+		min_step = gov->nr_levels - 1;
+	if (step < max_step)
+		step = max_step;
+	if (step > min_step)
+		step = min_step;
+
+	*mif_step = step;
+	if (!sample->window_us || !sample->clock)
+		return step;
+
+	work = frame_gov_div((u64)util * sample->window_us * sample->clock, 100);
+
+	if (sample->frames) {
+		u64 frame_work = frame_gov_div(work, sample->frames);
+
+		gpu_frame_gov_update(gov, frame_work,
+				     sample->window_us / sample->frames);
+		deadline = gov->target_frame_us ? gov->target_frame_us :
+						  gov->frame_period_us;
+		if (!deadline)
+			deadline = 1;
+
+		gov->frames += sample->frames;
+		if (frame_work > (u64)deadline * sample->clock)
+			gov->late_frames += sample->frames;
+
+		need = frame_gov_div(gov->frame_work * 100,
+				     (u64)deadline * headroom);
+	} else {
+		need = frame_gov_div(work * 100,
+				     (u64)sample->window_us * headroom);
+	}
+
+	/*
+	 * A saturated GPU also stretches the observed frame period, which
+	 * would hide the lack of performance. Always go up one level then.
+	 */
+	if (util >= GPU_FRAME_GOV_SATURATED_UTIL && step > max_step &&
+			need < gov->clock[step - 1])
+		need = gov->clock[step - 1];
+
+	for (target = min_step; target > max_step; target--)
+		if (gov->clock[target] >= need)
+			break;
+
+	if (target < step) {
+		step = target;
+		gov->down_count = 0;
+	} else if (target > step) {
+		if (++gov->down_count >= gov->down_hold) {
+			step = target;
+			gov->down_count = 0;
+		}
+	} else {
+		gov->down_count = 0;
+	}
+
+	*mif_step = step;
+	if (deadline && step > max_step) {
+		u64 busy_us = frame_gov_div(gov->frame_work, gov->clock[step]);
+
+		if (busy_us * 100 > (u64)deadline * (100 - gov->mif_slack))
+			*mif_step = step - 1;
+	}
+
+	return step;
+}
@@ -0,0 +1,98 @@
+/* drivers/gpu/arm/.../platform/gpu_dvfs_frame_gov.h
+ *
+ * Copyright 2011 by S.LSI. Samsung Electronics Inc.
+ * San#24, Nongseo-Dong, Giheung-Gu, Yongin, Korea
+ *
+ * Samsung SoC Mali-T Series DVFS driver
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software FoundatIon.
+ */
+
+/**
+ * @file gpu_dvfs_frame_gov.h
+ * Decision core of the frame governor.
+ *
+ * This file and gpu_dvfs_frame_gov.c must not depend on kbase or on the
+ * exynos platform context: tools/power/mali-dvfs-replay builds them as a
+ * userspace library to replay recorded utilization and frame traces.
+ */
+
+#ifndef _GPU_DVFS_FRAME_GOV_H_
+#define _GPU_DVFS_FRAME_GOV_H_
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+typedef uint32_t u32;
+typedef uint64_t u64;
+#endif
+
+#define GPU_FRAME_GOV_MAX_LEVELS		32
+
+#define GPU_FRAME_GOV_DEFAULT_HEADROOM		85
+#define GPU_FRAME_GOV_DEFAULT_MIF_SLACK		10
+#define GPU_FRAME_GOV_DEFAULT_DOWN_HOLD		2
+#define GPU_FRAME_GOV_SATURATED_UTIL		95
+
+/**
+ * struct gpu_frame_gov_sample - what happened during one DVFS window
+ * @window_us:		length of the window
+ * @utilization:	GPU busy percentage over the window
+ * @frames:		frames completed in the window
+ * @clock:		GPU clock in kHz the window ran at
+ */
+struct gpu_frame_gov_sample {
+	u32 window_us;
+	u32 utilization;
+	u32 frames;
+	u32 clock;
+};
+
+/**
+ * struct gpu_frame_gov - frame governor state
+ * @clock:		clock table in kHz, index 0 is the highest clock
+ * @nr_levels:		number of valid entries in @clock
+ * @target_frame_us:	frame deadline, 0 follows the observed frame period
+ * @headroom:		percentage of the deadline a frame may be busy for
+ * @mif_slack:		deadline slack percentage under which the MIF floor of
+ *			the next higher level is requested
+ * @down_hold:		windows of lower demand needed before lowering clock
+ * @frame_work:		decayed busy work per frame in kHz*us (1000 cycles)
+ * @frame_period_us:	decayed observed frame period
+ * @down_count:		windows lower demand has been seen for
+ * @frames:		frames seen so far
+ * @late_frames:	frames whose busy time exceeded the deadline
+ *
+ * Levels are table indices as in exynos_context.step: a lower index is a
+ * higher clock.
+ */
+struct gpu_frame_gov {
+	u32 clock[GPU_FRAME_GOV_MAX_LEVELS];
+	int nr_levels;
+
+	u32 target_frame_us;
+	u32 headroom;
+	u32 mif_slack;
+	u32 down_hold;
+
+	u64 frame_work;
+	u32 frame_period_us;
+	u32 down_count;
+
+	u64 frames;
+	u64 late_frames;
+};
+
+void gpu_frame_gov_init(struct gpu_frame_gov *gov);
+void gpu_frame_gov_reset(struct gpu_frame_gov *gov);
+int gpu_frame_gov_set_table(struct gpu_frame_gov *gov, const u32 *clock,
+			    int nr_levels);
+int gpu_frame_gov_next_step(struct gpu_frame_gov *gov,
+			    const struct gpu_frame_gov_sample *sample,
+			    int step, int max_step, int min_step,
+			    int *mif_step);
+
+#endif /* _GPU_DVFS_FRAME_GOV_H_ */
@@ -33,6 +33,7 @@ static int gpu_dvfs_governor_interactive(struct exynos_context *platform, int ut
 static int gpu_dvfs_governor_static(struct exynos_context *platform, int utilization);
 static int gpu_dvfs_governor_booster(struct exynos_context *platform, int utilization);
 static int gpu_dvfs_governor_dynamic(struct exynos_context *platform, int utilization);
+static int gpu_dvfs_governor_frame(struct exynos_context *platform, int utilization);
 
 static gpu_dvfs_governor_info governor_info[G3D_MAX_GOVERNOR_NUM] = {
 	{
@@ -65,6 +66,12 @@ static gpu_dvfs_governor_info governor_info[G3D_MAX_GOVERNOR_NUM] = {
 		gpu_dvfs_governor_dynamic,
 		NULL
 	},
+	{
+		G3D_DVFS_GOVERNOR_FRAME,
+		"Frame",
+		gpu_dvfs_governor_frame,
+		NULL
+	},
 };
 
 void gpu_dvfs_update_start_clk(int governor_type, int clk)
@@ -285,6 +292,65 @@ static int gpu_dvfs_governor_dynamic(struct exynos_context *platform, int utiliz
 	return 0;
 }
 
+/*
+ * The frame governor plans a clock per frame from the frames completed in
+ * the last polling window, see gpu_dvfs_frame_gov.c. Frame completions are
+ * counted by gpu_dvfs_frame_done() from the fence signalling path.
+ */
+static int gpu_dvfs_governor_frame(struct exynos_context *platform, int utilization)
+{
+	struct gpu_frame_gov_sample sample;
+	int max_clock_lev = gpu_dvfs_get_level(platform->gpu_max_clock);
+	int min_clock_lev = gpu_dvfs_get_level(platform->gpu_min_clock);
+
+	DVFS_ASSERT(platform);
+
+	if (platform->table[max_clock_lev].clock > platform->gpu_max_clock_limit)
+		max_clock_lev = gpu_dvfs_get_level(platform->gpu_max_clock_limit);
+
+	sample.window_us = platform->polling_speed * USEC_PER_MSEC;
+	sample.utilization = utilization;
+	sample.frames = atomic_xchg(&platform->frame.count, 0);
+	sample.clock = platform->table[platform->step].clock;
+
+	platform->step = gpu_frame_gov_next_step(&platform->frame.gov, &sample,
+			platform->step, max_clock_lev, min_clock_lev,
+			&platform->frame.mif_step);
+	platform->down_requirement = platform->table[platform->step].down_staycount;
+
+	DVFS_ASSERT((platform->step >= max_clock_lev) && (platform->step <= min_clock_lev));
+
+	return 0;
+}
+
+static void gpu_dvfs_frame_governor_setting(struct exynos_context *platform)
+{
+	u32 clock[GPU_FRAME_GOV_MAX_LEVELS];
+	int i, size = min(platform->table_size, GPU_FRAME_GOV_MAX_LEVELS);
+
+	for (i = 0; i < size; i++)
+		clock[i] = platform->table[i].clock;
+
+	if (gpu_frame_gov_set_table(&platform->frame.gov, clock, size) < 0)
+		GPU_LOG(DVFS_WARNING, DUMMY, 0u, 0u, "%s: invalid table size (%d)\n", __func__, platform->table_size);
+
+	atomic_set(&platform->frame.count, 0);
+	platform->frame.mif_step = platform->step;
+}
+
+void gpu_dvfs_frame_done(void *dev)
+{
+	struct kbase_device *kbdev = (struct kbase_device *)dev;
+	struct exynos_context *platform = (struct exynos_context *) kbdev->platform_context;
+
+	if (!platform)
+		return;
+
+	atomic_long_inc(&platform->frame.total);
+	if (platform->governor_type == G3D_DVFS_GOVERNOR_FRAME)
+		atomic_inc(&platform->frame.count);
+}
+
 static int gpu_dvfs_decide_next_governor(struct exynos_context *platform)
 {
 	return 0;
@@ -347,6 +413,9 @@ int gpu_dvfs_governor_setting(struct exynos_context *platform, int governor_type
 	platform->down_requirement = 1;
 	platform->governor_type = governor_type;
 
+	if (governor_type == G3D_DVFS_GOVERNOR_FRAME)
+		gpu_dvfs_frame_governor_setting(platform);
+
 	gpu_dvfs_init_time_in_state();
 #else /* CONFIG_MALI_DVFS */
 	platform->table = (gpu_dvfs_info *)gpu_get_attrib_data(platform->attrib, GPU_GOVERNOR_TABLE_DEFAULT);
@@ -369,6 +438,7 @@ int gpu_dvfs_governor_init(struct kbase_device *kbdev)
 
 #ifdef CONFIG_MALI_DVFS
 	governor_type = platform->governor_type;
+	gpu_frame_gov_init(&platform->frame.gov);
 #endif /* CONFIG_MALI_DVFS */
 	if (gpu_dvfs_governor_setting(platform, governor_type) < 0) {
 		GPU_LOG(DVFS_WARNING, DUMMY, 0u, 0u, "%s: fail to initialize governor\n", __func__);
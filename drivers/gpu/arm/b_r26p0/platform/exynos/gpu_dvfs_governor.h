@@ -24,6 +24,7 @@ typedef enum {
 	G3D_DVFS_GOVERNOR_STATIC,
 	G3D_DVFS_GOVERNOR_BOOSTER,
 	G3D_DVFS_GOVERNOR_DYNAMIC,
+	G3D_DVFS_GOVERNOR_FRAME,
 	G3D_MAX_GOVERNOR_NUM,
 } gpu_governor_type;
 
@@ -34,5 +35,6 @@ void *gpu_dvfs_get_governor_info(void);
 int gpu_dvfs_decide_next_freq(struct kbase_device *kbdev, int utilization);
 int gpu_dvfs_governor_setting(struct exynos_context *platform, int governor_type);
 int gpu_dvfs_governor_init(struct kbase_device *kbdev);
+void gpu_dvfs_frame_done(void *dev);
 
 #endif /* _GPU_DVFS_GOVERNOR_H_ */
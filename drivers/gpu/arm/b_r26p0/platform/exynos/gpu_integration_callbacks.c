@@ -28,6 +28,7 @@
 #if MALI_SEC_PROBE_TEST != 1
 #include <platform/exynos/gpu_integration_defs.h>
 #endif
+#include <platform/exynos/gpu_dvfs_governor.h>
 
 #if defined(CONFIG_SCHED_EMS)
 #include <linux/ems.h>
@@ -697,6 +698,11 @@ struct kbase_vendor_callbacks exynos_callbacks = {
 #else
 	.pm_metrics_init = NULL,
 	.pm_metrics_term = NULL,
+#endif
+#ifdef CONFIG_MALI_DVFS
+	.frame_done = gpu_dvfs_frame_done,
+#else
+	.frame_done = NULL,
 #endif
 	.debug_pagetable_info = gpu_debug_pagetable_info,
 	.mem_profile_check_kctx = gpu_mem_profile_check_kctx,
@@ -54,6 +54,7 @@ struct kbase_vendor_callbacks {
 	int (*init_hw)(void *dev);
 	void (*debug_pagetable_info)(void *ctx, u64 vaddr);
 	void (*jd_done_worker)(void *dev);
+	void (*frame_done)(void *dev);
 	void (*update_status)(void *dev, char *str, u32 val);
 	bool (*mem_profile_check_kctx)(void *ctx);
 	int (*register_dump)(void);
@@ -21,6 +21,7 @@
 
 #include "mali_kbase_platform.h"
 #include "gpu_dvfs_handler.h"
+#include "gpu_dvfs_governor.h"
 
 #if defined(PM_QOS_CLUSTER2_FREQ_MAX_DEFAULT_VALUE)
 #define PM_QOS_CPU_CLUSTER_NUM 3
@@ -110,6 +111,13 @@ int gpu_pm_qos_command(struct exynos_context *platform, gpu_pmqos_state state)
 			return -ENOENT;
 		}
 		KBASE_DEBUG_ASSERT(platform->step >= 0);
+#ifdef CONFIG_MALI_DVFS
+		/* the frame governor raises the MIF floor when a frame is tight */
+		if (platform->governor_type == G3D_DVFS_GOVERNOR_FRAME)
+			pm_qos_update_request(&exynos5_g3d_mif_min_qos,
+					platform->table[platform->frame.mif_step].mem_freq);
+		else
+#endif
 		pm_qos_update_request(&exynos5_g3d_mif_min_qos, platform->table[platform->step].mem_freq);
 		if (platform->pmqos_mif_max_clock &&
 				(platform->table[platform->step].clock >= platform->pmqos_mif_max_clock_base))
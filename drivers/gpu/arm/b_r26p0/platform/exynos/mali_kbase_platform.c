@@ -269,6 +269,8 @@ static int gpu_dvfs_update_config_data_from_dt(struct kbase_device *kbdev)
 		platform->governor_type = G3D_DVFS_GOVERNOR_BOOSTER;
 	} else if (!strncmp("dynamic", of_string, strlen("dynamic"))) {
 		platform->governor_type = G3D_DVFS_GOVERNOR_DYNAMIC;
+	} else if (!strncmp("frame", of_string, strlen("frame"))) {
+		platform->governor_type = G3D_DVFS_GOVERNOR_FRAME;
 	} else {
 		platform->governor_type = G3D_DVFS_GOVERNOR_DEFAULT;
 	}
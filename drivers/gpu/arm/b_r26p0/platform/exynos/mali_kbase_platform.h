@@ -20,6 +20,8 @@
 
 #include <soc/samsung/exynos-pd.h>
 
+#include "gpu_dvfs_frame_gov.h"
+
 #ifdef CONFIG_MALI_EXYNOS_TRACE
 #define GPU_LOG(level, code, gpu_addr, info_val, msg, args...) \
 do { \
@@ -212,6 +214,14 @@ struct exynos_context {
 		int eureka_gpu_highspeed_clock;
 		int eureka_gpu_highspeed_load;
 	} interactive;
+
+	/* For the frame governor */
+	struct {
+		struct gpu_frame_gov gov;
+		atomic_t count;
+		atomic_long_t total;
+		int mif_step;
+	} frame;
 #ifdef CONFIG_CPU_THERMAL_IPA
 	int norm_utilisation;
 	int freq_for_normalisation;
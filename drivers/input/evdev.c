@@ -60,6 +60,11 @@ struct evdev_client {
 	unsigned int clk_type;
 	bool revoked;
 	unsigned long *evmasks[EV_CNT];
+	struct input_event_ring *ring; /* replaces buffer after EVIOCSRING */
+	unsigned int ring_size;
+	unsigned int ring_head; /* next slot the kernel fills */
+	unsigned int ring_packet_head; /* head last published to the client */
+	bool ring_dropped; /* SYN_DROPPED owed to the client */
 	unsigned int bufsize;
 	struct input_event buffer[];
 };
@@ -118,6 +123,10 @@ static void __evdev_flush_queue(struct evdev_client *client, unsigned int type)
 
 	BUG_ON(type == EV_SYN);
 
+	/* events in the ring already belong to the client */
+	if (client->ring)
+		return;
+
 	head = client->tail;
 	client->packet_head = client->tail;
 
@@ -154,6 +163,60 @@ static void __evdev_flush_queue(struct evdev_client *client, unsigned int type)
 	client->head = head;
 }
 
+static inline struct input_ring_event *
+evdev_ring_slot(struct evdev_client *client, unsigned int pos)
+{
+	return (void *)client->ring + INPUT_RING_DATA_OFFSET +
+		(pos & (client->ring_size - 1)) * sizeof(struct input_ring_event);
+}
+
+/*
+ * tail is written by the client. Anything it puts there only makes the
+ * ring look full, as long as it is only used for this check.
+ */
+static bool evdev_ring_full(struct evdev_client *client, unsigned int needed)
+{
+	unsigned int used = client->ring_head -
+			    smp_load_acquire(&client->ring->tail);
+
+	return used > client->ring_size - needed;
+}
+
+static void __evdev_ring_put(struct evdev_client *client,
+			     const struct input_event *event)
+{
+	struct input_ring_event *slot =
+		evdev_ring_slot(client, client->ring_head++);
+
+	slot->sec = event->time.tv_sec;
+	slot->usec = event->time.tv_usec;
+	slot->type = event->type;
+	slot->code = event->code;
+	slot->value = event->value;
+}
+
+static void evdev_ring_publish(struct evdev_client *client)
+{
+	client->ring_packet_head = client->ring_head;
+	/* pairs with the client's load-acquire of head */
+	smp_store_release(&client->ring->head, client->ring_head);
+}
+
+static void __evdev_ring_queue_syn_dropped(struct evdev_client *client,
+					   const struct input_event *ev)
+{
+	/* drop the partial packet, the client cannot tell where it started */
+	client->ring_head = client->ring_packet_head;
+
+	if (evdev_ring_full(client, 1)) {
+		client->ring_dropped = true;
+		return;
+	}
+
+	__evdev_ring_put(client, ev);
+	evdev_ring_publish(client);
+}
+
 static void __evdev_queue_syn_dropped(struct evdev_client *client)
 {
 	struct input_event ev;
@@ -170,6 +233,11 @@ static void __evdev_queue_syn_dropped(struct evdev_client *client)
 	ev.code = SYN_DROPPED;
 	ev.value = 0;
 
+	if (client->ring) {
+		__evdev_ring_queue_syn_dropped(client, &ev);
+		return;
+	}
+
 	client->buffer[client->head++] = ev;
 	client->head &= client->bufsize - 1;
 
@@ -218,7 +286,9 @@ static int evdev_set_clk_type(struct evdev_client *client, unsigned int clkid)
 		 */
 		spin_lock_irqsave(&client->buffer_lock, flags);
 
-		if (client->head != client->tail) {
+		if (client->ring) {
+			__evdev_queue_syn_dropped(client);
+		} else if (client->head != client->tail) {
 			client->packet_head = client->head = client->tail;
 			__evdev_queue_syn_dropped(client);
 		}
@@ -256,6 +326,49 @@ static void __pass_event(struct evdev_client *client,
 	}
 }
 
+static void __pass_ring_event(struct evdev_client *client,
+			      const struct input_event *event)
+{
+	if (unlikely(client->ring_dropped)) {
+		if (evdev_ring_full(client, 2)) {
+			client->ring->dropped++;
+			return;
+		}
+
+		client->ring_dropped = false;
+		__evdev_ring_queue_syn_dropped(client, &(struct input_event) {
+			.time = event->time,
+			.type = EV_SYN,
+			.code = SYN_DROPPED,
+		});
+	} else if (unlikely(evdev_ring_full(client, 1))) {
+		/*
+		 * Unlike with the buffer nothing queued can be dropped, the
+		 * client owns it. Drop the packet being delivered instead.
+		 */
+		client->ring->dropped += client->ring_head -
+					 client->ring_packet_head + 1;
+		client->ring_head = client->ring_packet_head;
+		client->ring_dropped = true;
+		return;
+	}
+
+	__evdev_ring_put(client, event);
+
+	if (event->type == EV_SYN && event->code == SYN_REPORT) {
+		evdev_ring_publish(client);
+		kill_fasync(&client->fasync, SIGIO, POLL_IN);
+	}
+}
+
+static bool evdev_packet_empty(struct evdev_client *client)
+{
+	if (client->ring)
+		return client->ring_packet_head == client->ring_head;
+
+	return client->packet_head == client->head;
+}
+
 static void evdev_pass_values(struct evdev_client *client,
 			const struct input_value *vals, unsigned int count,
 			ktime_t *ev_time)
@@ -279,7 +392,7 @@ static void evdev_pass_values(struct evdev_client *client,
 
 		if (v->type == EV_SYN && v->code == SYN_REPORT) {
 			/* drop empty SYN_REPORT */
-			if (client->packet_head == client->head)
+			if (evdev_packet_empty(client))
 				continue;
 
 			wakeup = true;
@@ -288,7 +401,10 @@ static void evdev_pass_values(struct evdev_client *client,
 		event.type = v->type;
 		event.code = v->code;
 		event.value = v->value;
-		__pass_event(client, &event);
+		if (client->ring)
+			__pass_ring_event(client, &event);
+		else
+			__pass_event(client, &event);
 	}
 
 	spin_unlock(&client->buffer_lock);
@@ -468,6 +584,7 @@ static int evdev_release(struct inode *inode, struct file *file)
 	for (i = 0; i < EV_CNT; ++i)
 		kfree(client->evmasks[i]);
 
+	vfree(client->ring);
 	kvfree(client);
 
 	evdev_close_device(evdev);
@@ -586,6 +703,9 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 	if (count != 0 && count < input_event_size())
 		return -EINVAL;
 
+	if (client->ring)
+		return -EINVAL;
+
 	for (;;) {
 		if (!evdev->exist || client->revoked)
 			return -ENODEV;
@@ -630,6 +750,7 @@ static unsigned int evdev_poll(struct file *file, poll_table *wait)
 {
 	struct evdev_client *client = file->private_data;
 	struct evdev *evdev = client->evdev;
+	struct input_event_ring *ring = READ_ONCE(client->ring);
 	unsigned int mask;
 
 	poll_wait(file, &evdev->wait, wait);
@@ -639,12 +760,64 @@ static unsigned int evdev_poll(struct file *file, poll_table *wait)
 	else
 		mask = POLLHUP | POLLERR;
 
-	if (client->packet_head != client->tail)
+	if (ring) {
+		if (READ_ONCE(ring->head) != READ_ONCE(ring->tail))
+			mask |= POLLIN | POLLRDNORM;
+	} else if (client->packet_head != client->tail) {
 		mask |= POLLIN | POLLRDNORM;
+	}
 
 	return mask;
 }
 
+static int evdev_enable_ring(struct evdev_client *client,
+			     unsigned int nr_events)
+{
+	struct input_event_ring *ring;
+	unsigned int size;
+
+	if (client->ring)
+		return -EBUSY;
+
+	if (!nr_events || nr_events > INPUT_RING_MAX_EVENTS)
+		return -EINVAL;
+
+	size = roundup_pow_of_two(max(nr_events, EVDEV_MIN_BUFFER_SIZE));
+	ring = vmalloc_user(INPUT_RING_DATA_OFFSET +
+			    size * sizeof(struct input_ring_event));
+	if (!ring)
+		return -ENOMEM;
+
+	ring->version = INPUT_RING_VERSION;
+	ring->size = size;
+	ring->event_size = sizeof(struct input_ring_event);
+	ring->data_offset = INPUT_RING_DATA_OFFSET;
+
+	spin_lock_irq(&client->buffer_lock);
+
+	/* events still in the buffer are not carried over */
+	client->ring_dropped = client->head != client->tail;
+	client->packet_head = client->head = client->tail;
+
+	client->ring_size = size;
+	client->ring = ring;
+
+	spin_unlock_irq(&client->buffer_lock);
+
+	return 0;
+}
+
+static int evdev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct evdev_client *client = file->private_data;
+	struct input_event_ring *ring = READ_ONCE(client->ring);
+
+	if (!ring || vma->vm_pgoff)
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, ring, 0);
+}
+
 #ifdef CONFIG_COMPAT
 
 #define BITS_PER_LONG_COMPAT (sizeof(compat_long_t) * 8)
@@ -1104,6 +1277,12 @@ static long evdev_do_ioctl(struct file *file, unsigned int cmd,
 			return -EFAULT;
 		return 0;
 
+	case EVIOCSRING:
+		if (get_user(u, ip))
+			return -EFAULT;
+
+		return evdev_enable_ring(client, u);
+
 	case EVIOCGRAB:
 		if (p)
 			return evdev_grab(evdev, client);
@@ -1315,6 +1494,7 @@ static const struct file_operations evdev_fops = {
 	.read		= evdev_read,
 	.write		= evdev_write,
 	.poll		= evdev_poll,
+	.mmap		= evdev_mmap,
 	.open		= evdev_open,
 	.release	= evdev_release,
 	.unlocked_ioctl	= evdev_ioctl,
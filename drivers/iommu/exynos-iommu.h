@@ -371,6 +371,8 @@ struct exynos_iovmm {
 	int num_areas;
 	unsigned int num_map;
 	unsigned int num_unmap;
+	unsigned int num_map_hit;	/* reused mappings of cached buffers */
+	unsigned int num_map_miss;	/* mappings created for cached buffers */
 	const char *domain_name;
 	struct iommu_group *group;
 };
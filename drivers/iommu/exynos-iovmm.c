@@ -262,6 +262,21 @@ struct iommu_domain *get_domain_from_dev(struct device *dev)
 	return vmm->domain;
 }
 
+void iovmm_account_map_cache(struct device *dev, bool hit)
+{
+	struct exynos_iovmm *vmm = exynos_get_iovmm(dev);
+
+	if (!vmm)
+		return;
+
+	spin_lock(&vmm->vmlist_lock);
+	if (hit)
+		vmm->num_map_hit++;
+	else
+		vmm->num_map_miss++;
+	spin_unlock(&vmm->vmlist_lock);
+}
+
 /* iovmm_map - allocate and map IO virtual memory for the given device
  * dev: device that has IO virtual address space managed by IOVMM
  * sg: list of physically contiguous memory chunks. The preceding chunk needs to
@@ -698,6 +713,8 @@ static int iovmm_debug_show(struct seq_file *s, void *unused)
 	seq_puts(s, "---------------------------------------------\n");
 	seq_printf(s, "Total number of mappings  : %d\n", vmm->num_map);
 	seq_printf(s, "Total number of unmappings: %d\n", vmm->num_unmap);
+	seq_printf(s, "Mapping cache hits        : %u\n", vmm->num_map_hit);
+	seq_printf(s, "Mapping cache misses      : %u\n", vmm->num_map_miss);
 	spin_unlock(&vmm->vmlist_lock);
 
 	return 0;
@@ -717,6 +734,8 @@ static ssize_t iovmm_debug_write(struct file *filp, const char __user *p,
 	spin_lock(&vmm->vmlist_lock);
 	vmm->num_map = 0;
 	vmm->num_unmap = 0;
+	vmm->num_map_hit = 0;
+	vmm->num_map_miss = 0;
 	spin_unlock(&vmm->vmlist_lock);
 	return len;
 }
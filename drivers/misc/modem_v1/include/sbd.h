@@ -35,6 +35,7 @@
 
 #include "link_device_memory_config.h"
 #include "circ_queue.h"
+#include "sbd_rx_pool.h"
 
 /*
 Abbreviations
@@ -431,6 +432,11 @@ struct sbd_link_device {
 	unsigned long rxdone_mask;
 
 	bool reset_zerocopy_done;
+
+	/*
+	Page pool backing the skbs of the PS DL RBs, used from the NAPI poll
+	*/
+	struct sbd_rx_pool rx_pool;
 };
 
 static inline void sbd_activate(struct sbd_link_device *sl)
@@ -596,6 +602,8 @@ int init_sbd_link(struct sbd_link_device *sl);
 
 int sbd_pio_tx(struct sbd_ring_buffer *rb, struct sk_buff *skb);
 struct sk_buff *sbd_pio_rx(struct sbd_ring_buffer *rb);
+int sbd_pio_rx_batch(struct sbd_ring_buffer *rb, unsigned int budget,
+		     struct sk_buff_head *list);
 
 #define SBD_UL_LIMIT		16	/* Uplink burst limit */
 
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2019 Samsung Electronics.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef __MODEM_INCLUDE_SBD_RX_POOL_H__
+#define __MODEM_INCLUDE_SBD_RX_POOL_H__
+
+/**
+@file		sbd_rx_pool.h
+@brief		recycled page pool backing the SBD downlink skbs
+
+Downlink packets are copied out of their SBD slot into fragments of pool
+pages and attached to skbs as page frags, so that the slot can be
+returned to CP right away while the skbs travel up the stack. Pages are
+used round robin. A page whose fragments have all been freed by the
+stack (only the pool's reference left) is carved again instead of being
+given back to the page allocator.
+
+The pool has no lock: it is used only from the NAPI poll of the link.
+
+It also builds outside of the kernel, for tools/modem/sbd-fake-cp, which
+provides the few page helpers it uses.
+*/
+
+#ifdef __KERNEL__
+#include <linux/mm.h>
+#include <linux/skbuff.h>
+#else
+#include "page_shim.h"
+#endif
+
+/* bytes copied to the linear part of an skb, the rest goes to a frag */
+#define SBD_RX_HDR_LEN		128
+
+struct sbd_rx_pool {
+	struct page **pages;
+	unsigned int nr_pages;		/* a power of 2 */
+	unsigned int idx;		/* page being carved */
+	unsigned int offset;		/* in pages[idx] */
+
+	/* statistics */
+	unsigned long frags;
+	unsigned long recycled;		/* pages carved again */
+	unsigned long allocated;	/* pages taken from the allocator */
+	unsigned long busy;		/* pages still held by the stack */
+	unsigned long failed;		/* allocation failures */
+};
+
+static inline unsigned int sbd_rx_pool_truesize(unsigned int len)
+{
+	return ALIGN(len, SMP_CACHE_BYTES);
+}
+
+int sbd_rx_pool_init(struct sbd_rx_pool *pool, unsigned int nr_pages);
+void sbd_rx_pool_destroy(struct sbd_rx_pool *pool);
+struct page *sbd_rx_pool_get(struct sbd_rx_pool *pool, unsigned int len,
+			     unsigned int *offset);
+
+static inline bool sbd_rx_pool_enabled(struct sbd_rx_pool *pool)
+{
+	return pool->nr_pages > 0;
+}
+
+#endif
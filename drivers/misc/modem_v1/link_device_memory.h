@@ -186,6 +186,42 @@ struct mem_ipc_device {
 #define TXQ_STOP_MASK			(0x1<<0)
 #define TX_SUSPEND_MASK			(0x1<<1)
 #define SHM_FLOWCTL_BIT			BIT(2)
+
+#define TX_COAL_MAX_DELAY_US		1000	/* 1 ms, as TX_PERIOD_MS */
+#define TX_COAL_MIN_FRAMES		4
+#define TX_COAL_MAX_FRAMES		64
+#define TX_COAL_HIST			6	/* 1, 2-3, 4-7, ..., 32+ */
+
+/*
+ * Adaptive coalescing of the SBD uplink: frames of the bulk PS RBs are
+ * held in their skb_q for at most @max_delay_us, or until @target frames
+ * are pending, and then written to the RBs by sbd_tx_timer_func() with one
+ * doorbell for all of them. Frames of the other RBs are sent at once.
+ */
+struct shmem_tx_coal {
+	spinlock_t lock;
+
+	unsigned int enable;
+	unsigned int max_delay_us;
+
+	unsigned int target;		/* frames per doorbell aimed at */
+	unsigned int pending;		/* frames queued since the last doorbell */
+	u64 first_ns;			/* when the oldest of them was queued */
+	u64 last_xmit_ns;
+	u32 gap_ns;			/* average gap between two frames */
+
+	u32 cp_rate;			/* frames per second taken by CP */
+	unsigned int inflight;		/* frames left in the RBs at the last flush */
+	u64 last_flush_ns;
+
+	/* statistics */
+	u64 doorbells;
+	u64 frames;
+	u64 urgent;			/* doorbells rung at once */
+	u64 delay_ns;			/* sum of the delay of the oldest frames */
+	u64 max_delay_ns;
+	u64 hist[TX_COAL_HIST];		/* doorbells by frames per doorbell */
+};
 #endif
 
 #ifdef GROUP_MEM_CP_CRASH
@@ -494,6 +530,7 @@ struct mem_link_device {
 	struct dentry *dbgfs_frame;
 #endif
 	unsigned int tx_period_ms;
+	struct shmem_tx_coal tx_coal;
 	unsigned int force_use_memcpy;
 	unsigned int memcpy_packet_count;
 	unsigned int zeromemcpy_packet_count;
@@ -505,6 +542,7 @@ struct mem_link_device {
 	unsigned int rx_int_count;
 	unsigned int rx_poll_count;
 	unsigned long long rx_int_disabled_time;
+	bool rx_batch;		/* delivering a batch, GRO flushed after it */
 #endif /* CONFIG_LINK_DEVICE_NAPI */
 #ifdef CONFIG_MODEM_IF_NET_GRO
 	struct timespec flush_time;
@@ -32,6 +32,11 @@
 @{
 */
 
+/* pages in the DL page pool, 0 copies every packet to its own skb */
+static unsigned int sbd_rx_pool_pages = 256;
+module_param(sbd_rx_pool_pages, uint, 0444);
+MODULE_PARM_DESC(sbd_rx_pool_pages, "pages backing the PS downlink skbs");
+
 #ifdef GROUP_MEM_LINK_SETUP
 /**
 @weakgroup group_mem_link_setup
@@ -477,6 +482,11 @@ int create_sbd_link_device(struct link_device *ld, struct sbd_link_device *sl,
 
 	sl->reset_zerocopy_done = 1;
 
+#ifdef CONFIG_LINK_DEVICE_NAPI
+	if (sbd_rx_pool_init(&sl->rx_pool, sbd_rx_pool_pages))
+		mif_err("%s: ERR! no DL page pool, copying\n", ld->name);
+#endif
+
 	return 0;
 }
 
@@ -606,10 +616,57 @@ static inline struct sk_buff *recv_data(struct sbd_ring_buffer *rb, u16 out)
 	return skb;
 }
 
-static inline void set_skb_priv(struct sbd_ring_buffer *rb, struct sk_buff *skb)
+/*
+Copy a PS packet longer than SBD_RX_HDR_LEN to a page of the DL pool, and
+only its headers to the linear part, where the IOD and the stack look for
+them.
+*/
+static inline struct sk_buff *recv_frag(struct sbd_ring_buffer *rb, u16 out)
 {
-	unsigned int out = *rb->rp;
+	struct sbd_rx_pool *pool = &rb->sl->rx_pool;
+	unsigned int len = rb->size_v[out] & 0xFFFF;
+	unsigned int space = (rb->buff_size - rb->payload_offset);
+	unsigned int offset;
+	struct sk_buff *skb;
+	struct page *page;
+	u8 *src;
+
+	if (!sbd_rx_pool_enabled(pool) || rb->lnk_hdr || len <= SBD_RX_HDR_LEN)
+		return recv_data(rb, out);
 
+	if (unlikely(len > space)) {
+		mif_err("ERR! {id:%d ch:%d} size %d > space %d\n",
+			rb->id, rb->ch, len, space);
+		return NULL;
+	}
+
+	page = sbd_rx_pool_get(pool, len - SBD_RX_HDR_LEN, &offset);
+	if (unlikely(!page))
+		return recv_data(rb, out);
+
+	skb = dev_alloc_skb(SBD_RX_HDR_LEN);
+	if (unlikely(!skb)) {
+		put_page(page);
+		mif_err("ERR! {id:%d ch:%d} alloc_skb(%d) fail\n",
+			rb->id, rb->ch, SBD_RX_HDR_LEN);
+		return NULL;
+	}
+
+	src = rb->buff[out] + rb->payload_offset;
+	skb_put(skb, SBD_RX_HDR_LEN);
+	skb_copy_to_linear_data(skb, src, SBD_RX_HDR_LEN);
+
+	memcpy(page_address(page) + offset, src + SBD_RX_HDR_LEN,
+	       len - SBD_RX_HDR_LEN);
+	skb_add_rx_frag(skb, 0, page, offset, len - SBD_RX_HDR_LEN,
+			sbd_rx_pool_truesize(len - SBD_RX_HDR_LEN));
+
+	return skb;
+}
+
+static inline void set_skb_priv(struct sbd_ring_buffer *rb, struct sk_buff *skb,
+				unsigned int out)
+{
 	/* Record the IO device, the link device, etc. into &skb->cb */
 	if (sipc_ps_ch(rb->ch)) {
 		unsigned ch = (rb->size_v[out] >> 16) & 0xff;
@@ -640,7 +697,7 @@ struct sk_buff *sbd_pio_rx(struct sbd_ring_buffer *rb)
 
 	set_lnk_hdr(rb, skb);
 
-	set_skb_priv(rb, skb);
+	set_skb_priv(rb, skb, out);
 
 	check_more(rb, skb);
 
@@ -649,6 +706,57 @@ struct sk_buff *sbd_pio_rx(struct sbd_ring_buffer *rb)
 	return skb;
 }
 
+/**
+@brief		receive up to @budget frames from a DL RB at once
+
+Frames are queued on @list, and their slots are given back to CP with a
+single update of the RP once all of them have been copied out, instead of
+one update of the shared RP per frame.
+
+@return		the number of frames queued on @list
+*/
+int sbd_pio_rx_batch(struct sbd_ring_buffer *rb, unsigned int budget,
+		     struct sk_buff_head *list)
+{
+	unsigned int qlen = rb->len;
+	unsigned int in = *rb->wp;
+	unsigned int out = *rb->rp;
+	unsigned int num_frames;
+	int rcvd = 0;
+
+	if (unlikely(!circ_valid(qlen, in, out))) {
+		mif_err("ERR! RXQ[%d:%d] DIRTY (qlen:%d in:%d out:%d)\n",
+			rb->id, rb->ch, qlen, in, out);
+		return -EIO;
+	}
+
+	num_frames = min(circ_get_usage(qlen, in, out), budget);
+
+	while (rcvd < num_frames) {
+		struct sk_buff *skb;
+
+		skb = recv_frag(rb, out);
+		if (unlikely(!skb))
+			break;
+
+		set_lnk_hdr(rb, skb);
+		set_skb_priv(rb, skb, out);
+		check_more(rb, skb);
+
+		__skb_queue_tail(list, skb);
+		out = circ_new_ptr(qlen, out, 1);
+		rcvd++;
+	}
+
+	if (rcvd) {
+		/* The slots must be read before CP can reuse them */
+		mb();
+		*rb->rp = out;
+	}
+
+	return rcvd;
+}
+
 /**
 @}
 */
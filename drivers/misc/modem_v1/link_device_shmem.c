@@ -986,7 +986,147 @@ static inline void cancel_datalloc_timer(struct mem_link_device *mld)
 
 }
 
-static int tx_frames_to_rb(struct sbd_ring_buffer *rb)
+static void start_sbd_tx_timer(struct mem_link_device *mld, u64 delay_ns)
+{
+	struct hrtimer *timer = &mld->sbd_tx_timer;
+	struct modem_ctl *mc = mld->link_dev.mc;
+	unsigned long flags;
+
+	spin_lock_irqsave(&mc->lock, flags);
+
+	if (unlikely(cp_offline(mc)))
+		goto exit;
+
+	/* Never push back an expiry that is already queued */
+	if (!hrtimer_is_queued(timer) ||
+	    ktime_to_ns(hrtimer_get_remaining(timer)) > delay_ns)
+		hrtimer_start(timer, ns_to_ktime(delay_ns), HRTIMER_MODE_REL);
+
+exit:
+	spin_unlock_irqrestore(&mc->lock, flags);
+}
+
+/* Control, RFS and high priority PS frames do not wait for a batch */
+static inline bool tx_coal_urgent(struct sbd_ring_buffer *rb)
+{
+	return rb->ch != QOS_NORMAL;
+}
+
+static void tx_coal_queue(struct mem_link_device *mld,
+			  struct sbd_ring_buffer *rb)
+{
+	struct shmem_tx_coal *tc = &mld->tx_coal;
+	u64 now = ktime_get_ns();
+	u64 max_delay_ns, delay_ns;
+	unsigned long flags;
+
+	spin_lock_irqsave(&tc->lock, flags);
+
+	max_delay_ns = (u64)tc->max_delay_us * NSEC_PER_USEC;
+
+	if (tc->last_xmit_ns)
+		tc->gap_ns = ((u64)tc->gap_ns * 7 +
+			      min(now - tc->last_xmit_ns, 2 * max_delay_ns)) >> 3;
+	tc->last_xmit_ns = now;
+
+	if (!tc->pending++)
+		tc->first_ns = now;
+
+	if (!tc->enable) {
+		delay_ns = (u64)mld->tx_period_ms * NSEC_PER_MSEC;
+	} else if (tx_coal_urgent(rb)) {
+		tc->urgent++;
+		delay_ns = 0;
+	} else if (tc->pending >= tc->target || tc->gap_ns >= max_delay_ns) {
+		/* The batch is complete, or no other frame is coming soon */
+		delay_ns = 0;
+	} else {
+		delay_ns = now - tc->first_ns < max_delay_ns ?
+			   tc->first_ns + max_delay_ns - now : 0;
+	}
+
+	spin_unlock_irqrestore(&tc->lock, flags);
+
+	start_sbd_tx_timer(mld, delay_ns);
+}
+
+static unsigned int tx_coal_inflight(struct sbd_link_device *sl)
+{
+	unsigned int inflight = 0;
+	int i;
+
+	for (i = 0; i < sl->num_channels; i++)
+		inflight += rb_usage(sbd_id2rb(sl, i, TX));
+
+	return inflight;
+}
+
+/*
+ * Account a run of sbd_tx_timer_func() that found @backlog frames not yet
+ * taken by CP, wrote @frames more and left @inflight in the RBs and @left
+ * in the skb queues. The frames CP took since the last run give its rate,
+ * which sets the size of the next batch: what CP takes in half the delay
+ * allowed, so that it is still busy with one batch while the next fills.
+ */
+static void tx_coal_flushed(struct mem_link_device *mld, unsigned int backlog,
+			    unsigned int frames, unsigned int inflight,
+			    unsigned int left, bool doorbell)
+{
+	struct shmem_tx_coal *tc = &mld->tx_coal;
+	u64 now = ktime_get_ns();
+	unsigned long flags;
+
+	spin_lock_irqsave(&tc->lock, flags);
+
+	if (tc->inflight && now > tc->last_flush_ns) {
+		unsigned int taken = tc->inflight > backlog ?
+				     tc->inflight - backlog : 0;
+		u32 rate = div64_u64((u64)taken * NSEC_PER_SEC,
+				     now - tc->last_flush_ns);
+
+		/* CP idled once it had taken all, so the rate is a floor */
+		if (backlog || rate > tc->cp_rate)
+			tc->cp_rate = ((u64)tc->cp_rate * 3 + rate) >> 2;
+
+		tc->target = clamp_t(u64, div_u64((u64)tc->cp_rate *
+						  tc->max_delay_us,
+						  2 * USEC_PER_SEC),
+				     TX_COAL_MIN_FRAMES, TX_COAL_MAX_FRAMES);
+	}
+	tc->inflight = inflight;
+	tc->last_flush_ns = now;
+
+	if (doorbell && frames) {
+		u64 delay = tc->pending ? now - tc->first_ns : 0;
+
+		tc->doorbells++;
+		tc->frames += frames;
+		tc->hist[min_t(int, ilog2(frames), TX_COAL_HIST - 1)]++;
+		tc->delay_ns += delay;
+		if (delay > tc->max_delay_ns)
+			tc->max_delay_ns = delay;
+
+		/* frames left behind keep their age */
+		tc->pending = left;
+	}
+
+	spin_unlock_irqrestore(&tc->lock, flags);
+}
+
+static void tx_coal_reset(struct mem_link_device *mld)
+{
+	struct shmem_tx_coal *tc = &mld->tx_coal;
+	unsigned long flags;
+
+	spin_lock_irqsave(&tc->lock, flags);
+	tc->pending = 0;
+	tc->inflight = 0;
+	tc->last_xmit_ns = 0;
+	tc->gap_ns = 0;
+	spin_unlock_irqrestore(&tc->lock, flags);
+}
+
+static int tx_frames_to_rb(struct sbd_ring_buffer *rb, unsigned int *frames)
 {
 	struct sk_buff_head *skb_txq = &rb->skb_q;
 	int tx_bytes = 0;
@@ -1007,6 +1147,7 @@ static int tx_frames_to_rb(struct sbd_ring_buffer *rb)
 		}
 
 		tx_bytes += ret;
+		(*frames)++;
 #ifdef DEBUG_MODEM_IF_LINK_TX
 		mif_pkt(rb->ch, "LNK-TX", skb);
 #endif
@@ -1023,6 +1164,7 @@ static enum hrtimer_restart sbd_tx_timer_func(struct hrtimer *timer)
 	struct link_device *ld = &mld->link_dev;
 	struct modem_ctl *mc = ld->mc;
 	struct sbd_link_device *sl = &mld->sbd_link_dev;
+	unsigned int backlog, frames = 0, left = 0;
 	int i;
 	bool need_schedule = false;
 	u16 mask = 0;
@@ -1044,6 +1186,8 @@ static enum hrtimer_restart sbd_tx_timer_func(struct hrtimer *timer)
 	}
 #endif
 
+	backlog = tx_coal_inflight(sl);
+
 	for (i = 0; i < sl->num_channels; i++) {
 		struct sbd_ring_buffer *rb = sbd_id2rb(sl, i, TX);
 		int ret;
@@ -1064,7 +1208,8 @@ static enum hrtimer_restart sbd_tx_timer_func(struct hrtimer *timer)
 			}
 		}
 
-		ret = tx_frames_to_rb(rb);
+		ret = tx_frames_to_rb(rb, &frames);
+		left += skb_queue_len(&rb->skb_q);
 		if (unlikely(ret < 0)) {
 			if (ret == -EBUSY || ret == -ENOSPC) {
 				need_schedule = true;
@@ -1109,11 +1254,12 @@ static enum hrtimer_restart sbd_tx_timer_func(struct hrtimer *timer)
 		spin_unlock_irqrestore(&mc->lock, flags);
 	}
 
+	tx_coal_flushed(mld, backlog, frames, tx_coal_inflight(sl), left,
+			mask != 0);
+
 exit:
-	if (need_schedule) {
-		ktime_t ktime = ktime_set(0, mld->tx_period_ms * NSEC_PER_MSEC);
-		hrtimer_start(timer, ktime, HRTIMER_MODE_REL);
-	}
+	if (need_schedule)
+		start_sbd_tx_timer(mld, (u64)mld->tx_period_ms * NSEC_PER_MSEC);
 
 	return HRTIMER_NORESTART;
 }
@@ -1186,7 +1332,7 @@ static int xmit_ipc_to_rb(struct mem_link_device *mld, enum sipc_ch_id ch,
 
 		ret = skb->len;
 		skb_queue_tail(skb_txq, skb);
-		start_tx_timer(mld, &mld->sbd_tx_timer);
+		tx_coal_queue(mld, rb);
 	}
 
 	spin_unlock_irqrestore(&rb->lock, flags);
@@ -1678,6 +1824,41 @@ static int rx_net_frames_from_zerocopy_adaptor(struct sbd_ring_buffer *rb,
 	return rcvd;
 }
 
+#ifdef CONFIG_LINK_DEVICE_NAPI
+/*
+ * Take the frames out of the RB in one batch, returning their slots to CP
+ * at once, then hand them to the IODs with GRO flushed once per batch
+ * rather than once per frame.
+ */
+static int rx_net_frames_batch(struct sbd_ring_buffer *rb, int budget,
+		int *work_done)
+{
+	struct link_device *ld = rb->ld;
+	struct mem_link_device *mld = ld_to_mem_link_device(ld);
+	struct sk_buff_head list;
+	struct sk_buff *skb;
+	int rcvd;
+
+	__skb_queue_head_init(&list);
+
+	rcvd = sbd_pio_rx_batch(rb, budget, &list);
+	if (rcvd <= 0)
+		return rcvd;
+
+	mld->rx_batch = true;
+	while ((skb = __skb_dequeue(&list)))
+		pass_skb_to_net(mld, skb);
+	mld->rx_batch = false;
+
+	if (ld->gro_flush)
+		ld->gro_flush(ld);
+
+	*work_done = rcvd;
+
+	return rcvd;
+}
+#endif /* CONFIG_LINK_DEVICE_NAPI */
+
 static int rx_net_frames_from_rb(struct sbd_ring_buffer *rb, int budget,
 		int *work_done)
 {
@@ -1687,6 +1868,9 @@ static int rx_net_frames_from_rb(struct sbd_ring_buffer *rb, int budget,
 	unsigned int num_frames;
 
 #ifdef CONFIG_LINK_DEVICE_NAPI
+	if (sbd_rx_pool_enabled(&mld->sbd_link_dev.rx_pool))
+		return rx_net_frames_batch(rb, budget, work_done);
+
 	num_frames = min_t(unsigned int, rb_usage(rb), budget);
 #else /* !CONFIG_LINK_DEVICE_NAPI */
 	num_frames = rb_usage(rb);
@@ -2144,6 +2328,7 @@ static void shmem_boot_on(struct link_device *ld, struct io_device *iod)
 		sbd_deactivate(&mld->sbd_link_dev);
 #endif
 		cancel_tx_timer(mld, &mld->sbd_tx_timer);
+		tx_coal_reset(mld);
 		cancel_datalloc_timer(mld);
 
 		if (mld->iosm) {
@@ -2298,6 +2483,11 @@ static void gro_flush_timer(struct link_device *ld)
 	struct mem_link_device *mld = to_mem_link_device(ld);
 	struct timespec curr, diff;
 
+#ifdef CONFIG_LINK_DEVICE_NAPI
+	if (mld->rx_batch)
+		return;
+#endif
+
 	if (!gro_flush_time) {
 		napi_gro_flush(&mld->mld_napi, false);
 		return;
@@ -3185,6 +3375,108 @@ static ssize_t tx_period_ms_store(struct device *dev,
 	return ret;
 }
 
+static ssize_t tx_coal_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct modem_data *modem;
+	modem = (struct modem_data *)dev->platform_data;
+	return sprintf(buf, "%u\n", modem->mld->tx_coal.enable);
+}
+
+static ssize_t tx_coal_store(struct device *dev,
+		struct device_attribute *attr,
+		const char *buf, size_t count)
+{
+	struct modem_data *modem;
+	unsigned int val;
+
+	modem = (struct modem_data *)dev->platform_data;
+	if (kstrtouint(buf, 0, &val))
+		return -EINVAL;
+
+	modem->mld->tx_coal.enable = !!val;
+	return count;
+}
+
+static ssize_t tx_coal_delay_us_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct modem_data *modem;
+	modem = (struct modem_data *)dev->platform_data;
+	return sprintf(buf, "%u\n", modem->mld->tx_coal.max_delay_us);
+}
+
+static ssize_t tx_coal_delay_us_store(struct device *dev,
+		struct device_attribute *attr,
+		const char *buf, size_t count)
+{
+	struct modem_data *modem;
+	unsigned int val;
+
+	modem = (struct modem_data *)dev->platform_data;
+	if (kstrtouint(buf, 0, &val) || !val || val > USEC_PER_SEC)
+		return -EINVAL;
+
+	modem->mld->tx_coal.max_delay_us = val;
+	return count;
+}
+
+static ssize_t tx_coal_stats_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	static const char * const hist_names[TX_COAL_HIST] = {
+		"1", "2-3", "4-7", "8-15", "16-31", "32+",
+	};
+	struct modem_data *modem;
+	struct shmem_tx_coal *tc;
+	u64 doorbells;
+	ssize_t count = 0;
+	int i;
+
+	modem = (struct modem_data *)dev->platform_data;
+	tc = &modem->mld->tx_coal;
+	doorbells = tc->doorbells ? tc->doorbells : 1;
+
+	count += sprintf(&buf[count], "doorbells: %llu frames: %llu "
+			 "frames/doorbell: %llu\n", tc->doorbells, tc->frames,
+			 div64_u64(tc->frames, doorbells));
+	count += sprintf(&buf[count], "urgent: %llu\n", tc->urgent);
+	count += sprintf(&buf[count], "delay_us: avg %llu max %llu\n",
+			 div64_u64(tc->delay_ns, doorbells * NSEC_PER_USEC),
+			 div_u64(tc->max_delay_ns, NSEC_PER_USEC));
+	count += sprintf(&buf[count], "target: %u cp_rate: %u\n",
+			 tc->target, tc->cp_rate);
+	for (i = 0; i < TX_COAL_HIST; i++)
+		count += sprintf(&buf[count], "%s%s:%llu", i ? " " : "",
+				 hist_names[i], tc->hist[i]);
+	count += sprintf(&buf[count], "\n");
+
+	return count;
+}
+
+static ssize_t tx_coal_stats_store(struct device *dev,
+		struct device_attribute *attr,
+		const char *buf, size_t count)
+{
+	struct modem_data *modem;
+	struct shmem_tx_coal *tc;
+	unsigned long flags;
+
+	modem = (struct modem_data *)dev->platform_data;
+	tc = &modem->mld->tx_coal;
+
+	spin_lock_irqsave(&tc->lock, flags);
+	tc->doorbells = 0;
+	tc->frames = 0;
+	tc->urgent = 0;
+	tc->delay_ns = 0;
+	tc->max_delay_ns = 0;
+	memset(tc->hist, 0, sizeof(tc->hist));
+	spin_unlock_irqrestore(&tc->lock, flags);
+
+	return count;
+}
+
 static int rb_ch_id = 8;
 static ssize_t rb_info_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
@@ -3300,6 +3592,9 @@ static ssize_t force_use_memcpy_store(struct device *dev,
 #endif
 
 static DEVICE_ATTR_RW(tx_period_ms);
+static DEVICE_ATTR_RW(tx_coal);
+static DEVICE_ATTR_RW(tx_coal_delay_us);
+static DEVICE_ATTR_RW(tx_coal_stats);
 static DEVICE_ATTR_RW(rb_info);
 #if defined(CONFIG_CP_ZEROCOPY)
 static DEVICE_ATTR_RO(mif_buff_mng);
@@ -3309,6 +3604,9 @@ static DEVICE_ATTR_RW(force_use_memcpy);
 
 static struct attribute *shmem_attrs[] = {
 	&dev_attr_tx_period_ms.attr,
+	&dev_attr_tx_coal.attr,
+	&dev_attr_tx_coal_delay_us.attr,
+	&dev_attr_tx_coal_stats.attr,
 	&dev_attr_rb_info.attr,
 #if defined(CONFIG_CP_ZEROCOPY)
 	&dev_attr_mif_buff_mng.attr,
@@ -3425,7 +3723,20 @@ static ssize_t rx_int_disabled_time_store(struct device *dev,
 	return count;
 }
 
+static ssize_t rx_pool_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct modem_data *modem = (struct modem_data *)dev->platform_data;
+	struct sbd_rx_pool *pool = &modem->mld->sbd_link_dev.rx_pool;
+
+	return sprintf(buf, "pages: %u\nfrags: %lu\nrecycled: %lu\n"
+		       "allocated: %lu\nbusy: %lu\nfailed: %lu\n",
+		       pool->nr_pages, pool->frags, pool->recycled,
+		       pool->allocated, pool->busy, pool->failed);
+}
+
 static DEVICE_ATTR_RO(rx_napi_list);
+static DEVICE_ATTR_RO(rx_pool);
 static DEVICE_ATTR_RO(rx_int_enable);
 static DEVICE_ATTR_RW(rx_int_count);
 static DEVICE_ATTR_RW(rx_poll_count);
@@ -3433,6 +3744,7 @@ static DEVICE_ATTR_RW(rx_int_disabled_time);
 
 static struct attribute *napi_attrs[] = {
 	&dev_attr_rx_napi_list.attr,
+	&dev_attr_rx_pool.attr,
 	&dev_attr_rx_int_enable.attr,
 	&dev_attr_rx_int_count.attr,
 	&dev_attr_rx_poll_count.attr,
@@ -3890,6 +4202,11 @@ struct link_device *shmem_create_link_device(struct platform_device *pdev)
 
 	mld->tx_period_ms = TX_PERIOD_MS;
 
+	spin_lock_init(&mld->tx_coal.lock);
+	mld->tx_coal.enable = 1;
+	mld->tx_coal.max_delay_us = TX_COAL_MAX_DELAY_US;
+	mld->tx_coal.target = TX_COAL_MIN_FRAMES;
+
 	if (sysfs_create_group(&pdev->dev.kobj, &shmem_group))
 		mif_err("failed to create sysfs node related shmem\n");
 
@@ -0,0 +1,123 @@
+/**
+@file		sbd_rx_pool.c
+@brief		recycled page pool backing the SBD downlink skbs
+*/
+
+/*
+ * Copyright (C) 2019 Samsung Electronics.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifdef __KERNEL__
+#include <linux/slab.h>
+#include <linux/log2.h>
+#include "include/sbd_rx_pool.h"
+#else
+#include "sbd_rx_pool.h"
+#endif
+
+/**
+@brief		set up a pool of up to @nr_pages pages
+
+Pages are allocated on first use. A @nr_pages of 0 disables the pool.
+*/
+int sbd_rx_pool_init(struct sbd_rx_pool *pool, unsigned int nr_pages)
+{
+	memset(pool, 0, sizeof(*pool));
+
+	if (!nr_pages)
+		return 0;
+
+	nr_pages = roundup_pow_of_two(nr_pages);
+	pool->pages = kcalloc(nr_pages, sizeof(*pool->pages), GFP_KERNEL);
+	if (!pool->pages)
+		return -ENOMEM;
+
+	pool->nr_pages = nr_pages;
+	/* the first sbd_rx_pool_get() moves on to page 0 */
+	pool->idx = nr_pages - 1;
+	pool->offset = PAGE_SIZE;
+
+	return 0;
+}
+
+void sbd_rx_pool_destroy(struct sbd_rx_pool *pool)
+{
+	unsigned int i;
+
+	for (i = 0; i < pool->nr_pages; i++)
+		if (pool->pages[i])
+			put_page(pool->pages[i]);
+
+	kfree(pool->pages);
+	pool->pages = NULL;
+	pool->nr_pages = 0;
+}
+
+/* make the next page of the ring the one being carved */
+static struct page *sbd_rx_pool_next(struct sbd_rx_pool *pool)
+{
+	unsigned int idx = (pool->idx + 1) & (pool->nr_pages - 1);
+	struct page *page = pool->pages[idx];
+
+	if (page && page_count(page) == 1) {
+		pool->recycled++;
+	} else {
+		if (page) {
+			/* the stack still holds frags, let it free the page */
+			put_page(page);
+			pool->busy++;
+		}
+
+		page = dev_alloc_page();
+		pool->pages[idx] = page;
+		if (!page) {
+			pool->failed++;
+			return NULL;
+		}
+		pool->allocated++;
+	}
+
+	pool->idx = idx;
+	pool->offset = 0;
+
+	return page;
+}
+
+/**
+@brief		reserve @len bytes for a frag
+
+@return		a page with a reference for the caller, with @len bytes free
+		at @offset, or NULL
+*/
+struct page *sbd_rx_pool_get(struct sbd_rx_pool *pool, unsigned int len,
+			     unsigned int *offset)
+{
+	unsigned int size = sbd_rx_pool_truesize(len);
+	struct page *page = pool->pages[pool->idx];
+
+	if (unlikely(!len || size > PAGE_SIZE))
+		return NULL;
+
+	if (!page || pool->offset + size > PAGE_SIZE) {
+		page = sbd_rx_pool_next(pool);
+		if (unlikely(!page))
+			return NULL;
+	}
+
+	*offset = pool->offset;
+	pool->offset += size;
+	pool->frags++;
+	get_page(page);
+
+	return page;
+}
@@ -7,6 +7,7 @@
 #include <scsc/scsc_mx.h>
 #include "scsc_logring_main.h"
 #include "scsc_logring_debugfs.h"
+#include "scsc_logring_defer.h"
 
 static int  scsc_max_records_per_read = SCSC_DEFAULT_MAX_RECORDS_PER_READ;
 module_param(scsc_max_records_per_read, int, S_IRUGO | S_IWUSR);
@@ -107,6 +108,7 @@ static int debugfile_open(struct inode *ino, struct file *filp)
 	    filp->f_flags & O_TRUNC) {
 		unsigned long    flags;
 
+		scsc_defer_truncate();
 		raw_spin_lock_irqsave(&i->rb->lock, flags);
 		scsc_ring_truncate(i->rb);
 		raw_spin_unlock_irqrestore(&i->rb->lock, flags);
@@ -230,13 +232,17 @@ static ssize_t samsg_read(struct file *filp, char __user *ubuf,
 	/* open() assures us that this private data is certainly non-NULL */
 	i = filp->private_data;
 	if (!i->t_used) {
+		/* Deferred lines are formatted into the ring here */
+		scsc_defer_drain();
 		raw_spin_lock_irqsave(&i->rb->lock, flags);
 		current_head = *f_pos ? i->f_pos : i->rb->head;
 		while (current_head == i->rb->head) {
 			raw_spin_unlock_irqrestore(&i->rb->lock, flags);
 			if (wait_event_interruptible(i->rb->wq,
-						     current_head != i->rb->head))
+						     current_head != i->rb->head ||
+						     scsc_defer_pending()))
 				return -ERESTARTSYS;
+			scsc_defer_drain();
 			raw_spin_lock_irqsave(&i->rb->lock, flags);
 		}
 		retrieved_bytes = read_next_records(i->rb,
@@ -362,6 +368,8 @@ static int debugfile_open_snapshot(struct inode *ino, struct file *filp)
 		size_t			snap_sz;
 		struct scsc_ibox	*i = filp->private_data;
 
+		/* The snapshot must hold the deferred lines too */
+		scsc_defer_drain();
 		/* This is read-only...no spinlocking needed */
 		snap_sz = i->rb->bsz + i->rb->ssz;
 		/* Allocate here to minimize lock time... */
@@ -426,6 +434,8 @@ static ssize_t samlog_read(struct file *filp, char __user *ubuf,
 	if (!i->t_used) {
 		unsigned long    flags;
 
+		if (!i->saved_live_rb)
+			scsc_defer_drain();
 		/* Lock ONLY if NOT using a snapshot */
 		if (!i->saved_live_rb)
 			raw_spin_lock_irqsave(&i->rb->lock, flags);
@@ -517,6 +527,8 @@ static ssize_t statfile_read(struct file *filp, char __user *ubuf,
 			"sz:%zd  used:%lld  free:%lld  logged:%lld  records:%d\nhead:%lld  tail:%lld  last:%lld  written:%lld  wraps:%d  oos:%d\n",
 			bsz, used, max_chunk, logged, records,
 			head, tail, last, written, wraps, oos);
+	if (slen >= 0 && slen < STATSTR_SZ)
+		slen += scsc_defer_stat(statstr + slen, STATSTR_SZ - slen);
 	if (slen >= 0 && *f_pos < slen) {
 		count = (count <= slen - *f_pos) ? count : (slen - *f_pos);
 		if (copy_to_user(ubuf, statstr + *f_pos, count))
@@ -612,6 +624,53 @@ const struct file_operations samwrite_fops = {
 	.release = samwritefile_release,
 };
 
+#ifdef CONFIG_SCSC_LOGRING_DEFERRED
+/**
+ * defer_bench runs the logging microbenchmark: writing N logs N lines
+ * through the immediate and then through the deferred path, reading
+ * back returns the cost per line of the last run.
+ */
+static DEFINE_MUTEX(bench_mutex);
+static char bench_result[STATSTR_SZ];
+static int  bench_len;
+
+static ssize_t benchfile_read(struct file *filp, char __user *ubuf,
+			      size_t count, loff_t *f_pos)
+{
+	ssize_t ret;
+
+	mutex_lock(&bench_mutex);
+	ret = simple_read_from_buffer(ubuf, count, f_pos, bench_result,
+				      bench_len);
+	mutex_unlock(&bench_mutex);
+	return ret;
+}
+
+static ssize_t benchfile_write(struct file *filp, const char __user *ubuf,
+			       size_t count, loff_t *f_pos)
+{
+	unsigned int records;
+	int          ret;
+
+	ret = kstrtouint_from_user(ubuf, count, 0, &records);
+	if (ret)
+		return ret;
+	if (!records || records > SCSC_DEFER_BENCH_MAX)
+		return -EINVAL;
+	mutex_lock(&bench_mutex);
+	ret = scsc_defer_bench(records, bench_result, sizeof(bench_result));
+	bench_len = ret > 0 ? ret : 0;
+	mutex_unlock(&bench_mutex);
+	return ret < 0 ? ret : count;
+}
+
+const struct file_operations bench_fops = {
+	.owner = THIS_MODULE,
+	.read = benchfile_read,
+	.write = benchfile_write,
+};
+#endif
+
 /**
  * Initializes debugfs support build the proper debugfs file dentries:
  * - entries in debugfs are created under /sys/kernel/debugfs/scsc/@name/
@@ -663,6 +722,12 @@ void __init *samlog_debugfs_init(const char *root_name, void *rb)
 	if (!di->samwritefile)
 		goto no_samwrite;
 
+#ifdef CONFIG_SCSC_LOGRING_DEFERRED
+	/* Optional: the rings work without it */
+	di->benchfile = debugfs_create_file(SCSC_BENCH_FNAME, 0600,
+					    di->bufdir, NULL, &bench_fops);
+#endif
+
 	pr_info("Samlog Debugfs Initialized\n");
 	return di;
 
@@ -18,15 +18,17 @@
 #include <scsc/scsc_logring.h>
 #include "scsc_logring_ring.h"
 
-#define STATSTR_SZ				256
+#define STATSTR_SZ				384
 #define SCSC_DEBUGFS_ROOT			"scsc"
 #define SCSC_SAMSG_FNAME			"samsg"
 #define SCSC_SAMLOG_FNAME			"samlog"
 #define SCSC_STAT_FNAME				"stat"
 #define SCSC_SAMWRITE_FNAME			"samwrite"
+#define SCSC_BENCH_FNAME			"defer_bench"
 
 #define SAMWRITE_BUFSZ				2048
 #define SCSC_DEFAULT_MAX_RECORDS_PER_READ	1
+#define SCSC_DEFER_BENCH_MAX			1000000
 
 struct scsc_ibox {
 	struct scsc_ring_buffer		*rb;
@@ -47,6 +49,7 @@ struct scsc_debugfs_info {
 	struct dentry *samlogfile;
 	struct dentry *statfile;
 	struct dentry *samwritefile;
+	struct dentry *benchfile;
 };
 
 struct write_config {
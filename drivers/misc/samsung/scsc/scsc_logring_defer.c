@@ -0,0 +1,460 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2016-2017 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ ****************************************************************************/
+
+#include <linux/ctype.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/workqueue.h>
+#include <linux/notifier.h>
+#include <linux/log2.h>
+
+#include "scsc_logring_defer.h"
+
+/**
+ * Deferred logging.
+ *
+ * scsc_printk() spends most of its time in vsnprintf() and in the CRC of
+ * the record, both done while holding the ring raw spinlock with IRQs
+ * disabled. In deferred mode a line is instead recorded as its format
+ * pointer, timestamp and raw arguments (as saved by vbin_printf(), which
+ * copies %s strings) into a small ring of the local CPU: the only IRQ-off
+ * section left is the copy of that record, and no lock is shared between
+ * CPUs.
+ *
+ * The per-CPU rings are drained into the logring, merged by timestamp, by
+ * a periodic deferrable work and by the debugfs readers right before they
+ * read: the lines are expanded there, with bstr_printf(), into regular
+ * string records, so that every reader of the logring and the log
+ * collector see exactly what the immediate path would have written.
+ *
+ * The format string must still be there when the line is expanded: lines
+ * whose format uses a %p extension dereferencing its argument (%pM, %pI4,
+ * ...) are logged immediately, and the rings are drained whenever a
+ * module goes away.
+ *
+ * Each ring is a stream of records that never wrap across its end; a
+ * record with a zero len pads to the end of the ring. @head is only moved
+ * by the owning CPU with IRQs disabled and @tail only by the drain, under
+ * defer_mutex.
+ */
+struct scsc_defer_ring {
+	char          *buf;
+	unsigned long head;
+	unsigned long tail;
+	unsigned long records;
+	unsigned long full;
+	unsigned long unsafe;
+};
+
+struct scsc_defer_record {
+	u16        len;
+	u8         tag;
+	u8         lev;
+	u8         ctx;
+	u8         header;
+	s64        nsec;
+	const char *fmt;
+	u32        args[0];
+};
+
+#define SCSC_DEFER_REC_ALIGN	8
+
+static int deferred = 1;
+module_param(deferred, int, S_IRUGO | S_IWUSR);
+SCSC_MODPARAM_DESC(deferred,
+		   "Record lines in per-CPU rings and format them when draining.",
+		   "run-time", 1);
+
+static int deferred_ringsize = DEFAULT_DEFER_RING_SZ;
+module_param(deferred_ringsize, int, S_IRUGO);
+SCSC_MODPARAM_DESC(deferred_ringsize,
+		   "Size of each per-CPU ring. MUST be power-of-two.",
+		   "load-time", DEFAULT_DEFER_RING_SZ);
+
+static int deferred_flush_ms = DEFAULT_DEFER_FLUSH_MS;
+module_param(deferred_flush_ms, int, S_IRUGO | S_IWUSR);
+SCSC_MODPARAM_DESC(deferred_flush_ms,
+		   "Period of the drain of the per-CPU rings into the logring.",
+		   "run-time", DEFAULT_DEFER_FLUSH_MS);
+
+static DEFINE_PER_CPU(struct scsc_defer_ring, defer_rings);
+static struct scsc_ring_buffer *defer_rb;
+static size_t defer_sz;
+
+static DEFINE_MUTEX(defer_mutex);
+/* Expansion buffer of the drain, under defer_mutex */
+static char *defer_tbuf;
+static unsigned long defer_drained;
+
+static struct delayed_work defer_work;
+
+/**
+ * Tells if the line can be formatted later: %p extensions other than the
+ * symbol and pointer ones look at the memory pointed to by the argument.
+ */
+static bool fmt_is_deferrable(const char *fmt)
+{
+	const char *p = fmt;
+
+	while ((p = strchr(p, '%'))) {
+		p++;
+		if (*p == '%') {
+			p++;
+			continue;
+		}
+		/* flags, field width, precision and qualifiers */
+		while (*p && strchr("-+ #0123456789.*hlLzjt", *p))
+			p++;
+		if (*p == 'p' && isalnum(p[1]) && !strchr("SsFfBK", p[1]))
+			return false;
+	}
+	return true;
+}
+
+static int __push_record_deferred(int tag, int lev, int prepend_header,
+				  const char *fmt, va_list args)
+{
+	u32                      bin[SCSC_DEFER_ARGS_WORDS];
+	struct scsc_defer_ring   *r;
+	struct scsc_defer_record *rec;
+	unsigned long            flags, head, tail, off;
+	size_t                   len, pad;
+	va_list                  aq;
+	int                      words;
+
+	if (!fmt_is_deferrable(fmt)) {
+		this_cpu_inc(defer_rings.unsafe);
+		return -EINVAL;
+	}
+	va_copy(aq, args);
+	words = vbin_printf(bin, SCSC_DEFER_ARGS_WORDS, fmt, aq);
+	va_end(aq);
+	if (words > SCSC_DEFER_ARGS_WORDS) {
+		this_cpu_inc(defer_rings.unsafe);
+		return -E2BIG;
+	}
+	len = ALIGN(sizeof(*rec) + words * sizeof(u32), SCSC_DEFER_REC_ALIGN);
+
+	local_irq_save(flags);
+	r = this_cpu_ptr(&defer_rings);
+	head = r->head;
+	tail = smp_load_acquire(&r->tail);
+	off = head & (defer_sz - 1);
+	pad = (off + len > defer_sz) ? defer_sz - off : 0;
+	if (head + pad + len - tail > defer_sz) {
+		/* Not drained fast enough: log it the old way */
+		r->full++;
+		local_irq_restore(flags);
+		return -ENOSPC;
+	}
+	if (pad) {
+		((struct scsc_defer_record *)(r->buf + off))->len = 0;
+		head += pad;
+		off = 0;
+	}
+	rec = (struct scsc_defer_record *)(r->buf + off);
+	rec->len = len;
+	rec->tag = tag;
+	rec->lev = lev;
+	rec->ctx = (in_interrupt()) ? ((in_softirq()) ? 'S' : 'I') : 'P';
+	rec->header = !!prepend_header;
+	rec->nsec = local_clock();
+	rec->fmt = fmt;
+	memcpy(rec->args, bin, words * sizeof(u32));
+	smp_store_release(&r->head, head + len);
+	r->records++;
+	local_irq_restore(flags);
+
+	/* Readers sleeping on samsg drain the rings once woken up */
+	smp_mb();
+	if (waitqueue_active(&defer_rb->wq))
+		wake_up_interruptible(&defer_rb->wq);
+	return len;
+}
+
+/**
+ * Records a line into the ring of the local CPU. Returns a negative value
+ * when the line must be logged with push_record_string() instead.
+ */
+int push_record_deferred(int tag, int lev, int prepend_header,
+			 const char *fmt, va_list args)
+{
+	if (!deferred || !defer_rb)
+		return -EINVAL;
+	return __push_record_deferred(tag, lev, prepend_header, fmt, args);
+}
+
+/* Oldest record of @r, skipping the padding. Under defer_mutex. */
+static struct scsc_defer_record *defer_peek(struct scsc_defer_ring *r)
+{
+	unsigned long head = smp_load_acquire(&r->head);
+	unsigned long tail = r->tail;
+
+	while (tail != head) {
+		unsigned long off = tail & (defer_sz - 1);
+		struct scsc_defer_record *rec =
+			(struct scsc_defer_record *)(r->buf + off);
+
+		if (rec->len)
+			return rec;
+		tail += defer_sz - off;
+		smp_store_release(&r->tail, tail);
+	}
+	return NULL;
+}
+
+/**
+ * Moves the records of all the per-CPU rings into the logring, oldest
+ * first. Lines logged after the drain started are left for the next one,
+ * so that a flood of writers cannot keep a reader here.
+ */
+static void defer_drain_locked(void)
+{
+	struct scsc_ring_record rrec;
+	unsigned long           drained = 0;
+	u64                     start = local_clock();
+
+	while (true) {
+		struct scsc_defer_ring   *r = NULL;
+		struct scsc_defer_record *next = NULL;
+		int                      cpu, next_cpu = 0;
+
+		for_each_possible_cpu(cpu) {
+			struct scsc_defer_ring *c = per_cpu_ptr(&defer_rings, cpu);
+			struct scsc_defer_record *rec = defer_peek(c);
+
+			if (rec && (!next || rec->nsec < next->nsec)) {
+				next = rec;
+				r = c;
+				next_cpu = cpu;
+			}
+		}
+		if (!next || next->nsec > start)
+			break;
+
+		rrec.sync = SYNC_MAGIC;
+		rrec.crc = 0;
+		rrec.tag = next->tag;
+		rrec.len = 0;
+		rrec.lev = next->lev;
+		rrec.ctx = next->ctx;
+		rrec.core = next_cpu;
+		rrec.nsec = next->nsec;
+		push_record_bstr(defer_rb, &rrec, next->header, next->fmt,
+				 next->args, defer_tbuf);
+		smp_store_release(&r->tail, r->tail + next->len);
+		if (!(++drained & 0xff))
+			cond_resched();
+	}
+	if (drained) {
+		defer_drained += drained;
+		wake_up_interruptible(&defer_rb->wq);
+	}
+}
+
+/* Drains the per-CPU rings into the logring. MAY SLEEP. */
+void scsc_defer_drain(void)
+{
+	if (!defer_rb)
+		return;
+	mutex_lock(&defer_mutex);
+	defer_drain_locked();
+	mutex_unlock(&defer_mutex);
+}
+
+/* Drops whatever is still in the per-CPU rings. MAY SLEEP. */
+void scsc_defer_truncate(void)
+{
+	int cpu;
+
+	if (!defer_rb)
+		return;
+	mutex_lock(&defer_mutex);
+	for_each_possible_cpu(cpu) {
+		struct scsc_defer_ring *r = per_cpu_ptr(&defer_rings, cpu);
+
+		smp_store_release(&r->tail, smp_load_acquire(&r->head));
+	}
+	mutex_unlock(&defer_mutex);
+}
+
+bool scsc_defer_pending(void)
+{
+	int cpu;
+
+	if (!defer_rb)
+		return false;
+	for_each_possible_cpu(cpu) {
+		struct scsc_defer_ring *r = per_cpu_ptr(&defer_rings, cpu);
+
+		if (READ_ONCE(r->head) != READ_ONCE(r->tail))
+			return true;
+	}
+	return false;
+}
+
+int scsc_defer_stat(char *buf, size_t sz)
+{
+	unsigned long records = 0, full = 0, unsafe = 0, pending = 0;
+	int           cpu;
+
+	if (!defer_rb)
+		return 0;
+	for_each_possible_cpu(cpu) {
+		struct scsc_defer_ring *r = per_cpu_ptr(&defer_rings, cpu);
+
+		records += r->records;
+		full += r->full;
+		unsafe += r->unsafe;
+		pending += READ_ONCE(r->head) - READ_ONCE(r->tail);
+	}
+	return scnprintf(buf, sz,
+			 "deferred:%d  records:%lu  drained:%lu  pending_bytes:%lu  full:%lu  unsafe:%lu\n",
+			 deferred, records, defer_drained, pending, full,
+			 unsafe);
+}
+
+static int bench_push(bool defer, const char *fmt, ...)
+{
+	int     ret;
+	va_list args;
+
+	va_start(args, fmt);
+	if (defer)
+		ret = __push_record_deferred(TEST_ME, SCSC_DBG4, 1, fmt, args);
+	else
+		ret = push_record_string(defer_rb, TEST_ME, SCSC_DBG4, 1, fmt,
+					 args);
+	va_end(args);
+	return ret;
+}
+
+/**
+ * Microbenchmark: logs @records lines typical of the Wi-Fi data path with
+ * the TEST_ME tag, first through the immediate path and then through the
+ * deferred one, and reports the cost per line seen by the caller. For the
+ * deferred path the drain cost per line, paid by the drain, is reported
+ * apart. The lines end up in the logring like any other.
+ */
+int scsc_defer_bench(unsigned int records, char *buf, size_t sz)
+{
+	static const char * const names[] = { "string", "deferred" };
+	int pass, len = 0;
+
+	if (!defer_rb)
+		return -ENODEV;
+
+	len += scnprintf(buf + len, sz - len, "records:%u\n", records);
+	for (pass = 0; pass < 2; pass++) {
+		u64          sum = 0, max = 0, drain = 0, t;
+		unsigned int i;
+
+		for (i = 0; i < records; i++) {
+			t = local_clock();
+			bench_push(pass, "%s: rx vif:%d peer:%d tid:%d seq:%u len:%u flags:0x%x\n",
+				   "wlan0", 1, i & 7, i & 3, i, 1400, 0x21);
+			t = local_clock() - t;
+			sum += t;
+			if (t > max)
+				max = t;
+
+			if (pass && ((i & 0xff) == 0xff || i == records - 1)) {
+				t = local_clock();
+				scsc_defer_drain();
+				drain += local_clock() - t;
+			}
+		}
+		len += scnprintf(buf + len, sz - len,
+				 "%-9s ns/record avg:%llu max:%llu",
+				 names[pass],
+				 records ? div_u64(sum, records) : 0, max);
+		if (pass)
+			len += scnprintf(buf + len, sz - len, " drain:%llu",
+					 records ? div_u64(drain, records) : 0);
+		len += scnprintf(buf + len, sz - len, "\n");
+	}
+	return len;
+}
+
+static void defer_work_fn(struct work_struct *work)
+{
+	scsc_defer_drain();
+	queue_delayed_work(system_wq, &defer_work,
+			   msecs_to_jiffies(deferred_flush_ms > 0 ?
+					    deferred_flush_ms :
+					    DEFAULT_DEFER_FLUSH_MS));
+}
+
+/* Format strings of a module going away must be used before they go */
+static int defer_module_notify(struct notifier_block *nb,
+			       unsigned long action, void *data)
+{
+	if (action == MODULE_STATE_GOING)
+		scsc_defer_drain();
+	return NOTIFY_OK;
+}
+
+static struct notifier_block defer_module_nb = {
+	.notifier_call = defer_module_notify,
+};
+
+static void defer_free(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct scsc_defer_ring *r = per_cpu_ptr(&defer_rings, cpu);
+
+		kfree(r->buf);
+		r->buf = NULL;
+	}
+	kfree(defer_tbuf);
+	defer_tbuf = NULL;
+}
+
+int __init scsc_defer_init(struct scsc_ring_buffer *rb)
+{
+	int cpu;
+
+	if (!is_power_of_2(deferred_ringsize) ||
+	    deferred_ringsize < BASE_SPARE_SZ) {
+		deferred_ringsize = DEFAULT_DEFER_RING_SZ;
+		pr_info("Samlog: scsc_logring.deferred_ringsize MUST be power-of-two. Using default: %d\n",
+			deferred_ringsize);
+	}
+	defer_sz = deferred_ringsize;
+	defer_tbuf = kmalloc(BASE_SPARE_SZ, GFP_KERNEL);
+	if (!defer_tbuf)
+		return -ENOMEM;
+	for_each_possible_cpu(cpu) {
+		struct scsc_defer_ring *r = per_cpu_ptr(&defer_rings, cpu);
+
+		r->buf = kzalloc_node(defer_sz, GFP_KERNEL, cpu_to_node(cpu));
+		if (!r->buf) {
+			defer_free();
+			return -ENOMEM;
+		}
+	}
+	defer_rb = rb;
+	register_module_notifier(&defer_module_nb);
+	INIT_DEFERRABLE_WORK(&defer_work, defer_work_fn);
+	queue_delayed_work(system_wq, &defer_work,
+			   msecs_to_jiffies(DEFAULT_DEFER_FLUSH_MS));
+	pr_info("Samlog: Allocated per-CPU deferred rings of size %zd bytes.\n",
+		defer_sz);
+	return 0;
+}
+
+void __exit scsc_defer_exit(void)
+{
+	if (!defer_rb)
+		return;
+	cancel_delayed_work_sync(&defer_work);
+	unregister_module_notifier(&defer_module_nb);
+	scsc_defer_drain();
+	defer_rb = NULL;
+	defer_free();
+}
@@ -0,0 +1,58 @@
+/******************************************************************************
+ *
+ *   Copyright (c) 2016-2017 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef _SCSC_LOGRING_DEFER_H_
+#define _SCSC_LOGRING_DEFER_H_
+
+#include <linux/types.h>
+#include <linux/kernel.h>
+
+#include "scsc_logring_ring.h"
+
+#define DEFAULT_DEFER_RING_SZ		65536
+#define DEFAULT_DEFER_FLUSH_MS		100
+/* Room for the raw arguments of one line, in 32-bit words */
+#define SCSC_DEFER_ARGS_WORDS		64
+
+#ifdef CONFIG_SCSC_LOGRING_DEFERRED
+int scsc_defer_init(struct scsc_ring_buffer *rb) __init;
+void scsc_defer_exit(void) __exit;
+int push_record_deferred(int tag, int lev, int prepend_header,
+			 const char *fmt, va_list args);
+void scsc_defer_drain(void);
+void scsc_defer_truncate(void);
+bool scsc_defer_pending(void);
+int scsc_defer_stat(char *buf, size_t sz);
+int scsc_defer_bench(unsigned int records, char *buf, size_t sz);
+#else
+static inline int scsc_defer_init(struct scsc_ring_buffer *rb)
+{
+	return 0;
+}
+
+static inline void scsc_defer_exit(void) { }
+
+static inline int push_record_deferred(int tag, int lev, int prepend_header,
+				       const char *fmt, va_list args)
+{
+	return -ENOSYS;
+}
+
+static inline void scsc_defer_drain(void) { }
+static inline void scsc_defer_truncate(void) { }
+
+static inline bool scsc_defer_pending(void)
+{
+	return false;
+}
+
+static inline int scsc_defer_stat(char *buf, size_t sz)
+{
+	return 0;
+}
+#endif
+
+#endif /* _SCSC_LOGRING_DEFER_H_ */
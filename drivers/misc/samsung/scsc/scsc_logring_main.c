@@ -6,6 +6,7 @@
 #include "scsc_logring_main.h"
 #include "scsc_logring_ring.h"
 #include "scsc_logring_debugfs.h"
+#include "scsc_logring_defer.h"
 #ifdef CONFIG_SCSC_LOG_COLLECTION
 #include <scsc/scsc_log_collector.h>
 #endif
@@ -76,6 +77,8 @@ int __init samlog_init(void)
 	pr_info("scsc_logring:: Allocated STATIC ring buffer of size %zd bytes.\n",
 		rb->bsz);
 #endif
+	if (scsc_defer_init(rb))
+		pr_info("Samlog: Cannot allocate deferred rings...logging immediately.\n");
 	the_ringbuf = rb;
 	initialized = true;
 	pr_info("Samlog Loaded.\n");
@@ -105,6 +108,7 @@ void __exit samlog_exit(void)
 	if (the_ringbuf && the_ringbuf->private)
 		samlog_debugfs_exit(&the_ringbuf->private);
 	initialized = false;
+	scsc_defer_exit();
 	free_ring_buffer(the_ringbuf);
 	the_ringbuf = NULL;
 #ifdef CONFIG_SCSC_LOG_COLLECTION
@@ -330,6 +334,9 @@ static int logring_collect(struct scsc_log_collector_client *collect_client, siz
 	saved_droplevel = scsc_droplevel_all;
 	scsc_droplevel_all = DEFAULT_DROP_ALL;
 
+	/* Lines still in the per-CPU rings belong to the collection */
+	scsc_defer_drain();
+
 	/* Write buffer */
 	ret = scsc_log_collector_write(the_ringbuf->buf, the_ringbuf->bsz, 1);
 
@@ -414,8 +421,11 @@ static inline int _scsc_printk(int level, int tag,
 	     (scsc_droplevel_all >= 0 && level >= scsc_droplevel_all)))
 		return written;
 	drop_message_level_macro(fmt, &msg_head);
-	written = push_record_string(the_ringbuf, tag, level,
-				     prepend_header, msg_head, args);
+	written = push_record_deferred(tag, level, prepend_header, msg_head,
+				       args);
+	if (written < 0)
+		written = push_record_string(the_ringbuf, tag, level,
+					     prepend_header, msg_head, args);
 	return written;
 }
 
@@ -387,6 +387,44 @@ int push_record_string(struct scsc_ring_buffer *rb, int tag, int lev,
 	return rec_len;
 }
 
+#ifdef CONFIG_SCSC_LOGRING_DEFERRED
+/**
+ * A ring API function to push a deferred record: @rec is the descriptor
+ * filled when the line was logged and @bin_args its arguments as saved by
+ * vbin_printf(). The line is expanded into the caller's @tbuf (at least
+ * BASE_SPARE_SZ - SCSC_RINGREC_SZ bytes) BEFORE taking the ring lock, so that only the copy
+ * into the ring happens with interrupts disabled.
+ */
+int push_record_bstr(struct scsc_ring_buffer *rb, struct scsc_ring_record *rec,
+		     int prepend_header, const char *fmt, const u32 *bin_args,
+		     char *tbuf)
+{
+	int           rec_len = 0, room;
+	loff_t        free_bytes;
+	unsigned long flags;
+
+	if (prepend_header)
+		rec_len = build_header(tbuf, SCSC_HBUF_LEN, rec, NULL);
+	/* Truncate as the vscnprintf() of tag_writer_string() would */
+	room = BASE_SPARE_SZ - SCSC_RINGREC_SZ - rec_len;
+	rec_len += min(bstr_printf(tbuf + rec_len, room, fmt, bin_args),
+		       room - 1);
+	rec->len = rec_len;
+
+	raw_spin_lock_irqsave(&rb->lock, flags);
+	free_bytes = SCSC_RING_FREE_BYTES(rb);
+	if (rec_len + SCSC_RINGREC_SZ < free_bytes)
+		scsc_ring_buffer_plain_append(rb, tbuf, rec_len,
+					      (char *)rec, SCSC_RINGREC_SZ);
+	else
+		scsc_ring_buffer_overlap_append(rb, tbuf, rec_len,
+						(char *)rec, SCSC_RINGREC_SZ);
+	rb->written += rec_len;
+	raw_spin_unlock_irqrestore(&rb->lock, flags);
+	return rec_len;
+}
+#endif
+
 /* This simply builds up a record descriptor for a binary entry. */
 static inline
 int tag_writer_binary(char *spare, int tag, int lev, size_t hexlen)
@@ -236,6 +236,11 @@ int push_record_string(struct scsc_ring_buffer *rb, int tag, int lev,
 		       int prepend_header, const char *msg_head, va_list args);
 int push_record_blob(struct scsc_ring_buffer *rb, int tag, int lev,
 		     int prepend_header, const void *start, size_t len);
+#ifdef CONFIG_SCSC_LOGRING_DEFERRED
+int push_record_bstr(struct scsc_ring_buffer *rb, struct scsc_ring_record *rec,
+		     int prepend_header, const char *fmt, const u32 *bin_args,
+		     char *tbuf);
+#endif
 size_t read_next_records(struct scsc_ring_buffer *rb, int max_recs,
 			 loff_t *last_read_rec, void *tbuf, size_t tsz);
 struct scsc_ring_buffer *scsc_ring_get_snapshot(const struct scsc_ring_buffer *rb,
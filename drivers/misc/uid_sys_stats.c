@@ -28,12 +28,23 @@
 #include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
+#include <linux/uid_sys_stats.h>
+#include <linux/user_namespace.h>
 
 
 #define UID_HASH_BITS	10
 DECLARE_HASHTABLE(hash_table, UID_HASH_BITS);
 
+/*
+ * Per-uid cputime and I/O are charged as they happen, from the scheduler
+ * tick, when a task is switched out and when it exits, so readers only
+ * walk hash_table. Entries are added and removed under uid_hash_lock and
+ * freed after a grace period; the accounting hooks look them up under RCU.
+ * uid_lock serializes the process context writers and the per-task
+ * statistics of CONFIG_UID_SYS_STATS_DEBUG.
+ */
 static DEFINE_RT_MUTEX(uid_lock);
+static DEFINE_SPINLOCK(uid_hash_lock);
 static struct proc_dir_entry *cpu_parent;
 static struct proc_dir_entry *io_parent;
 static struct proc_dir_entry *proc_parent;
@@ -46,9 +57,9 @@ struct io_stats {
 	u64 fsync;
 };
 
-#define UID_STATE_FOREGROUND	0
-#define UID_STATE_BACKGROUND	1
-#define UID_STATE_BUCKET_SIZE	2
+#define UID_STATE_FOREGROUND	UID_SYS_STATS_FOREGROUND
+#define UID_STATE_BACKGROUND	UID_SYS_STATS_BACKGROUND
+#define UID_STATE_BUCKET_SIZE	UID_SYS_STATS_NR_STATES
 
 #define UID_STATE_TOTAL_CURR	2
 #define UID_STATE_TOTAL_LAST	3
@@ -66,18 +77,63 @@ struct task_entry {
 
 struct uid_entry {
 	uid_t uid;
-	cputime_t utime;
-	cputime_t stime;
-	cputime_t active_utime;
-	cputime_t active_stime;
+	atomic64_t utime;
+	atomic64_t stime;
 	int state;
-	struct io_stats io[UID_STATE_SIZE];
+	atomic64_t io[UID_STATE_BUCKET_SIZE][UID_SYS_STATS_NR_IO];
+	/* uid_stats_epoch at the last change, for show_uid_stat_bin */
+	u64 epoch;
 	struct hlist_node hash;
+	struct rcu_head rcu;
 #ifdef CONFIG_UID_SYS_STATS_DEBUG
 	DECLARE_HASHTABLE(task_entries, UID_HASH_BITS);
 #endif
 };
 
+static atomic64_t uid_stats_epoch = ATOMIC64_INIT(1);
+
+enum {
+	UID_READ_CPUTIME,
+	UID_READ_IO,
+	UID_READ_BIN,
+	UID_READ_NR,
+};
+
+/* duration of the last and slowest read of each file, with nr_threads */
+struct uid_read_cost {
+	u64 last_ns;
+	u64 max_ns;
+	int last_threads;
+	int max_threads;
+};
+
+static struct uid_read_cost uid_read_cost[UID_READ_NR];
+
+static const char * const uid_read_names[UID_READ_NR] = {
+	[UID_READ_CPUTIME]	= "show_uid_stat",
+	[UID_READ_IO]		= "uid_io_stats",
+	[UID_READ_BIN]		= "show_uid_stat_bin",
+};
+
+static void uid_read_cost_update(int file, u64 start)
+{
+	struct uid_read_cost *cost = &uid_read_cost[file];
+	u64 delta = local_clock() - start;
+	int threads = nr_threads;
+
+	cost->last_ns = delta;
+	cost->last_threads = threads;
+	if (delta > cost->max_ns) {
+		cost->max_ns = delta;
+		cost->max_threads = threads;
+	}
+}
+
+static inline void uid_entry_touch(struct uid_entry *uid_entry)
+{
+	WRITE_ONCE(uid_entry->epoch, atomic64_read(&uid_stats_epoch));
+}
+
 static u64 compute_write_bytes(struct task_struct *task)
 {
 	if (task->ioac.write_bytes <= task->ioac.cancelled_write_bytes)
@@ -86,6 +142,60 @@ static u64 compute_write_bytes(struct task_struct *task)
 	return task->ioac.write_bytes - task->ioac.cancelled_write_bytes;
 }
 
+/*
+ * task->uid_ioac holds what was already charged; uid_ioac.write_bytes is
+ * kept net of cancelled writes. A counter found below its charged value
+ * was reduced by a cancelled write and is only resynchronized.
+ */
+static inline struct task_io_accounting *task_uid_ioac(struct task_struct *task)
+{
+	if (task->uid_ioac_task != task) {
+		memset(&task->uid_ioac, 0, sizeof(task->uid_ioac));
+		task->uid_ioac_task = task;
+	}
+	return &task->uid_ioac;
+}
+
+static bool task_io_changed(struct task_struct *task)
+{
+	struct task_io_accounting *last = task_uid_ioac(task);
+
+	return task->ioac.rchar != last->rchar ||
+		task->ioac.wchar != last->wchar ||
+		task->ioac.read_bytes != last->read_bytes ||
+		compute_write_bytes(task) != last->write_bytes ||
+		task->ioac.syscfs != last->syscfs;
+}
+
+static inline void charge_io(atomic64_t *io, u64 now, u64 *last)
+{
+	if (now > *last)
+		atomic64_add(now - *last, io);
+	*last = now;
+}
+
+/*
+ * Charge the I/O @task did since it was last charged to the current state
+ * of @uid_entry. Only called by @task itself or when it is switched out,
+ * with interrupts off so that the tick cannot charge the same delta.
+ */
+static void uid_entry_charge_io(struct uid_entry *uid_entry,
+				struct task_struct *task)
+{
+	struct task_io_accounting *last = task_uid_ioac(task);
+	atomic64_t *io = uid_entry->io[READ_ONCE(uid_entry->state)];
+
+	charge_io(&io[UID_SYS_STATS_IO_RCHAR], task->ioac.rchar, &last->rchar);
+	charge_io(&io[UID_SYS_STATS_IO_WCHAR], task->ioac.wchar, &last->wchar);
+	charge_io(&io[UID_SYS_STATS_IO_READ_BYTES], task->ioac.read_bytes,
+		  &last->read_bytes);
+	charge_io(&io[UID_SYS_STATS_IO_WRITE_BYTES], compute_write_bytes(task),
+		  &last->write_bytes);
+	charge_io(&io[UID_SYS_STATS_IO_FSYNC], task->ioac.syscfs,
+		  &last->syscfs);
+}
+
+#ifdef CONFIG_UID_SYS_STATS_DEBUG
 static void compute_io_bucket_stats(struct io_stats *io_bucket,
 					struct io_stats *io_curr,
 					struct io_stats *io_last,
@@ -119,7 +229,6 @@ static void compute_io_bucket_stats(struct io_stats *io_bucket,
 	memset(io_dead, 0, sizeof(struct io_stats));
 }
 
-#ifdef CONFIG_UID_SYS_STATS_DEBUG
 static void get_full_task_comm(struct task_entry *task_entry,
 		struct task_struct *task)
 {
@@ -290,96 +399,193 @@ static void show_io_uid_tasks(struct seq_file *m, struct uid_entry *uid_entry)
 }
 #else
 static void remove_uid_tasks(struct uid_entry *uid_entry) {};
-static void set_io_uid_tasks_zero(struct uid_entry *uid_entry) {};
 static void add_uid_tasks_io_stats(struct uid_entry *uid_entry,
 		struct task_struct *task, int slot) {};
-static void compute_io_uid_tasks(struct uid_entry *uid_entry) {};
 static void show_io_uid_tasks(struct seq_file *m,
 		struct uid_entry *uid_entry) {}
 #endif
 
+/*
+ * Entries are keyed by the uid in init_user_ns, so that the accounting
+ * hooks do not depend on the namespace of whatever task happens to run.
+ * Readers and writers translate to and from their own namespace.
+ */
+static inline uid_t task_entry_uid(struct task_struct *task)
+{
+	return from_kuid_munged(&init_user_ns, task_uid(task));
+}
+
+static inline uid_t uid_entry_show_uid(struct seq_file *m,
+				       struct uid_entry *uid_entry)
+{
+	return from_kuid_munged(seq_user_ns(m),
+				make_kuid(&init_user_ns, uid_entry->uid));
+}
+
+/* Caller must hold rcu_read_lock() */
 static struct uid_entry *find_uid_entry(uid_t uid)
 {
 	struct uid_entry *uid_entry;
-	hash_for_each_possible(hash_table, uid_entry, hash, uid) {
+	hash_for_each_possible_rcu(hash_table, uid_entry, hash, uid) {
 		if (uid_entry->uid == uid)
 			return uid_entry;
 	}
 	return NULL;
 }
 
+/* Caller must hold rcu_read_lock() */
 static struct uid_entry *find_or_register_uid(uid_t uid)
 {
 	struct uid_entry *uid_entry;
+	unsigned long flags;
 
 	uid_entry = find_uid_entry(uid);
 	if (uid_entry)
 		return uid_entry;
 
+	spin_lock_irqsave(&uid_hash_lock, flags);
+	uid_entry = find_uid_entry(uid);
+	if (uid_entry)
+		goto out;
+
 	uid_entry = kzalloc(sizeof(struct uid_entry), GFP_ATOMIC);
 	if (!uid_entry)
-		return NULL;
+		goto out;
 
 	uid_entry->uid = uid;
+	uid_entry_touch(uid_entry);
 #ifdef CONFIG_UID_SYS_STATS_DEBUG
 	hash_init(uid_entry->task_entries);
 #endif
-	hash_add(hash_table, &uid_entry->hash, uid);
-
+	hash_add_rcu(hash_table, &uid_entry->hash, uid);
+out:
+	spin_unlock_irqrestore(&uid_hash_lock, flags);
 	return uid_entry;
 }
 
-static int uid_cputime_show(struct seq_file *m, void *v)
+#ifdef CONFIG_UID_SYS_STATS_DEBUG
+/*
+ * The per-task statistics still come from a walk of all threads, of the
+ * tasks of @only if set. The per-uid totals do not depend on it.
+ */
+static void update_io_tasks_locked(struct uid_entry *only)
 {
 	struct uid_entry *uid_entry = NULL;
 	struct task_struct *task, *temp;
-	struct user_namespace *user_ns = current_user_ns();
-	cputime_t utime;
-	cputime_t stime;
 	unsigned long bkt;
 	uid_t uid;
 
-	rt_mutex_lock(&uid_lock);
-
-	hash_for_each(hash_table, bkt, uid_entry, hash) {
-		uid_entry->active_stime = 0;
-		uid_entry->active_utime = 0;
-	}
+	rcu_read_lock();
+	if (only)
+		set_io_uid_tasks_zero(only);
+	else
+		hash_for_each_rcu(hash_table, bkt, uid_entry, hash)
+			set_io_uid_tasks_zero(uid_entry);
 
-	read_lock(&tasklist_lock);
+	uid_entry = NULL;
 	do_each_thread(temp, task) {
-		uid = from_kuid_munged(user_ns, task_uid(task));
-		if (!uid_entry || uid_entry->uid != uid)
-			uid_entry = find_or_register_uid(uid);
-		if (!uid_entry) {
-			read_unlock(&tasklist_lock);
-			rt_mutex_unlock(&uid_lock);
-			pr_err("%s: failed to find the uid_entry for uid %d\n",
-				__func__, uid);
-			return -ENOMEM;
-		}
 		/* avoid double accounting of dying threads */
-		if (!(task->flags & PF_EXITING)) {
-			task_cputime_adjusted(task, &utime, &stime);
-			uid_entry->active_utime += utime;
-			uid_entry->active_stime += stime;
+		if (task->flags & PF_EXITING)
+			continue;
+		uid = task_entry_uid(task);
+		if (only) {
+			if (uid != only->uid)
+				continue;
+			uid_entry = only;
+		} else if (!uid_entry || uid_entry->uid != uid) {
+			uid_entry = find_uid_entry(uid);
 		}
+		if (!uid_entry)
+			continue;
+		add_uid_tasks_io_stats(uid_entry, task, UID_STATE_TOTAL_CURR);
 	} while_each_thread(temp, task);
-	read_unlock(&tasklist_lock);
-
-	hash_for_each(hash_table, bkt, uid_entry, hash) {
-		cputime_t total_utime = uid_entry->utime +
-							uid_entry->active_utime;
-		cputime_t total_stime = uid_entry->stime +
-							uid_entry->active_stime;
-		seq_printf(m, "%d: %llu %llu\n", uid_entry->uid,
-			(unsigned long long)jiffies_to_msecs(
-				cputime_to_jiffies(total_utime)) * USEC_PER_MSEC,
-			(unsigned long long)jiffies_to_msecs(
-				cputime_to_jiffies(total_stime)) * USEC_PER_MSEC);
+
+	if (only)
+		compute_io_uid_tasks(only);
+	else
+		hash_for_each_rcu(hash_table, bkt, uid_entry, hash)
+			compute_io_uid_tasks(uid_entry);
+	rcu_read_unlock();
+}
+#else
+static void update_io_tasks_locked(struct uid_entry *only) {}
+#endif
+
+/*
+ * Called from the cputime accounting of the tick. Also charges the I/O the
+ * running task did since it was last charged, so that a task that keeps
+ * running is not reported late.
+ */
+void uid_sys_stats_account_cputime(struct task_struct *p, cputime_t cputime,
+				   bool user)
+{
+	struct uid_entry *uid_entry;
+	unsigned long flags;
+	uid_t uid;
+
+	rcu_read_lock();
+	uid = task_entry_uid(p);
+	uid_entry = find_or_register_uid(uid);
+	if (uid_entry) {
+		atomic64_add((__force u64)cputime,
+			     user ? &uid_entry->utime : &uid_entry->stime);
+		if (p == current) {
+			local_irq_save(flags);
+			uid_entry_charge_io(uid_entry, p);
+			local_irq_restore(flags);
+		}
+		uid_entry_touch(uid_entry);
 	}
+	rcu_read_unlock();
+}
 
-	rt_mutex_unlock(&uid_lock);
+/*
+ * Called with the runqueue lock held, so nothing is allocated here: the
+ * I/O of a uid without an entry yet is charged at its next tick or exit.
+ */
+void uid_sys_stats_task_switch(struct task_struct *prev)
+{
+	struct uid_entry *uid_entry;
+
+	if (!task_io_changed(prev))
+		return;
+
+	rcu_read_lock();
+	uid_entry = find_uid_entry(task_entry_uid(prev));
+	if (uid_entry) {
+		uid_entry_charge_io(uid_entry, prev);
+		uid_entry_touch(uid_entry);
+	}
+	rcu_read_unlock();
+}
+
+static u64 uid_cputime_us(atomic64_t *cputime)
+{
+	cputime_t total = (__force cputime_t)atomic64_read(cputime);
+
+	return (u64)jiffies_to_msecs(cputime_to_jiffies(total)) *
+		USEC_PER_MSEC;
+}
+
+#define uid_io_read(uid_entry, state, item) \
+	((unsigned long long)atomic64_read( \
+		&(uid_entry)->io[state][UID_SYS_STATS_IO_##item]))
+
+static int uid_cputime_show(struct seq_file *m, void *v)
+{
+	struct uid_entry *uid_entry;
+	unsigned long bkt;
+	u64 start = local_clock();
+
+	rcu_read_lock();
+	hash_for_each_rcu(hash_table, bkt, uid_entry, hash) {
+		seq_printf(m, "%d: %llu %llu\n", uid_entry_show_uid(m, uid_entry),
+			uid_cputime_us(&uid_entry->utime),
+			uid_cputime_us(&uid_entry->stime));
+	}
+	rcu_read_unlock();
+
+	uid_read_cost_update(UID_READ_CPUTIME, start);
 	return 0;
 }
 
@@ -395,6 +601,106 @@ static const struct file_operations uid_cputime_fops = {
 	.release	= single_release,
 };
 
+static int uid_stat_bin_show(struct seq_file *m, void *v)
+{
+	u64 *since = m->private;
+	struct uid_sys_stats_header hdr = {
+		.version	= UID_SYS_STATS_VERSION,
+		.record_size	= sizeof(struct uid_sys_stats_record),
+	};
+	struct uid_sys_stats_record rec;
+	struct uid_entry *uid_entry;
+	unsigned long bkt;
+	u64 start = local_clock();
+	u64 epoch;
+	int i, j;
+
+	/* changes racing with this walk are stamped with epoch or later */
+	epoch = atomic64_inc_return(&uid_stats_epoch) - 1;
+
+	seq_write(m, &hdr, sizeof(hdr));
+
+	rcu_read_lock();
+	hash_for_each_rcu(hash_table, bkt, uid_entry, hash) {
+		if (READ_ONCE(uid_entry->epoch) < *since)
+			continue;
+
+		rec.uid = uid_entry_show_uid(m, uid_entry);
+		rec.state = READ_ONCE(uid_entry->state);
+		rec.utime_us = uid_cputime_us(&uid_entry->utime);
+		rec.stime_us = uid_cputime_us(&uid_entry->stime);
+		for (i = 0; i < UID_SYS_STATS_NR_STATES; i++)
+			for (j = 0; j < UID_SYS_STATS_NR_IO; j++)
+				rec.io[i][j] = atomic64_read(&uid_entry->io[i][j]);
+		seq_write(m, &rec, sizeof(rec));
+	}
+	rcu_read_unlock();
+
+	/* seq_read() calls us again with a larger buffer on overflow */
+	if (!seq_has_overflowed(m))
+		*since = epoch;
+
+	uid_read_cost_update(UID_READ_BIN, start);
+	return 0;
+}
+
+static int uid_stat_bin_open(struct inode *inode, struct file *file)
+{
+	u64 *since;
+	int ret;
+
+	since = kzalloc(sizeof(*since), GFP_KERNEL);
+	if (!since)
+		return -ENOMEM;
+
+	ret = single_open(file, uid_stat_bin_show, since);
+	if (ret)
+		kfree(since);
+	return ret;
+}
+
+static int uid_stat_bin_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *m = file->private_data;
+
+	kfree(m->private);
+	return single_release(inode, file);
+}
+
+static const struct file_operations uid_stat_bin_fops = {
+	.open		= uid_stat_bin_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= uid_stat_bin_release,
+};
+
+static int uid_read_cost_show(struct seq_file *m, void *v)
+{
+	int i;
+
+	seq_printf(m, "nr_threads: %d\n", nr_threads);
+	for (i = 0; i < UID_READ_NR; i++) {
+		struct uid_read_cost *cost = &uid_read_cost[i];
+
+		seq_printf(m, "%s: last %llu ns (%d threads) max %llu ns (%d threads)\n",
+			uid_read_names[i], cost->last_ns, cost->last_threads,
+			cost->max_ns, cost->max_threads);
+	}
+	return 0;
+}
+
+static int uid_read_cost_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, uid_read_cost_show, PDE_DATA(inode));
+}
+
+static const struct file_operations uid_read_cost_fops = {
+	.open		= uid_read_cost_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int uid_remove_open(struct inode *inode, struct file *file)
 {
 	return single_open(file, NULL, NULL);
@@ -408,6 +714,7 @@ static ssize_t uid_remove_write(struct file *file,
 	char uids[128];
 	char *start_uid, *end_uid = NULL;
 	long int uid_start = 0, uid_end = 0;
+	unsigned long flags;
 
 	if (count >= sizeof(uids))
 		count = sizeof(uids) - 1;
@@ -433,14 +740,23 @@ static ssize_t uid_remove_write(struct file *file,
 	rt_mutex_lock(&uid_lock);
 
 	for (; uid_start <= uid_end; uid_start++) {
+		kuid_t kuid = make_kuid(current_user_ns(), uid_start);
+		uid_t uid;
+
+		if (!uid_valid(kuid))
+			continue;
+		uid = from_kuid(&init_user_ns, kuid);
+
+		spin_lock_irqsave(&uid_hash_lock, flags);
 		hash_for_each_possible_safe(hash_table, uid_entry, tmp,
-							hash, (uid_t)uid_start) {
-			if (uid_start == uid_entry->uid) {
+							hash, uid) {
+			if (uid == uid_entry->uid) {
+				hash_del_rcu(&uid_entry->hash);
 				remove_uid_tasks(uid_entry);
-				hash_del(&uid_entry->hash);
-				kfree(uid_entry);
+				kfree_rcu(uid_entry, rcu);
 			}
 		}
+		spin_unlock_irqrestore(&uid_hash_lock, flags);
 	}
 
 	rt_mutex_unlock(&uid_lock);
@@ -454,110 +770,38 @@ static const struct file_operations uid_remove_fops = {
 };
 
 
-static void add_uid_io_stats(struct uid_entry *uid_entry,
-			struct task_struct *task, int slot)
-{
-	struct io_stats *io_slot = &uid_entry->io[slot];
-
-	/* avoid double accounting of dying threads */
-	if (slot != UID_STATE_DEAD_TASKS && (task->flags & PF_EXITING))
-		return;
-
-	io_slot->read_bytes += task->ioac.read_bytes;
-	io_slot->write_bytes += compute_write_bytes(task);
-	io_slot->rchar += task->ioac.rchar;
-	io_slot->wchar += task->ioac.wchar;
-	io_slot->fsync += task->ioac.syscfs;
-
-	add_uid_tasks_io_stats(uid_entry, task, slot);
-}
-
-static void update_io_stats_all_locked(void)
-{
-	struct uid_entry *uid_entry = NULL;
-	struct task_struct *task, *temp;
-	struct user_namespace *user_ns = current_user_ns();
-	unsigned long bkt;
-	uid_t uid;
-
-	hash_for_each(hash_table, bkt, uid_entry, hash) {
-		memset(&uid_entry->io[UID_STATE_TOTAL_CURR], 0,
-			sizeof(struct io_stats));
-		set_io_uid_tasks_zero(uid_entry);
-	}
-
-	rcu_read_lock();
-	do_each_thread(temp, task) {
-		uid = from_kuid_munged(user_ns, task_uid(task));
-		if (!uid_entry || uid_entry->uid != uid)
-			uid_entry = find_or_register_uid(uid);
-		if (!uid_entry)
-			continue;
-		add_uid_io_stats(uid_entry, task, UID_STATE_TOTAL_CURR);
-	} while_each_thread(temp, task);
-	rcu_read_unlock();
-
-	hash_for_each(hash_table, bkt, uid_entry, hash) {
-		compute_io_bucket_stats(&uid_entry->io[uid_entry->state],
-					&uid_entry->io[UID_STATE_TOTAL_CURR],
-					&uid_entry->io[UID_STATE_TOTAL_LAST],
-					&uid_entry->io[UID_STATE_DEAD_TASKS]);
-		compute_io_uid_tasks(uid_entry);
-	}
-}
-
-static void update_io_stats_uid_locked(struct uid_entry *uid_entry)
-{
-	struct task_struct *task, *temp;
-	struct user_namespace *user_ns = current_user_ns();
-
-	memset(&uid_entry->io[UID_STATE_TOTAL_CURR], 0,
-		sizeof(struct io_stats));
-	set_io_uid_tasks_zero(uid_entry);
-
-	rcu_read_lock();
-	do_each_thread(temp, task) {
-		if (from_kuid_munged(user_ns, task_uid(task)) != uid_entry->uid)
-			continue;
-		add_uid_io_stats(uid_entry, task, UID_STATE_TOTAL_CURR);
-	} while_each_thread(temp, task);
-	rcu_read_unlock();
-
-	compute_io_bucket_stats(&uid_entry->io[uid_entry->state],
-				&uid_entry->io[UID_STATE_TOTAL_CURR],
-				&uid_entry->io[UID_STATE_TOTAL_LAST],
-				&uid_entry->io[UID_STATE_DEAD_TASKS]);
-	compute_io_uid_tasks(uid_entry);
-}
-
-
 static int uid_io_show(struct seq_file *m, void *v)
 {
 	struct uid_entry *uid_entry;
 	unsigned long bkt;
+	u64 start = local_clock();
 
 	rt_mutex_lock(&uid_lock);
 
-	update_io_stats_all_locked();
+	update_io_tasks_locked(NULL);
 
-	hash_for_each(hash_table, bkt, uid_entry, hash) {
+	rcu_read_lock();
+	hash_for_each_rcu(hash_table, bkt, uid_entry, hash) {
 		seq_printf(m, "%d %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu\n",
-				uid_entry->uid,
-				uid_entry->io[UID_STATE_FOREGROUND].rchar,
-				uid_entry->io[UID_STATE_FOREGROUND].wchar,
-				uid_entry->io[UID_STATE_FOREGROUND].read_bytes,
-				uid_entry->io[UID_STATE_FOREGROUND].write_bytes,
-				uid_entry->io[UID_STATE_BACKGROUND].rchar,
-				uid_entry->io[UID_STATE_BACKGROUND].wchar,
-				uid_entry->io[UID_STATE_BACKGROUND].read_bytes,
-				uid_entry->io[UID_STATE_BACKGROUND].write_bytes,
-				uid_entry->io[UID_STATE_FOREGROUND].fsync,
-				uid_entry->io[UID_STATE_BACKGROUND].fsync);
+				uid_entry_show_uid(m, uid_entry),
+				uid_io_read(uid_entry, UID_STATE_FOREGROUND, RCHAR),
+				uid_io_read(uid_entry, UID_STATE_FOREGROUND, WCHAR),
+				uid_io_read(uid_entry, UID_STATE_FOREGROUND, READ_BYTES),
+				uid_io_read(uid_entry, UID_STATE_FOREGROUND, WRITE_BYTES),
+				uid_io_read(uid_entry, UID_STATE_BACKGROUND, RCHAR),
+				uid_io_read(uid_entry, UID_STATE_BACKGROUND, WCHAR),
+				uid_io_read(uid_entry, UID_STATE_BACKGROUND, READ_BYTES),
+				uid_io_read(uid_entry, UID_STATE_BACKGROUND, WRITE_BYTES),
+				uid_io_read(uid_entry, UID_STATE_FOREGROUND, FSYNC),
+				uid_io_read(uid_entry, UID_STATE_BACKGROUND, FSYNC));
 
 		show_io_uid_tasks(m, uid_entry);
 	}
+	rcu_read_unlock();
 
 	rt_mutex_unlock(&uid_lock);
+
+	uid_read_cost_update(UID_READ_IO, start);
 	return 0;
 }
 
@@ -583,6 +827,7 @@ static ssize_t uid_procstat_write(struct file *file,
 {
 	struct uid_entry *uid_entry;
 	uid_t uid;
+	kuid_t kuid;
 	int argc, state;
 	char input[128];
 
@@ -601,9 +846,17 @@ static ssize_t uid_procstat_write(struct file *file,
 	if (state != UID_STATE_BACKGROUND && state != UID_STATE_FOREGROUND)
 		return -EINVAL;
 
+	kuid = make_kuid(current_user_ns(), uid);
+	if (!uid_valid(kuid))
+		return -EINVAL;
+	uid = from_kuid(&init_user_ns, kuid);
+
 	rt_mutex_lock(&uid_lock);
 
+	/* entries are only removed under uid_lock */
+	rcu_read_lock();
 	uid_entry = find_or_register_uid(uid);
+	rcu_read_unlock();
 	if (!uid_entry) {
 		rt_mutex_unlock(&uid_lock);
 		return -EINVAL;
@@ -614,9 +867,14 @@ static ssize_t uid_procstat_write(struct file *file,
 		return count;
 	}
 
-	update_io_stats_uid_locked(uid_entry);
+	update_io_tasks_locked(uid_entry);
 
-	uid_entry->state = state;
+	/*
+	 * Sleeping tasks were charged when they were switched out, so only
+	 * what running tasks did since their last tick goes to the new state.
+	 */
+	WRITE_ONCE(uid_entry->state, state);
+	uid_entry_touch(uid_entry);
 
 	rt_mutex_unlock(&uid_lock);
 
@@ -634,25 +892,30 @@ static int process_notifier(struct notifier_block *self,
 {
 	struct task_struct *task = v;
 	struct uid_entry *uid_entry;
-	cputime_t utime, stime;
+	unsigned long flags;
 	uid_t uid;
 
 	if (!task)
 		return NOTIFY_OK;
 
 	rt_mutex_lock(&uid_lock);
-	uid = from_kuid_munged(current_user_ns(), task_uid(task));
+	rcu_read_lock();
+	uid = task_entry_uid(task);
 	uid_entry = find_or_register_uid(uid);
 	if (!uid_entry) {
+		rcu_read_unlock();
 		pr_err("%s: failed to find uid %d\n", __func__, uid);
 		goto exit;
 	}
 
-	task_cputime_adjusted(task, &utime, &stime);
-	uid_entry->utime += utime;
-	uid_entry->stime += stime;
+	/* cputime is charged by the tick, only the last I/O is left */
+	local_irq_save(flags);
+	uid_entry_charge_io(uid_entry, task);
+	local_irq_restore(flags);
+	uid_entry_touch(uid_entry);
+	rcu_read_unlock();
 
-	add_uid_io_stats(uid_entry, task, UID_STATE_DEAD_TASKS);
+	add_uid_tasks_io_stats(uid_entry, task, UID_STATE_DEAD_TASKS);
 
 exit:
 	rt_mutex_unlock(&uid_lock);
@@ -678,6 +941,10 @@ static int __init proc_uid_sys_stats_init(void)
 		&uid_remove_fops, NULL);
 	proc_create_data("show_uid_stat", 0444, cpu_parent,
 		&uid_cputime_fops, NULL);
+	proc_create_data("show_uid_stat_bin", 0444, cpu_parent,
+		&uid_stat_bin_fops, NULL);
+	proc_create_data("read_cost", 0444, cpu_parent,
+		&uid_read_cost_fops, NULL);
 
 	io_parent = proc_mkdir("uid_io", NULL);
 	if (!io_parent) {
@@ -17,6 +17,7 @@
 #include <net/sock.h>
 #include <linux/hrtimer.h>
 #include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 
 
 #define RET_OK   0
@@ -28,6 +29,23 @@ static int last_kill_pid = -1;
 
 int freecess_fw_version = 0;    // record freecess framework version
 
+static atomic_long_t freecess_stat[NR_FREECESS_STAT];
+static atomic_long_t msg_sent[MOD_END];
+static atomic_long_t msg_failed[MOD_END];
+
+static const char * const freecess_stat_name[NR_FREECESS_STAT] = {
+	"binder_deferred",
+	"binder_coalesced",
+	"binder_overflow",
+	"binder_aggregated",
+	"binder_epoch",
+	"pkg_hit",
+};
+
+static const char * const mod_name[MOD_END] = {
+	"noop", "binder", "sig", "pkg", "cfb",
+};
+
 struct priv_data
 {
 	int target_uid;
@@ -74,7 +92,40 @@ static void dump_kfreecess_msg(struct kfreecess_msg_data *msg)
 }
 
 
-int mod_sendmsg(int type, int mod, struct priv_data* data)
+void freecess_stat_inc(enum freecess_stat_item item)
+{
+	atomic_long_inc(&freecess_stat[item]);
+}
+
+static int freecess_stat_show(struct seq_file *m, void *v)
+{
+	int i;
+
+	for (i = 0; i < NR_FREECESS_STAT; i++)
+		seq_printf(m, "%s %ld\n", freecess_stat_name[i],
+			   atomic_long_read(&freecess_stat[i]));
+
+	for (i = 1; i < MOD_END; i++)
+		seq_printf(m, "msg_%s %ld %ld\n", mod_name[i],
+			   atomic_long_read(&msg_sent[i]),
+			   atomic_long_read(&msg_failed[i]));
+
+	return 0;
+}
+
+static int freecess_stat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, freecess_stat_show, NULL);
+}
+
+static const struct file_operations freecess_stat_fops = {
+	.open		= freecess_stat_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __mod_sendmsg(int type, int mod, struct priv_data* data)
 {
 	int ret, msg_len = 0;
 	struct sk_buff *skb = NULL;
@@ -133,6 +184,20 @@ int mod_sendmsg(int type, int mod, struct priv_data* data)
 	return RET_OK;
 }
 
+int mod_sendmsg(int type, int mod, struct priv_data* data)
+{
+	int ret = __mod_sendmsg(type, mod, data);
+
+	if (check_mod_type(mod) && type == MSG_TO_USER) {
+		if (ret == RET_OK)
+			atomic_long_inc(&msg_sent[mod]);
+		else
+			atomic_long_inc(&msg_failed[mod]);
+	}
+
+	return ret;
+}
+
 int sig_report(struct task_struct *p)
 {
 	int ret = RET_OK;
@@ -287,12 +352,16 @@ static int __init kfreecess_init(void)
 	for(i = 1; i<MOD_END; i++)
 		atomic_set(&bind_port[i], 0);
 
+	if (!proc_create("freecess_stat", S_IRUGO, NULL, &freecess_stat_fops))
+		pr_err("%s: create /proc/freecess_stat failed\n", __func__);
+
 	atomic_set(&kfreecess_init_suc, 1);
 	return RET_OK;
 }
 
 static void __exit kfreecess_exit(void)
 {
+	remove_proc_entry("freecess_stat", NULL);
 	if (kfreecess_mod_sock)
 		netlink_kernel_release(kfreecess_mod_sock);
 }
@@ -10,6 +10,9 @@
 #include <linux/ktime.h>
 #include <linux/time.h>
 #include <linux/list.h>
+#include <linux/hashtable.h>
+#include <linux/rculist.h>
+#include <linux/slab.h>
 #include <linux/types.h>
 #include <net/sock.h>
 #include <net/ip.h>
@@ -19,73 +22,119 @@
 #include <linux/freecess.h>
 
 
-#define MAX_REC_UID 64
-static atomic_t uid_rec[MAX_REC_UID];
+/*
+ * uids userspace wants a report for on their next incoming TCP packet. The
+ * netfilter hooks look them up for every packet, so lookups are lockless
+ * under RCU; a hit removes the uid, so it is reported once.
+ */
+#define MAX_REC_UID		64
+#define UID_HASH_BITS		6
+
+struct uid_rec {
+	struct hlist_node node;
+	uid_t uid;
+	struct rcu_head rcu;
+};
+
+static DEFINE_HASHTABLE(uid_table, UID_HASH_BITS);
+static DEFINE_SPINLOCK(uid_table_lock);
+static unsigned int nr_uid_rec;
 extern void binders_in_transcation(int uid);
 
+static struct uid_rec *__freecess_find_uid(uid_t uid)
+{
+	struct uid_rec *rec;
+
+	hash_for_each_possible_rcu(uid_table, rec, node, uid)
+		if (rec->uid == uid)
+			return rec;
+
+	return NULL;
+}
+
+static void __freecess_del_uid(struct uid_rec *rec)
+{
+	hash_del_rcu(&rec->node);
+	WRITE_ONCE(nr_uid_rec, nr_uid_rec - 1);
+	kfree_rcu(rec, rcu);
+}
+
 static void freecess_add_uid(uid_t uid)
 {
-	int i, j;
-	uid_t inner_uid;
-
-	for (i = 0, j = MAX_REC_UID; i < MAX_REC_UID; i++) {
-		inner_uid = atomic_read(&uid_rec[i]);
-		if (inner_uid == 0 && j == MAX_REC_UID)
-			j = i;
-		else if (inner_uid == uid)
-			goto out;
+	struct uid_rec *rec;
+
+	rec = kmalloc(sizeof(*rec), GFP_KERNEL);
+	if (!rec) {
+		pr_err("%s : add uid:%d failed (nomem)!\n", __func__, uid);
+		return;
 	}
+	rec->uid = uid;
 
-	if (j < MAX_REC_UID)
-		atomic_set(&uid_rec[j], uid);
-	else
+	spin_lock_bh(&uid_table_lock);
+	if (__freecess_find_uid(uid)) {
+		spin_unlock_bh(&uid_table_lock);
+		kfree(rec);
+		return;
+	}
+	if (nr_uid_rec >= MAX_REC_UID) {
+		spin_unlock_bh(&uid_table_lock);
+		kfree(rec);
 		pr_err("%s : add uid:%d failed (full)!\n", __func__, uid);
-out:
-
-	return;
+		return;
+	}
+	hash_add_rcu(uid_table, &rec->node, uid);
+	WRITE_ONCE(nr_uid_rec, nr_uid_rec + 1);
+	spin_unlock_bh(&uid_table_lock);
 }
 
 static void freecess_del_uid(uid_t uid)
 {
-	int i;
-	uid_t inner_uid;
-	
-	for (i = 0; i < MAX_REC_UID; i++) {
-		inner_uid = (uid_t)atomic_read(&uid_rec[i]);
-		if (inner_uid == uid) {
-			atomic_set(&uid_rec[i], 0);
-			break;
-		}
-	}
+	struct uid_rec *rec;
 
-	return;
+	spin_lock_bh(&uid_table_lock);
+	rec = __freecess_find_uid(uid);
+	if (rec)
+		__freecess_del_uid(rec);
+	spin_unlock_bh(&uid_table_lock);
 }
 
 static void freecess_clear_all(void)
 {
-	int i;
-
-	for (i = 0; i < MAX_REC_UID; i++) {
-		atomic_set(&uid_rec[i], 0);
-	}
-
-	return;
+	struct hlist_node *tmp;
+	struct uid_rec *rec;
+	int bkt;
+
+	spin_lock_bh(&uid_table_lock);
+	hash_for_each_safe(uid_table, bkt, tmp, rec, node)
+		__freecess_del_uid(rec);
+	spin_unlock_bh(&uid_table_lock);
 }
 
 static int find_and_clear_uid(uid_t uid)
 {
+	struct uid_rec *rec;
 	int found = 0;
-	int i = 0;
-	uid_t inner_uid;
-
-	for (i = 0; i < MAX_REC_UID; i++) {
-		inner_uid = atomic_read(&uid_rec[i]);
-		if (unlikely (inner_uid == uid)) {
-			if (atomic_cmpxchg(&uid_rec[i], uid, 0) == uid)
-				found = 1;
-			break;
-		}
+
+	if (!READ_ONCE(nr_uid_rec))
+		return 0;
+
+	rcu_read_lock();
+	rec = __freecess_find_uid(uid);
+	rcu_read_unlock();
+	if (likely(!rec))
+		return 0;
+
+	/* only one of concurrent lookups gets to report the uid */
+	spin_lock_bh(&uid_table_lock);
+	rec = __freecess_find_uid(uid);
+	if (rec) {
+		__freecess_del_uid(rec);
+		found = 1;
 	}
+	spin_unlock_bh(&uid_table_lock);
+
+	if (found)
+		freecess_stat_inc(FREECESS_STAT_PKG_HIT);
 
 	return found;
 }
@@ -241,12 +290,8 @@ static struct nf_hook_ops freecess_nf_ops[] = {
 static int __init kfreecess_pkg_init(void)
 {
 	int ret;
-	int i;
 	struct net *net;
 
-	for (i = 0; i < MAX_REC_UID; i++)
-		atomic_set(&uid_rec[i], 0);
-	
 	rtnl_lock();
 	for_each_net(net) {
 		ret = nf_register_net_hooks(net, freecess_nf_ops,
@@ -289,6 +334,8 @@ static void __exit kfreecess_pkg_exit(void)
 					ARRAY_SIZE(freecess_nf_ops));
 	}
 	rtnl_unlock();
+
+	freecess_clear_all();
 }
 
 
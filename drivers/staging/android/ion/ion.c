@@ -34,6 +34,7 @@
 #include <linux/seq_file.h>
 #include <linux/uaccess.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 #include <linux/debugfs.h>
 #include <linux/dma-buf.h>
 #include <linux/idr.h>
@@ -497,6 +498,73 @@ err2:
 	return ERR_PTR(ret);
 }
 
+#ifdef CONFIG_ION_EXYNOS_LAZY_IOVMM_UNMAP
+/*
+ * Mappings whose map_cnt dropped to zero stay on buffer->iovas so that the
+ * next ion_iovmm_map() for the same domain is a list lookup rather than a
+ * System MMU page table update and TLB invalidation. They are also linked on
+ * ion_iovm_lru so that they can be released under memory pressure or on an
+ * explicit flush. ion_iovm_lru_lock nests inside buffer->lock.
+ */
+static LIST_HEAD(ion_iovm_lru);
+static DEFINE_SPINLOCK(ion_iovm_lru_lock);
+static DEFINE_MUTEX(ion_iovm_release_lock);
+static unsigned long ion_iovm_lru_count;
+static atomic_long_t ion_iovm_cache_hits = ATOMIC_LONG_INIT(0);
+static atomic_long_t ion_iovm_cache_misses = ATOMIC_LONG_INIT(0);
+static atomic_long_t ion_iovm_cache_released = ATOMIC_LONG_INIT(0);
+
+/* Must be called under buffer->lock held */
+static void ion_iovm_cache_get(struct ion_iovm_map *iovm_map)
+{
+	spin_lock(&ion_iovm_lru_lock);
+	if (!list_empty(&iovm_map->lru)) {
+		list_del_init(&iovm_map->lru);
+		ion_iovm_lru_count--;
+	}
+	spin_unlock(&ion_iovm_lru_lock);
+}
+
+/* Must be called under buffer->lock held */
+static bool ion_iovm_cache_put(struct ion_iovm_map *iovm_map)
+{
+	spin_lock(&ion_iovm_lru_lock);
+	list_add_tail(&iovm_map->lru, &ion_iovm_lru);
+	ion_iovm_lru_count++;
+	spin_unlock(&ion_iovm_lru_lock);
+
+	return true;
+}
+
+static void ion_iovm_cache_remove(struct ion_iovm_map *iovm_map)
+{
+	ion_iovm_cache_get(iovm_map);
+}
+
+static void ion_iovm_cache_account(struct device *dev, bool hit)
+{
+	atomic_long_inc(hit ? &ion_iovm_cache_hits : &ion_iovm_cache_misses);
+	iovmm_account_map_cache(dev, hit);
+}
+#else
+static inline void ion_iovm_cache_get(struct ion_iovm_map *iovm_map)
+{
+}
+
+static inline bool ion_iovm_cache_put(struct ion_iovm_map *iovm_map)
+{
+	return false;
+}
+
+static inline void ion_iovm_cache_remove(struct ion_iovm_map *iovm_map)
+{
+}
+
+static inline void ion_iovm_cache_account(struct device *dev, bool hit)
+{
+}
+#endif
+
 void ion_buffer_destroy(struct ion_buffer *buffer)
 {
 	struct ion_iovm_map *iovm_map;
@@ -510,6 +578,7 @@ void ion_buffer_destroy(struct ion_buffer *buffer)
 		buffer->heap->ops->unmap_kernel(buffer->heap, buffer);
 
 	list_for_each_entry_safe(iovm_map, tmp, &buffer->iovas, list) {
+		ion_iovm_cache_remove(iovm_map);
 		iovmm_unmap(iovm_map->dev, iovm_map->iova);
 		list_del(&iovm_map->list);
 		kfree(iovm_map);
@@ -553,6 +622,215 @@ static int ion_buffer_put(struct ion_buffer *buffer)
 	return kref_put(&buffer->ref, _ion_buffer_destroy);
 }
 
+#ifdef CONFIG_ION_EXYNOS_LAZY_IOVMM_UNMAP
+static LLIST_HEAD(ion_iovm_put_list);
+
+static void ion_iovm_put_work_fn(struct work_struct *work)
+{
+	struct llist_node *node = llist_del_all(&ion_iovm_put_list);
+	struct ion_buffer *buffer, *tmp;
+
+	llist_for_each_entry_safe(buffer, tmp, node, iovm_put)
+		ion_buffer_put(buffer);
+}
+
+static DECLARE_WORK(ion_iovm_put_work, ion_iovm_put_work_fn);
+
+/*
+ * The final put of a buffer takes dev->buffer_lock, which nests outside
+ * buffer->lock. Without @may_block the caller may hold another buffer lock
+ * or be in reclaim, so the last reference is dropped by a worker instead.
+ */
+static void ion_iovm_buffer_put(struct ion_buffer *buffer, bool may_block)
+{
+	if (may_block) {
+		ion_buffer_put(buffer);
+		return;
+	}
+
+	if (atomic_add_unless(&buffer->ref.refcount, -1, 1))
+		return;
+
+	if (llist_add(&buffer->iovm_put, &ion_iovm_put_list))
+		schedule_work(&ion_iovm_put_work);
+}
+
+/*
+ * Releases up to @nr_to_scan idle mappings, only those of @domain if it is
+ * not NULL. The buffer lock is only tried and the last buffer reference is
+ * never dropped here if @may_block is false, so that it is safe to call from
+ * reclaim and with another buffer lock held.
+ * Must be called under ion_iovm_release_lock held.
+ */
+static unsigned long __ion_iovm_cache_release(struct iommu_domain *domain,
+				unsigned long nr_to_scan, bool may_block)
+{
+	struct ion_iovm_map *iovm_map;
+	struct ion_buffer *buffer;
+	unsigned long released = 0;
+	bool idle;
+
+	while (nr_to_scan--) {
+		spin_lock(&ion_iovm_lru_lock);
+		if (list_empty(&ion_iovm_lru)) {
+			spin_unlock(&ion_iovm_lru_lock);
+			break;
+		}
+
+		iovm_map = list_first_entry(&ion_iovm_lru,
+					    struct ion_iovm_map, lru);
+		list_move_tail(&iovm_map->lru, &ion_iovm_lru);
+		buffer = iovm_map->buffer;
+		/* the buffer being destroyed unmaps its iovas by itself */
+		if ((domain && (iovm_map->domain != domain)) ||
+				!kref_get_unless_zero(&buffer->ref)) {
+			spin_unlock(&ion_iovm_lru_lock);
+			continue;
+		}
+		spin_unlock(&ion_iovm_lru_lock);
+
+		if (may_block) {
+			mutex_lock(&buffer->lock);
+		} else if (!mutex_trylock(&buffer->lock)) {
+			ion_iovm_buffer_put(buffer, false);
+			continue;
+		}
+
+		/* ion_iovmm_map() may have revived the mapping meanwhile */
+		spin_lock(&ion_iovm_lru_lock);
+		idle = !iovm_map->map_cnt && !list_empty(&iovm_map->lru);
+		if (idle) {
+			list_del_init(&iovm_map->lru);
+			ion_iovm_lru_count--;
+		}
+		spin_unlock(&ion_iovm_lru_lock);
+
+		if (idle) {
+			list_del(&iovm_map->list);
+			pr_debug("%s: release cached %pa for dev %s\n",
+				 __func__, &iovm_map->iova,
+				 dev_name(iovm_map->dev));
+			iovmm_unmap(iovm_map->dev, iovm_map->iova);
+			kfree(iovm_map);
+			released++;
+		}
+
+		mutex_unlock(&buffer->lock);
+		ion_iovm_buffer_put(buffer, may_block);
+	}
+
+	atomic_long_add(released, &ion_iovm_cache_released);
+
+	return released;
+}
+
+static unsigned long ion_iovm_cache_release(struct iommu_domain *domain,
+					    bool may_block)
+{
+	unsigned long released;
+
+	if (may_block)
+		mutex_lock(&ion_iovm_release_lock);
+	else if (!mutex_trylock(&ion_iovm_release_lock))
+		return 0;
+
+	released = __ion_iovm_cache_release(domain,
+				ACCESS_ONCE(ion_iovm_lru_count), may_block);
+	mutex_unlock(&ion_iovm_release_lock);
+
+	return released;
+}
+
+/**
+ * ion_iovmm_flush_cache - release idle cached mappings of a device
+ * @dev:	the device whose mappings are released, or NULL for all
+ *
+ * Drivers call this before their IOVMM goes away or when they want their
+ * IOVA space back. Mappings still in use are not touched. Must not be called
+ * with an ion buffer lock held.
+ */
+void ion_iovmm_flush_cache(struct device *dev)
+{
+	struct iommu_domain *domain = NULL;
+
+	if (dev) {
+		domain = get_domain_from_dev(dev);
+		if (!domain)
+			return;
+	}
+
+	ion_iovm_cache_release(domain, true);
+}
+EXPORT_SYMBOL(ion_iovmm_flush_cache);
+
+static unsigned long ion_iovm_cache_count(struct shrinker *shrinker,
+					  struct shrink_control *sc)
+{
+	return ACCESS_ONCE(ion_iovm_lru_count);
+}
+
+static unsigned long ion_iovm_cache_scan(struct shrinker *shrinker,
+					 struct shrink_control *sc)
+{
+	unsigned long released;
+
+	if (!mutex_trylock(&ion_iovm_release_lock))
+		return SHRINK_STOP;
+
+	released = __ion_iovm_cache_release(NULL, sc->nr_to_scan, false);
+	mutex_unlock(&ion_iovm_release_lock);
+
+	return released;
+}
+
+static struct shrinker ion_iovm_cache_shrinker = {
+	.count_objects = ion_iovm_cache_count,
+	.scan_objects = ion_iovm_cache_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
+static int ion_debug_iovm_cache_show(struct seq_file *s, void *unused)
+{
+	seq_printf(s, "%16.s %16.s %16.s %16.s\n",
+		   "cached", "hits", "misses", "released");
+	seq_printf(s, "%16lu %16ld %16ld %16ld\n",
+		   ACCESS_ONCE(ion_iovm_lru_count),
+		   atomic_long_read(&ion_iovm_cache_hits),
+		   atomic_long_read(&ion_iovm_cache_misses),
+		   atomic_long_read(&ion_iovm_cache_released));
+
+	return 0;
+}
+
+static int ion_debug_iovm_cache_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ion_debug_iovm_cache_show, inode->i_private);
+}
+
+/* any write releases all idle cached mappings */
+static ssize_t ion_debug_iovm_cache_write(struct file *file,
+			const char __user *buf, size_t count, loff_t *ppos)
+{
+	ion_iovm_cache_release(NULL, true);
+
+	return count;
+}
+
+static const struct file_operations debug_iovm_cache_fops = {
+	.open = ion_debug_iovm_cache_open,
+	.read = seq_read,
+	.write = ion_debug_iovm_cache_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+#else
+static inline unsigned long ion_iovm_cache_release(struct iommu_domain *domain,
+						   bool may_block)
+{
+	return 0;
+}
+#endif
+
 static void ion_buffer_add_to_handle(struct ion_buffer *buffer)
 {
 	mutex_lock(&buffer->lock);
@@ -2516,6 +2794,12 @@ struct ion_device *ion_device_create(long (*custom_ioctl)
 	if (!idev->event_debug_file)
 		pr_err("%s: failed to create event debug file\n", __func__);
 #endif
+#ifdef CONFIG_ION_EXYNOS_LAZY_IOVMM_UNMAP
+	if (!debugfs_create_file("iovm_cache", 0664, idev->debug_root, idev,
+				 &debug_iovm_cache_fops))
+		pr_err("%s: failed to create iovm cache debug file\n",
+		       __func__);
+#endif
 
 debugfs_done:
 
@@ -2529,6 +2813,10 @@ debugfs_done:
 	/* backup of ion device: assumes there is only one ion device */
 	g_idev = idev;
 
+#ifdef CONFIG_ION_EXYNOS_LAZY_IOVMM_UNMAP
+	register_shrinker(&ion_iovm_cache_shrinker);
+#endif
+
 	return idev;
 }
 EXPORT_SYMBOL(ion_device_create);
@@ -2592,6 +2880,14 @@ static struct ion_iovm_map *ion_buffer_iova_create(struct ion_buffer *buffer,
 
 	iovm_map->iova = iovmm_map(dev, buffer->sg_table->sgl,
 					0, buffer->size, dir, prop);
+	/*
+	 * Idle cached mappings may be what exhausted the IOVA space. Only
+	 * trylock other buffers here because this buffer's lock is held.
+	 */
+	if (iovm_map->iova == (dma_addr_t)-ENOMEM &&
+	    ion_iovm_cache_release(get_domain_from_dev(dev), false))
+		iovm_map->iova = iovmm_map(dev, buffer->sg_table->sgl,
+					0, buffer->size, dir, prop);
 
 	if (iovm_map->iova == (dma_addr_t)-ENOSYS) {
 		size_t len;
@@ -2617,6 +2913,10 @@ static struct ion_iovm_map *ion_buffer_iova_create(struct ion_buffer *buffer,
 	iovm_map->dev = dev;
 	iovm_map->domain = get_domain_from_dev(dev);
 	iovm_map->map_cnt = 1;
+#ifdef CONFIG_ION_EXYNOS_LAZY_IOVMM_UNMAP
+	INIT_LIST_HEAD(&iovm_map->lru);
+	iovm_map->buffer = buffer;
+#endif
 
 	pr_debug("%s: new map added for dev %s, iova %pa, prop %d\n", __func__,
 		 dev_name(dev), &iovm_map->iova, prop);
@@ -2657,8 +2957,10 @@ dma_addr_t ion_iovmm_map(struct dma_buf_attachment *attachment,
 	mutex_lock(&buffer->lock);
 	list_for_each_entry(iovm_map, &buffer->iovas, list) {
 		if (domain == iovm_map->domain) {
-			iovm_map->map_cnt++;
+			if (iovm_map->map_cnt++ == 0)
+				ion_iovm_cache_get(iovm_map);
 			mutex_unlock(&buffer->lock);
+			ion_iovm_cache_account(attachment->dev, true);
 			return iovm_map->iova;
 		}
 	}
@@ -2675,6 +2977,7 @@ dma_addr_t ion_iovmm_map(struct dma_buf_attachment *attachment,
 
 	list_add_tail(&iovm_map->list, &buffer->iovas);
 	mutex_unlock(&buffer->lock);
+	ion_iovm_cache_account(attachment->dev, false);
 
 	return iovm_map->iova;
 }
@@ -2702,7 +3005,8 @@ void ion_iovmm_unmap(struct dma_buf_attachment *attachment, dma_addr_t iova)
 	mutex_lock(&buffer->lock);
 	list_for_each_entry(iovm_map, &buffer->iovas, list) {
 		if ((domain == iovm_map->domain) && (iova == iovm_map->iova)) {
-			if (--iovm_map->map_cnt == 0) {
+			if (--iovm_map->map_cnt == 0 &&
+					!ion_iovm_cache_put(iovm_map)) {
 				list_del(&iovm_map->list);
 				pr_debug("%s: unmap previous %pa for dev %s\n",
 					 __func__, &iovm_map->iova,
@@ -248,6 +248,11 @@ dma_addr_t ion_iovmm_map(struct dma_buf_attachment *attachment,
 			 off_t offset, size_t size,
 			 enum dma_data_direction direction, int prop);
 void ion_iovmm_unmap(struct dma_buf_attachment *attachment, dma_addr_t iova);
+#ifdef CONFIG_ION_EXYNOS_LAZY_IOVMM_UNMAP
+void ion_iovmm_flush_cache(struct device *dev);
+#else
+static inline void ion_iovmm_flush_cache(struct device *dev) { }
+#endif
 bool ion_is_heap_available(struct ion_heap *heap, unsigned long flags, void *data);
 
 #endif /* _LINUX_ION_H */
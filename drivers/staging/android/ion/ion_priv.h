@@ -20,6 +20,7 @@
 #include <linux/device.h>
 #include <linux/dma-direction.h>
 #include <linux/kref.h>
+#include <linux/llist.h>
 #include <linux/mm_types.h>
 #include <linux/mutex.h>
 #include <linux/rbtree.h>
@@ -60,6 +61,11 @@ struct ion_iovm_map {
 	struct device *dev;
 	struct iommu_domain *domain;
 	dma_addr_t iova;
+#ifdef CONFIG_ION_EXYNOS_LAZY_IOVMM_UNMAP
+	/* on the idle mapping lru while map_cnt is zero */
+	struct list_head lru;
+	struct ion_buffer *buffer;
+#endif
 };
 
 /**
@@ -116,6 +122,10 @@ struct ion_buffer {
 	int handle_count;
 	char task_comm[TASK_COMM_LEN];
 	pid_t pid;
+#ifdef CONFIG_ION_EXYNOS_LAZY_IOVMM_UNMAP
+	/* last reference handed to ion_iovm_put_work */
+	struct llist_node iovm_put;
+#endif
 
 #ifdef CONFIG_ION_EXYNOS_STAT_LOG
 	struct list_head master_list;
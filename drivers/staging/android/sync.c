@@ -34,6 +34,13 @@
 static const struct fence_ops android_fence_ops;
 static const struct file_operations sync_fence_fops;
 
+/*
+ * Fences with up to SYNC_FENCE_INLINE_PTS sync_pts, i.e. nearly all of them
+ * once merges are deduplicated per timeline, come from a dedicated slab.
+ */
+#define SYNC_FENCE_INLINE_PTS	4
+static struct kmem_cache *sync_fence_cache;
+
 struct sync_timeline *sync_timeline_create(const struct sync_timeline_ops *ops,
 					   int size, const char *name)
 {
@@ -150,11 +157,26 @@ void sync_pt_free(struct sync_pt *pt)
 }
 EXPORT_SYMBOL(sync_pt_free);
 
-static struct sync_fence *sync_fence_alloc(int size, const char *name)
+static void sync_fence_kfree(struct sync_fence *fence)
+{
+	if (fence->cached)
+		kmem_cache_free(sync_fence_cache, fence);
+	else
+		kfree(fence);
+}
+
+static struct sync_fence *sync_fence_alloc(int num_fences, const char *name)
 {
 	struct sync_fence *fence;
 
-	fence = kzalloc(size, GFP_KERNEL);
+	if (num_fences <= SYNC_FENCE_INLINE_PTS && sync_fence_cache) {
+		fence = kmem_cache_zalloc(sync_fence_cache, GFP_KERNEL);
+		if (fence)
+			fence->cached = true;
+	} else {
+		fence = kzalloc(offsetof(struct sync_fence, cbs[num_fences]),
+				GFP_KERNEL);
+	}
 	if (fence == NULL)
 		return NULL;
 
@@ -172,7 +194,7 @@ static struct sync_fence *sync_fence_alloc(int size, const char *name)
 	return fence;
 
 err:
-	kfree(fence);
+	sync_fence_kfree(fence);
 	return NULL;
 }
 
@@ -193,7 +215,7 @@ struct sync_fence *sync_fence_create(const char *name, struct sync_pt *pt)
 {
 	struct sync_fence *fence;
 
-	fence = sync_fence_alloc(offsetof(struct sync_fence, cbs[1]), name);
+	fence = sync_fence_alloc(1, name);
 	if (fence == NULL)
 		return NULL;
 
@@ -245,6 +267,10 @@ EXPORT_SYMBOL(sync_fence_install);
 static void sync_fence_add_pt(struct sync_fence *fence,
 			      int *i, struct fence *pt)
 {
+	/* left out by sync_fence_merge_count(), so there is no room for it */
+	if (fence_is_signaled(pt))
+		return;
+
 	fence->cbs[*i].sync_pt = pt;
 	fence->cbs[*i].fence = fence;
 
@@ -254,15 +280,55 @@ static void sync_fence_add_pt(struct sync_fence *fence,
 	}
 }
 
+/*
+ * Number of sync_pts a merge of a and b ends up with: one per timeline,
+ * leaving out those that already signaled.
+ */
+static int sync_fence_merge_count(struct sync_fence *a, struct sync_fence *b)
+{
+	int num_fences = 0;
+	int i_a, i_b;
+
+	for (i_a = i_b = 0; i_a < a->num_fences && i_b < b->num_fences; ) {
+		struct fence *pt_a = a->cbs[i_a].sync_pt;
+		struct fence *pt_b = b->cbs[i_b].sync_pt;
+		struct fence *pt;
+
+		if (pt_a->context < pt_b->context) {
+			pt = pt_a;
+			i_a++;
+		} else if (pt_a->context > pt_b->context) {
+			pt = pt_b;
+			i_b++;
+		} else {
+			pt = pt_a->seqno - pt_b->seqno <= INT_MAX ? pt_a : pt_b;
+			i_a++;
+			i_b++;
+		}
+
+		if (!fence_is_signaled(pt))
+			num_fences++;
+	}
+
+	for (; i_a < a->num_fences; i_a++)
+		if (!fence_is_signaled(a->cbs[i_a].sync_pt))
+			num_fences++;
+
+	for (; i_b < b->num_fences; i_b++)
+		if (!fence_is_signaled(b->cbs[i_b].sync_pt))
+			num_fences++;
+
+	return num_fences;
+}
+
 struct sync_fence *sync_fence_merge(const char *name,
 				    struct sync_fence *a, struct sync_fence *b)
 {
-	int num_fences = a->num_fences + b->num_fences;
+	int num_fences = sync_fence_merge_count(a, b);
 	struct sync_fence *fence;
 	int i, i_a, i_b;
-	unsigned long size = offsetof(struct sync_fence, cbs[num_fences]);
 
-	fence = sync_fence_alloc(size, name);
+	fence = sync_fence_alloc(num_fences, name);
 	if (fence == NULL)
 		return NULL;
 
@@ -553,7 +619,7 @@ static void sync_fence_free(struct kref *kref)
 		fence_put(fence->cbs[i].sync_pt);
 	}
 
-	kfree(fence);
+	sync_fence_kfree(fence);
 }
 
 static int sync_fence_release(struct inode *inode, struct file *file)
@@ -735,6 +801,117 @@ static long sync_fence_ioctl_set_name(struct sync_fence *fence,
 	return ret;
 }
 
+struct sync_wait_multi {
+	struct sync_fence *fence[SYNC_WAIT_MULTI_MAX];
+	wait_queue_t wait[SYNC_WAIT_MULTI_MAX];
+	__s32 fd[SYNC_WAIT_MULTI_MAX];
+	__s32 status[SYNC_WAIT_MULTI_MAX];
+};
+
+/* returns whether the wait is satisfied and fills mw->status */
+static bool sync_wait_multi_check(struct sync_wait_multi *mw, int num_fds,
+				  bool any, __s32 *index)
+{
+	int signaled = 0;
+	int i;
+
+	*index = -1;
+	for (i = 0; i < num_fds; i++) {
+		int status = atomic_read(&mw->fence[i]->status);
+
+		mw->status[i] = status < 0 ? status : !status;
+		if (status <= 0) {
+			if (*index < 0)
+				*index = i;
+			signaled++;
+		}
+	}
+
+	return any ? signaled > 0 : signaled == num_fds;
+}
+
+static long sync_fence_ioctl_wait_multi(unsigned long arg)
+{
+	struct sync_wait_multi_data data;
+	struct sync_wait_multi *mw;
+	long timeout;
+	bool any;
+	long ret = 0;
+	int i, n;
+
+	if (copy_from_user(&data, (void __user *)arg, sizeof(data)))
+		return -EFAULT;
+
+	if (!data.num_fds || data.num_fds > SYNC_WAIT_MULTI_MAX ||
+	    data.flags & ~SYNC_WAIT_MULTI_ANY)
+		return -EINVAL;
+
+	mw = kmalloc(sizeof(*mw), GFP_KERNEL);
+	if (!mw)
+		return -ENOMEM;
+
+	if (copy_from_user(mw->fd, u64_to_user_ptr(data.fds),
+			   data.num_fds * sizeof(__s32))) {
+		ret = -EFAULT;
+		goto out_free;
+	}
+
+	for (n = 0; n < data.num_fds; n++) {
+		mw->fence[n] = sync_fence_fdget(mw->fd[n]);
+		if (!mw->fence[n]) {
+			ret = -ENOENT;
+			goto out_put;
+		}
+	}
+
+	if (data.timeout < 0)
+		timeout = MAX_SCHEDULE_TIMEOUT;
+	else
+		timeout = msecs_to_jiffies(data.timeout);
+	any = data.flags & SYNC_WAIT_MULTI_ANY;
+
+	for (i = 0; i < n; i++) {
+		init_waitqueue_entry(&mw->wait[i], current);
+		add_wait_queue(&mw->fence[i]->wq, &mw->wait[i]);
+	}
+
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (sync_wait_multi_check(mw, n, any, &data.index))
+			break;
+		if (signal_pending(current)) {
+			ret = -ERESTARTSYS;
+			break;
+		}
+		if (!timeout) {
+			ret = -ETIME;
+			break;
+		}
+		timeout = schedule_timeout(timeout);
+	}
+	__set_current_state(TASK_RUNNING);
+
+	for (i = 0; i < n; i++)
+		remove_wait_queue(&mw->fence[i]->wq, &mw->wait[i]);
+
+	if (ret == -ERESTARTSYS)
+		goto out_put;
+
+	if (data.status &&
+	    copy_to_user(u64_to_user_ptr(data.status), mw->status,
+			 n * sizeof(__s32)))
+		ret = -EFAULT;
+	else if (copy_to_user((void __user *)arg, &data, sizeof(data)))
+		ret = -EFAULT;
+
+out_put:
+	while (n--)
+		sync_fence_put(mw->fence[n]);
+out_free:
+	kfree(mw);
+	return ret;
+}
+
 static long sync_fence_ioctl(struct file *file, unsigned int cmd,
 			     unsigned long arg)
 {
@@ -753,6 +930,9 @@ static long sync_fence_ioctl(struct file *file, unsigned int cmd,
 	case SYNC_IOC_FENCE_NAME:
 		return sync_fence_ioctl_set_name(fence, (char *)arg);
 
+	case SYNC_IOC_WAIT_MULTI:
+		return sync_fence_ioctl_wait_multi(arg);
+
 	default:
 		return -ENOTTY;
 	}
@@ -765,3 +945,14 @@ static const struct file_operations sync_fence_fops = {
 	.compat_ioctl = sync_fence_ioctl,
 };
 
+static int __init sync_fence_cache_init(void)
+{
+	sync_fence_cache = kmem_cache_create("sync_fence",
+			offsetof(struct sync_fence, cbs[SYNC_FENCE_INLINE_PTS]),
+			0, SLAB_HWCACHE_ALIGN, NULL);
+	if (!sync_fence_cache)
+		pr_warn("sync: no sync_fence cache, using kmalloc\n");
+
+	return 0;
+}
+core_initcall(sync_fence_cache_init);
@@ -159,6 +159,7 @@ struct sync_fence {
 	struct list_head	sync_fence_list;
 #endif
 	int num_fences;
+	bool cached;
 
 	wait_queue_head_t	wq;
 	atomic_t		status;
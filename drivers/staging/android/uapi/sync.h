@@ -62,6 +62,29 @@ struct sync_fence_info_data {
 	__u8	pt_info[0];
 };
 
+/**
+ * struct sync_wait_multi_data - data passed to the multi-fence wait ioctl
+ * @fds:	user pointer to an array of @num_fds fence fds
+ * @status:	user pointer to an array of @num_fds __s32 that returns each
+ *		fence's status (1: signaled 0: active <0: error), or 0
+ * @num_fds:	number of fences, at most SYNC_WAIT_MULTI_MAX
+ * @flags:	SYNC_WAIT_MULTI_ANY to return once any fence signaled,
+ *		otherwise waits for all of them
+ * @timeout:	timeout in milliseconds, < 0 waits forever, 0 only polls
+ * @index:	returns the index of the first signaled fence, or -1
+ */
+struct sync_wait_multi_data {
+	__u64	fds;
+	__u64	status;
+	__u32	num_fds;
+	__u32	flags;
+	__s32	timeout;
+	__s32	index;
+};
+
+#define SYNC_WAIT_MULTI_ANY	(1 << 0)
+#define SYNC_WAIT_MULTI_MAX	32
+
 #define SYNC_IOC_MAGIC		'>'
 
 /**
@@ -100,4 +123,16 @@ struct sync_fence_info_data {
 
 #define SYNC_IOC_FENCE_NAME	_IOWR(SYNC_IOC_MAGIC, 10, char[32])
 
+/**
+ * DOC: SYNC_IOC_WAIT_MULTI - wait for or poll several fences
+ *
+ * Takes a struct sync_wait_multi_data. May be issued on any fence fd, the
+ * fences waited for are only those listed in fds. Returns 0 once all (or,
+ * with SYNC_WAIT_MULTI_ANY, any) of them signaled or hit an error, -ETIME
+ * when the timeout expired first. status and index are filled in either
+ * case.
+ */
+#define SYNC_IOC_WAIT_MULTI	_IOWR(SYNC_IOC_MAGIC, 11,\
+	struct sync_wait_multi_data)
+
 #endif /* _UAPI_LINUX_SYNC_H */
@@ -450,7 +450,7 @@ static int handle_vsoc_cond_wait(struct file *filp, struct vsoc_cond_wait *arg)
 		hrtimer_init_on_stack(&to->timer, CLOCK_MONOTONIC,
 				      HRTIMER_MODE_ABS);
 		hrtimer_set_expires_range_ns(&to->timer, timespec_to_ktime(ts),
-					     current->timer_slack_ns);
+					     task_timer_slack(current));
 
 		hrtimer_init_sleeper(to, current);
 	}
@@ -0,0 +1,489 @@
+/*
+ * A model predictive governor to manage temperature
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed "as is" WITHOUT ANY WARRANTY of any
+ * kind, whether express or implied; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#define pr_fmt(fmt) "Model predictive: " fmt
+
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/thermal.h>
+
+#include "mpc_model.h"
+#include "thermal_core.h"
+
+#define INVALID_TRIP -1
+
+#define MPC_DEFAULT_HORIZON_MS	3000
+#define MPC_DEFAULT_TAU_MS	20000
+#define MPC_DEFAULT_AMBIENT	25000
+
+/**
+ * struct model_predictive_params - parameters for the model predictive governor
+ * @trip_switch_on:	first passive trip point of the thermal zone. From
+ *			this temperature on the zone is polled at the passive
+ *			rate. INVALID_TRIP if there is only one passive trip.
+ * @trip_control:	last passive trip point of the thermal zone. The
+ *			forecast is kept at or below its temperature.
+ * @model:		thermal model of the zone, fitted online
+ * @last_sample:	time of the last sample fed to @model
+ * @horizon_ms:		how far ahead the temperature is forecast
+ * @requested:		power requested by the actors at the last update
+ * @budget:		power granted at the last update
+ * @delivered:		power the actors can draw within their grants
+ * @dt_ms:		time since the previous update
+ * @forecast:		temperature forecast at the requested power
+ * @emul_tau_ms:	time constant of the emulated zone, 0 disables it
+ * @emul_mC_per_W:	steady state temperature rise of the emulated zone
+ * @emul_ambient:	ambient temperature of the emulated zone
+ * @emul_temp:		current temperature of the emulated zone
+ * @emul_plant:		model of the emulated zone
+ * @debugfs:		debugfs directory of the zone
+ */
+struct model_predictive_params {
+	int trip_switch_on;
+	int trip_control;
+	struct mpc_model model;
+	ktime_t last_sample;
+	u32 horizon_ms;
+	u32 requested;
+	u32 budget;
+	u32 delivered;
+	u32 dt_ms;
+	s32 forecast;
+	u32 emul_tau_ms;
+	u32 emul_mC_per_W;
+	u32 emul_ambient;
+	s32 emul_temp;
+	struct mpc_model emul_plant;
+	struct dentry *debugfs;
+};
+
+static struct dentry *mpc_debugfs_root;
+
+/*
+ * Share @budget between the actors so that the least performance is lost:
+ * actors requesting less than their weighted share of what is left get
+ * all they asked for, the others split the rest by weight. Power left
+ * once all requests are met is handed out up to each actor's maximum,
+ * so that a satisfied actor can still ramp up.
+ */
+static void divide_power(u32 *req_power, u32 *max_power, u32 *weight,
+			 int num_actors, u32 budget, u32 *granted_power)
+{
+	u64 total_weight, total_headroom;
+	bool progress;
+	int i;
+
+	for (i = 0; i < num_actors; i++)
+		granted_power[i] = 0;
+
+	do {
+		total_weight = 0;
+		for (i = 0; i < num_actors; i++)
+			total_weight += weight[i];
+		if (!total_weight)
+			break;
+
+		progress = false;
+		for (i = 0; i < num_actors; i++) {
+			u64 share;
+
+			if (!weight[i])
+				continue;
+
+			share = div64_u64((u64)budget * weight[i], total_weight);
+			if (req_power[i] <= share) {
+				granted_power[i] = req_power[i];
+				budget -= req_power[i];
+				weight[i] = 0;
+				progress = true;
+			}
+		}
+
+		if (!progress) {
+			for (i = 0; i < num_actors; i++)
+				if (weight[i])
+					granted_power[i] = div64_u64(
+						(u64)budget * weight[i],
+						total_weight);
+			return;
+		}
+	} while (budget);
+
+	total_headroom = 0;
+	for (i = 0; i < num_actors; i++)
+		total_headroom += max_power[i] - granted_power[i];
+
+	if (!budget || !total_headroom)
+		return;
+
+	budget = min_t(u64, budget, total_headroom);
+	for (i = 0; i < num_actors; i++)
+		granted_power[i] += div64_u64((u64)budget *
+				(max_power[i] - granted_power[i]),
+				total_headroom);
+}
+
+static int allocate_power(struct thermal_zone_device *tz, int switch_on_temp,
+			  int control_temp)
+{
+	struct model_predictive_params *params = tz->governor_data;
+	struct thermal_instance *instance;
+	u32 *req_power, *max_power, *weight, *granted_power;
+	u32 total_req_power, max_allocatable_power, budget;
+	unsigned int steps;
+	ktime_t now;
+	int i, num_actors, total_weight, ret = 0;
+
+	mutex_lock(&tz->lock);
+
+	num_actors = 0;
+	total_weight = 0;
+	list_for_each_entry(instance, &tz->thermal_instances, tz_node) {
+		if ((instance->trip == params->trip_control) &&
+		    cdev_is_power_actor(instance->cdev)) {
+			num_actors++;
+			total_weight += instance->weight;
+		}
+	}
+
+	if (!num_actors) {
+		ret = -ENODEV;
+		goto unlock;
+	}
+
+	req_power = kcalloc(num_actors * 4, sizeof(*req_power), GFP_KERNEL);
+	if (!req_power) {
+		ret = -ENOMEM;
+		goto unlock;
+	}
+
+	max_power = &req_power[num_actors];
+	weight = &req_power[2 * num_actors];
+	granted_power = &req_power[3 * num_actors];
+
+	i = 0;
+	total_req_power = 0;
+	max_allocatable_power = 0;
+
+	list_for_each_entry(instance, &tz->thermal_instances, tz_node) {
+		struct thermal_cooling_device *cdev = instance->cdev;
+
+		if (instance->trip != params->trip_control)
+			continue;
+
+		if (!cdev_is_power_actor(cdev))
+			continue;
+
+		if (cdev->ops->get_requested_power(cdev, tz, &req_power[i]))
+			continue;
+
+		if (power_actor_get_max_power(cdev, tz, &max_power[i]))
+			continue;
+
+		if (req_power[i] == 0)
+			req_power[i] = 1;
+		req_power[i] = min(req_power[i], max_power[i]);
+
+		weight[i] = total_weight ? instance->weight : 1;
+
+		total_req_power += req_power[i];
+		max_allocatable_power += max_power[i];
+
+		i++;
+	}
+	num_actors = i;
+
+	/*
+	 * The requested power is what the actors draw at their current
+	 * state, i.e. the power that heated the zone up to now.
+	 */
+	now = ktime_get();
+	params->dt_ms = params->last_sample.tv64 ?
+			ktime_ms_delta(now, params->last_sample) : 0;
+	params->last_sample = now;
+	mpc_model_add_sample(&params->model, tz->temperature, total_req_power,
+			     params->dt_ms);
+	mpc_model_fit(&params->model);
+
+	steps = DIV_ROUND_UP(params->horizon_ms, MPC_STEP_MS);
+	params->forecast = mpc_model_forecast(&params->model, tz->temperature,
+					      total_req_power, steps);
+
+	if (params->forecast <= control_temp && tz->temperature < control_temp)
+		budget = max_allocatable_power;
+	else
+		budget = mpc_model_power_budget(&params->model,
+						tz->temperature, control_temp,
+						steps, max_allocatable_power);
+
+	tz->passive = tz->temperature >= switch_on_temp ||
+		      budget < max_allocatable_power;
+
+	divide_power(req_power, max_power, weight, num_actors, budget,
+		     granted_power);
+
+	params->delivered = 0;
+	i = 0;
+	list_for_each_entry(instance, &tz->thermal_instances, tz_node) {
+		if (instance->trip != params->trip_control)
+			continue;
+
+		if (!cdev_is_power_actor(instance->cdev))
+			continue;
+
+		if (i == num_actors)
+			break;
+
+		power_actor_set_power(instance->cdev, instance,
+				      granted_power[i]);
+		params->delivered += min(req_power[i], granted_power[i]);
+		i++;
+	}
+
+	params->requested = total_req_power;
+	params->budget = budget;
+
+	kfree(req_power);
+unlock:
+	mutex_unlock(&tz->lock);
+
+	return ret;
+}
+
+/*
+ * As for power_allocator: the last passive trip is the temperature to
+ * control for, the first one the switch on temperature.
+ */
+static void get_governor_trips(struct thermal_zone_device *tz,
+			       struct model_predictive_params *params)
+{
+	int i;
+
+	params->trip_switch_on = INVALID_TRIP;
+	params->trip_control = INVALID_TRIP;
+
+	for (i = 0; i < tz->trips; i++) {
+		enum thermal_trip_type type;
+
+		if (tz->ops->get_trip_type(tz, i, &type))
+			continue;
+
+		if (type != THERMAL_TRIP_PASSIVE)
+			continue;
+
+		if (params->trip_control == INVALID_TRIP)
+			params->trip_switch_on = i;
+		params->trip_control = i;
+	}
+
+	if (params->trip_switch_on == params->trip_control)
+		params->trip_switch_on = INVALID_TRIP;
+}
+
+/*
+ * Closed-loop test without heating the SoC: with emul_tau_ms set, the zone
+ * is replaced by an RC model driven by the power the actors may draw, and
+ * its temperature is fed back through the sensor's emulation interface
+ * (exynos_tmu_set_emulation() on Exynos), so that the trip and cooling
+ * device paths run as they would for real. Writing 0 to emul_tau_ms and
+ * to the zone's emul_temp ends the test.
+ */
+static void model_predictive_emulate(struct thermal_zone_device *tz)
+{
+	struct model_predictive_params *params = tz->governor_data;
+	unsigned int steps;
+
+	if (!params->emul_tau_ms || !tz->ops->set_emul_temp) {
+		params->emul_temp = 0;
+		return;
+	}
+
+	if (!params->emul_temp)
+		params->emul_temp = tz->temperature;
+
+	mpc_model_init(&params->emul_plant, params->emul_tau_ms,
+		       params->emul_ambient,
+		       params->emul_ambient + params->emul_mC_per_W, 1000);
+
+	steps = max(DIV_ROUND_CLOSEST(params->dt_ms, MPC_STEP_MS), 1U);
+	params->emul_temp = mpc_model_forecast(&params->emul_plant,
+					       params->emul_temp,
+					       params->delivered, steps);
+
+	tz->ops->set_emul_temp(tz, params->emul_temp);
+}
+
+static int model_show(struct seq_file *m, void *v)
+{
+	struct thermal_zone_device *tz = m->private;
+	struct model_predictive_params *params;
+	struct mpc_model *model;
+
+	mutex_lock(&tz->lock);
+	params = tz->governor_data;
+	model = &params->model;
+
+	seq_printf(m, "tau_ms: %u\n", mpc_model_tau_ms(model));
+	seq_printf(m, "ambient: %d\n", mpc_model_ambient(model));
+	seq_printf(m, "mC_per_W: %lld\n", model->a < 0 ?
+		   div64_s64(model->b * 1000, -model->a) : 0);
+	seq_printf(m, "fits: %u\n", model->fits);
+	seq_printf(m, "rejected: %u\n", model->rejected);
+	seq_printf(m, "requested: %u\n", params->requested);
+	seq_printf(m, "budget: %u\n", params->budget);
+	seq_printf(m, "forecast: %d\n", params->forecast);
+	mutex_unlock(&tz->lock);
+
+	return 0;
+}
+
+static int model_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, model_show, inode->i_private);
+}
+
+static const struct file_operations model_fops = {
+	.open		= model_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void model_predictive_debugfs_init(struct thermal_zone_device *tz)
+{
+	struct model_predictive_params *params = tz->governor_data;
+	char name[THERMAL_NAME_LENGTH];
+
+	if (!mpc_debugfs_root)
+		return;
+
+	snprintf(name, sizeof(name), "thermal_zone%d", tz->id);
+	params->debugfs = debugfs_create_dir(name, mpc_debugfs_root);
+	if (!params->debugfs)
+		return;
+
+	debugfs_create_u32("horizon_ms", 0644, params->debugfs,
+			   &params->horizon_ms);
+	debugfs_create_file("model", 0444, params->debugfs, tz, &model_fops);
+	debugfs_create_u32("emul_tau_ms", 0644, params->debugfs,
+			   &params->emul_tau_ms);
+	debugfs_create_u32("emul_mC_per_W", 0644, params->debugfs,
+			   &params->emul_mC_per_W);
+	debugfs_create_u32("emul_ambient", 0644, params->debugfs,
+			   &params->emul_ambient);
+}
+
+/**
+ * model_predictive_bind() - bind the model_predictive governor to a thermal zone
+ * @tz:	thermal zone to bind it to
+ *
+ * Start the thermal model of the zone from a prior: a time constant of
+ * MPC_DEFAULT_TAU_MS and the sustainable power of the zone, if known,
+ * holding it at the control temperature.
+ *
+ * Return: 0 on success, or -ENOMEM if we ran out of memory.
+ */
+static int model_predictive_bind(struct thermal_zone_device *tz)
+{
+	struct model_predictive_params *params;
+	int control_temp = 0;
+
+	params = kzalloc(sizeof(*params), GFP_KERNEL);
+	if (!params)
+		return -ENOMEM;
+
+	get_governor_trips(tz, params);
+
+	if (params->trip_control != INVALID_TRIP)
+		tz->ops->get_trip_temp(tz, params->trip_control, &control_temp);
+
+	mpc_model_init(&params->model, MPC_DEFAULT_TAU_MS, MPC_DEFAULT_AMBIENT,
+		       control_temp,
+		       tz->tzp ? tz->tzp->sustainable_power : 0);
+	params->horizon_ms = MPC_DEFAULT_HORIZON_MS;
+	params->emul_mC_per_W = 10000;
+	params->emul_ambient = MPC_DEFAULT_AMBIENT;
+
+	tz->governor_data = params;
+	model_predictive_debugfs_init(tz);
+
+	return 0;
+}
+
+static void model_predictive_unbind(struct thermal_zone_device *tz)
+{
+	struct model_predictive_params *params = tz->governor_data;
+
+	dev_dbg(&tz->device, "Unbinding from thermal zone %d\n", tz->id);
+
+	debugfs_remove_recursive(params->debugfs);
+
+	kfree(tz->governor_data);
+	tz->governor_data = NULL;
+}
+
+static int model_predictive_throttle(struct thermal_zone_device *tz, int trip)
+{
+	int ret;
+	int switch_on_temp, control_temp;
+	struct model_predictive_params *params = tz->governor_data;
+
+	/*
+	 * We get called for every trip point but we only need to do
+	 * our calculations once
+	 */
+	if (trip != params->trip_control)
+		return 0;
+
+	ret = tz->ops->get_trip_temp(tz, params->trip_control, &control_temp);
+	if (ret) {
+		dev_warn(&tz->device,
+			 "Failed to get the maximum desired temperature: %d\n",
+			 ret);
+		return ret;
+	}
+
+	if (params->trip_switch_on == INVALID_TRIP ||
+	    tz->ops->get_trip_temp(tz, params->trip_switch_on,
+				   &switch_on_temp))
+		switch_on_temp = control_temp;
+
+	ret = allocate_power(tz, switch_on_temp, control_temp);
+	if (!ret)
+		model_predictive_emulate(tz);
+
+	return ret;
+}
+
+static struct thermal_governor thermal_gov_model_predictive = {
+	.name		= "model_predictive",
+	.bind_to_tz	= model_predictive_bind,
+	.unbind_from_tz	= model_predictive_unbind,
+	.throttle	= model_predictive_throttle,
+};
+
+int thermal_gov_model_predictive_register(void)
+{
+	mpc_debugfs_root = debugfs_create_dir("model_predictive", NULL);
+
+	return thermal_register_governor(&thermal_gov_model_predictive);
+}
+
+void thermal_gov_model_predictive_unregister(void)
+{
+	thermal_unregister_governor(&thermal_gov_model_predictive);
+	debugfs_remove_recursive(mpc_debugfs_root);
+}
@@ -0,0 +1,235 @@
+/*
+ * Thermal model of the model_predictive governor
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed "as is" WITHOUT ANY WARRANTY of any
+ * kind, whether express or implied; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include "mpc_model.h"
+
+#ifdef __KERNEL__
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/string.h>
+#define mpc_div(a, b)	div64_s64(a, b)
+#else
+#include <string.h>
+#define mpc_div(a, b)	((a) / (b))
+#endif
+
+/*
+ * Deviations from the window mean are scaled down before the sums of
+ * products are taken, so that the 2x2 normal equations of a window of
+ * temperatures up to ~150C and powers up to ~20W fit in s64.
+ */
+#define MPC_TEMP_SHIFT		6	/* 64 mC */
+#define MPC_POWER_SHIFT		4	/* 16 mW */
+#define MPC_FIT_FRAC_BITS	10
+
+static inline s64 mul_frac(s64 x, s64 y)
+{
+	return (x * y) >> MPC_FRAC_BITS;
+}
+
+void mpc_model_init(struct mpc_model *model, u32 tau_ms, s32 ambient,
+		    s32 control_temp, u32 sustainable_power)
+{
+	memset(model, 0, sizeof(*model));
+
+	if (tau_ms < 2 * MPC_STEP_MS)
+		tau_ms = 2 * MPC_STEP_MS;
+	if (!sustainable_power)
+		sustainable_power = 1000;
+	if (control_temp - ambient < 1000)
+		ambient = control_temp - 20000;
+
+	/*
+	 * Prior: time constant @tau_ms, and @sustainable_power holds the
+	 * zone at @control_temp.
+	 */
+	model->a = -mpc_div(MPC_ONE * MPC_STEP_MS, tau_ms);
+	model->b = mpc_div(-model->a * (control_temp - ambient),
+			   sustainable_power);
+	model->c = -model->a * ambient;
+}
+
+void mpc_model_add_sample(struct mpc_model *model, s32 temp, u32 power,
+			  u32 dt_ms)
+{
+	struct mpc_sample *s;
+
+	if (model->have_last && dt_ms) {
+		s = &model->samples[model->head];
+		s->temp = model->last_temp;
+		s->power = model->last_power;
+		s->dtemp = mpc_div((s64)(temp - model->last_temp) * MPC_STEP_MS,
+				   dt_ms);
+
+		model->head = (model->head + 1) % MPC_WINDOW;
+		if (model->count < MPC_WINDOW)
+			model->count++;
+	}
+
+	model->last_temp = temp;
+	model->last_power = power;
+	model->have_last = true;
+}
+
+/**
+ * mpc_model_fit() - refit the model over the recorded window
+ * @model:	model to update
+ *
+ * Return: 0 if a new fit was blended in, -1 if the window does not carry
+ * enough information and the model was left alone.
+ */
+int mpc_model_fit(struct mpc_model *model)
+{
+	s64 mean_t = 0, mean_p = 0, mean_d = 0;
+	s64 s_tt = 0, s_pp = 0, s_tp = 0, s_td = 0, s_pd = 0;
+	s64 det, a, b, c;
+	unsigned int i, n = model->count;
+
+	if (n < MPC_MIN_SAMPLES)
+		return -1;
+
+	for (i = 0; i < n; i++) {
+		mean_t += model->samples[i].temp;
+		mean_p += model->samples[i].power;
+		mean_d += model->samples[i].dtemp;
+	}
+	mean_t = mpc_div(mean_t, n);
+	mean_p = mpc_div(mean_p, n);
+	mean_d = mpc_div(mean_d, n);
+
+	for (i = 0; i < n; i++) {
+		s64 t = (model->samples[i].temp - mean_t) / (1 << MPC_TEMP_SHIFT);
+		s64 p = (model->samples[i].power - mean_p) /
+			(1 << MPC_POWER_SHIFT);
+		s64 d = model->samples[i].dtemp - mean_d;
+
+		s_tt += t * t;
+		s_pp += p * p;
+		s_tp += t * p;
+		s_td += t * d;
+		s_pd += p * d;
+	}
+
+	/*
+	 * Without variation of temperature and power, or when they move
+	 * together, their effects cannot be told apart.
+	 */
+	det = s_tt * s_pp - s_tp * s_tp;
+	if (s_tt < n || s_pp < n || det * 16 < s_tt * s_pp)
+		goto reject;
+
+	a = mpc_div((s_td * s_pp - s_pd * s_tp) << MPC_FIT_FRAC_BITS, det);
+	b = mpc_div((s_pd * s_tt - s_td * s_tp) << MPC_FIT_FRAC_BITS, det);
+
+	/* back to unscaled units with MPC_FRAC_BITS */
+	a <<= MPC_FRAC_BITS - MPC_FIT_FRAC_BITS - MPC_TEMP_SHIFT;
+	b <<= MPC_FRAC_BITS - MPC_FIT_FRAC_BITS - MPC_POWER_SHIFT;
+
+	/* a zone has to cool towards ambient and heat up with power */
+	if (a >= 0 || a < -MPC_ONE / 2 || b <= 0)
+		goto reject;
+
+	c = (mean_d << MPC_FRAC_BITS) - a * mean_t - b * mean_p;
+
+	model->a = (3 * model->a + a) / 4;
+	model->b = (3 * model->b + b) / 4;
+	model->c = (3 * model->c + c) / 4;
+	model->fits++;
+
+	return 0;
+
+reject:
+	model->rejected++;
+	return -1;
+}
+
+/**
+ * mpc_model_forecast() - forecast the temperature
+ * @model:	model of the zone
+ * @temp:	current temperature in mC
+ * @power:	power in mW kept for the whole forecast
+ * @steps:	number of MPC_STEP_MS steps to forecast
+ *
+ * Return: the temperature after @steps.
+ */
+s32 mpc_model_forecast(const struct mpc_model *model, s32 temp, u32 power,
+		       unsigned int steps)
+{
+	s64 t = (s64)temp << MPC_FRAC_BITS;
+	unsigned int i;
+
+	for (i = 0; i < steps; i++)
+		t += mul_frac(model->a, t) + model->b * power + model->c;
+
+	return t >> MPC_FRAC_BITS;
+}
+
+/**
+ * mpc_model_power_budget() - highest power keeping the zone below a limit
+ * @model:		model of the zone
+ * @temp:		current temperature in mC
+ * @control_temp:	temperature that must not be exceeded
+ * @steps:		number of MPC_STEP_MS steps to look ahead
+ * @max_power:		power the actors can use at most
+ *
+ * The forecast is linear in the power, so the budget is the lowest of
+ * the power limits that keep each of the next @steps steps at or below
+ * @control_temp. Above @control_temp this asks for enough cooling to be
+ * back at it after one step, as far as the actors allow.
+ *
+ * Return: the power budget in mW, between 0 and @max_power.
+ */
+u32 mpc_model_power_budget(const struct mpc_model *model, s32 temp,
+			   s32 control_temp, unsigned int steps,
+			   u32 max_power)
+{
+	s64 limit = (s64)control_temp << MPC_FRAC_BITS;
+	s64 t = (s64)temp << MPC_FRAC_BITS;	/* forecast at no power */
+	s64 u = 0;				/* forecast per mW */
+	s64 budget = max_power;
+	unsigned int i;
+
+	for (i = 0; i < steps; i++) {
+		s64 p;
+
+		t += mul_frac(model->a, t) + model->c;
+		u += mul_frac(model->a, u) + model->b;
+		if (u <= 0)
+			continue;
+
+		if (t >= limit)
+			return 0;
+
+		p = mpc_div(limit - t, u);
+		if (p < budget)
+			budget = p;
+	}
+
+	return budget;
+}
+
+u32 mpc_model_tau_ms(const struct mpc_model *model)
+{
+	if (model->a >= 0)
+		return 0;
+
+	return mpc_div(-MPC_ONE * MPC_STEP_MS, model->a);
+}
+
+s32 mpc_model_ambient(const struct mpc_model *model)
+{
+	if (model->a >= 0)
+		return 0;
+
+	return mpc_div(-model->c, model->a);
+}
@@ -0,0 +1,105 @@
+/*
+ * Thermal model of the model_predictive governor
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed "as is" WITHOUT ANY WARRANTY of any
+ * kind, whether express or implied; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * This file and mpc_model.c must not depend on the thermal core:
+ * tools/thermal/mpc-replay builds them in userspace to replay recorded
+ * temperature and power traces.
+ */
+
+#ifndef __MPC_MODEL_H__
+#define __MPC_MODEL_H__
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+#include <stdbool.h>
+typedef int32_t s32;
+typedef uint32_t u32;
+typedef int64_t s64;
+#endif
+
+#define MPC_FRAC_BITS		20
+#define MPC_ONE			((s64)1 << MPC_FRAC_BITS)
+
+/* the model advances in steps of this length */
+#define MPC_STEP_MS		100
+/* samples the model is fitted over */
+#define MPC_WINDOW		64
+#define MPC_MIN_SAMPLES		16
+
+/**
+ * struct mpc_sample - one step of recorded history
+ * @temp:	temperature at the start of the step, in millicelsius
+ * @power:	power estimate at the start of the step, in mW
+ * @dtemp:	temperature change over the step, scaled to MPC_STEP_MS
+ */
+struct mpc_sample {
+	s32 temp;
+	s32 power;
+	s32 dtemp;
+};
+
+/**
+ * struct mpc_model - first order (RC) thermal model of a zone
+ * @a:		per-step change of temperature per mC of temperature, this is
+ *		-MPC_STEP_MS / (R * C), fixed point
+ * @b:		per-step change of temperature per mW of power, this is
+ *		MPC_STEP_MS / C, fixed point
+ * @c:		per-step constant term, -a times the ambient temperature,
+ *		fixed point mC
+ * @samples:	ring of the last MPC_WINDOW steps
+ * @head:	next slot of @samples to fill
+ * @count:	valid entries in @samples
+ * @last_temp:	temperature of the previous call to mpc_model_add_sample()
+ * @last_power:	power of the previous call to mpc_model_add_sample()
+ * @have_last:	@last_temp and @last_power are valid
+ * @fits:	fits accepted
+ * @rejected:	fits rejected as ill-conditioned or implausible
+ *
+ * The model is T[k + 1] = T[k] + a * T[k] + b * P[k] + c. It starts from
+ * a prior and is refitted by least squares over the recorded steps. A fit
+ * is only accepted when the window has enough variation of both
+ * temperature and power to tell them apart, and is blended into the
+ * current parameters.
+ */
+struct mpc_model {
+	s64 a;
+	s64 b;
+	s64 c;
+
+	struct mpc_sample samples[MPC_WINDOW];
+	unsigned int head;
+	unsigned int count;
+
+	s32 last_temp;
+	s32 last_power;
+	bool have_last;
+
+	u32 fits;
+	u32 rejected;
+};
+
+void mpc_model_init(struct mpc_model *model, u32 tau_ms, s32 ambient,
+		    s32 control_temp, u32 sustainable_power);
+void mpc_model_add_sample(struct mpc_model *model, s32 temp, u32 power,
+			  u32 dt_ms);
+int mpc_model_fit(struct mpc_model *model);
+s32 mpc_model_forecast(const struct mpc_model *model, s32 temp, u32 power,
+		       unsigned int steps);
+u32 mpc_model_power_budget(const struct mpc_model *model, s32 temp,
+			   s32 control_temp, unsigned int steps,
+			   u32 max_power);
+u32 mpc_model_tau_ms(const struct mpc_model *model);
+s32 mpc_model_ambient(const struct mpc_model *model);
+
+#endif /* __MPC_MODEL_H__ */
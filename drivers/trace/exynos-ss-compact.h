@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2013 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com
+ *
+ * Exynos-SnapShot compact kernel event encoding
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The IRQ, hrtimer and frequency events are written to one ring per CPU
+ * as packed records instead of fixed-size log entries. The first block of
+ * a ring holds its header, the others hold records. A block of records
+ * starts with the absolute time of its first record and each record only
+ * carries the time elapsed since the previous one. Records never straddle
+ * blocks and the ring is overwritten a block at a time, so every block
+ * that survives in a ramdump decodes on its own.
+ *
+ * A record is:
+ *
+ *   u8      type (enum ess_kevent_flag)
+ *   varint  nanoseconds since the previous record of the block
+ *   varint  fields of the type, see ess_compact_decode()
+ *
+ * Varints are LEB128, signed fields are zigzag coded and function
+ * pointers are stored relative to ess_compact_hdr.text_base.
+ *
+ * This file must not depend on the rest of exynos-ss: tools/trace/ess-decode
+ * builds it in userspace to decode the rings of a ramdump.
+ */
+
+#ifndef EXYNOS_SNAPSHOT_COMPACT_H
+#define EXYNOS_SNAPSHOT_COMPACT_H
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int64_t s64;
+#endif
+
+#define ESS_COMPACT_MAGIC		0x43535345	/* "ESSC" */
+#define ESS_COMPACT_VERSION		1
+#define ESS_COMPACT_BLOCK_SZ		1024
+/* type, delta and the five fields of the largest record */
+#define ESS_COMPACT_REC_MAX		64
+
+/* Same values as enum ess_kevent_flag */
+#define ESS_COMPACT_IRQ			5
+#define ESS_COMPACT_FREQ		10
+#define ESS_COMPACT_HRTIMER		12
+
+/**
+ * struct ess_compact_hdr - start of the ring of one CPU
+ * @magic:	ESS_COMPACT_MAGIC, written once the ring is usable
+ * @version:	ESS_COMPACT_VERSION
+ * @cpu:	CPU the ring belongs to
+ * @size:	size of the ring including this header
+ * @block_size:	size of a block including its header
+ * @text_base:	runtime address of _text
+ * @cur:	block being written
+ * @last_time:	time of the last record written
+ */
+struct ess_compact_hdr {
+	u32 magic;
+	u16 version;
+	u16 cpu;
+	u32 size;
+	u32 block_size;
+	u64 text_base;
+	u32 cur;
+	u32 reserved;
+	u64 last_time;
+};
+
+/**
+ * struct ess_compact_block - start of a block
+ * @time:	time of the first record
+ * @seq:	sequence number of the block on its CPU, 0 if never written
+ * @used:	bytes of records following this header
+ */
+struct ess_compact_block {
+	u64 time;
+	u32 seq;
+	u16 used;
+	u16 reserved;
+};
+
+#define ESS_COMPACT_BLOCK_DATA	(ESS_COMPACT_BLOCK_SZ - sizeof(struct ess_compact_block))
+
+/**
+ * struct ess_compact_event - a decoded record
+ * @time:	absolute time
+ * @type:	ESS_COMPACT_IRQ, ESS_COMPACT_FREQ or ESS_COMPACT_HRTIMER
+ * @en:		ESS_FLAG_IN, ESS_FLAG_OUT, ...
+ * @irq:	irq number, negative for SMC calls
+ * @val:	value given with the irq
+ * @preempt:	preempt count when the irq was logged
+ * @fn:		handler, relative to ess_compact_hdr.text_base
+ * @domain:	frequency domain, enum esslog_freq_flag
+ * @old_freq:	frequency before the change
+ * @target_freq: frequency requested
+ * @timer:	address of the hrtimer
+ * @now:	base time of the hrtimer
+ */
+struct ess_compact_event {
+	u64 time;
+	int type;
+	int en;
+	union {
+		struct {
+			int irq;
+			u32 val;
+			u32 preempt;
+			s64 fn;
+		} irq;
+		struct {
+			u32 domain;
+			u64 old_freq;
+			u64 target_freq;
+		} freq;
+		struct {
+			u64 timer;
+			s64 fn;
+			u64 now;
+		} hrtimer;
+	};
+};
+
+static inline u8 *ess_compact_put(u8 *p, u64 v)
+{
+	while (v >= 0x80) {
+		*p++ = (u8)v | 0x80;
+		v >>= 7;
+	}
+	*p++ = (u8)v;
+	return p;
+}
+
+static inline u8 *ess_compact_put_signed(u8 *p, s64 v)
+{
+	return ess_compact_put(p, ((u64)v << 1) ^ (u64)(v >> 63));
+}
+
+static inline const u8 *ess_compact_get(const u8 *p, const u8 *end, u64 *v)
+{
+	unsigned int shift = 0;
+
+	*v = 0;
+	while (p < end && shift < 64) {
+		u8 c = *p++;
+
+		*v |= (u64)(c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return p;
+		shift += 7;
+	}
+	return NULL;
+}
+
+static inline const u8 *ess_compact_get_signed(const u8 *p, const u8 *end,
+					       s64 *v)
+{
+	u64 u;
+
+	p = ess_compact_get(p, end, &u);
+	*v = (s64)(u >> 1) ^ -(s64)(u & 1);
+	return p;
+}
+
+/**
+ * ess_compact_decode - decode the record at @p
+ * @p:		record
+ * @end:	end of the records of the block
+ * @time:	time of the previous record, updated
+ * @ev:		decoded record
+ *
+ * Returns the next record, or NULL if the record at @p is cut or unknown,
+ * in which case the rest of the block cannot be decoded.
+ */
+static inline const u8 *ess_compact_decode(const u8 *p, const u8 *end,
+					   u64 *time,
+					   struct ess_compact_event *ev)
+{
+	u64 delta, v[4];
+	s64 s;
+
+	if (p >= end)
+		return NULL;
+	ev->type = *p++;
+	p = ess_compact_get(p, end, &delta);
+	if (!p)
+		return NULL;
+	*time += delta;
+	ev->time = *time;
+
+	switch (ev->type) {
+	case ESS_COMPACT_IRQ:
+		if (!(p = ess_compact_get_signed(p, end, &s)) ||
+		    !(p = ess_compact_get(p, end, &v[0])) ||
+		    !(p = ess_compact_get(p, end, &v[1])) ||
+		    !(p = ess_compact_get(p, end, &v[2])) ||
+		    !(p = ess_compact_get_signed(p, end, &ev->irq.fn)))
+			return NULL;
+		ev->irq.irq = (int)s;
+		ev->en = (int)v[0];
+		ev->irq.val = (u32)v[1];
+		ev->irq.preempt = (u32)v[2];
+		break;
+	case ESS_COMPACT_FREQ:
+		if (!(p = ess_compact_get(p, end, &v[0])) ||
+		    !(p = ess_compact_get(p, end, &v[1])) ||
+		    !(p = ess_compact_get(p, end, &ev->freq.old_freq)) ||
+		    !(p = ess_compact_get(p, end, &ev->freq.target_freq)))
+			return NULL;
+		ev->en = (int)v[0];
+		ev->freq.domain = (u32)v[1];
+		break;
+	case ESS_COMPACT_HRTIMER:
+		if (!(p = ess_compact_get(p, end, &v[0])) ||
+		    !(p = ess_compact_get(p, end, &ev->hrtimer.timer)) ||
+		    !(p = ess_compact_get_signed(p, end, &ev->hrtimer.fn)) ||
+		    !(p = ess_compact_get(p, end, &ev->hrtimer.now)))
+			return NULL;
+		ev->en = (int)v[0];
+		break;
+	default:
+		return NULL;
+	}
+
+	return p;
+}
+
+#endif
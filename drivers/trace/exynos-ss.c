@@ -38,6 +38,8 @@
 #include <linux/exynos-sdm.h>
 #include <linux/exynos-ss-soc.h>
 #include <linux/clk-provider.h>
+#include <linux/jump_label.h>
+#include <linux/bitmap.h>
 
 #include <asm/cputype.h>
 #include <asm/cacheflush.h>
@@ -71,6 +73,11 @@
 
 #include <linux/nmi.h>
 
+#ifdef CONFIG_EXYNOS_SNAPSHOT_COMPACT
+#include <asm/sections.h>
+#include "exynos-ss-compact.h"
+#endif
+
 /*  Size domain */
 #define ESS_KEEP_HEADER_SZ		(SZ_256 * 3)
 #define ESS_HEADER_SZ			SZ_4K
@@ -98,6 +105,9 @@
 #define ESS_ITERATION			5
 #define ESS_NR_CPUS			NR_CPUS
 #define ESS_ITEM_MAX_NUM		10
+#define ESS_IRQ_EXLIST_BITS		SZ_1K
+/* Takes the place of the irq, hrtimer and freq logs of one CPU */
+#define ESS_COMPACT_RING_SZ		(ESS_LOG_MAX_NUM * SZ_128)
 
 /* Sign domain */
 #define ESS_SIGN_RESET			0x0
@@ -180,6 +190,7 @@ struct exynos_ss_log {
 		int core;
 	} suspend[ESS_LOG_MAX_NUM * 4];
 
+#ifndef CONFIG_EXYNOS_SNAPSHOT_COMPACT
 	struct irq_log {
 		unsigned long long time;
 		unsigned long sp;
@@ -189,6 +200,7 @@ struct exynos_ss_log {
 		unsigned int val;
 		int en;
 	} irq[ESS_NR_CPUS][ESS_LOG_MAX_NUM * 2];
+#endif
 
 #ifdef CONFIG_EXYNOS_SNAPSHOT_IRQ_EXIT
 	struct irq_exit_log {
@@ -240,7 +252,7 @@ struct exynos_ss_log {
 		int mode;
 	} pmu[ESS_LOG_MAX_NUM];
 #endif
-#ifdef CONFIG_EXYNOS_SNAPSHOT_FREQ
+#if defined(CONFIG_EXYNOS_SNAPSHOT_FREQ) && !defined(CONFIG_EXYNOS_SNAPSHOT_COMPACT)
 	struct freq_log {
 		unsigned long long time;
 		int cpu;
@@ -271,7 +283,7 @@ struct exynos_ss_log {
 		void *caller[ESS_CALLSTACK_MAX_NUM];
 	} reg[ESS_NR_CPUS][ESS_LOG_MAX_NUM];
 #endif
-#ifdef CONFIG_EXYNOS_SNAPSHOT_HRTIMER
+#if defined(CONFIG_EXYNOS_SNAPSHOT_HRTIMER) && !defined(CONFIG_EXYNOS_SNAPSHOT_COMPACT)
 	struct hrtimer_log {
 		unsigned long long time;
 		unsigned long long now;
@@ -357,6 +369,9 @@ struct exynos_ss_log {
 		void *last_pc[ESS_ITERATION];
 	} core[ESS_NR_CPUS];
 #endif
+#ifdef CONFIG_EXYNOS_SNAPSHOT_COMPACT
+	u8 compact[ESS_NR_CPUS][ESS_COMPACT_RING_SZ] __aligned(ESS_COMPACT_BLOCK_SZ);
+#endif
 };
 
 #define ESS_SAVE_STACK_TRACE_CPU(xxx)					\
@@ -593,21 +608,49 @@ static struct exynos_ss_item ess_items[] = {
  *  including or excluding options
  *  if you want to except some interrupt, it should be written in this array
  */
-static int ess_irqlog_exlist[] = {
+static int ess_irqlog_exlist[] __initdata = {
 /*  interrupt number ex) 152, 153, 154, */
 	-1,
 };
+static DECLARE_BITMAP(ess_irqlog_exmap, ESS_IRQ_EXLIST_BITS);
 
 #ifdef CONFIG_EXYNOS_SNAPSHOT_IRQ_EXIT
-static int ess_irqexit_exlist[] = {
+static int ess_irqexit_exlist[] __initdata = {
 /*  interrupt number ex) 152, 153, 154, */
 	-1,
 };
+static DECLARE_BITMAP(ess_irqexit_exmap, ESS_IRQ_EXLIST_BITS);
 
 static unsigned ess_irqexit_threshold =
 		CONFIG_EXYNOS_SNAPSHOT_IRQ_EXIT_THRESHOLD;
 #endif
 
+/*
+ *  The lists above are loaded into bitmaps at boot, so that the irq hooks
+ *  test one bit whatever the number of excluded irqs.
+ */
+static inline bool ess_irq_excluded(const unsigned long *map, int irq)
+{
+	return irq >= 0 && irq < ESS_IRQ_EXLIST_BITS && test_bit(irq, map);
+}
+
+static void __init ess_irq_exmap_init(unsigned long *map, const int *list,
+				      unsigned int nr)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++)
+		if (list[i] >= 0 && list[i] < ESS_IRQ_EXLIST_BITS)
+			set_bit(list[i], map);
+}
+
+/*
+ *  The kevent hooks run on every interrupt, timer and context switch.
+ *  Until the kevents log is set up they cost a patched branch and nothing
+ *  else, the enable flags are only loaded once it is.
+ */
+static DEFINE_STATIC_KEY_FALSE(ess_kevents_ready);
+
 #ifdef CONFIG_EXYNOS_SNAPSHOT_REG
 struct ess_reg_list {
 	size_t addr;
@@ -633,7 +676,7 @@ static struct ess_reg_list ess_reg_exlist[] = {
 };
 #endif
 
-#ifdef CONFIG_EXYNOS_SNAPSHOT_FREQ
+#if defined(CONFIG_EXYNOS_SNAPSHOT_FREQ) && !defined(CONFIG_EXYNOS_SNAPSHOT_COMPACT)
 static char *ess_freq_name[] = {
 	"APL", "ATL", "INT", "MIF", "ISP", "DISP", "INTCAM", "AUD", "FSYS",
 };
@@ -656,6 +699,88 @@ static struct exynos_ss_desc ess_desc;
 DEFINE_PER_CPU(struct pt_regs *, ess_core_reg);
 DEFINE_PER_CPU(struct exynos_ss_mmu_reg *, ess_mmu_reg);
 
+#ifdef CONFIG_EXYNOS_SNAPSHOT_COMPACT
+#define ESS_COMPACT_NR_BLOCKS	(ESS_COMPACT_RING_SZ / ESS_COMPACT_BLOCK_SZ - 1)
+
+static inline struct ess_compact_hdr *ess_compact_ring(int cpu)
+{
+	return (struct ess_compact_hdr *)ess_log->compact[cpu];
+}
+
+static inline struct ess_compact_block *
+ess_compact_block(struct ess_compact_hdr *hdr, unsigned int n)
+{
+	return (struct ess_compact_block *)((u8 *)hdr +
+					    (n + 1) * ESS_COMPACT_BLOCK_SZ);
+}
+
+static void __init ess_compact_init(void)
+{
+	int cpu;
+
+	for (cpu = 0; cpu < ESS_NR_CPUS; cpu++) {
+		struct ess_compact_hdr *hdr = ess_compact_ring(cpu);
+
+		hdr->version = ESS_COMPACT_VERSION;
+		hdr->cpu = cpu;
+		hdr->size = ESS_COMPACT_RING_SZ;
+		hdr->block_size = ESS_COMPACT_BLOCK_SZ;
+		hdr->text_base = (u64)(unsigned long)_text;
+		/*  the first record opens block 0 */
+		hdr->cur = ESS_COMPACT_NR_BLOCKS - 1;
+		hdr->magic = ESS_COMPACT_MAGIC;
+	}
+}
+
+/*
+ *  Appends a record of @type whose fields are encoded in @buf to the ring
+ *  of this CPU. Nothing else writes the ring and interrupts are off, so
+ *  the only ordering needed is for a ramdump taken in the middle: @used is
+ *  published after the record and @seq after the block is reset.
+ */
+static void ess_compact_log(int type, const u8 *buf, unsigned int len)
+{
+	struct ess_compact_hdr *hdr;
+	struct ess_compact_block *blk;
+	unsigned long flags;
+	u64 time;
+	u8 *p;
+	int cpu;
+
+	flags = pure_arch_local_irq_save();
+	cpu = raw_smp_processor_id();
+	time = cpu_clock(cpu);
+	hdr = ess_compact_ring(cpu);
+	blk = ess_compact_block(hdr, hdr->cur);
+
+	/*  1 byte of type and up to 10 of delta */
+	if (unlikely(!blk->seq || time < hdr->last_time ||
+		     blk->used + 11 + len > ESS_COMPACT_BLOCK_DATA)) {
+		u32 seq = blk->seq + 1;
+
+		hdr->cur = (hdr->cur + 1) % ESS_COMPACT_NR_BLOCKS;
+		blk = ess_compact_block(hdr, hdr->cur);
+		WRITE_ONCE(blk->seq, 0);
+		barrier();
+		blk->used = 0;
+		blk->time = time;
+		hdr->last_time = time;
+		barrier();
+		WRITE_ONCE(blk->seq, seq);
+	}
+
+	p = (u8 *)(blk + 1) + blk->used;
+	*p++ = type;
+	p = ess_compact_put(p, time - hdr->last_time);
+	memcpy(p, buf, len);
+	p += len;
+	barrier();
+	WRITE_ONCE(blk->used, p - (u8 *)(blk + 1));
+	hdr->last_time = time;
+	pure_arch_local_irq_restore(flags);
+}
+#endif
+
 static void exynos_ss_save_system(void *unused)
 {
 	struct exynos_ss_mmu_reg *mmu_reg;
@@ -1888,6 +2013,8 @@ bool exynos_ss_dumper_one(void *v_dumper,
 						suspend_fn, en == ESS_FLAG_IN ? "IN" : "OUT");
 		break;
 	}
+#ifndef CONFIG_EXYNOS_SNAPSHOT_COMPACT
+	/*  with the compact encoding these are decoded by ess-decode */
 	case ESS_FLAG_IRQ:
 	{
 		char irq_fn[KSYM_NAME_LEN];
@@ -1915,6 +2042,7 @@ bool exynos_ss_dumper_one(void *v_dumper,
 						en == ESS_FLAG_IN ? "IN" : "OUT");
 		break;
 	}
+#endif
 #ifdef CONFIG_EXYNOS_SNAPSHOT_IRQ_EXIT
 	case ESS_FLAG_IRQ_EXIT:
 	{
@@ -2015,7 +2143,7 @@ bool exynos_ss_dumper_one(void *v_dumper,
 		break;
 	}
 #endif
-#ifdef CONFIG_EXYNOS_SNAPSHOT_FREQ
+#if defined(CONFIG_EXYNOS_SNAPSHOT_FREQ) && !defined(CONFIG_EXYNOS_SNAPSHOT_COMPACT)
 	case ESS_FLAG_FREQ:
 	{
 		char *freq_name;
@@ -2265,6 +2393,13 @@ static int __init exynos_ss_init_desc(void)
 	if (!ess_items[ess_desc.kevents_num].entry.enabled_init)
 		ess_desc.need_header = true;
 
+	ess_irq_exmap_init(ess_irqlog_exmap, ess_irqlog_exlist,
+			   ARRAY_SIZE(ess_irqlog_exlist));
+#ifdef CONFIG_EXYNOS_SNAPSHOT_IRQ_EXIT
+	ess_irq_exmap_init(ess_irqexit_exmap, ess_irqexit_exlist,
+			   ARRAY_SIZE(ess_irqexit_exlist));
+#endif
+
 #ifdef CONFIG_S3C2410_WATCHDOG
 	ess_desc.no_wdt_dev = false;
 #else
@@ -2469,6 +2604,9 @@ static void __init exynos_ss_fixmap_header(void)
 	}
 	/*  initialize kernel event to 0 except only header */
 	memset((size_t *)(vaddr + ESS_KEEP_HEADER_SZ), 0, size - ESS_KEEP_HEADER_SZ);
+#ifdef CONFIG_EXYNOS_SNAPSHOT_COMPACT
+	ess_compact_init();
+#endif
 }
 
 static int __init exynos_ss_fixmap(void)
@@ -2593,6 +2731,8 @@ static int __init exynos_ss_init(void)
 		exynos_ss_init_dt();
 		exynos_ss_scratch_reg(ESS_SIGN_SCRATCH);
 		exynos_ss_set_enable("base", true);
+		if (ess_log)
+			static_branch_enable(&ess_kevents_ready);
 
 		register_hook_logbuf(exynos_ss_hook_logbuf);
 
@@ -2672,7 +2812,8 @@ void exynos_ss_task(int cpu, void *v_task)
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
 	{
 		unsigned long i = atomic_inc_return(&ess_idx.task_log_idx[cpu]) &
@@ -2692,7 +2833,8 @@ void exynos_ss_work(void *worker, void *v_task, void *fn, int en)
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
 
 	{
@@ -2714,7 +2856,8 @@ void exynos_ss_cpuidle(char *modes, unsigned state, int diff, int en)
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
 	{
 		int cpu = raw_smp_processor_id();
@@ -2735,7 +2878,8 @@ void exynos_ss_suspend(void *fn, void *dev, int en)
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
 	{
 		int cpu = raw_smp_processor_id();
@@ -2756,7 +2900,8 @@ void exynos_ss_regulator(char* f_name, unsigned int addr, unsigned int volt, int
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
 	{
 		int cpu = raw_smp_processor_id();
@@ -2780,7 +2925,8 @@ void exynos_ss_thermal(void *data, unsigned int temp, char *name, unsigned int m
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
 	{
 		int cpu = raw_smp_processor_id();
@@ -2800,22 +2946,31 @@ void exynos_ss_thermal(void *data, unsigned int temp, char *name, unsigned int m
 void exynos_ss_irq(int irq, void *fn, unsigned int val, int en)
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
+#ifdef CONFIG_EXYNOS_SNAPSHOT_COMPACT
+	u8 buf[ESS_COMPACT_REC_MAX], *p = buf;
+#else
 	unsigned long flags;
+#endif
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
 
+	if (ess_irq_excluded(ess_irqlog_exmap, irq))
+		return;
+#ifdef CONFIG_EXYNOS_SNAPSHOT_COMPACT
+	p = ess_compact_put_signed(p, irq);
+	p = ess_compact_put(p, (u32)en);
+	p = ess_compact_put(p, val);
+	p = ess_compact_put(p, preempt_count());
+	p = ess_compact_put_signed(p, (long)fn - (long)_text);
+	ess_compact_log(ESS_COMPACT_IRQ, buf, p - buf);
+#else
 	flags = pure_arch_local_irq_save();
 	{
 		int cpu = raw_smp_processor_id();
 		unsigned long i;
 
-		for (i = 0; i < ARRAY_SIZE(ess_irqlog_exlist); i++) {
-			if (irq == ess_irqlog_exlist[i]) {
-				pure_arch_local_irq_restore(flags);
-				return;
-			}
-		}
 		i = atomic_inc_return(&ess_idx.irq_log_idx[cpu]) &
 				(ARRAY_SIZE(ess_log->irq[0]) - 1);
 
@@ -2828,6 +2983,7 @@ void exynos_ss_irq(int irq, void *fn, unsigned int val, int en)
 		ess_log->irq[cpu][i].en = en;
 	}
 	pure_arch_local_irq_restore(flags);
+#endif
 }
 
 #ifdef CONFIG_EXYNOS_SNAPSHOT_IRQ_EXIT
@@ -2836,12 +2992,12 @@ void exynos_ss_irq_exit(unsigned int irq, unsigned long long start_time)
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 	unsigned long i;
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
 
-	for (i = 0; i < ARRAY_SIZE(ess_irqexit_exlist); i++)
-		if (irq == ess_irqexit_exlist[i])
-			return;
+	if (ess_irq_excluded(ess_irqexit_exmap, irq))
+		return;
 	{
 		int cpu = raw_smp_processor_id();
 		unsigned long long time, latency;
@@ -2870,7 +3026,8 @@ void exynos_ss_spinlock(void *v_lock, int en)
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
 	{
 		int cpu = raw_smp_processor_id();
@@ -2904,7 +3061,8 @@ void exynos_ss_irqs_disabled(unsigned long flags)
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 	int cpu = raw_smp_processor_id();
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
 
 	if (unlikely(flags)) {
@@ -2941,7 +3099,8 @@ void exynos_ss_clk(void *clock, const char *func_name, unsigned long arg, int mo
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
 	{
 		int cpu = raw_smp_processor_id();
@@ -2962,7 +3121,8 @@ void exynos_ss_pmu(int id, const char *func_name, int mode)
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
 	{
 		int cpu = raw_smp_processor_id();
@@ -2982,8 +3142,25 @@ void exynos_ss_freq(int type, unsigned long old_freq, unsigned long target_freq,
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
+#ifdef CONFIG_EXYNOS_SNAPSHOT_COMPACT
+	{
+		u8 buf[ESS_COMPACT_REC_MAX], *p = buf;
+
+		p = ess_compact_put(p, (u32)en);
+		p = ess_compact_put(p, type);
+		p = ess_compact_put(p, old_freq);
+		p = ess_compact_put(p, target_freq);
+		ess_compact_log(ESS_COMPACT_FREQ, buf, p - buf);
+#ifdef CONFIG_SEC_DEBUG_AUTO_SUMMARY
+		if(func_hook_auto_comm_lastfreq && en == ESS_FLAG_OUT)
+			func_hook_auto_comm_lastfreq(type, old_freq, target_freq,
+					cpu_clock(raw_smp_processor_id()));
+#endif
+	}
+#else
 	{
 		int cpu = raw_smp_processor_id();
 		unsigned long i = atomic_inc_return(&ess_idx.freq_log_idx) &
@@ -3000,6 +3177,7 @@ void exynos_ss_freq(int type, unsigned long old_freq, unsigned long target_freq,
 			func_hook_auto_comm_lastfreq(type, old_freq, target_freq, ess_log->freq[i].time);
 #endif
 	}
+#endif
 }
 #endif
 
@@ -3008,7 +3186,8 @@ void exynos_ss_dm(int type, unsigned long min, unsigned long max, s32 wait_t, s3
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled))
 		return;
 	{
 		int cpu = raw_smp_processor_id();
@@ -3031,8 +3210,20 @@ void exynos_ss_hrtimer(void *timer, s64 *now, void *fn, int en)
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
+#ifdef CONFIG_EXYNOS_SNAPSHOT_COMPACT
+	{
+		u8 buf[ESS_COMPACT_REC_MAX], *p = buf;
+
+		p = ess_compact_put(p, (u32)en);
+		p = ess_compact_put(p, (unsigned long)timer);
+		p = ess_compact_put_signed(p, (long)fn - (long)_text);
+		p = ess_compact_put(p, *now);
+		ess_compact_log(ESS_COMPACT_HRTIMER, buf, p - buf);
+	}
+#else
 	{
 		int cpu = raw_smp_processor_id();
 		unsigned long i = atomic_inc_return(&ess_idx.hrtimer_log_idx[cpu]) &
@@ -3044,6 +3235,7 @@ void exynos_ss_hrtimer(void *timer, s64 *now, void *fn, int en)
 		ess_log->hrtimers[cpu][i].fn = fn;
 		ess_log->hrtimers[cpu][i].en = en;
 	}
+#endif
 }
 #endif
 
@@ -3052,7 +3244,8 @@ void exynos_ss_i2c(struct i2c_adapter *adap, struct i2c_msg *msgs, int num, int
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled))
 		return;
 	{
 		int cpu = raw_smp_processor_id();
@@ -3074,7 +3267,8 @@ void exynos_ss_spi(struct spi_master *master, struct spi_message *cur_msg, int e
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled))
 		return;
 	{
 		int cpu = raw_smp_processor_id();
@@ -3095,7 +3289,8 @@ void exynos_ss_acpm(unsigned long long timestamp, const char *log, unsigned int
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled))
 		return;
 	{
 		int cpu = raw_smp_processor_id();
@@ -3157,7 +3352,8 @@ void exynos_ss_reg(unsigned int read, size_t val, size_t reg, int en)
 	unsigned long i, j;
 	size_t phys_reg, start_addr, end_addr;
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
 
 	if (ess_reg_exlist[0].addr == 0)
@@ -3194,7 +3390,8 @@ void exynos_ss_clockevent(unsigned long long clc, int64_t delta, void *next_even
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
 	{
 		int cpu = raw_smp_processor_id();
@@ -3216,7 +3413,8 @@ void exynos_ss_printk(const char *fmt, ...)
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
 	{
 		int cpu = raw_smp_processor_id();
@@ -3241,7 +3439,8 @@ void exynos_ss_printkl(size_t msg, size_t val)
 {
 	struct exynos_ss_item *item = &ess_items[ess_desc.kevents_num];
 
-	if (unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
+	if (!static_branch_unlikely(&ess_kevents_ready) ||
+	    unlikely(!ess_base.enabled || !item->entry.enabled || !item->entry.enabled_init))
 		return;
 	{
 		int cpu = raw_smp_processor_id();
@@ -4007,12 +4206,8 @@ static ssize_t ess_irqlog_exlist_show(struct kobject *kobj,
 	ssize_t n = 0;
 
 	n = scnprintf(buf, 24, "excluded irq number\n");
-
-	for (i = 0; i < ARRAY_SIZE(ess_irqlog_exlist); i++) {
-		if (ess_irqlog_exlist[i] == 0)
-			break;
-		n += scnprintf(buf + n, 24, "irq num: %-4d\n", ess_irqlog_exlist[i]);
-        }
+	for_each_set_bit(i, ess_irqlog_exmap, ESS_IRQ_EXLIST_BITS)
+		n += scnprintf(buf + n, PAGE_SIZE - n, "irq num: %-4lu\n", i);
 	return n;
 }
 
@@ -4020,24 +4215,18 @@ static ssize_t ess_irqlog_exlist_store(struct kobject *kobj,
 					struct kobj_attribute *attr,
 					const char *buf, size_t count)
 {
-	unsigned long i;
 	unsigned long irq;
 
 	irq = simple_strtoul(buf, NULL, 0);
 	pr_info("irq number : %lu\n", irq);
 
-	for (i = 0; i < ARRAY_SIZE(ess_irqlog_exlist); i++) {
-		if (ess_irqlog_exlist[i] == 0)
-			break;
-	}
-
-	if (i == ARRAY_SIZE(ess_irqlog_exlist)) {
-		pr_err("list is full\n");
+	if (irq >= ESS_IRQ_EXLIST_BITS) {
+		pr_err("irq %lu is out of range\n", irq);
 		return count;
 	}
 
 	if (irq != 0) {
-		ess_irqlog_exlist[i] = irq;
+		set_bit(irq, ess_irqlog_exmap);
 		pr_info("success inserting %lu to list\n", irq);
 	}
 	return count;
@@ -4051,11 +4240,8 @@ static ssize_t ess_irqexit_exlist_show(struct kobject *kobj,
 	ssize_t n = 0;
 
 	n = scnprintf(buf, 36, "Excluded irq number\n");
-	for (i = 0; i < ARRAY_SIZE(ess_irqexit_exlist); i++) {
-		if (ess_irqexit_exlist[i] == 0)
-			break;
-		n += scnprintf(buf + n, 24, "IRQ num: %-4d\n", ess_irqexit_exlist[i]);
-        }
+	for_each_set_bit(i, ess_irqexit_exmap, ESS_IRQ_EXLIST_BITS)
+		n += scnprintf(buf + n, PAGE_SIZE - n, "IRQ num: %-4lu\n", i);
 	return n;
 }
 
@@ -4063,24 +4249,18 @@ static ssize_t ess_irqexit_exlist_store(struct kobject *kobj,
 				struct kobj_attribute *attr,
 				const char *buf, size_t count)
 {
-	unsigned long i;
 	unsigned long irq;
 
 	irq = simple_strtoul(buf, NULL, 0);
 	pr_info("irq number : %lu\n", irq);
 
-	for (i = 0; i < ARRAY_SIZE(ess_irqexit_exlist); i++) {
-		if (ess_irqexit_exlist[i] == 0)
-			break;
-	}
-
-	if (i == ARRAY_SIZE(ess_irqexit_exlist)) {
-		pr_err("list is full\n");
+	if (irq >= ESS_IRQ_EXLIST_BITS) {
+		pr_err("irq %lu is out of range\n", irq);
 		return count;
 	}
 
 	if (irq != 0) {
-		ess_irqexit_exlist[i] = irq;
+		set_bit(irq, ess_irqexit_exmap);
 		pr_info("success inserting %lu to list\n", irq);
 	}
 	return count;
@@ -4335,6 +4515,107 @@ late_initcall(sec_log_late_init);
 
 #if defined(CONFIG_HARDLOCKUP_DETECTOR_OTHER_CPU)			\
 	&& defined(CONFIG_SEC_DEBUG)
+#ifdef CONFIG_EXYNOS_SNAPSHOT_COMPACT
+#define ESS_HL_IRQ_NUM		20
+
+/*
+ *  Decodes the block being written on @cpu and the one before into @ev,
+ *  keeping the last @nr irq records, oldest first. Returns how many.
+ */
+static int ess_compact_last_irqs(int cpu, struct ess_compact_event *ev,
+				 int nr)
+{
+	struct ess_compact_hdr *hdr = ess_compact_ring(cpu);
+	struct ess_compact_event tmp;
+	unsigned int cur = READ_ONCE(hdr->cur);
+	unsigned int n[2], i;
+	int found = 0, first;
+
+	n[0] = (cur + ESS_COMPACT_NR_BLOCKS - 1) % ESS_COMPACT_NR_BLOCKS;
+	n[1] = cur;
+
+	for (i = 0; i < ARRAY_SIZE(n); i++) {
+		struct ess_compact_block *blk = ess_compact_block(hdr, n[i]);
+		const u8 *p = (const u8 *)(blk + 1);
+		const u8 *end = p + min_t(unsigned int, READ_ONCE(blk->used),
+					  ESS_COMPACT_BLOCK_DATA);
+		u64 time = blk->time;
+
+		if (!blk->seq)
+			continue;
+		while ((p = ess_compact_decode(p, end, &time, &tmp))) {
+			if (tmp.type == ESS_COMPACT_IRQ)
+				ev[found++ % nr] = tmp;
+		}
+	}
+
+	if (found <= nr)
+		return found;
+
+	/*  rotate the oldest to the front */
+	first = found % nr;
+	for (i = 0; i < first; i++) {
+		tmp = ev[0];
+		memmove(ev, ev + 1, (nr - 1) * sizeof(*ev));
+		ev[nr - 1] = tmp;
+	}
+	return nr;
+}
+
+static inline void exynos_ss_get_busiest_irq(struct hardlockup_info *hl_info,
+					     struct ess_compact_event *ev, int nr)
+{
+	#define MAX_BUF 5
+	int i, j;
+	int buf_count = 0;
+	int max_irq_idx = 0;
+
+	struct irq_info_buf {
+		unsigned int occurrences;
+		int irq;
+		void *fn;
+		unsigned long long total_duration;
+		unsigned long long last_time;
+	};
+
+	struct irq_info_buf i_buf[MAX_BUF] = {{0,},};
+
+	for (i = nr - 1; i >= 0; i--) {
+		if (ev[i].en != ESS_FLAG_IN)
+			continue;
+
+		for (j = 0; j < buf_count; j++) {
+			if (i_buf[j].irq == ev[i].irq.irq) {
+				i_buf[j].total_duration += (i_buf[j].last_time - ev[i].time);
+				i_buf[j].last_time = ev[i].time;
+				i_buf[j].occurrences++;
+				break;
+			}
+		}
+
+		if (j == buf_count && buf_count < MAX_BUF) {
+			i_buf[buf_count].irq = ev[i].irq.irq;
+			i_buf[buf_count].fn = (void *)((long)_text + ev[i].irq.fn);
+			i_buf[buf_count].occurrences = 0;
+			i_buf[buf_count].total_duration = 0;
+			i_buf[buf_count].last_time = ev[i].time;
+			buf_count++;
+		} else if (buf_count == MAX_BUF) {
+			pr_info("Buffer overflow. Various irqs were generated!!\n");
+		}
+	}
+
+	for (i = 1; i < buf_count; i++) {
+		if (i_buf[max_irq_idx].occurrences < i_buf[i].occurrences)
+			max_irq_idx = i;
+	}
+
+	hl_info->irq_info.irq = i_buf[max_irq_idx].irq;
+	hl_info->irq_info.fn = i_buf[max_irq_idx].fn;
+	hl_info->irq_info.avg_period = i_buf[max_irq_idx].occurrences ?
+		i_buf[max_irq_idx].total_duration / i_buf[max_irq_idx].occurrences : 0;
+}
+#else
 #define for_each_generated_irq_in_snapshot(idx, i, max, base, cpu)							\
 	for (i = 0, idx = base; i < max; ++i, idx = (base - i) & (ARRAY_SIZE(ess_log->irq[0]) - 1))		\
 		if (ess_log->irq[cpu][idx].en == ESS_FLAG_IN)
@@ -4387,13 +4668,20 @@ static inline void exynos_ss_get_busiest_irq(struct hardlockup_info *hl_info, un
 	hl_info->irq_info.fn = i_buf[max_irq_idx].fn;
 	hl_info->irq_info.avg_period = i_buf[max_irq_idx].total_duration / i_buf[max_irq_idx].occurrences;
 }
+#endif
 
 void exynos_ss_get_hardlockup_info(unsigned int cpu,  void *info)
 {
 	struct hardlockup_info *hl_info = info;
-	unsigned long cpuidle_idx, irq_idx, task_idx;
+	unsigned long cpuidle_idx, task_idx;
 	unsigned long long cpuidle_delay_time, irq_delay_time, task_delay_time;
 	unsigned long long curr, thresh;
+#ifdef CONFIG_EXYNOS_SNAPSHOT_COMPACT
+	struct ess_compact_event irqs[ESS_HL_IRQ_NUM], *last = NULL;
+	int nr_irq;
+#else
+	unsigned long irq_idx;
+#endif
 
 	thresh = get_hardlockup_thresh();
 	curr = local_clock();
@@ -4409,6 +4697,26 @@ void exynos_ss_get_hardlockup_info(unsigned int cpu,  void *info)
 		return;
 	}
 
+#ifdef CONFIG_EXYNOS_SNAPSHOT_COMPACT
+	nr_irq = ess_compact_last_irqs(cpu, irqs, ESS_HL_IRQ_NUM);
+	if (nr_irq)
+		last = &irqs[nr_irq - 1];
+	irq_delay_time = curr - (last ? last->time : 0);
+
+	if (last && last->en == ESS_FLAG_IN && irq_delay_time > thresh) {
+		hl_info->delay_time = irq_delay_time;
+
+		if (last->irq.irq < 0) {				// smc calls have negative irq number
+			hl_info->smc_info.cmd = last->irq.irq;
+			hl_info->hl_type = HL_SMC_CALL_STUCK;
+		} else {
+			hl_info->irq_info.irq = last->irq.irq;
+			hl_info->irq_info.fn = (void *)((long)_text + last->irq.fn);
+			hl_info->hl_type = HL_IRQ_STUCK;
+		}
+		return;
+	}
+#else
 	irq_idx = atomic_read(&ess_idx.irq_log_idx[cpu]) & (ARRAY_SIZE(ess_log->irq[0]) - 1);
 	irq_delay_time = curr - ess_log->irq[cpu][irq_idx].time;
 
@@ -4428,6 +4736,7 @@ void exynos_ss_get_hardlockup_info(unsigned int cpu,  void *info)
 			return;
 		}
 	}
+#endif
 
 	task_idx = atomic_read(&ess_idx.task_log_idx[cpu]) & (ARRAY_SIZE(ess_log->task[0]) - 1);
 	task_delay_time = curr - ess_log->task[cpu][task_idx].time;
@@ -4441,7 +4750,11 @@ void exynos_ss_get_hardlockup_info(unsigned int cpu,  void *info)
 			hl_info->hl_type = HL_TASK_STUCK;
 			return;
 		} else {
+#ifdef CONFIG_EXYNOS_SNAPSHOT_COMPACT
+			exynos_ss_get_busiest_irq(hl_info, irqs, nr_irq);
+#else
 			exynos_ss_get_busiest_irq(hl_info, irq_idx, cpu);
+#endif
 			hl_info->hl_type = HL_IRQ_STORM;
 			return;
 		}
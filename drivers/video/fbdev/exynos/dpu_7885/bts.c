@@ -12,99 +12,24 @@
 #include "decon.h"
 
 #include <linux/debugfs.h>
+#include <linux/module.h>
 #include <soc/samsung/bts.h>
 #include <media/v4l2-subdev.h>
 
-#define DISP_FACTOR		100UL
-#define PPC			1UL	/* Katmai PPC : 1 */
 #define LCD_REFRESH_RATE	63UL
-#define MULTI_FACTOR 		(1UL << 10)
-#define BTS_DMA_MAX			4
 
-
-u64 dpu_bts_calc_aclk_disp(struct decon_device *decon,
-		struct decon_win_config *config, u64 resol_clock)
-{
-	u64 s_ratio_h, s_ratio_v;
-	u64 aclk_disp;
-	u64 ppc;
-
-	struct decon_frame *src = &config->src;
-	struct decon_frame *dst = &config->dst;
-
-	s_ratio_h = (src->w <= dst->w) ? MULTI_FACTOR : MULTI_FACTOR * (u64)src->w / (u64)dst->w;
-	s_ratio_v = (src->h <= dst->h) ? MULTI_FACTOR : MULTI_FACTOR * (u64)src->h / (u64)dst->h;
-
-	ppc = PPC;
-
-	aclk_disp = resol_clock * s_ratio_h * s_ratio_v * DISP_FACTOR  / 100UL
-		/ ppc * (MULTI_FACTOR * (u64)dst->w / (u64)decon->lcd_info->xres)
-		/ (MULTI_FACTOR * MULTI_FACTOR * MULTI_FACTOR);
-
-	return aclk_disp;
-}
-
-/* bus utilization 75% */
-#define BUS_UTIL	75
-
-static void dpu_bts_find_max_disp_freq(struct decon_device *decon,
-		struct decon_reg_data *regs)
-{
-	int i, idx;
-	u32 disp_ch_bw;
-	u32 max_disp_ch_bw;
-	u32 disp_op_freq = 0, freq = 0;
-	u64 resol_clock;
-	u64 op_fps = LCD_REFRESH_RATE;
-	struct decon_win_config *config = regs->dpp_config;
-
-	/* # of DMA of Katmai : 4 */
-	disp_ch_bw = decon->bts.bw[BTS_DPP0] + decon->bts.bw[BTS_DPP1]
-		+ decon->bts.bw[BTS_DPP2] + decon->bts.bw[BTS_DPP3];
-
-	/* calculate DECON 0 max peak bandwidth */
-	max_disp_ch_bw = disp_ch_bw;
-
-	decon->bts.peak = max_disp_ch_bw;
-	decon->bts.max_disp_freq = max_disp_ch_bw * 100 / (16 * BUS_UTIL) + 1;
-
-	/* check that the following calculation is needed ? */
-	/* 1.1: 10% margin, 1000: for KHZ, 1: for raising to a unit */
-	resol_clock = decon->lcd_info->xres * decon->lcd_info->yres *
-		op_fps * 11 / 10 / 1000 + 1;
-	decon->bts.resol_clk = resol_clock;
-
-	DPU_DEBUG_BTS("[Run: D%d]  resol clock = %d Khz\n",
-		decon->id, decon->bts.resol_clk);
-
-	for (i = 0; i < MAX_DECON_WIN; ++i) {
-		idx = config[i].idma_type;
-		if (config[i].state != DECON_WIN_STATE_BUFFER)
-			continue;
-
-		freq = dpu_bts_calc_aclk_disp(decon, &config[i], resol_clock);
-		if (disp_op_freq < freq)
-			disp_op_freq = freq;
-	}
-
-	DPU_DEBUG_BTS("DISP bus freq(%d), operating freq(%d)\n",
-			decon->bts.max_disp_freq, disp_op_freq);
-
-	if (decon->bts.max_disp_freq < disp_op_freq)
-		decon->bts.max_disp_freq = disp_op_freq;
-
-	if (decon->bts.max_disp_freq < decon->bts.disp_freq_minlock)
-		decon->bts.max_disp_freq = decon->bts.disp_freq_minlock;
-
-	DPU_DEBUG_BTS("MAX DISP CH FREQ = %d\n", decon->bts.max_disp_freq);
-}
+/* frames of lower demand before the QoS is dropped, see bts_plan.h */
+static unsigned int dpu_bts_hold_frames = DPU_BTS_DEFAULT_HOLD;
+module_param(dpu_bts_hold_frames, uint, 0644);
 
 void dpu_bts_calc_bw(struct decon_device *decon, struct decon_reg_data *regs)
 {
 
 	struct decon_win_config *config = regs->dpp_config;
 	struct bts_decon_info bts_info;
-	int idx, i;
+	struct dpu_bts_layer layers[MAX_DECON_WIN];
+	struct dpu_bts_demand demand, grant;
+	int idx, i, nr_layers = 0;
 
 	memset(&bts_info, 0, sizeof(struct bts_decon_info));
 	for (i = 0; i < MAX_DECON_WIN; ++i) {
@@ -137,7 +62,7 @@ void dpu_bts_calc_bw(struct decon_device *decon, struct decon_reg_data *regs)
 	decon->bts.total_bw = bts_calc_bw(decon->bts.type, &bts_info); /* total bandwidth */
 	memcpy(&decon->bts.bts_info, &bts_info, sizeof(struct bts_decon_info));
 
-	for (i = 0; i < BTS_DMA_MAX; ++i) {	/* instead of BTS_DPP_MAX */
+	for (i = 0; i < DPU_BTS_MAX_DMA; ++i) {	/* instead of BTS_DPP_MAX */
 		decon->bts.bw[i] = bts_info.dpp[i].bw;
 		DPU_DEBUG_BTS("DPP%d bandwidth = %d\n", i, decon->bts.bw[i]);
 	}
@@ -145,7 +70,45 @@ void dpu_bts_calc_bw(struct decon_device *decon, struct decon_reg_data *regs)
 	DPU_DEBUG_BTS("DECON%d total bandwidth = %d\n", decon->id,
 			decon->bts.total_bw);
 
-	dpu_bts_find_max_disp_freq(decon, regs);
+	decon->bts.resol_clk = dpu_bts_resol_clock(decon->lcd_info->xres,
+			decon->lcd_info->yres, LCD_REFRESH_RATE);
+
+	for (i = 0; i < MAX_DECON_WIN; ++i) {
+		if (config[i].state != DECON_WIN_STATE_BUFFER)
+			continue;
+
+		idx = config[i].idma_type;
+		layers[nr_layers].dma = idx;
+		layers[nr_layers].src_w = config[i].src.w;
+		layers[nr_layers].src_h = config[i].src.h;
+		layers[nr_layers].dst_w = config[i].dst.w;
+		layers[nr_layers].dst_h = config[i].dst.h;
+		layers[nr_layers].bw = bts_info.dpp[idx].bw;
+		nr_layers++;
+	}
+
+	dpu_bts_calc_demand(layers, nr_layers, decon->lcd_info->xres,
+			decon->bts.resol_clk, decon->bts.disp_freq_minlock,
+			&demand);
+	/* as the BTS driver accounts it */
+	demand.total_bw = decon->bts.total_bw;
+	decon->bts.demand = demand;
+
+	/*
+	 * Request what the planner grants rather than this frame's demand,
+	 * so that alternating configurations do not raise and drop MIF, INT
+	 * and DISP every frame.
+	 */
+	decon->bts.plan.hold = dpu_bts_hold_frames;
+	dpu_bts_plan_next(&decon->bts.plan, &demand, &grant);
+
+	decon->bts.total_bw = grant.total_bw;
+	decon->bts.peak = grant.peak;
+	decon->bts.max_disp_freq = grant.disp_freq;
+
+	DPU_DEBUG_BTS("demand bw %u peak %u disp %u, granted bw %u peak %u disp %u\n",
+			demand.total_bw, demand.peak, demand.disp_freq,
+			grant.total_bw, grant.peak, grant.disp_freq);
 }
 
 static void dpu_bts_log_info_output(struct decon_device *decon, struct decon_reg_data *regs)
@@ -159,14 +122,16 @@ static void dpu_bts_log_info_output(struct decon_device *decon, struct decon_reg
 			continue;
 
 		idx = config[i].idma_type;
-		DPU_LOG_BTS("[%d] DPP[%d] (%d) (%4d %4d)\t(%4d %4d %4d %4d)\n",
+		DPU_LOG_BTS("[%d] DPP[%d] (%d) (%4d %4d)\t(%4d %4d %4d %4d) %u\n",
 			i, bts_info->dpp[idx].idma_type, bts_info->dpp[idx].bpp,
 			bts_info->dpp[idx].src_w, bts_info->dpp[idx].src_h,
 			bts_info->dpp[idx].dst.x1, bts_info->dpp[idx].dst.y1,
-			bts_info->dpp[idx].dst.x2, bts_info->dpp[idx].dst.y2);
+			bts_info->dpp[idx].dst.x2, bts_info->dpp[idx].dst.y2,
+			bts_info->dpp[idx].bw);
 	}
-	DPU_LOG_BTS("BW(KB/s): type%d bw %up %ur\n",
-		decon->id, decon->bts.peak, decon->bts.total_bw);
+	DPU_LOG_BTS("BW(KB/s): type%d bw %up %ur, demand %up %ur\n",
+		decon->id, decon->bts.peak, decon->bts.total_bw,
+		decon->bts.demand.peak, decon->bts.demand.total_bw);
 }
 
 void dpu_bts_update_bw(struct decon_device *decon, struct decon_reg_data *regs,
@@ -251,6 +216,7 @@ void dpu_bts_release_bw(struct decon_device *decon)
 	decon->bts.prev_total_bw = 0;
 	pm_qos_update_request(&decon->bts.disp_qos, 0);
 	decon->bts.prev_max_disp_freq = 0;
+	dpu_bts_plan_reset(&decon->bts.plan);
 
 	DPU_DEBUG_BTS("%s -\n", __func__);
 }
@@ -275,8 +241,9 @@ void dpu_bts_init(struct decon_device *decon)
 	  *               1.1(10% margin) x comp_ratio(1/3 DSC) / 2(2PPC) /
 	  *		1000(for KHZ) + 1(for raising to a unit)
 	  */
-	decon->bts.resol_clk = decon->lcd_info->xres *
-		decon->lcd_info->yres * LCD_REFRESH_RATE * 11 / 10 / 1000 + 1;
+	decon->bts.resol_clk = dpu_bts_resol_clock(decon->lcd_info->xres,
+		decon->lcd_info->yres, LCD_REFRESH_RATE);
+	dpu_bts_plan_init(&decon->bts.plan);
 
 	DPU_DEBUG_BTS("[Init: D%d] resol clock = %d Khz\n",
 		decon->id, decon->bts.resol_clk);
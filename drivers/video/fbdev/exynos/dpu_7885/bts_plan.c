@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com
+ *
+ * BTS planner for Samsung EXYNOS DPU driver
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include "bts_plan.h"
+
+#ifdef __KERNEL__
+#include <linux/kernel.h>
+#include <linux/string.h>
+#else
+#include <string.h>
+#endif
+
+#define DISP_FACTOR		100ULL
+#define PPC			1ULL	/* Katmai PPC : 1 */
+#define MULTI_FACTOR		(1ULL << 10)
+
+/* bus utilization 75% */
+#define BUS_UTIL		75
+
+/*
+ * Resol clock(KHZ) = lcd width x lcd height x refresh rate x
+ *		1.1(10% margin) / 1000(for KHZ) + 1(for raising to a unit)
+ */
+u32 dpu_bts_resol_clock(u32 xres, u32 yres, u32 fps)
+{
+	return xres * yres * fps * 11 / 10 / 1000 + 1;
+}
+
+u32 dpu_bts_calc_aclk_disp(const struct dpu_bts_layer *layer, u32 xres,
+			   u32 resol_clock)
+{
+	u64 s_ratio_h, s_ratio_v;
+
+	if (!layer->dst_w || !layer->dst_h || !xres)
+		return 0;
+
+	s_ratio_h = (layer->src_w <= layer->dst_w) ? MULTI_FACTOR :
+		MULTI_FACTOR * layer->src_w / layer->dst_w;
+	s_ratio_v = (layer->src_h <= layer->dst_h) ? MULTI_FACTOR :
+		MULTI_FACTOR * layer->src_h / layer->dst_h;
+
+	return resol_clock * s_ratio_h * s_ratio_v * DISP_FACTOR / 100ULL
+		/ PPC * (MULTI_FACTOR * layer->dst_w / xres)
+		/ (MULTI_FACTOR * MULTI_FACTOR * MULTI_FACTOR);
+}
+
+/*
+ * The peak is the sum of the bandwidth of the DMAs, and the DISP clock has
+ * to carry it at BUS_UTIL of a 16 byte bus, and to scale the most
+ * demanding window at the pixel rate of the panel.
+ */
+void dpu_bts_calc_demand(const struct dpu_bts_layer *layers, int nr_layers,
+			 u32 xres, u32 resol_clock, u32 disp_freq_minlock,
+			 struct dpu_bts_demand *demand)
+{
+	u32 peak = 0, freq, disp_freq;
+	int i;
+
+	demand->total_bw = 0;
+	for (i = 0; i < nr_layers; i++) {
+		demand->total_bw += layers[i].bw;
+		if (layers[i].dma < DPU_BTS_MAX_DMA)
+			peak += layers[i].bw;
+	}
+
+	disp_freq = peak * 100 / (16 * BUS_UTIL) + 1;
+	for (i = 0; i < nr_layers; i++) {
+		freq = dpu_bts_calc_aclk_disp(&layers[i], xres, resol_clock);
+		if (disp_freq < freq)
+			disp_freq = freq;
+	}
+	if (disp_freq < disp_freq_minlock)
+		disp_freq = disp_freq_minlock;
+
+	demand->peak = peak;
+	demand->disp_freq = disp_freq;
+}
+
+void dpu_bts_plan_reset(struct dpu_bts_plan *plan)
+{
+	plan->head = 0;
+	plan->count = 0;
+	memset(&plan->granted, 0, sizeof(plan->granted));
+}
+
+void dpu_bts_plan_init(struct dpu_bts_plan *plan)
+{
+	memset(plan, 0, sizeof(*plan));
+	plan->hold = DPU_BTS_DEFAULT_HOLD;
+}
+
+/* @ago frames before the last one recorded */
+static const struct dpu_bts_demand *
+dpu_bts_plan_history(const struct dpu_bts_plan *plan, unsigned int ago)
+{
+	return &plan->history[(plan->head + DPU_BTS_HISTORY - 1 - ago) %
+			      DPU_BTS_HISTORY];
+}
+
+/*
+ * Grant for one member of the demand, from its values @val of the last
+ * @count frames, newest first: the highest of the last @window frames, or
+ * the next step if it is still rising.
+ */
+static u32 dpu_bts_plan_target(const u32 *val, unsigned int count,
+			       unsigned int window)
+{
+	u32 target = val[0], next;
+	unsigned int i;
+
+	for (i = 1; i < window; i++)
+		if (val[i] > target)
+			target = val[i];
+
+	/* still rising: grant the next step now */
+	if (count >= 3) {
+		next = val[0] + (val[0] - val[1]);
+		if (val[0] > val[1] && val[1] > val[2] && next > val[0] &&
+		    next > target)
+			target = next;
+	}
+
+	return target;
+}
+
+/**
+ * dpu_bts_plan_next - plan the QoS of the next frame
+ * @plan:	planner state
+ * @demand:	demand of the frame about to be updated
+ * @grant:	returns the QoS to hold while it is displayed
+ *
+ * The grant always covers @demand.
+ */
+void dpu_bts_plan_next(struct dpu_bts_plan *plan,
+		       const struct dpu_bts_demand *demand,
+		       struct dpu_bts_demand *grant)
+{
+	const struct dpu_bts_demand *prev = &plan->granted;
+	u32 total_bw[DPU_BTS_HISTORY];
+	u32 peak[DPU_BTS_HISTORY];
+	u32 disp_freq[DPU_BTS_HISTORY];
+	unsigned int window, i;
+
+	if (plan->count && (demand->total_bw > prev->total_bw ||
+			    demand->peak > prev->peak ||
+			    demand->disp_freq > prev->disp_freq))
+		plan->late++;
+
+	plan->history[plan->head] = *demand;
+	plan->head = (plan->head + 1) % DPU_BTS_HISTORY;
+	if (plan->count < DPU_BTS_HISTORY)
+		plan->count++;
+
+	window = plan->hold ? plan->hold : 1;
+	if (window > plan->count)
+		window = plan->count;
+
+	for (i = 0; i < plan->count; i++) {
+		const struct dpu_bts_demand *d = dpu_bts_plan_history(plan, i);
+
+		total_bw[i] = d->total_bw;
+		peak[i] = d->peak;
+		disp_freq[i] = d->disp_freq;
+	}
+
+	grant->total_bw = dpu_bts_plan_target(total_bw, plan->count, window);
+	grant->peak = dpu_bts_plan_target(peak, plan->count, window);
+	grant->disp_freq = dpu_bts_plan_target(disp_freq, plan->count, window);
+
+	if (plan->frames && memcmp(grant, prev, sizeof(*grant)))
+		plan->changes++;
+	plan->frames++;
+	plan->granted = *grant;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com
+ *
+ * BTS planner for Samsung EXYNOS DPU driver
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This file and bts_plan.c must not depend on decon_device or on the BTS
+ * driver: tools/video/dpu-bts-replay builds them in userspace to replay
+ * window configurations recorded with dpu_bts_log_level >= 7.
+ */
+
+#ifndef __DPU_BTS_PLAN_H__
+#define __DPU_BTS_PLAN_H__
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+typedef uint32_t u32;
+typedef uint64_t u64;
+#endif
+
+#define DPU_BTS_MAX_LAYERS		4	/* MAX_DECON_WIN */
+#define DPU_BTS_MAX_DMA			4	/* DMAs of Katmai */
+#define DPU_BTS_HISTORY			8
+#define DPU_BTS_DEFAULT_HOLD		4
+
+/**
+ * struct dpu_bts_layer - one window of a frame as far as BTS is concerned
+ * @dma:	IDMA the window is read by
+ * @src_w:	source width
+ * @src_h:	source height
+ * @dst_w:	destination width
+ * @dst_h:	destination height
+ * @bw:		read bandwidth in KB/s, as bts_calc_bw() computed it
+ */
+struct dpu_bts_layer {
+	u32 dma;
+	u32 src_w;
+	u32 src_h;
+	u32 dst_w;
+	u32 dst_h;
+	u32 bw;
+};
+
+/**
+ * struct dpu_bts_demand - what a frame needs from the bus
+ * @total_bw:	read bandwidth in KB/s
+ * @peak:	peak bandwidth of the display channels in KB/s
+ * @disp_freq:	DISP clock in kHz
+ */
+struct dpu_bts_demand {
+	u32 total_bw;
+	u32 peak;
+	u32 disp_freq;
+};
+
+/**
+ * struct dpu_bts_plan - per-frame QoS planner
+ * @hold:	frames of lower demand needed before the QoS is dropped
+ * @history:	demand of the last DPU_BTS_HISTORY frames
+ * @head:	next slot of @history
+ * @count:	valid entries in @history
+ * @granted:	QoS granted for the current frame
+ * @frames:	frames planned
+ * @changes:	frames whose QoS differed from the previous frame's
+ * @late:	frames whose demand the previous frame's QoS did not cover,
+ *		i.e. that had to raise the QoS right before their update
+ *
+ * The QoS granted is the highest demand of the last @hold frames, so it
+ * rises at once and drops only after sustained lower demand. When the
+ * demand has been rising for the last frames, its next step is granted
+ * one frame ahead.
+ */
+struct dpu_bts_plan {
+	u32 hold;
+
+	struct dpu_bts_demand history[DPU_BTS_HISTORY];
+	unsigned int head;
+	unsigned int count;
+
+	struct dpu_bts_demand granted;
+
+	u64 frames;
+	u64 changes;
+	u64 late;
+};
+
+u32 dpu_bts_resol_clock(u32 xres, u32 yres, u32 fps);
+u32 dpu_bts_calc_aclk_disp(const struct dpu_bts_layer *layer, u32 xres,
+			   u32 resol_clock);
+void dpu_bts_calc_demand(const struct dpu_bts_layer *layers, int nr_layers,
+			 u32 xres, u32 resol_clock, u32 disp_freq_minlock,
+			 struct dpu_bts_demand *demand);
+
+void dpu_bts_plan_init(struct dpu_bts_plan *plan);
+void dpu_bts_plan_reset(struct dpu_bts_plan *plan);
+void dpu_bts_plan_next(struct dpu_bts_plan *plan,
+		       const struct dpu_bts_demand *demand,
+		       struct dpu_bts_demand *grant);
+
+#endif /* __DPU_BTS_PLAN_H__ */
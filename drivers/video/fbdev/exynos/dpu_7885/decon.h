@@ -31,6 +31,7 @@
 #include "regs-decon.h"
 #include "./panels/decon_lcd.h"
 #include "decon_abd.h"
+#include "bts_plan.h"
 #include "dsim.h"
 #include "../../../../staging/android/sw_sync.h"
 
@@ -1069,6 +1070,8 @@ struct decon_bts {
 	struct pm_qos_request int_qos;
 	struct pm_qos_request disp_qos;
 	u32 disp_freq_minlock;
+	struct dpu_bts_demand demand;
+	struct dpu_bts_plan plan;
 };
 
 struct decon_device {
@@ -3238,6 +3238,7 @@ static const struct pid_entry tgid_base_stuff[] = {
 	REG("mountstats", S_IRUSR, proc_mountstats_operations),
 #ifdef CONFIG_PROCESS_RECLAIM
 	REG("reclaim", S_IWUSR|S_IWOTH, proc_reclaim_operations),
+	REG("reclaim_result", S_IRUGO, proc_reclaim_result_operations),
 #endif
 #ifdef CONFIG_PROC_PAGE_MONITOR
 	REG("clear_refs", S_IWUSR, proc_clear_refs_operations),
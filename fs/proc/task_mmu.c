@@ -17,6 +17,8 @@
 #include <linux/io_record.h>
 #include <linux/mm_inline.h>
 #include <linux/ctype.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
 
 #include <asm/elf.h>
 #include <asm/uaccess.h>
@@ -1679,10 +1681,54 @@ const struct file_operations proc_pagemap_operations = {
 #endif /* CONFIG_PROC_PAGE_MONITOR */
 
 #ifdef CONFIG_PROCESS_RECLAIM
+enum reclaim_type {
+	RECLAIM_FILE,
+	RECLAIM_ANON,
+	RECLAIM_ALL,
+	RECLAIM_RANGE,
+};
+
+/* Why a reclaim pass over an mm ended */
+enum reclaim_stop {
+	RECLAIM_STOP_DONE,
+	RECLAIM_STOP_CONTENDED,
+	RECLAIM_STOP_BUDGET,
+	RECLAIM_STOP_DEADLINE,
+};
+
+/*
+ * @nr_to_reclaim and @deadline are 0 for no limit. With @skip_young, pages
+ * whose pte was accessed since the last pass have the accessed bit cleared
+ * and are left alone, so only pages idle for a whole pass are reclaimed.
+ */
+struct reclaim_param {
+	struct vm_area_struct *vma;
+	unsigned long nr_to_reclaim;
+	unsigned long deadline;
+	bool skip_young;
+	bool prioritize;
+	unsigned long nr_scanned;
+	unsigned long nr_reclaimed;
+	enum reclaim_stop stop;
+};
+
+static bool reclaim_should_stop(struct mm_walk *walk, struct reclaim_param *rp)
+{
+	if (rwsem_is_contended(&walk->mm->mmap_sem))
+		rp->stop = RECLAIM_STOP_CONTENDED;
+	else if (rp->nr_to_reclaim && rp->nr_reclaimed >= rp->nr_to_reclaim)
+		rp->stop = RECLAIM_STOP_BUDGET;
+	else if (rp->deadline && time_after(jiffies, rp->deadline))
+		rp->stop = RECLAIM_STOP_DEADLINE;
+
+	return rp->stop != RECLAIM_STOP_DONE;
+}
+
 static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
 				unsigned long end, struct mm_walk *walk)
 {
-	struct vm_area_struct *vma = walk->private;
+	struct reclaim_param *rp = walk->private;
+	struct vm_area_struct *vma = rp->vma;
 	pte_t *pte, ptent;
 	spinlock_t *ptl;
 	struct page *page;
@@ -1693,7 +1739,7 @@ static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
 	if (pmd_trans_unstable(pmd))
 		return 0;
 cont:
-	if (rwsem_is_contended(&walk->mm->mmap_sem))
+	if (reclaim_should_stop(walk, rp))
 		return -1;
 	
 	isolated = 0;
@@ -1706,6 +1752,10 @@ cont:
 		page = vm_normal_page(vma, addr, ptent);
 		if (!page)
 			continue;
+
+		rp->nr_scanned++;
+		if (rp->skip_young && ptep_test_and_clear_young(vma, addr, pte))
+			continue;
 		
 		if (PageUnevictable(page))
 			continue;
@@ -1736,7 +1786,7 @@ cont:
 			break;
 	}
 	pte_unmap_unlock(pte - 1, ptl);
-	reclaim_pages_from_list(&page_list, vma);
+	rp->nr_reclaimed += reclaim_pages_from_list(&page_list, vma);
 	if (addr != end)
 		goto cont;
 
@@ -1744,25 +1794,316 @@ cont:
 	return 0;
 }
 
-enum reclaim_type {
-	RECLAIM_FILE,
-	RECLAIM_ANON,
-	RECLAIM_ALL,
-	RECLAIM_RANGE,
+/*
+ * Order in which prioritized reclaim visits VMAs: clean file data is the
+ * cheapest to drop, anon needs swap I/O, and code refaults hurt the most
+ * once the app comes back to the foreground.
+ */
+enum reclaim_vma_class {
+	RECLAIM_VMA_FILE,
+	RECLAIM_VMA_ANON,
+	RECLAIM_VMA_EXEC,
+	RECLAIM_VMA_NR,
+};
+
+static enum reclaim_vma_class reclaim_vma_class(struct vm_area_struct *vma)
+{
+	if (!vma->vm_file)
+		return RECLAIM_VMA_ANON;
+	if (vma->vm_flags & VM_EXEC)
+		return RECLAIM_VMA_EXEC;
+	return RECLAIM_VMA_FILE;
+}
+
+static void reclaim_mm(struct mm_struct *mm, enum reclaim_type type,
+		       unsigned long start, unsigned long end,
+		       struct reclaim_param *rp)
+{
+	struct vm_area_struct *vma;
+	struct mm_walk reclaim_walk = {};
+	int class;
+
+	reclaim_walk.mm = mm;
+	reclaim_walk.pmd_entry = reclaim_pte_range;
+	reclaim_walk.private = rp;
+
+	down_read(&mm->mmap_sem);
+	if (type == RECLAIM_RANGE) {
+		for (vma = find_vma(mm, start); vma; vma = vma->vm_next) {
+			if (vma->vm_start > end)
+				break;
+			if (is_vm_hugetlb_page(vma))
+				continue;
+
+			rp->vma = vma;
+			if (walk_page_range(max(vma->vm_start, start),
+					min(vma->vm_end, end),
+					&reclaim_walk))
+				goto out;
+		}
+		goto out;
+	}
+
+	for (class = 0; class < RECLAIM_VMA_NR; class++) {
+		for (vma = mm->mmap; vma; vma = vma->vm_next) {
+			if (is_vm_hugetlb_page(vma))
+				continue;
+
+			if (type == RECLAIM_ANON && vma->vm_file)
+				continue;
+
+			if (type == RECLAIM_FILE && !vma->vm_file)
+				continue;
+
+			if (rp->prioritize && reclaim_vma_class(vma) != class)
+				continue;
+
+			rp->vma = vma;
+			if (walk_page_range(vma->vm_start, vma->vm_end,
+				&reclaim_walk))
+				goto out;
+		}
+
+		if (!rp->prioritize)
+			break;
+	}
+out:
+	flush_tlb_mm(mm);
+	up_read(&mm->mmap_sem);
+}
+
+/*
+ * Asynchronous reclaim: "async <type> [budget=<pages>] [deadline=<ms>]"
+ * written to /proc/<pid>/reclaim queues a job on a low priority unbound
+ * workqueue and returns at once. Jobs reclaim VMAs in reclaim_vma_class
+ * order, skip recently accessed pages and stop at the page budget or the
+ * deadline, counted from the write. /proc/<pid>/reclaim_result reports
+ * queued, running and recently finished jobs.
+ */
+#define RECLAIM_ASYNC_DEFAULT_DEADLINE_MS	2000
+#define RECLAIM_ASYNC_MAX_ACTIVE		2
+#define RECLAIM_RESULT_MAX			32
+
+enum reclaim_job_state {
+	RECLAIM_JOB_QUEUED,
+	RECLAIM_JOB_RUNNING,
+	RECLAIM_JOB_DONE,
+	RECLAIM_JOB_EXITED,
+};
+
+static const char * const reclaim_job_state_name[] = {
+	"queued", "running", "done", "exited",
 };
 
+static const char * const reclaim_stop_name[] = {
+	"complete", "contended", "budget", "deadline",
+};
+
+static const char * const reclaim_type_name[] = {
+	"file", "anon", "all", "range",
+};
+
+struct reclaim_result {
+	unsigned long id;
+	pid_t pid;
+	enum reclaim_type type;
+	enum reclaim_job_state state;
+	enum reclaim_stop stop;
+	unsigned long budget;
+	unsigned int deadline_ms;
+	unsigned long nr_scanned;
+	unsigned long nr_reclaimed;
+	u64 wait_ns;
+	u64 run_ns;
+};
+
+struct reclaim_job {
+	struct work_struct work;
+	struct list_head list;
+	struct mm_struct *mm;
+	unsigned long start;
+	unsigned long end;
+	unsigned long deadline;
+	ktime_t queued;
+	struct reclaim_result res;
+};
+
+static struct workqueue_struct *reclaim_wq;
+static DEFINE_SPINLOCK(reclaim_job_lock);
+static LIST_HEAD(reclaim_jobs);
+static struct reclaim_result reclaim_results[RECLAIM_RESULT_MAX];
+static unsigned int reclaim_result_next;
+static unsigned long reclaim_job_id;
+
+static void reclaim_job_fn(struct work_struct *work)
+{
+	struct reclaim_job *job = container_of(work, struct reclaim_job, work);
+	struct reclaim_param rp = {
+		.nr_to_reclaim = job->res.budget,
+		.deadline = job->deadline,
+		.skip_young = true,
+		.prioritize = true,
+	};
+	enum reclaim_job_state state = RECLAIM_JOB_DONE;
+	ktime_t start = ktime_get();
+
+	/* job->res is copied by reclaim_result_show() under the lock */
+	spin_lock(&reclaim_job_lock);
+	job->res.state = RECLAIM_JOB_RUNNING;
+	job->res.wait_ns = ktime_to_ns(ktime_sub(start, job->queued));
+	spin_unlock(&reclaim_job_lock);
+
+	if (time_after(jiffies, job->deadline)) {
+		rp.stop = RECLAIM_STOP_DEADLINE;
+	} else if (atomic_inc_not_zero(&job->mm->mm_users)) {
+		reclaim_mm(job->mm, job->res.type, job->start, job->end, &rp);
+		mmput(job->mm);
+	} else {
+		state = RECLAIM_JOB_EXITED;
+	}
+	mmdrop(job->mm);
+
+	spin_lock(&reclaim_job_lock);
+	job->res.state = state;
+	job->res.stop = rp.stop;
+	job->res.nr_scanned = rp.nr_scanned;
+	job->res.nr_reclaimed = rp.nr_reclaimed;
+	job->res.run_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	list_del(&job->list);
+	reclaim_results[reclaim_result_next] = job->res;
+	reclaim_result_next = (reclaim_result_next + 1) % RECLAIM_RESULT_MAX;
+	spin_unlock(&reclaim_job_lock);
+
+	kfree(job);
+}
+
+static int reclaim_wq_init(void)
+{
+	struct workqueue_attrs *attrs;
+	struct workqueue_struct *wq;
+	int ret;
+
+	if (reclaim_wq)
+		return 0;
+
+	wq = alloc_workqueue("proc_reclaim",
+			     WQ_UNBOUND | WQ_FREEZABLE | WQ_SYSFS,
+			     RECLAIM_ASYNC_MAX_ACTIVE);
+	if (!wq)
+		return -ENOMEM;
+
+	attrs = alloc_workqueue_attrs(GFP_KERNEL);
+	if (!attrs) {
+		destroy_workqueue(wq);
+		return -ENOMEM;
+	}
+	attrs->nice = MAX_NICE;
+	cpumask_copy(attrs->cpumask, cpu_possible_mask);
+	ret = apply_workqueue_attrs(wq, attrs);
+	free_workqueue_attrs(attrs);
+	if (ret) {
+		destroy_workqueue(wq);
+		return ret;
+	}
+
+	if (cmpxchg(&reclaim_wq, NULL, wq))
+		destroy_workqueue(wq);
+
+	return 0;
+}
+
+static int reclaim_queue_job(struct task_struct *task, enum reclaim_type type,
+			     unsigned long start, unsigned long end,
+			     unsigned long budget, unsigned int deadline_ms)
+{
+	struct reclaim_job *job, *pos;
+	struct mm_struct *mm;
+	int ret;
+
+	ret = reclaim_wq_init();
+	if (ret)
+		return ret;
+
+	job = kzalloc(sizeof(*job), GFP_KERNEL);
+	if (!job)
+		return -ENOMEM;
+
+	mm = get_task_mm(task);
+	if (!mm) {
+		kfree(job);
+		return -ESRCH;
+	}
+	/* only pin the mm_struct so that a killed app frees its memory */
+	atomic_inc(&mm->mm_count);
+	mmput(mm);
+
+	INIT_WORK(&job->work, reclaim_job_fn);
+	job->mm = mm;
+	job->start = start;
+	job->end = end;
+	job->queued = ktime_get();
+	job->deadline = jiffies + msecs_to_jiffies(deadline_ms);
+	job->res.pid = task_tgid_nr(task);
+	job->res.type = type;
+	job->res.state = RECLAIM_JOB_QUEUED;
+	job->res.budget = budget;
+	job->res.deadline_ms = deadline_ms;
+
+	spin_lock(&reclaim_job_lock);
+	list_for_each_entry(pos, &reclaim_jobs, list) {
+		if (pos->mm == mm) {
+			spin_unlock(&reclaim_job_lock);
+			mmdrop(mm);
+			kfree(job);
+			return -EBUSY;
+		}
+	}
+	job->res.id = ++reclaim_job_id;
+	list_add_tail(&job->list, &reclaim_jobs);
+	spin_unlock(&reclaim_job_lock);
+
+	queue_work(reclaim_wq, &job->work);
+
+	return 0;
+}
+
+static int reclaim_parse_async_opts(char *opts, unsigned long *budget,
+				    unsigned int *deadline_ms)
+{
+	char *opt;
+
+	while ((opt = strsep(&opts, " ")) != NULL) {
+		if (!*opt)
+			continue;
+		if (!strncmp(opt, "budget=", 7)) {
+			if (kstrtoul(opt + 7, 0, budget))
+				return -EINVAL;
+		} else if (!strncmp(opt, "deadline=", 9)) {
+			if (kstrtouint(opt + 9, 0, deadline_ms) || !*deadline_ms)
+				return -EINVAL;
+		} else {
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
 static ssize_t reclaim_write(struct file *file, const char __user *buf,
 				size_t count, loff_t *ppos)
 {
 	struct task_struct *task;
 	char buffer[200];
 	struct mm_struct *mm;
-	struct vm_area_struct *vma;
 	enum reclaim_type type;
 	char *type_buf;
-	struct mm_walk reclaim_walk = {};
+	struct reclaim_param rp = {};
 	unsigned long start = 0;
 	unsigned long end = 0;
+	bool async = false;
+	unsigned long budget = 0;
+	unsigned int deadline_ms = RECLAIM_ASYNC_DEFAULT_DEADLINE_MS;
+	ssize_t ret = count;
 
 	memset(buffer, 0, sizeof(buffer));
 	if (count > sizeof(buffer) - 1)
@@ -1772,6 +2113,24 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 		return -EFAULT;
 
 	type_buf = strstrip(buffer);
+	if (!strncmp(type_buf, "async ", 6)) {
+		char *opts = strchr(type_buf, '=');
+
+		async = true;
+		type_buf = skip_spaces(type_buf + 6);
+		if (opts) {
+			while (opts > type_buf && *(opts - 1) != ' ')
+				opts--;
+			if (opts == type_buf)
+				goto out_err;
+			*(opts - 1) = '\0';
+			type_buf = strim(type_buf);
+			if (reclaim_parse_async_opts(opts, &budget,
+						     &deadline_ms))
+				goto out_err;
+		}
+	}
+
 	if (!strcmp(type_buf, "file"))
 		type = RECLAIM_FILE;
 	else if (!strcmp(type_buf, "anon"))
@@ -1782,8 +2141,9 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 		type = RECLAIM_RANGE;
 	else
 		goto out_err;
-	
-	if (type == RECLAIM_ALL)
+
+	/* synchronous "all" stays a no-op, async jobs reclaim in class order */
+	if (type == RECLAIM_ALL && !async)
 		return count;
 
 	if (type == RECLAIM_RANGE) {
@@ -1821,53 +2181,24 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 	if (!task)
 		return -ESRCH;
 
+	if (async) {
+		int err = reclaim_queue_job(task, type, start, end, budget,
+					    deadline_ms);
+
+		if (err && err != -ESRCH)
+			ret = err;
+		goto out;
+	}
+
 	mm = get_task_mm(task);
 	if (!mm)
 		goto out;
 
-	reclaim_walk.mm = mm;
-	reclaim_walk.pmd_entry = reclaim_pte_range;
-
-	down_read(&mm->mmap_sem);
-	if (type == RECLAIM_RANGE) {
-		vma = find_vma(mm, start);
-		while (vma) {
-			if (vma->vm_start > end)
-				break;
-			if (is_vm_hugetlb_page(vma))
-				continue;
-
-			reclaim_walk.private = vma;
-			if (walk_page_range(max(vma->vm_start, start),
-					min(vma->vm_end, end),
-					&reclaim_walk))
-					break;
-			vma = vma->vm_next;
-		}
-	} else {
-		for (vma = mm->mmap; vma; vma = vma->vm_next) {
-			if (is_vm_hugetlb_page(vma))
-				continue;
-
-			if (type == RECLAIM_ANON && vma->vm_file)
-				continue;
-
-			if (type == RECLAIM_FILE && !vma->vm_file)
-				continue;
-
-			reclaim_walk.private = vma;
-			if (walk_page_range(vma->vm_start, vma->vm_end,
-				&reclaim_walk))
-				break;;
-		}
-	}
-
-	flush_tlb_mm(mm);
-	up_read(&mm->mmap_sem);
+	reclaim_mm(mm, type, start, end, &rp);
 	mmput(mm);
 out:
 	put_task_struct(task);
-	return count;
+	return ret;
 
 out_err:
 	return -EINVAL;
@@ -1877,6 +2208,87 @@ const struct file_operations proc_reclaim_operations = {
 	.write		= reclaim_write,
 	.llseek		= noop_llseek,
 };
+
+static void reclaim_result_show_one(struct seq_file *m,
+				    const struct reclaim_result *res)
+{
+	seq_printf(m, "%lu %s %s %s %lu %u %lu %lu %llu %llu\n",
+		   res->id, reclaim_type_name[res->type],
+		   reclaim_job_state_name[res->state],
+		   res->state == RECLAIM_JOB_DONE ?
+				reclaim_stop_name[res->stop] : "-",
+		   res->budget, res->deadline_ms,
+		   res->nr_scanned, res->nr_reclaimed,
+		   div_u64(res->wait_ns, NSEC_PER_USEC),
+		   div_u64(res->run_ns, NSEC_PER_USEC));
+}
+
+static int reclaim_result_show(struct seq_file *m, void *v)
+{
+	struct task_struct *task = m->private;
+	struct reclaim_result *results;
+	struct reclaim_job *job;
+	pid_t pid = task_tgid_nr(task);
+	unsigned int i, idx, nr = 0;
+
+	results = kmalloc_array(RECLAIM_RESULT_MAX, sizeof(*results),
+				GFP_KERNEL);
+	if (!results)
+		return -ENOMEM;
+
+	seq_puts(m, "id type state stop budget deadline_ms scanned reclaimed wait_us run_us\n");
+
+	spin_lock(&reclaim_job_lock);
+	list_for_each_entry(job, &reclaim_jobs, list)
+		if (job->res.pid == pid && nr < RECLAIM_RESULT_MAX)
+			results[nr++] = job->res;
+	for (i = 0; i < RECLAIM_RESULT_MAX && nr < RECLAIM_RESULT_MAX; i++) {
+		/* newest first */
+		idx = (reclaim_result_next + RECLAIM_RESULT_MAX - 1 - i) %
+			RECLAIM_RESULT_MAX;
+		if (reclaim_results[idx].id && reclaim_results[idx].pid == pid)
+			results[nr++] = reclaim_results[idx];
+	}
+	spin_unlock(&reclaim_job_lock);
+
+	for (i = 0; i < nr; i++)
+		reclaim_result_show_one(m, &results[i]);
+
+	kfree(results);
+
+	return 0;
+}
+
+static int reclaim_result_open(struct inode *inode, struct file *file)
+{
+	struct task_struct *task = get_proc_task(inode);
+	int ret;
+
+	if (!task)
+		return -ESRCH;
+
+	ret = single_open(file, reclaim_result_show, task);
+	if (ret)
+		put_task_struct(task);
+
+	return ret;
+}
+
+static int reclaim_result_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *m = file->private_data;
+
+	put_task_struct(m->private);
+
+	return single_release(inode, file);
+}
+
+const struct file_operations proc_reclaim_result_operations = {
+	.open		= reclaim_result_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= reclaim_result_release,
+};
 #endif
 
 #ifdef CONFIG_NUMA
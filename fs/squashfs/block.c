@@ -79,85 +79,14 @@ static struct buffer_head *get_block_length(struct super_block *sb,
 
 
 /*
- * Read and decompress a metadata block or datablock.  Length is non-zero
- * if a datablock is being read (the size is stored elsewhere in the
- * filesystem), otherwise the length is obtained from the first two bytes of
- * the metadata block.  A bit in the length field indicates if the block
- * is stored uncompressed in the filesystem (usually because compression
- * generated a larger block - this does occasionally happen with compression
- * algorithms).
+ * Wait for the buffers of a block and decompress or copy them into @output.
+ * The buffers are released.
  */
-int squashfs_read_data(struct super_block *sb, u64 index, int length,
-		u64 *next_index, struct squashfs_page_actor *output)
+static int squashfs_read_buffers(struct squashfs_sb_info *msblk,
+	struct buffer_head **bh, int b, int offset, int length, int compressed,
+	struct squashfs_page_actor *output)
 {
-	struct squashfs_sb_info *msblk = sb->s_fs_info;
-	struct buffer_head **bh;
-	int offset = index & ((1 << msblk->devblksize_log2) - 1);
-	u64 cur_index = index >> msblk->devblksize_log2;
-	int bytes, compressed, b = 0, k = 0, avail, i;
-
-	bh = kcalloc(((output->length + msblk->devblksize - 1)
-		>> msblk->devblksize_log2) + 1, sizeof(*bh), GFP_KERNEL);
-	if (bh == NULL)
-		return -ENOMEM;
-
-	if (length) {
-		/*
-		 * Datablock.
-		 */
-		bytes = -offset;
-		compressed = SQUASHFS_COMPRESSED_BLOCK(length);
-		length = SQUASHFS_COMPRESSED_SIZE_BLOCK(length);
-		if (next_index)
-			*next_index = index + length;
-
-		TRACE("Block @ 0x%llx, %scompressed size %d, src size %d\n",
-			index, compressed ? "" : "un", length, output->length);
-
-		if (length < 0 || length > output->length ||
-				(index + length) > msblk->bytes_used)
-			goto read_failure;
-
-		for (b = 0; bytes < length; b++, cur_index++) {
-			bh[b] = sb_getblk(sb, cur_index);
-			if (bh[b] == NULL)
-				goto block_release;
-			bytes += msblk->devblksize;
-		}
-		ll_rw_block(READ, b, bh);
-	} else {
-		/*
-		 * Metadata block.
-		 */
-		if ((index + 2) > msblk->bytes_used)
-			goto read_failure;
-
-		bh[0] = get_block_length(sb, &cur_index, &offset, &length);
-		if (bh[0] == NULL)
-			goto read_failure;
-		b = 1;
-
-		bytes = msblk->devblksize - offset;
-		compressed = SQUASHFS_COMPRESSED(length);
-		length = SQUASHFS_COMPRESSED_SIZE(length);
-		if (next_index)
-			*next_index = index + length + 2;
-
-		TRACE("Block @ 0x%llx, %scompressed size %d\n", index,
-				compressed ? "" : "un", length);
-
-		if (length < 0 || length > output->length ||
-					(index + length) > msblk->bytes_used)
-			goto block_release;
-
-		for (; bytes < length; b++) {
-			bh[b] = sb_getblk(sb, ++cur_index);
-			if (bh[b] == NULL)
-				goto block_release;
-			bytes += msblk->devblksize;
-		}
-		ll_rw_block(READ, b - 1, bh + 1);
-	}
+	int bytes, k = 0, avail, i;
 
 	for (i = 0; i < b; i++) {
 		wait_on_buffer(bh[i]);
@@ -167,11 +96,9 @@ int squashfs_read_data(struct super_block *sb, u64 index, int length,
 
 	if (compressed) {
 		if (!msblk->stream)
-			goto read_failure;
-		length = squashfs_decompress(msblk, bh, b, offset, length,
+			goto block_release;
+		return squashfs_decompress(msblk, bh, b, offset, length,
 			output);
-		if (length < 0)
-			goto read_failure;
 	} else {
 		/*
 		 * Block is uncompressed.
@@ -201,6 +128,173 @@ int squashfs_read_data(struct super_block *sb, u64 index, int length,
 		squashfs_finish_page(output);
 	}
 
+	return length;
+
+block_release:
+	for (; k < b; k++)
+		put_bh(bh[k]);
+
+	return -EIO;
+}
+
+
+/*
+ * Reading a datablock is split in two halves, so that readahead can have
+ * the I/O of all the blocks it covers in flight before it starts to
+ * decompress the first.  squashfs_submit_datablock() starts the I/O,
+ * squashfs_complete_datablock() waits for it and decompresses the block.
+ * A submitted block must be completed or discarded.
+ */
+int squashfs_submit_datablock(struct super_block *sb, u64 index, int length,
+	int max_length, struct squashfs_datablock_read *rd)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	u64 cur_index = index >> msblk->devblksize_log2;
+	int bytes;
+
+	rd->index = index;
+	rd->offset = index & ((1 << msblk->devblksize_log2) - 1);
+	rd->compressed = SQUASHFS_COMPRESSED_BLOCK(length);
+	rd->length = SQUASHFS_COMPRESSED_SIZE_BLOCK(length);
+	rd->b = 0;
+
+	TRACE("Block @ 0x%llx, %scompressed size %d, src size %d\n",
+		index, rd->compressed ? "" : "un", rd->length, max_length);
+
+	if (rd->length < 0 || rd->length > max_length ||
+			(index + rd->length) > msblk->bytes_used)
+		goto read_failure;
+
+	rd->bh = kcalloc(((max_length + msblk->devblksize - 1)
+		>> msblk->devblksize_log2) + 1, sizeof(*rd->bh), GFP_KERNEL);
+	if (rd->bh == NULL)
+		return -ENOMEM;
+
+	for (bytes = -rd->offset; bytes < rd->length; rd->b++, cur_index++) {
+		rd->bh[rd->b] = sb_getblk(sb, cur_index);
+		if (rd->bh[rd->b] == NULL) {
+			squashfs_discard_datablock(rd);
+			goto read_failure;
+		}
+		bytes += msblk->devblksize;
+	}
+	ll_rw_block(READ, rd->b, rd->bh);
+
+	return 0;
+
+read_failure:
+	ERROR("squashfs_read_data failed to read block 0x%llx\n",
+					(unsigned long long) index);
+	return -EIO;
+}
+
+
+int squashfs_complete_datablock(struct super_block *sb,
+	struct squashfs_datablock_read *rd, struct squashfs_page_actor *output)
+{
+	int length = squashfs_read_buffers(sb->s_fs_info, rd->bh, rd->b,
+		rd->offset, rd->length, rd->compressed, output);
+
+	kfree(rd->bh);
+	if (length < 0) {
+		ERROR("squashfs_read_data failed to read block 0x%llx\n",
+					(unsigned long long) rd->index);
+		return -EIO;
+	}
+
+	return length;
+}
+
+
+void squashfs_discard_datablock(struct squashfs_datablock_read *rd)
+{
+	int i;
+
+	for (i = 0; i < rd->b; i++)
+		put_bh(rd->bh[i]);
+	kfree(rd->bh);
+}
+
+
+/*
+ * Read and decompress a metadata block or datablock.  Length is non-zero
+ * if a datablock is being read (the size is stored elsewhere in the
+ * filesystem), otherwise the length is obtained from the first two bytes of
+ * the metadata block.  A bit in the length field indicates if the block
+ * is stored uncompressed in the filesystem (usually because compression
+ * generated a larger block - this does occasionally happen with compression
+ * algorithms).
+ */
+int squashfs_read_data(struct super_block *sb, u64 index, int length,
+		u64 *next_index, struct squashfs_page_actor *output)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	struct buffer_head **bh;
+	int offset = index & ((1 << msblk->devblksize_log2) - 1);
+	u64 cur_index = index >> msblk->devblksize_log2;
+	int bytes, compressed, b = 0, k = 0;
+
+	if (length) {
+		/*
+		 * Datablock.
+		 */
+		struct squashfs_datablock_read rd;
+		int res;
+
+		if (next_index)
+			*next_index = index +
+				SQUASHFS_COMPRESSED_SIZE_BLOCK(length);
+
+		res = squashfs_submit_datablock(sb, index, length,
+			output->length, &rd);
+		if (res)
+			return res;
+
+		return squashfs_complete_datablock(sb, &rd, output);
+	}
+
+	bh = kcalloc(((output->length + msblk->devblksize - 1)
+		>> msblk->devblksize_log2) + 1, sizeof(*bh), GFP_KERNEL);
+	if (bh == NULL)
+		return -ENOMEM;
+
+	/*
+	 * Metadata block.
+	 */
+	if ((index + 2) > msblk->bytes_used)
+		goto read_failure;
+
+	bh[0] = get_block_length(sb, &cur_index, &offset, &length);
+	if (bh[0] == NULL)
+		goto read_failure;
+	b = 1;
+
+	bytes = msblk->devblksize - offset;
+	compressed = SQUASHFS_COMPRESSED(length);
+	length = SQUASHFS_COMPRESSED_SIZE(length);
+	if (next_index)
+		*next_index = index + length + 2;
+
+	TRACE("Block @ 0x%llx, %scompressed size %d\n", index,
+			compressed ? "" : "un", length);
+
+	if (length < 0 || length > output->length ||
+				(index + length) > msblk->bytes_used)
+		goto block_release;
+
+	for (; bytes < length; b++) {
+		bh[b] = sb_getblk(sb, ++cur_index);
+		if (bh[b] == NULL)
+			goto block_release;
+		bytes += msblk->devblksize;
+	}
+	ll_rw_block(READ, b - 1, bh + 1);
+
+	length = squashfs_read_buffers(msblk, bh, b, offset, length,
+		compressed, output);
+	if (length < 0)
+		goto read_failure;
+
 	kfree(bh);
 	return length;
 
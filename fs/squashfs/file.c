@@ -336,7 +336,7 @@ failed:
  * Get the on-disk location and compressed size of the datablock
  * specified by index.  Fill_meta_index() does most of the work.
  */
-static int read_blocklist(struct inode *inode, int index, u64 *block)
+int squashfs_read_blocklist(struct inode *inode, int index, u64 *block)
 {
 	u64 start;
 	long long blks;
@@ -344,7 +344,7 @@ static int read_blocklist(struct inode *inode, int index, u64 *block)
 	__le32 size;
 	int res = fill_meta_index(inode, index, &start, &offset, block);
 
-	TRACE("read_blocklist: res %d, index %d, start 0x%llx, offset"
+	TRACE("squashfs_read_blocklist: res %d, index %d, start 0x%llx, offset"
 		       " 0x%x, block 0x%llx\n", res, index, start, offset,
 			*block);
 
@@ -473,7 +473,7 @@ static int squashfs_readpage(struct file *file, struct page *page)
 	if (index < file_end || squashfs_i(inode)->fragment_block ==
 					SQUASHFS_INVALID_BLK) {
 		u64 block = 0;
-		int bsize = read_blocklist(inode, index, &block);
+		int bsize = squashfs_read_blocklist(inode, index, &block);
 		if (bsize < 0)
 			goto error_out;
 
@@ -503,5 +503,8 @@ out:
 
 
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+	.readpages = squashfs_readpages
+#endif
 };
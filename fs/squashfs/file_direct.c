@@ -13,6 +13,9 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/mm_inline.h>
+#include <linux/workqueue.h>
+#include <linux/cpumask.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -174,3 +177,227 @@ out:
 	squashfs_cache_put(buffer);
 	return res;
 }
+
+
+/*
+ * Readahead.  All the datablocks covered by the readahead window are
+ * submitted before the first one is decompressed, and all but the first
+ * are then decompressed by workers spread over the online CPUs, so that
+ * the multi and percpu decompressors work on them in parallel.  Pages of
+ * a block that are not part of the window are grabbed from the page
+ * cache as squashfs_readpage_block() does, or decompressed into scratch
+ * pages if they cannot be.
+ */
+struct squashfs_readahead_block {
+	struct work_struct		work;
+	struct super_block		*sb;
+	struct squashfs_datablock_read	rd;
+	struct squashfs_page_actor	*actor;
+	struct page			**page;
+	int				start;
+	int				pages;
+	u64				block;
+	int				bsize;
+	int				res;
+	bool				queued;
+};
+
+/* Scratch pages are the ones not in the page cache */
+static inline bool squashfs_scratch_page(struct page *page)
+{
+	return page->mapping == NULL;
+}
+
+static void squashfs_readahead_finish(struct squashfs_readahead_block *blk)
+{
+	int i, bytes = blk->res > 0 ? blk->res % PAGE_CACHE_SIZE : 0;
+	void *pageaddr;
+
+	for (i = 0; i < blk->pages; i++) {
+		struct page *page = blk->page[i];
+
+		if (page == NULL)
+			continue;
+
+		if (squashfs_scratch_page(page)) {
+			__free_page(page);
+			continue;
+		}
+
+		if (blk->res < 0) {
+			SetPageError(page);
+		} else {
+			/* Last page may have trailing bytes not filled */
+			if (bytes && i == blk->pages - 1) {
+				pageaddr = kmap_atomic(page);
+				memset(pageaddr + bytes, 0,
+					PAGE_CACHE_SIZE - bytes);
+				kunmap_atomic(pageaddr);
+			}
+			flush_dcache_page(page);
+			SetPageUptodate(page);
+		}
+		unlock_page(page);
+		page_cache_release(page);
+	}
+
+	kfree(blk->actor);
+}
+
+static void squashfs_readahead_work(struct work_struct *work)
+{
+	struct squashfs_readahead_block *blk = container_of(work,
+		struct squashfs_readahead_block, work);
+
+	blk->res = squashfs_complete_datablock(blk->sb, &blk->rd, blk->actor);
+	squashfs_readahead_finish(blk);
+}
+
+static void squashfs_readahead_submit(struct address_space *mapping,
+	struct squashfs_readahead_block *blk)
+{
+	int i;
+
+	for (i = 0; i < blk->pages; i++) {
+		struct page *page = blk->page[i];
+
+		if (page)
+			continue;
+
+		page = grab_cache_page_nowait(mapping, blk->start + i);
+		if (page && PageUptodate(page)) {
+			unlock_page(page);
+			page_cache_release(page);
+			page = NULL;
+		}
+		if (page == NULL)
+			page = alloc_page(GFP_KERNEL);
+		if (page == NULL) {
+			blk->res = -ENOMEM;
+			goto failed;
+		}
+		blk->page[i] = page;
+	}
+
+	blk->actor = squashfs_page_actor_init_special(blk->page, blk->pages, 0);
+	if (blk->actor == NULL) {
+		blk->res = -ENOMEM;
+		goto failed;
+	}
+
+	blk->res = squashfs_submit_datablock(blk->sb, blk->block, blk->bsize,
+		blk->pages << PAGE_CACHE_SHIFT, &blk->rd);
+	if (blk->res)
+		goto failed;
+
+	return;
+
+failed:
+	squashfs_readahead_finish(blk);
+}
+
+int squashfs_readpages(struct file *file, struct address_space *mapping,
+	struct list_head *pages, unsigned nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_CACHE_SHIFT;
+	int file_end = i_size_read(inode) >> msblk->block_log;
+	int last_page = (i_size_read(inode) - 1) >> PAGE_CACHE_SHIFT;
+	gfp_t gfp = readahead_gfp_mask(mapping);
+	struct squashfs_readahead_block *blocks, *blk = NULL;
+	struct page **page_array;
+	int first, nr_blocks, nr = 0, index = -1, i, cpu;
+	bool parallel = squashfs_max_decompressors() > 1;
+
+	/* The pages are listed from the highest index down */
+	first = lru_to_page(pages)->index >> shift;
+	nr_blocks = (list_entry(pages->next, struct page, lru)->index >> shift) -
+		first + 1;
+
+	blocks = kcalloc(nr_blocks, sizeof(*blocks), GFP_KERNEL);
+	page_array = kcalloc(nr_blocks << shift, sizeof(*page_array),
+		GFP_KERNEL);
+	if (blocks == NULL || page_array == NULL) {
+		kfree(page_array);
+		kfree(blocks);
+		return -ENOMEM;
+	}
+
+	while (!list_empty(pages)) {
+		struct page *page = lru_to_page(pages);
+		int n = page->index >> shift;
+
+		list_del(&page->lru);
+		if (add_to_page_cache_lru(page, mapping, page->index, gfp)) {
+			page_cache_release(page);
+			continue;
+		}
+
+		if (n != index) {
+			u64 block = 0;
+			int bsize = 0;
+
+			index = n;
+			blk = NULL;
+			if (nr < nr_blocks && (n < file_end ||
+					squashfs_i(inode)->fragment_block ==
+					SQUASHFS_INVALID_BLK))
+				bsize = squashfs_read_blocklist(inode, n,
+					&block);
+
+			if (bsize > 0) {
+				blk = &blocks[nr];
+				blk->sb = inode->i_sb;
+				blk->page = &page_array[nr++ << shift];
+				blk->start = n << shift;
+				blk->pages = min(last_page - blk->start + 1,
+					1 << shift);
+				blk->block = block;
+				blk->bsize = bsize;
+			}
+		}
+
+		if (blk) {
+			/* The reference is dropped by squashfs_readahead_finish */
+			blk->page[page->index - blk->start] = page;
+			continue;
+		}
+
+		/*
+		 * Sparse blocks, the fragment and errors are left to
+		 * squashfs_readpage.
+		 */
+		mapping->a_ops->readpage(file, page);
+		page_cache_release(page);
+	}
+
+	for (i = 0; i < nr; i++)
+		squashfs_readahead_submit(mapping, &blocks[i]);
+
+	cpu = raw_smp_processor_id();
+	for (i = 1; i < nr && parallel; i++) {
+		if (blocks[i].res)
+			continue;
+
+		cpu = cpumask_next(cpu, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_online_mask);
+
+		INIT_WORK(&blocks[i].work, squashfs_readahead_work);
+		queue_work_on(cpu, system_wq, &blocks[i].work);
+		blocks[i].queued = true;
+	}
+
+	for (i = 0; i < nr; i++) {
+		if (blocks[i].queued)
+			flush_work(&blocks[i].work);
+		else if (!blocks[i].res)
+			squashfs_readahead_work(&blocks[i].work);
+	}
+
+	kfree(page_array);
+	kfree(blocks);
+
+	return 0;
+}
@@ -28,8 +28,23 @@
 #define WARNING(s, args...)	pr_warn("SQUASHFS: "s, ## args)
 
 /* block.c */
+struct squashfs_datablock_read {
+	u64			index;
+	struct buffer_head	**bh;
+	int			b;
+	int			offset;
+	int			length;
+	int			compressed;
+};
+
 extern int squashfs_read_data(struct super_block *, u64, int, u64 *,
 				struct squashfs_page_actor *);
+extern int squashfs_submit_datablock(struct super_block *, u64, int, int,
+				struct squashfs_datablock_read *);
+extern int squashfs_complete_datablock(struct super_block *,
+				struct squashfs_datablock_read *,
+				struct squashfs_page_actor *);
+extern void squashfs_discard_datablock(struct squashfs_datablock_read *);
 
 /* cache.c */
 extern struct squashfs_cache *squashfs_cache_init(char *, int, int);
@@ -69,9 +84,12 @@ extern __le64 *squashfs_read_fragment_index_table(struct super_block *,
 /* file.c */
 void squashfs_copy_cache(struct page *, struct squashfs_cache_entry *, int,
 				int);
+extern int squashfs_read_blocklist(struct inode *, int, u64 *);
 
 /* file_xxx.c */
 extern int squashfs_readpage_block(struct page *, u64, int);
+extern int squashfs_readpages(struct file *, struct address_space *,
+				struct list_head *, unsigned);
 
 /* id.c */
 extern int squashfs_get_id(struct super_block *, unsigned int, unsigned int *);
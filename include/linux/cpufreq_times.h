@@ -30,6 +30,9 @@ void cpufreq_times_create_policy(struct cpufreq_policy *policy);
 void cpufreq_times_record_transition(struct cpufreq_freqs *freq);
 void cpufreq_task_times_remove_uids(uid_t uid_start, uid_t uid_end);
 int single_uid_time_in_state_open(struct inode *inode, struct file *file);
+int cpufreq_times_cpu_index(int cpu);
+unsigned int cpufreq_times_cpu_states(int cpu);
+unsigned int cpufreq_times_cpu_freq(int cpu, unsigned int index);
 #else
 static inline void cpufreq_task_times_init(struct task_struct *p) {}
 static inline void cpufreq_task_times_exit(struct task_struct *p) {}
@@ -40,5 +43,11 @@ static inline void cpufreq_times_record_transition(
 	struct cpufreq_freqs *freq) {}
 static inline void cpufreq_task_times_remove_uids(uid_t uid_start,
 						  uid_t uid_end) {}
+static inline int cpufreq_times_cpu_index(int cpu) { return -1; }
+static inline unsigned int cpufreq_times_cpu_states(int cpu) { return 0; }
+static inline unsigned int cpufreq_times_cpu_freq(int cpu, unsigned int index)
+{
+	return 0;
+}
 #endif /* CONFIG_CPU_FREQ_TIMES */
 #endif /* _LINUX_CPUFREQ_TIMES_H */
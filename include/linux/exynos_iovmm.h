@@ -137,6 +137,15 @@ dma_addr_t iovmm_map(struct device *dev, struct scatterlist *sg, off_t offset,
  */
 void iovmm_unmap(struct device *dev, dma_addr_t iova);
 
+/* iovmm_account_map_cache() - counts a lookup in a client's mapping cache
+ * @dev: the owner of the IO address space the lookup was made for
+ * @hit: true if an existing mapping was reused, false if a new one was made
+ *
+ * Clients that keep mappings alive across map/unmap cycles (e.g. ION) report
+ * their lookups here so that the hit ratio shows up in debugfs/iovmm.
+ */
+void iovmm_account_map_cache(struct device *dev, bool hit);
+
 /*
  * flags to option_iplanes and option_oplanes.
  * inplanes and onplanes is 'input planes' and 'output planes', respectively.
@@ -163,6 +172,7 @@ void iovmm_unmap(struct device *dev, dma_addr_t iova);
 #define iovmm_deactivate(dev)		do { } while (0)
 #define iovmm_map(dev, sg, offset, size, direction, prot) (-ENOSYS)
 #define iovmm_unmap(dev, iova)		do { } while (0)
+#define iovmm_account_map_cache(dev, hit) do { } while (0)
 #define get_domain_from_dev(dev)	NULL
 static inline dma_addr_t exynos_iovmm_map_userptr(struct device *dev,
 			unsigned long vaddr, size_t size, int prot)
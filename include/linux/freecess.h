@@ -77,6 +77,19 @@ struct kfreecess_msg_data
 
 extern int freecess_fw_version;    // record freecess framework version
 
+/* event counters, shown in /proc/freecess_stat */
+enum freecess_stat_item {
+	FREECESS_STAT_BINDER_DEFERRED,		// one-way txn held, not reported
+	FREECESS_STAT_BINDER_COALESCED,		// held txn merged into (node, code)
+	FREECESS_STAT_BINDER_OVERFLOW,		// deferral table full
+	FREECESS_STAT_BINDER_AGGREGATED,	// aggregated report sent
+	FREECESS_STAT_BINDER_EPOCH,		// deferral epoch ended by a thaw
+	FREECESS_STAT_PKG_HIT,			// packet for a watched uid
+	NR_FREECESS_STAT,
+};
+
+void freecess_stat_inc(enum freecess_stat_item item);
+
 typedef void (*freecess_hook)(void* data, unsigned int len);
 
 int sig_report(struct task_struct *p);
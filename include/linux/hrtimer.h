@@ -221,6 +221,8 @@ struct hrtimer_cpu_base {
 	unsigned int			nr_retries;
 	unsigned int			nr_hangs;
 	unsigned int			max_hang_time;
+	unsigned int			nr_coalesced;
+	unsigned int			nr_aligned;
 #endif
 #ifdef CONFIG_PREEMPT_RT_BASE
 	wait_queue_head_t		wait;
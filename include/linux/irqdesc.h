@@ -12,6 +12,39 @@ struct irq_desc;
 struct irq_domain;
 struct pt_regs;
 
+#ifdef CONFIG_IRQ_BALANCE
+/**
+ * struct irq_load - handling time and balancer state of an interrupt
+ * @time:	total time spent in the hard irq handlers, in ns
+ * @count:	number of times the handlers ran
+ * @cpu:	cpu the handlers last ran on
+ * @last_time:	@time at the previous balancing round
+ * @last_count:	@count at the previous balancing round
+ * @rate:	interrupts per second, averaged over the recent rounds
+ * @load:	permille of @cpu spent in the handlers, averaged likewise
+ * @policy:	IRQ_BALANCE_* policy
+ * @target:	cpu the balancer last routed the interrupt to, or -1
+ * @last_move:	jiffies of the last move
+ * @moves:	number of moves made by the balancer
+ *
+ * The first three are updated from the flow handler, the rest only
+ * from the balancer.
+ */
+struct irq_load {
+	u64			time;
+	unsigned int		count;
+	int			cpu;
+	u64			last_time;
+	unsigned int		last_count;
+	unsigned int		rate;
+	unsigned int		load;
+	unsigned int		policy;
+	int			target;
+	unsigned long		last_move;
+	unsigned int		moves;
+};
+#endif
+
 /**
  * struct irq_desc - interrupt descriptor
  * @irq_common_data:	per irq and chip data passed down to chip functions
@@ -41,6 +74,7 @@ struct pt_regs;
  * @force_resume_depth:	number of irqactions on a irq descriptor with
  *			IRQF_FORCE_RESUME set
  * @dir:		/proc/irq/ procfs entry
+ * @load:		handling time accounting for the irq balancer
  * @name:		flow handler name for /proc/interrupts output
  */
 struct irq_desc {
@@ -82,6 +116,9 @@ struct irq_desc {
 #endif
 #ifdef CONFIG_PROC_FS
 	struct proc_dir_entry	*dir;
+#endif
+#ifdef CONFIG_IRQ_BALANCE
+	struct irq_load		load;
 #endif
 	int			parent_irq;
 	struct module		*owner;
@@ -50,6 +50,7 @@ struct wake_irq;
  * @wakeup_count: Number of times the wakeup source might abort suspend.
  * @active: Status of the wakeup source.
  * @has_timeout: The wakeup source has been activated with a timeout.
+ * @stats_detached: Removed from the top-N and snapshot statistics.
  */
 struct wakeup_source {
 	const char 		*name;
@@ -71,6 +72,7 @@ struct wakeup_source {
 	unsigned long		wakeup_count;
 	bool			active:1;
 	bool			autosleep_enabled:1;
+	bool			stats_detached;
 };
 
 #ifdef CONFIG_PM_SLEEP
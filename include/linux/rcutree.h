@@ -53,6 +53,7 @@ void synchronize_sched_expedited(void);
 void synchronize_rcu_expedited(void);
 
 void kfree_call_rcu(struct rcu_head *head, rcu_callback_t func);
+void call_rcu_lazy(struct rcu_head *head, rcu_callback_t func);
 
 /**
  * synchronize_rcu_bh_expedited - Brute-force RCU-bh grace period
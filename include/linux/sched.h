@@ -65,6 +65,7 @@ struct sched_param {
 #include <asm/processor.h>
 
 #define SCHED_ATTR_SIZE_VER0	48	/* sizeof first published struct */
+#define SCHED_ATTR_SIZE_VER1	56	/* add: util_{min,max} */
 
 /*
  * Extended scheduling parameters data structure.
@@ -102,6 +103,9 @@ struct sched_param {
  *  @sched_runtime	representative of the task's runtime
  *  @sched_period	representative of the task's period
  *
+ *  @sched_util_min	utilization floor    (SCHED_FLAG_UTIL_CLAMP_MIN)
+ *  @sched_util_max	utilization ceiling  (SCHED_FLAG_UTIL_CLAMP_MAX)
+ *
  * Given this task model, there are a multiplicity of scheduling algorithms
  * and policies, that can be used to ensure all the tasks will make their
  * timing constraints.
@@ -126,6 +130,10 @@ struct sched_attr {
 	u64 sched_runtime;
 	u64 sched_deadline;
 	u64 sched_period;
+
+	/* Utilization hints */
+	u32 sched_util_min;
+	u32 sched_util_max;
 };
 
 struct futex_pi_state;
@@ -1519,6 +1527,63 @@ struct sched_rt_entity {
 #endif
 };
 
+#ifdef CONFIG_UCLAMP_TASK
+/* Number of utilization clamp buckets (shorter alias) */
+#define UCLAMP_BUCKETS CONFIG_UCLAMP_BUCKETS_COUNT
+
+enum uclamp_id {
+	UCLAMP_MIN = 0,
+	UCLAMP_MAX,
+	UCLAMP_CNT
+};
+
+/*
+ * Utilization clamp for a scheduling entity
+ * @value:		clamp value "assigned" to a se
+ * @bucket_id:		bucket index corresponding to the "assigned" value
+ * @active:		the se is currently refcounted in a rq's bucket
+ * @user_defined:	the requested clamp value comes from user-space
+ *
+ * The bucket_id is the index of the clamp bucket matching the clamp value
+ * which is pre-computed and stored to avoid expensive integer divisions from
+ * the fast path.
+ *
+ * The active bit is set whenever a task has got an "effective" value assigned,
+ * which can be different from the clamp value "requested" from user-space.
+ * This allows to know a task is refcounted in the rq's bucket corresponding
+ * to the "effective" bucket_id.
+ */
+struct uclamp_se {
+	unsigned int value		: 11;	/* 0..SCHED_CAPACITY_SCALE */
+	unsigned int bucket_id		: 5;	/* 0..UCLAMP_BUCKETS-1 */
+	unsigned int active		: 1;
+	unsigned int user_defined	: 1;
+};
+#endif /* CONFIG_UCLAMP_TASK */
+
+#ifdef CONFIG_SCHED_TASK_PMU
+/*
+ * Hardware counter feed of a task, sampled when it is switched out
+ * @cycles:		cycles counted while the task ran
+ * @instructions:	instructions retired while the task ran
+ * @refills:		cache refills while the task ran
+ * @nr_samples:		slices long enough to update the averages
+ * @ipc_avg:		decayed instructions per cycle, scaled by 1024
+ * @mpki_avg:		decayed refills per 1000 instructions, scaled by 1024
+ *
+ * The totals are in the units of the events actually counting, see
+ * kernel/sched/task_pmu.c; the averages only move with hardware events.
+ */
+struct task_pmu {
+	u64			cycles;
+	u64			instructions;
+	u64			refills;
+	unsigned long		nr_samples;
+	unsigned int		ipc_avg;
+	unsigned int		mpki_avg;
+};
+#endif
+
 struct sched_dl_entity {
 	struct rb_node	rb_node;
 
@@ -1652,6 +1717,16 @@ struct task_struct {
 #endif
 	struct sched_dl_entity dl;
 
+#ifdef CONFIG_UCLAMP_TASK
+	/* Clamp values requested for a scheduling entity */
+	struct uclamp_se uclamp_req[UCLAMP_CNT];
+	/* Effective clamp values used for a scheduling entity */
+	struct uclamp_se uclamp[UCLAMP_CNT];
+#endif
+#ifdef CONFIG_SCHED_TASK_PMU
+	struct task_pmu pmu;
+#endif
+
 #ifdef CONFIG_PREEMPT_NOTIFIERS
 	/* list of struct preempt_notifier: */
 	struct hlist_head preempt_notifiers;
@@ -1931,6 +2006,15 @@ struct task_struct {
 	unsigned long ptrace_message;
 	siginfo_t *last_siginfo; /* For ptrace use.  */
 	struct task_io_accounting ioac;
+#ifdef CONFIG_UID_SYS_STATS
+	/*
+	 * Part of ioac already charged to the uid by uid_sys_stats. Only
+	 * valid when uid_ioac_task points back at this task, as a child
+	 * inherits the parent's copy.
+	 */
+	struct task_io_accounting uid_ioac;
+	struct task_struct *uid_ioac_task;
+#endif
 #if defined(CONFIG_TASK_XACCT)
 	u64 acct_rss_mem1;	/* accumulated rss usage */
 	u64 acct_vm_mem1;	/* accumulated virtual memory usage */
@@ -3781,6 +3865,24 @@ static inline unsigned long rlimit_max(unsigned int limit)
 	return task_rlimit_max(current, limit);
 }
 
+#ifdef CONFIG_CGROUP_SCHEDTUNE
+extern unsigned long schedtune_timer_slack(struct task_struct *tsk);
+#else
+static inline unsigned long schedtune_timer_slack(struct task_struct *tsk)
+{
+	return 0;
+}
+#endif
+
+/*
+ * Timer slack of @tsk: its own, raised to the one set for its schedtune
+ * group, so that background groups can be given coarse timers as a whole.
+ */
+static inline unsigned long task_timer_slack(struct task_struct *tsk)
+{
+	return max(tsk->timer_slack_ns, schedtune_timer_slack(tsk));
+}
+
 #ifdef CONFIG_CPU_FREQ
 struct update_util_data {
 	void (*func)(struct update_util_data *data,
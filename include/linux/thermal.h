@@ -69,6 +69,8 @@
 #define DEFAULT_THERMAL_GOVERNOR       "user_space"
 #elif defined(CONFIG_THERMAL_DEFAULT_GOV_POWER_ALLOCATOR)
 #define DEFAULT_THERMAL_GOVERNOR       "power_allocator"
+#elif defined(CONFIG_THERMAL_DEFAULT_GOV_MODEL_PREDICTIVE)
+#define DEFAULT_THERMAL_GOVERNOR       "model_predictive"
 #endif
 
 typedef int (*get_static_t)(cpumask_t *cpumask, int interval,
@@ -0,0 +1,33 @@
+/* include/linux/uid_sys_stats.h
+ *
+ * Copyright (C) 2014 - 2015 Google, Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _LINUX_UID_SYS_STATS_H
+#define _LINUX_UID_SYS_STATS_H
+
+#include <linux/cputime.h>
+#include <uapi/linux/uid_sys_stats.h>
+
+struct task_struct;
+
+#ifdef CONFIG_UID_SYS_STATS
+void uid_sys_stats_account_cputime(struct task_struct *p, cputime_t cputime,
+				   bool user);
+void uid_sys_stats_task_switch(struct task_struct *prev);
+#else
+static inline void uid_sys_stats_account_cputime(struct task_struct *p,
+						 cputime_t cputime, bool user) {}
+static inline void uid_sys_stats_task_switch(struct task_struct *prev) {}
+#endif /* CONFIG_UID_SYS_STATS */
+#endif /* _LINUX_UID_SYS_STATS_H */
@@ -517,7 +517,7 @@ do {									\
 	hrtimer_init_sleeper(&__t, current);				\
 	if ((timeout).tv64 != KTIME_MAX)				\
 		hrtimer_start_range_ns(&__t.timer, timeout,		\
-				       current->timer_slack_ns,		\
+				       task_timer_slack(current),	\
 				       HRTIMER_MODE_REL);		\
 									\
 	__ret = ___wait_event(wq, condition, state, 0, 0,		\
@@ -980,6 +980,79 @@ TRACE_EVENT(sched_fluid_select_norm_cpu,
 );
 #endif
 
+#ifdef CONFIG_SCHED_RT_CAS
+/*
+ * Tracepoint for the CPU find_lowest_rq() picks for an RT task.
+ */
+TRACE_EVENT(sched_rt_cas_select,
+
+	TP_PROTO(struct task_struct *p, unsigned long util,
+		 int best_cpu, unsigned long capacity,
+		 unsigned int exit_latency, bool fits),
+
+	TP_ARGS(p, util, best_cpu, capacity, exit_latency, fits),
+
+	TP_STRUCT__entry(
+		__array(char,		comm,	TASK_COMM_LEN	)
+		__field(pid_t,		pid			)
+		__field(int,		prio			)
+		__field(int,		prev_cpu		)
+		__field(unsigned long,	util			)
+		__field(int,		best_cpu		)
+		__field(unsigned long,	capacity		)
+		__field(unsigned int,	exit_latency		)
+		__field(bool,		fits			)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->comm, p->comm, TASK_COMM_LEN);
+		__entry->pid		= p->pid;
+		__entry->prio		= p->prio;
+		__entry->prev_cpu	= task_cpu(p);
+		__entry->util		= util;
+		__entry->best_cpu	= best_cpu;
+		__entry->capacity	= capacity;
+		__entry->exit_latency	= exit_latency;
+		__entry->fits		= fits;
+	),
+
+	TP_printk("comm=%s pid=%d prio=%d prev_cpu=%d util=%lu best_cpu=%d capacity=%lu exit_latency=%u fits=%d",
+		  __entry->comm, __entry->pid, __entry->prio,
+		  __entry->prev_cpu, __entry->util, __entry->best_cpu,
+		  __entry->capacity, __entry->exit_latency, __entry->fits)
+);
+
+/*
+ * Tracepoint for the wakeup placement of an RT task.
+ */
+TRACE_EVENT(sched_rt_cas_wakeup,
+
+	TP_PROTO(struct task_struct *p, int cpu, int target, bool prev_fits),
+
+	TP_ARGS(p, cpu, target, prev_fits),
+
+	TP_STRUCT__entry(
+		__array(char,	comm,	TASK_COMM_LEN	)
+		__field(pid_t,	pid			)
+		__field(int,	cpu			)
+		__field(int,	target			)
+		__field(bool,	prev_fits		)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->comm, p->comm, TASK_COMM_LEN);
+		__entry->pid		= p->pid;
+		__entry->cpu		= cpu;
+		__entry->target		= target;
+		__entry->prev_fits	= prev_fits;
+	),
+
+	TP_printk("comm=%s pid=%d cpu=%d target=%d prev_fits=%d",
+		  __entry->comm, __entry->pid, __entry->cpu,
+		  __entry->target, __entry->prev_fits)
+);
+#endif /* CONFIG_SCHED_RT_CAS */
+
 /*
  * Tracepoint for HMP (CONFIG_SCHED_HMP) task migrations.
  */
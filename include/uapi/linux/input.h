@@ -295,6 +295,82 @@ struct input_mask {
 
 #define EVIOCSCLOCKID		_IOW('E', 0xa0, int)			/* Set clockid to be used for timestamps */
 
+/**
+ * EVIOCSRING - Switch the client to an mmap'able event ring
+ *
+ * The argument is the minimum number of events the ring must hold; it is
+ * rounded up to a power of two. Afterwards the events of this file
+ * descriptor are no longer returned by read(), which fails with EINVAL,
+ * but written by the kernel directly into a ring the client maps with
+ * mmap() at offset 0. The mapping starts with a struct input_event_ring,
+ * the events follow at data_offset as struct input_ring_event.
+ *
+ * The kernel is the only producer and the client the only consumer. head
+ * is advanced by the kernel to the end of each complete packet (after
+ * SYN_REPORT or SYN_DROPPED); the client consumes the events from tail up
+ * to head and then advances tail. head and tail are free-running and
+ * taken modulo size to index the events. Read head with acquire and write
+ * tail with release semantics. poll() reports POLLIN while head != tail,
+ * so a client can sleep, batch or busy-poll as it sees fit.
+ *
+ * When the ring is full the packet being delivered is dropped and, as
+ * soon as there is room, a SYN_DROPPED event is queued. Unlike with
+ * read(), EVIOCGKEY and friends do not flush already queued events.
+ *
+ * This ioctl fails with EBUSY if the ring is already set up, EINVAL for
+ * a size of 0 or above INPUT_RING_MAX_EVENTS and ENOMEM if the ring
+ * cannot be allocated.
+ */
+#define EVIOCSRING		_IOW('E', 0xa1, unsigned int)		/* Switch to an mmap'able event ring */
+
+#define INPUT_RING_VERSION	1
+#define INPUT_RING_MAX_EVENTS	16384
+#define INPUT_RING_DATA_OFFSET	128
+
+/**
+ * struct input_event_ring - header of the ring mapped after EVIOCSRING
+ * @version: INPUT_RING_VERSION
+ * @size: number of events in the ring, a power of two
+ * @event_size: size of struct input_ring_event
+ * @data_offset: offset of the first event from the start of the mapping
+ * @head: end of the last complete packet, written by the kernel
+ * @dropped: events dropped because the ring was full, written by the kernel
+ * @tail: first event not consumed yet, written by the client
+ *
+ * The fields written by the kernel and by the client are kept on separate
+ * cache lines.
+ */
+struct input_event_ring {
+	__u32 version;
+	__u32 size;
+	__u32 event_size;
+	__u32 data_offset;
+	__u32 head;
+	__u32 dropped;
+	__u32 reserved0[10];
+	__u32 tail;
+	__u32 reserved1[15];
+};
+
+/**
+ * struct input_ring_event - one event in the ring
+ * @sec: timestamp seconds, in the clock selected with EVIOCSCLOCKID
+ * @usec: timestamp microseconds
+ * @type: event type
+ * @code: event code
+ * @value: event value
+ *
+ * The layout is the same for 32 and 64-bit clients.
+ */
+struct input_ring_event {
+	__s64 sec;
+	__u32 usec;
+	__u16 type;
+	__u16 code;
+	__s32 value;
+	__u32 reserved;
+};
+
 /*
  * IDs.
  */
@@ -0,0 +1,54 @@
+#ifndef _UAPI_LINUX_UID_SYS_STATS_H
+#define _UAPI_LINUX_UID_SYS_STATS_H
+
+#include <linux/types.h>
+
+/*
+ * Binary per-uid statistics, read from /proc/uid_cputime/show_uid_stat_bin.
+ * A read returns a struct uid_sys_stats_header followed by one struct
+ * uid_sys_stats_record per uid whose cputime, I/O or state changed since
+ * the previous read through the same open file; the first read returns all
+ * uids. Read again with pread() at offset 0 to get the next delta. Records
+ * carry totals, not deltas, so a uid may be reported more than once.
+ */
+
+#define UID_SYS_STATS_VERSION		1
+
+#define UID_SYS_STATS_FOREGROUND	0
+#define UID_SYS_STATS_BACKGROUND	1
+#define UID_SYS_STATS_NR_STATES		2
+
+#define UID_SYS_STATS_IO_RCHAR		0
+#define UID_SYS_STATS_IO_WCHAR		1
+#define UID_SYS_STATS_IO_READ_BYTES	2
+#define UID_SYS_STATS_IO_WRITE_BYTES	3
+#define UID_SYS_STATS_IO_FSYNC		4
+#define UID_SYS_STATS_NR_IO		5
+
+/**
+ * struct uid_sys_stats_header - start of a binary dump
+ * @version:		UID_SYS_STATS_VERSION
+ * @record_size:	size of each following record
+ */
+struct uid_sys_stats_header {
+	__u32	version;
+	__u32	record_size;
+};
+
+/**
+ * struct uid_sys_stats_record - totals of one uid
+ * @uid:	uid in the reader's user namespace
+ * @state:	UID_SYS_STATS_FOREGROUND or UID_SYS_STATS_BACKGROUND
+ * @utime_us:	user time, as the first column of show_uid_stat
+ * @stime_us:	system time, as the second column of show_uid_stat
+ * @io:		I/O per state, indexed by UID_SYS_STATS_IO_*
+ */
+struct uid_sys_stats_record {
+	__u32	uid;
+	__u32	state;
+	__u64	utime_us;
+	__u64	stime_us;
+	__u64	io[UID_SYS_STATS_NR_STATES][UID_SYS_STATS_NR_IO];
+};
+
+#endif /* _UAPI_LINUX_UID_SYS_STATS_H */
@@ -0,0 +1,63 @@
+#ifndef _UAPI_LINUX_WAKEUP_STATS_H
+#define _UAPI_LINUX_WAKEUP_STATS_H
+
+#include <linux/types.h>
+
+/*
+ * Binary wakeup source statistics, read from wakeup_sources_top and
+ * wakeup_sources_snapshots next to the wakeup_sources text dump (debugfs,
+ * or /proc without debugfs). wakeup_sources_top returns an array of
+ * struct wakeup_stats_source, wakeup_sources_snapshots one of struct
+ * wakeup_stats_snapshot, oldest first. Read each with a single read() large
+ * enough for the maximum number of records.
+ */
+
+#define WAKEUP_STATS_NAME_LEN		32
+#define WAKEUP_STATS_TOP_N		16
+#define WAKEUP_STATS_NR_SNAPSHOTS	8
+
+/* wakeup_stats_source.flags */
+#define WAKEUP_STATS_ACTIVE		(1 << 0)
+
+/**
+ * struct wakeup_stats_source - one wakeup source
+ * @name:		name, truncated to WAKEUP_STATS_NAME_LEN - 1
+ * @active_time_ns:	total active time including the ongoing activation,
+ *			or for snapshots the time of activations ended in the
+ *			period
+ * @active_count:	activations, or for snapshots activations ended in
+ *			the period
+ * @flags:		WAKEUP_STATS_ACTIVE if the source is active now, always
+ *			0 in snapshots
+ */
+struct wakeup_stats_source {
+	char	name[WAKEUP_STATS_NAME_LEN];
+	__u64	active_time_ns;
+	__u32	active_count;
+	__u32	flags;
+};
+
+/**
+ * struct wakeup_stats_snapshot - wakeup source activity in one period
+ * @seq:		snapshot sequence number, starting at 1
+ * @start_ns:		CLOCK_MONOTONIC start of the period
+ * @end_ns:		CLOCK_MONOTONIC end of the period
+ * @active_time_ns:	active time of all sources in the period
+ * @active_count:	activations of all sources ended in the period
+ * @nr_sources:		valid entries in @sources
+ * @sources:		sources with the most active time in the period,
+ *			most active first. The list is kept with bounded
+ *			memory, so a source's time may be overestimated by at
+ *			most the time of the last entry.
+ */
+struct wakeup_stats_snapshot {
+	__u64	seq;
+	__u64	start_ns;
+	__u64	end_ns;
+	__u64	active_time_ns;
+	__u32	active_count;
+	__u32	nr_sources;
+	struct wakeup_stats_source sources[WAKEUP_STATS_TOP_N];
+};
+
+#endif /* _UAPI_LINUX_WAKEUP_STATS_H */
@@ -0,0 +1,497 @@
+/*
+ * linux/kernel/irq/balance.c
+ *
+ * Capacity aware balancing of hot interrupts.
+ *
+ * The flow handler accounts the time spent in the hard irq handlers of
+ * every interrupt (irq_load_end()). Every interval the balancer turns
+ * that into a rate and a load for each interrupt, and moves the hot
+ * ones to the cpu where they cost the least:
+ *
+ *  - running the handlers costs their load, weighted by the capacity of
+ *    the cpu, as big cores spend more energy for the same work;
+ *  - waking a cpu costs the exit latency of its deepest idle state, for
+ *    the share of the interrupts that find it idle;
+ *  - load that does not fit in the spare capacity of a cpu delays the
+ *    tasks running there and is charged several times over.
+ *
+ * An interrupt is only moved when another cpu is cheaper by a margin
+ * and it has not been moved recently, so that the balancer does not
+ * chase noise. Softirqs raised by a handler run on the cpu that took
+ * the interrupt, so they follow it.
+ *
+ * Only interrupts routed to the default affinity, or to the cpu the
+ * balancer picked, are balanced. Any affinity set by DT, a driver or
+ * userspace is left alone.
+ */
+
+#include <linux/irq.h>
+#include <linux/interrupt.h>
+#include <linux/cpuidle.h>
+#include <linux/tick.h>
+#include <linux/topology.h>
+#include <linux/workqueue.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/moduleparam.h>
+
+#include "internals.h"
+
+#undef MODULE_PARAM_PREFIX
+#define MODULE_PARAM_PREFIX "irq_balance."
+
+#ifndef arch_scale_cpu_capacity
+#define arch_scale_cpu_capacity(sd, cpu)	SCHED_CAPACITY_SCALE
+#endif
+
+/* per round cap on moves, the rest waits for the next round */
+#define IRQ_BALANCE_MAX_MOVES	4
+
+static bool irq_balance_enabled;
+static unsigned int irq_balance_interval_ms = 1000;
+static unsigned int irq_balance_hot_permille = 10;
+static unsigned int irq_balance_hot_rate = 500;
+static unsigned int irq_balance_margin = 25;
+static unsigned int irq_balance_min_rounds = 5;
+
+module_param_named(interval_ms, irq_balance_interval_ms, uint, 0644);
+module_param_named(hot_permille, irq_balance_hot_permille, uint, 0644);
+module_param_named(hot_rate, irq_balance_hot_rate, uint, 0644);
+module_param_named(margin, irq_balance_margin, uint, 0644);
+module_param_named(min_rounds, irq_balance_min_rounds, uint, 0644);
+
+struct irq_balance_cpu {
+	u64		idle_us;
+	u64		wall_us;
+	unsigned long	capacity;
+	unsigned int	exit_latency;	/* us */
+	unsigned int	idle;		/* permille of the last round */
+	long		spare;		/* capacity left over */
+};
+
+static struct irq_balance_cpu *irq_balance_cpus;
+static struct cpumask irq_balance_little, irq_balance_big;
+static unsigned long irq_balance_max_capacity;
+static u64 irq_balance_last;
+static bool irq_balance_primed;
+static bool irq_balance_ready;
+
+static void irq_balance_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(irq_balance_work, irq_balance_fn);
+
+static const char * const irq_balance_policies[] = {
+	[IRQ_BALANCE_AUTO]	= "auto",
+	[IRQ_BALANCE_LITTLE]	= "little",
+	[IRQ_BALANCE_BIG]	= "big",
+	[IRQ_BALANCE_NONE]	= "none",
+};
+
+const char *irq_balance_policy_name(unsigned int policy)
+{
+	if (policy >= ARRAY_SIZE(irq_balance_policies))
+		return "?";
+	return irq_balance_policies[policy];
+}
+
+#ifdef CONFIG_CPU_IDLE
+static unsigned int irq_balance_exit_latency(int cpu)
+{
+	struct cpuidle_device *dev = per_cpu(cpuidle_devices, cpu);
+	struct cpuidle_driver *drv = cpuidle_get_cpu_driver(dev);
+	unsigned int latency = 0;
+	int i;
+
+	if (!dev || !drv)
+		return 0;
+
+	for (i = 0; i < drv->state_count; i++) {
+		if (drv->states[i].disabled || dev->states_usage[i].disable)
+			continue;
+		latency = max(latency, drv->states[i].exit_latency);
+	}
+
+	return latency;
+}
+#else
+static inline unsigned int irq_balance_exit_latency(int cpu)
+{
+	return 0;
+}
+#endif
+
+/*
+ * Sample the idle time of the online cpus. Returns false if the idle
+ * time is not accounted, i.e. nohz is not active.
+ */
+static bool irq_balance_update_cpus(void)
+{
+	unsigned long min_capacity = ULONG_MAX;
+	int cpu;
+
+	irq_balance_max_capacity = 0;
+
+	for_each_online_cpu(cpu) {
+		struct irq_balance_cpu *bc = &irq_balance_cpus[cpu];
+		u64 idle, iowait, wall;
+		u64 d_idle, d_wall;
+
+		idle = get_cpu_idle_time_us(cpu, &wall);
+		if (idle == -1ULL)
+			return false;
+		iowait = get_cpu_iowait_time_us(cpu, NULL);
+		if (iowait != -1ULL)
+			idle += iowait;
+
+		d_idle = idle - bc->idle_us;
+		d_wall = wall - bc->wall_us;
+		bc->idle_us = idle;
+		bc->wall_us = wall;
+
+		bc->idle = d_wall ? min_t(u64, div64_u64(d_idle * 1000, d_wall),
+					  1000) : 1000;
+		bc->capacity = arch_scale_cpu_capacity(NULL, cpu);
+		bc->exit_latency = irq_balance_exit_latency(cpu);
+		bc->spare = bc->capacity * bc->idle / 1000;
+
+		min_capacity = min(min_capacity, bc->capacity);
+		irq_balance_max_capacity = max(irq_balance_max_capacity,
+					       bc->capacity);
+	}
+
+	cpumask_clear(&irq_balance_little);
+	cpumask_clear(&irq_balance_big);
+	for_each_online_cpu(cpu) {
+		if (irq_balance_cpus[cpu].capacity == min_capacity)
+			cpumask_set_cpu(cpu, &irq_balance_little);
+		if (irq_balance_cpus[cpu].capacity == irq_balance_max_capacity)
+			cpumask_set_cpu(cpu, &irq_balance_big);
+	}
+
+	return true;
+}
+
+static void irq_balance_update_load(struct irq_desc *desc, u64 interval)
+{
+	struct irq_load *load = &desc->load;
+	u64 time = READ_ONCE(load->time);
+	unsigned int count = READ_ONCE(load->count);
+	unsigned int rate, permille;
+
+	rate = div64_u64((u64)(count - load->last_count) * NSEC_PER_SEC,
+			 interval);
+	permille = min_t(u64, div64_u64((time - load->last_time) * 1000,
+					interval), 1000);
+	load->last_time = time;
+	load->last_count = count;
+
+	/* average over a couple of rounds, the first one is taken as is */
+	if (!load->rate && !load->load) {
+		load->rate = rate;
+		load->load = permille;
+	} else {
+		load->rate = (load->rate + rate) / 2;
+		load->load = (load->load + permille) / 2;
+	}
+}
+
+static bool irq_balance_is_hot(struct irq_desc *desc)
+{
+	return desc->load.load >= irq_balance_hot_permille ||
+	       desc->load.rate >= irq_balance_hot_rate;
+}
+
+/* the interrupt is routed where the balancer may take it from */
+static bool irq_balance_owns(struct irq_desc *desc)
+{
+	const struct cpumask *mask = irq_data_get_affinity_mask(&desc->irq_data);
+
+	if (desc->load.target >= 0 &&
+	    cpumask_equal(mask, cpumask_of(desc->load.target)))
+		return true;
+
+	return cpumask_equal(mask, irq_default_affinity);
+}
+
+static bool irq_balance_can_move(struct irq_desc *desc)
+{
+	if (READ_ONCE(desc->load.policy) == IRQ_BALANCE_NONE)
+		return false;
+	if (!desc->action || irqd_is_per_cpu(&desc->irq_data) ||
+	    irqd_affinity_is_managed(&desc->irq_data) ||
+	    !irq_can_set_affinity(irq_desc_get_irq(desc)))
+		return false;
+
+	return irq_balance_owns(desc);
+}
+
+/* cost of running @desc on @cpu, in capacity units */
+static long irq_balance_cost(struct irq_desc *desc, int cpu, long demand,
+			     bool current_cpu)
+{
+	struct irq_balance_cpu *bc = &irq_balance_cpus[cpu];
+	long spare = bc->spare + (current_cpu ? demand : 0);
+	long cost, wake;
+
+	cost = demand * bc->capacity / irq_balance_max_capacity;
+
+	/* us per second spent exiting idle, as permille, then capacity */
+	wake = div_u64((u64)desc->load.rate * bc->idle * bc->exit_latency,
+		       1000000);
+	cost += wake * bc->capacity / 1000;
+
+	if (demand > spare)
+		cost += 4 * (demand - spare);
+
+	return cost;
+}
+
+static int irq_balance_pick(struct irq_desc *desc, int cur, long demand,
+			    long *cur_cost)
+{
+	struct cpumask candidates;
+	long best_cost = LONG_MAX;
+	int cpu, best = cur;
+
+	cpumask_and(&candidates, cpu_online_mask, irq_default_affinity);
+	switch (READ_ONCE(desc->load.policy)) {
+	case IRQ_BALANCE_LITTLE:
+		if (cpumask_intersects(&candidates, &irq_balance_little))
+			cpumask_and(&candidates, &candidates,
+				    &irq_balance_little);
+		break;
+	case IRQ_BALANCE_BIG:
+		if (cpumask_intersects(&candidates, &irq_balance_big))
+			cpumask_and(&candidates, &candidates, &irq_balance_big);
+		break;
+	}
+
+	*cur_cost = irq_balance_cost(desc, cur, demand, true);
+
+	for_each_cpu(cpu, &candidates) {
+		long cost = irq_balance_cost(desc, cpu, demand, cpu == cur);
+
+		if (cost < best_cost) {
+			best_cost = cost;
+			best = cpu;
+		}
+	}
+
+	/* a policy the current cpu does not satisfy is moved regardless */
+	if (!cpumask_test_cpu(cur, &candidates))
+		return best;
+
+	if (best_cost * (100 + irq_balance_margin) >= *cur_cost * 100)
+		return cur;
+
+	return best;
+}
+
+static void irq_balance_move(struct irq_desc *desc, int cur, int cpu,
+			     long demand)
+{
+	unsigned int irq = irq_desc_get_irq(desc);
+
+	if (irq_set_affinity(irq, cpumask_of(cpu)))
+		return;
+
+	desc->load.target = cpu;
+	desc->load.last_move = jiffies;
+	desc->load.moves++;
+
+	irq_balance_cpus[cur].spare += demand;
+	irq_balance_cpus[cpu].spare -= demand;
+}
+
+static void irq_balance(u64 interval)
+{
+	unsigned long min_wait = msecs_to_jiffies(irq_balance_interval_ms *
+						  irq_balance_min_rounds);
+	int moves = 0;
+	unsigned int irq;
+
+	irq_lock_sparse();
+
+	for_each_active_irq(irq) {
+		struct irq_desc *desc = irq_to_desc(irq);
+		int cur, cpu;
+		long demand, cur_cost;
+
+		if (!desc)
+			continue;
+
+		irq_balance_update_load(desc, interval);
+
+		if (moves >= IRQ_BALANCE_MAX_MOVES || !irq_balance_is_hot(desc) ||
+		    !irq_balance_can_move(desc))
+			continue;
+
+		cur = READ_ONCE(desc->load.cpu);
+		if (!cpu_online(cur))
+			continue;
+
+		if (desc->load.moves &&
+		    time_before(jiffies, desc->load.last_move + min_wait))
+			continue;
+
+		demand = (long)desc->load.load * irq_balance_cpus[cur].capacity /
+			 1000;
+		cpu = irq_balance_pick(desc, cur, demand, &cur_cost);
+		if (cpu != cur) {
+			irq_balance_move(desc, cur, cpu, demand);
+			moves++;
+		}
+	}
+
+	irq_unlock_sparse();
+}
+
+static void irq_balance_fn(struct work_struct *work)
+{
+	u64 now = ktime_get_ns();
+
+	if (!READ_ONCE(irq_balance_enabled)) {
+		irq_balance_primed = false;
+		return;
+	}
+
+	get_online_cpus();
+	if (irq_balance_update_cpus()) {
+		/* the first round only takes the snapshots */
+		if (irq_balance_primed && now > irq_balance_last)
+			irq_balance(now - irq_balance_last);
+		irq_balance_primed = true;
+	}
+	put_online_cpus();
+
+	irq_balance_last = now;
+
+	queue_delayed_work(system_power_efficient_wq, &irq_balance_work,
+			   msecs_to_jiffies(max(irq_balance_interval_ms, 10U)));
+}
+
+static int irq_balance_enabled_set(const char *val,
+				   const struct kernel_param *kp)
+{
+	int ret = param_set_bool(val, kp);
+
+	if (!ret && irq_balance_ready && irq_balance_enabled)
+		mod_delayed_work(system_power_efficient_wq, &irq_balance_work,
+				 0);
+
+	return ret;
+}
+
+static const struct kernel_param_ops irq_balance_enabled_ops = {
+	.set = irq_balance_enabled_set,
+	.get = param_get_bool,
+};
+module_param_cb(enabled, &irq_balance_enabled_ops, &irq_balance_enabled,
+		0644);
+
+/* userspace set the affinity, hands off */
+void irq_balance_user_affinity(struct irq_desc *desc)
+{
+	WRITE_ONCE(desc->load.policy, IRQ_BALANCE_NONE);
+}
+
+int irq_balance_set_policy(struct irq_desc *desc, const char *buf)
+{
+	unsigned int irq = irq_desc_get_irq(desc);
+	int policy;
+
+	for (policy = 0; policy < ARRAY_SIZE(irq_balance_policies); policy++)
+		if (sysfs_streq(buf, irq_balance_policies[policy]))
+			break;
+	if (policy == ARRAY_SIZE(irq_balance_policies))
+		return -EINVAL;
+
+	if (policy != IRQ_BALANCE_NONE) {
+		if (!irq_can_set_affinity_usr(irq) ||
+		    irqd_is_per_cpu(&desc->irq_data))
+			return -EIO;
+		/* hand an interrupt routed elsewhere to the balancer */
+		if (!irq_balance_owns(desc) &&
+		    irq_set_affinity(irq, irq_default_affinity))
+			return -EIO;
+	}
+
+	WRITE_ONCE(desc->load.policy, policy);
+
+	return 0;
+}
+
+void irq_balance_show(struct seq_file *m, struct irq_desc *desc)
+{
+	struct irq_load *load = &desc->load;
+
+	seq_printf(m, "count %u\n" "time %llu ns\n" "rate %u/s\n"
+		   "load %u.%u%%\n" "cpu %d\n" "policy %s\n" "moves %u\n",
+		   load->count, load->time, load->rate,
+		   load->load / 10, load->load % 10, load->cpu,
+		   irq_balance_policy_name(load->policy), load->moves);
+}
+
+static int irq_balance_hot_show(struct seq_file *m, void *v)
+{
+	unsigned int irq;
+
+	seq_printf(m, "%5s %4s %8s %7s %7s %6s  %s\n", "irq", "cpu", "rate",
+		   "load", "policy", "moves", "name");
+
+	irq_lock_sparse();
+	for_each_active_irq(irq) {
+		struct irq_desc *desc = irq_to_desc(irq);
+		struct irq_load *load;
+		unsigned long flags;
+
+		if (!desc || !irq_balance_is_hot(desc))
+			continue;
+
+		/* free_irq() clears desc->action under desc->lock */
+		raw_spin_lock_irqsave(&desc->lock, flags);
+		if (desc->action) {
+			load = &desc->load;
+			seq_printf(m, "%5u %4d %8u %5u.%u%% %7s %6u  %s\n", irq,
+				   load->cpu, load->rate, load->load / 10,
+				   load->load % 10,
+				   irq_balance_policy_name(load->policy),
+				   load->moves,
+				   desc->action->name ? desc->action->name : "");
+		}
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+	}
+	irq_unlock_sparse();
+
+	return 0;
+}
+
+static int irq_balance_hot_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_balance_hot_show, NULL);
+}
+
+static const struct file_operations irq_balance_hot_fops = {
+	.open		= irq_balance_hot_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init irq_balance_init(void)
+{
+	irq_balance_cpus = kcalloc(nr_cpu_ids, sizeof(*irq_balance_cpus),
+				   GFP_KERNEL);
+	if (!irq_balance_cpus)
+		return -ENOMEM;
+
+	proc_create("irq/hot", 0444, NULL, &irq_balance_hot_fops);
+
+	irq_balance_ready = true;
+	if (irq_balance_enabled)
+		queue_delayed_work(system_power_efficient_wq,
+				   &irq_balance_work, 0);
+
+	return 0;
+}
+late_initcall(irq_balance_init);
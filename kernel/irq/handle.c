@@ -139,6 +139,7 @@ irqreturn_t handle_irq_event_percpu(struct irq_desc *desc)
 	irqreturn_t retval = IRQ_NONE;
 	unsigned int flags = 0, irq = desc->irq_data.irq;
 	struct irqaction *action = desc->action;
+	u64 start = irq_load_begin();
 
 	/* action might have become NULL since we dropped the lock */
 	while (action) {
@@ -180,6 +181,8 @@ irqreturn_t handle_irq_event_percpu(struct irq_desc *desc)
 		action = action->next;
 	}
 
+	irq_load_end(desc, start);
+
 #ifdef CONFIG_PREEMPT_RT_FULL
 	desc->random_ip = ip;
 #else
@@ -107,6 +107,54 @@ static inline void unregister_handler_proc(unsigned int irq,
 
 extern bool irq_can_set_affinity_usr(unsigned int irq);
 
+#ifdef CONFIG_IRQ_BALANCE
+/* struct irq_load::policy */
+enum {
+	IRQ_BALANCE_AUTO,	/* any cpu of the default affinity */
+	IRQ_BALANCE_LITTLE,	/* the lowest capacity cpus only */
+	IRQ_BALANCE_BIG,	/* the highest capacity cpus only */
+	IRQ_BALANCE_NONE,	/* never moved */
+};
+
+static inline void irq_load_init(struct irq_desc *desc)
+{
+	memset(&desc->load, 0, sizeof(desc->load));
+	desc->load.target = -1;
+}
+
+static inline u64 irq_load_begin(void)
+{
+	return local_clock();
+}
+
+/*
+ * Called with interrupts disabled. IRQD_IRQ_INPROGRESS serializes the
+ * handlers of an interrupt except for per cpu ones, which cannot be
+ * balanced anyway and are not accounted.
+ */
+static inline void irq_load_end(struct irq_desc *desc, u64 start)
+{
+	if (irqd_is_per_cpu(&desc->irq_data))
+		return;
+
+	desc->load.time += local_clock() - start;
+	desc->load.count++;
+	desc->load.cpu = smp_processor_id();
+}
+
+struct seq_file;
+
+extern void irq_balance_user_affinity(struct irq_desc *desc);
+extern void irq_balance_show(struct seq_file *m, struct irq_desc *desc);
+extern const char *irq_balance_policy_name(unsigned int policy);
+extern int irq_balance_set_policy(struct irq_desc *desc, const char *buf);
+#else
+static inline void irq_load_init(struct irq_desc *desc) { }
+static inline u64 irq_load_begin(void) { return 0; }
+static inline void irq_load_end(struct irq_desc *desc, u64 start) { }
+static inline void irq_balance_user_affinity(struct irq_desc *desc) { }
+#endif
+
 extern int irq_select_affinity_usr(unsigned int irq, struct cpumask *mask);
 
 extern void irq_set_thread_affinity(struct irq_desc *desc);
@@ -13,6 +13,7 @@
 #include <linux/interrupt.h>
 #include <linux/kernel_stat.h>
 #include <linux/mutex.h>
+#include <linux/uaccess.h>
 
 #include "internals.h"
 
@@ -153,6 +154,7 @@ static ssize_t write_irq_affinity(int type, struct file *file,
 		err = irq_select_affinity_usr(irq, new_value) ? -EINVAL : count;
 	} else {
 		irq_set_affinity(irq, new_value);
+		irq_balance_user_affinity(irq_to_desc(irq));
 		err = count;
 	}
 
@@ -347,6 +349,65 @@ static const struct file_operations irq_spurious_proc_fops = {
 	.release	= single_release,
 };
 
+#ifdef CONFIG_IRQ_BALANCE
+static int irq_load_proc_show(struct seq_file *m, void *v)
+{
+	irq_balance_show(m, irq_to_desc((long) m->private));
+	return 0;
+}
+
+static int irq_load_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_load_proc_show, PDE_DATA(inode));
+}
+
+static const struct file_operations irq_load_proc_fops = {
+	.open		= irq_load_proc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int irq_balance_proc_show(struct seq_file *m, void *v)
+{
+	struct irq_desc *desc = irq_to_desc((long) m->private);
+
+	seq_printf(m, "%s\n", irq_balance_policy_name(desc->load.policy));
+	return 0;
+}
+
+static ssize_t irq_balance_proc_write(struct file *file,
+		const char __user *buffer, size_t count, loff_t *pos)
+{
+	unsigned int irq = (int)(long)PDE_DATA(file_inode(file));
+	char buf[16];
+	int err;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, buffer, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	err = irq_balance_set_policy(irq_to_desc(irq), buf);
+
+	return err ? err : count;
+}
+
+static int irq_balance_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_balance_proc_show, PDE_DATA(inode));
+}
+
+static const struct file_operations irq_balance_proc_fops = {
+	.open		= irq_balance_proc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+	.write		= irq_balance_proc_write,
+};
+#endif
+
 #define MAX_NAMELEN 128
 
 static int name_unique(unsigned int irq, struct irqaction *new_action)
@@ -440,6 +501,13 @@ void register_irq_proc(unsigned int irq, struct irq_desc *desc)
 	proc_create_data("spurious", 0444, desc->dir,
 			 &irq_spurious_proc_fops, (void *)(long)irq);
 
+#ifdef CONFIG_IRQ_BALANCE
+	proc_create_data("load", 0444, desc->dir,
+			 &irq_load_proc_fops, (void *)(long)irq);
+	proc_create_data("balance", 0644, desc->dir,
+			 &irq_balance_proc_fops, (void *)(long)irq);
+#endif
+
 out_unlock:
 	mutex_unlock(&register_lock);
 }
@@ -461,6 +529,10 @@ void unregister_irq_proc(unsigned int irq, struct irq_desc *desc)
 # endif
 #endif
 	remove_proc_entry("spurious", desc->dir);
+#ifdef CONFIG_IRQ_BALANCE
+	remove_proc_entry("load", desc->dir);
+	remove_proc_entry("balance", desc->dir);
+#endif
 
 	memset(name, 0, MAX_NAMELEN);
 	sprintf(name, "%u", irq);
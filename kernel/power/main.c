@@ -793,6 +793,27 @@ static ssize_t pm_freeze_timeout_store(struct kobject *kobj,
 
 power_attr(pm_freeze_timeout);
 
+static ssize_t pm_freeze_time_hist_show(struct kobject *kobj,
+					struct kobj_attribute *attr, char *buf)
+{
+	return pm_freeze_hist_print(buf);
+}
+
+static ssize_t pm_freeze_time_hist_store(struct kobject *kobj,
+					 struct kobj_attribute *attr,
+					 const char *buf, size_t n)
+{
+	unsigned long val;
+
+	if (kstrtoul(buf, 10, &val) || val)
+		return -EINVAL;
+
+	pm_freeze_hist_reset();
+	return n;
+}
+
+power_attr(pm_freeze_time_hist);
+
 #endif	/* CONFIG_FREEZER*/
 
 static struct attribute * g[] = {
@@ -824,6 +845,7 @@ static struct attribute * g[] = {
 #endif
 #ifdef CONFIG_FREEZER
 	&pm_freeze_timeout_attr.attr,
+	&pm_freeze_time_hist_attr.attr,
 #endif
 	NULL,
 };
@@ -234,6 +234,11 @@ enum {
 
 extern int pm_test_level;
 
+#ifdef CONFIG_FREEZER
+extern ssize_t pm_freeze_hist_print(char *buf);
+extern void pm_freeze_hist_reset(void);
+#endif
+
 #ifdef CONFIG_SUSPEND_FREEZER
 static inline int suspend_freeze_processes(void)
 {
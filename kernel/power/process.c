@@ -20,18 +20,148 @@
 #include <trace/events/power.h>
 #include <linux/wakeup_reason.h>
 #include <linux/cpuset.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
 
 /*
  * Timeout for stopping processes
  */
 unsigned int __read_mostly freeze_timeout_msecs = 2 * MSEC_PER_SEC;
 
+/*
+ * Duration histograms of the freeze and thaw phases, shown in
+ * /sys/power/pm_freeze_time_hist. Bucket i counts durations below
+ * FREEZE_HIST_BASE_US << i, the last one everything longer.
+ */
+#define FREEZE_HIST_BUCKETS	14
+#define FREEZE_HIST_BASE_US	250
+
+enum freeze_hist_type {
+	FREEZE_HIST_USER,
+	FREEZE_HIST_KERNEL,
+	FREEZE_HIST_THAW,
+	NR_FREEZE_HIST,
+};
+
+static unsigned int freeze_hist[NR_FREEZE_HIST][FREEZE_HIST_BUCKETS];
+
+static void freeze_hist_add(enum freeze_hist_type type, ktime_t start)
+{
+	u64 us = ktime_to_us(ktime_sub(ktime_get(), start));
+	int bucket = 0;
+
+	if (us >= FREEZE_HIST_BASE_US)
+		bucket = min_t(int, ilog2(div_u64(us, FREEZE_HIST_BASE_US)) + 1,
+			       FREEZE_HIST_BUCKETS - 1);
+
+	freeze_hist[type][bucket]++;
+}
+
+ssize_t pm_freeze_hist_print(char *buf)
+{
+	ssize_t len;
+	int i;
+
+	len = sprintf(buf, "%-10s %10s %10s %10s\n",
+		      "<us", "user", "kernel", "thaw");
+
+	for (i = 0; i < FREEZE_HIST_BUCKETS; i++) {
+		if (i < FREEZE_HIST_BUCKETS - 1)
+			len += sprintf(buf + len, "%-10u",
+				       FREEZE_HIST_BASE_US << i);
+		else
+			len += sprintf(buf + len, "%-10s", "inf");
+		len += sprintf(buf + len, " %10u %10u %10u\n",
+			       freeze_hist[FREEZE_HIST_USER][i],
+			       freeze_hist[FREEZE_HIST_KERNEL][i],
+			       freeze_hist[FREEZE_HIST_THAW][i]);
+	}
+
+	return len;
+}
+
+void pm_freeze_hist_reset(void)
+{
+	memset(freeze_hist, 0, sizeof(freeze_hist));
+}
+
+/*
+ * Tasks that were asked to freeze and have not frozen yet. Only these are
+ * checked again while waiting, the task list is walked once to send the
+ * requests and once more to confirm nothing was missed. If the array cannot
+ * hold them all, every wait step walks the whole list as before.
+ */
+struct freeze_pending {
+	struct task_struct **tasks;
+	unsigned int nr;
+	unsigned int max;
+	bool overflow;
+};
+
+static void freeze_pending_release(struct freeze_pending *fp)
+{
+	while (fp->nr)
+		put_task_struct(fp->tasks[--fp->nr]);
+}
+
+/* Asks every freezable task to freeze, returns how many did not yet */
+static unsigned int freeze_broadcast(struct freeze_pending *fp)
+{
+	struct task_struct *g, *p;
+	unsigned int todo = 0;
+
+	freeze_pending_release(fp);
+	fp->overflow = false;
+
+	read_lock(&tasklist_lock);
+	for_each_process_thread(g, p) {
+		if (p == current || !freeze_task(p))
+			continue;
+
+		if (freezer_should_skip(p))
+			continue;
+
+		todo++;
+		if (fp->nr < fp->max) {
+			get_task_struct(p);
+			fp->tasks[fp->nr++] = p;
+		} else {
+			fp->overflow = true;
+		}
+	}
+	read_unlock(&tasklist_lock);
+
+	return todo;
+}
+
+/* Checks the tasks still pending, returns how many did not freeze yet */
+static unsigned int freeze_recheck(struct freeze_pending *fp)
+{
+	unsigned int i, nr = 0;
+
+	for (i = 0; i < fp->nr; i++) {
+		struct task_struct *p = fp->tasks[i];
+
+		if (!freeze_task(p) || freezer_should_skip(p)) {
+			put_task_struct(p);
+			continue;
+		}
+		fp->tasks[nr++] = p;
+	}
+	fp->nr = nr;
+
+	return nr;
+}
+
 static int try_to_freeze_tasks(bool user_only)
 {
 	struct task_struct *g, *p;
+	struct freeze_pending fp = { };
 	unsigned long end_time;
 	unsigned int todo;
 	bool wq_busy = false;
+	bool full_scan;
 	struct timeval start, end;
 	u64 elapsed_msecs64;
 	unsigned int elapsed_msecs;
@@ -45,20 +175,24 @@ static int try_to_freeze_tasks(bool user_only)
 
 	end_time = jiffies + msecs_to_jiffies(freeze_timeout_msecs);
 
+	fp.max = nr_threads + 64;
+	fp.tasks = kmalloc_array(fp.max, sizeof(*fp.tasks),
+				 GFP_KERNEL | __GFP_NOWARN);
+	if (!fp.tasks)
+		fp.max = 0;
+
 	if (!user_only)
 		freeze_workqueues_begin();
 
+	todo = freeze_broadcast(&fp);
+	full_scan = true;
+
 	while (true) {
-		todo = 0;
-		read_lock(&tasklist_lock);
-		for_each_process_thread(g, p) {
-			if (p == current || !freeze_task(p))
-				continue;
-
-			if (!freezer_should_skip(p))
-				todo++;
+		/* everything we asked froze, make sure no task was missed */
+		if (!todo && !full_scan) {
+			todo = freeze_broadcast(&fp);
+			full_scan = true;
 		}
-		read_unlock(&tasklist_lock);
 
 		if (!user_only) {
 			wq_busy = freeze_workqueues_busy();
@@ -86,8 +220,14 @@ static int try_to_freeze_tasks(bool user_only)
 		usleep_range(sleep_usecs / 2, sleep_usecs);
 		if (sleep_usecs < 8 * USEC_PER_MSEC)
 			sleep_usecs *= 2;
+
+		full_scan = fp.overflow;
+		todo = full_scan ? freeze_broadcast(&fp) : freeze_recheck(&fp);
 	}
 
+	freeze_pending_release(&fp);
+	kfree(fp.tasks);
+
 	do_gettimeofday(&end);
 	elapsed_msecs64 = timeval_to_ns(&end) - timeval_to_ns(&start);
 	do_div(elapsed_msecs64, NSEC_PER_MSEC);
@@ -119,6 +259,23 @@ static int try_to_freeze_tasks(bool user_only)
 	return todo || wakeup ? -EBUSY : 0;
 }
 
+/* Freezing has ended, wake every task that may still be frozen */
+static void thaw_tasks(bool kthreads_only)
+{
+	struct task_struct *g, *p;
+
+	read_lock(&tasklist_lock);
+	for_each_process_thread(g, p) {
+		if (kthreads_only && !(p->flags & (PF_KTHREAD | PF_WQ_WORKER)))
+			continue;
+		/* No other threads should have PF_SUSPEND_TASK set */
+		WARN_ON(!kthreads_only && (p != current) &&
+			(p->flags & PF_SUSPEND_TASK));
+		__thaw_task(p);
+	}
+	read_unlock(&tasklist_lock);
+}
+
 /**
  * freeze_processes - Signal user space processes to enter the refrigerator.
  * The current thread will not be frozen.  The same process that calls
@@ -128,6 +285,7 @@ static int try_to_freeze_tasks(bool user_only)
  */
 int freeze_processes(void)
 {
+	ktime_t start;
 	int error;
 
 	error = __usermodehelper_disable(UMH_FREEZING);
@@ -142,8 +300,10 @@ int freeze_processes(void)
 
 	pr_debug("Freezing user space processes ... ");
 	pm_freezing = true;
+	start = ktime_get();
 	error = try_to_freeze_tasks(true);
 	if (!error) {
+		freeze_hist_add(FREEZE_HIST_USER, start);
 		__usermodehelper_set_disable_depth(UMH_DISABLED);
 		pr_cont("done.");
 	}
@@ -175,14 +335,18 @@ int freeze_processes(void)
  */
 int freeze_kernel_threads(void)
 {
+	ktime_t start;
 	int error;
 
 	pr_debug("Freezing remaining freezable tasks ... ");
 
 	pm_nosig_freezing = true;
+	start = ktime_get();
 	error = try_to_freeze_tasks(false);
-	if (!error)
+	if (!error) {
+		freeze_hist_add(FREEZE_HIST_KERNEL, start);
 		pr_cont("done.");
+	}
 
 	pr_cont("\n");
 	BUG_ON(in_atomic());
@@ -194,8 +358,8 @@ int freeze_kernel_threads(void)
 
 void thaw_processes(void)
 {
-	struct task_struct *g, *p;
 	struct task_struct *curr = current;
+	ktime_t start = ktime_get();
 
 	trace_suspend_resume(TPS("thaw_processes"), 0, true);
 	if (pm_freezing)
@@ -214,13 +378,7 @@ void thaw_processes(void)
 
 	cpuset_wait_for_hotplug();
 
-	read_lock(&tasklist_lock);
-	for_each_process_thread(g, p) {
-		/* No other threads should have PF_SUSPEND_TASK set */
-		WARN_ON((p != curr) && (p->flags & PF_SUSPEND_TASK));
-		__thaw_task(p);
-	}
-	read_unlock(&tasklist_lock);
+	thaw_tasks(false);
 
 	WARN_ON(!(curr->flags & PF_SUSPEND_TASK));
 	curr->flags &= ~PF_SUSPEND_TASK;
@@ -228,25 +386,19 @@ void thaw_processes(void)
 	usermodehelper_enable();
 
 	schedule();
+	freeze_hist_add(FREEZE_HIST_THAW, start);
 	pr_cont("done.\n");
 	trace_suspend_resume(TPS("thaw_processes"), 0, false);
 }
 
 void thaw_kernel_threads(void)
 {
-	struct task_struct *g, *p;
-
 	pm_nosig_freezing = false;
 	pr_info("Restarting kernel threads ... ");
 
 	thaw_workqueues();
 
-	read_lock(&tasklist_lock);
-	for_each_process_thread(g, p) {
-		if (p->flags & (PF_KTHREAD | PF_WQ_WORKER))
-			__thaw_task(p);
-	}
-	read_unlock(&tasklist_lock);
+	thaw_tasks(true);
 
 	schedule();
 	pr_cont("done.\n");
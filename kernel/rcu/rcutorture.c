@@ -390,6 +390,39 @@ static struct rcu_torture_ops rcu_ops = {
 	.name		= "rcu"
 };
 
+/*
+ * Definitions for lazy RCU torture testing: same as "rcu", but all
+ * callbacks go through call_rcu_lazy() and sit in the lazy lists of
+ * no-CBs CPUs until a batch fills up, times out or rcu_barrier() runs.
+ */
+
+static void rcu_lazy_torture_deferred_free(struct rcu_torture *p)
+{
+	call_rcu_lazy(&p->rtort_rcu, rcu_torture_cb);
+}
+
+static struct rcu_torture_ops rcu_lazy_ops = {
+	.ttype		= RCU_FLAVOR,
+	.init		= rcu_sync_torture_init,
+	.readlock	= rcu_torture_read_lock,
+	.read_delay	= rcu_read_delay,
+	.readunlock	= rcu_torture_read_unlock,
+	.started	= rcu_batches_started,
+	.completed	= rcu_batches_completed,
+	.deferred_free	= rcu_lazy_torture_deferred_free,
+	.sync		= synchronize_rcu,
+	.exp_sync	= synchronize_rcu_expedited,
+	.get_state	= get_state_synchronize_rcu,
+	.cond_sync	= cond_synchronize_rcu,
+	.call		= call_rcu_lazy,
+	.cb_barrier	= rcu_barrier,
+	.fqs		= rcu_force_quiescent_state,
+	.stats		= NULL,
+	.irq_capable	= 1,
+	.can_boost	= rcu_can_boost(),
+	.name		= "rcu_lazy"
+};
+
 #ifndef CONFIG_PREEMPT_RT_FULL
 /*
  * Definitions for rcu_bh torture testing.
@@ -1731,8 +1764,8 @@ rcu_torture_init(void)
 	int cpu;
 	int firsterr = 0;
 	static struct rcu_torture_ops *torture_ops[] = {
-		&rcu_ops, &rcu_bh_ops, &rcu_busted_ops, &srcu_ops, &srcud_ops,
-		&sched_ops, RCUTORTURE_TASKS_OPS
+		&rcu_ops, &rcu_lazy_ops, &rcu_bh_ops, &rcu_busted_ops,
+		&srcu_ops, &srcud_ops, &sched_ops, RCUTORTURE_TASKS_OPS
 	};
 
 	if (!torture_init_begin(torture_type, verbose, &torture_runnable))
@@ -59,6 +59,8 @@
 #include <linux/gfp.h>
 #include <linux/oom.h>
 #include <linux/smpboot.h>
+#include <linux/shrinker.h>
+#include <linux/topology.h>
 #include <linux/exynos-ss.h>
 
 #include "../time/tick-internal.h"
@@ -3168,7 +3170,10 @@ static void rcu_leak_callback(struct rcu_head *rhp)
  * Helper function for call_rcu() and friends.  The cpu argument will
  * normally be -1, indicating "currently running CPU".  It may specify
  * a CPU only if that CPU is a no-CBs CPU.  Currently, only _rcu_barrier()
- * is expected to specify a CPU.
+ * is expected to specify a CPU.  The lazy argument says that the caller
+ * does not care when the callback runs, so that no-CBs CPUs may batch it
+ * (see CONFIG_RCU_LAZY).  The ->qlen_lazy accounting instead follows
+ * __is_kfree_rcu_offset(), which is what rcu_do_batch() relies on.
  */
 static void
 __call_rcu(struct rcu_head *head, rcu_callback_t func,
@@ -3220,7 +3225,7 @@ __call_rcu(struct rcu_head *head, rcu_callback_t func,
 			init_default_callback_list(rdp);
 	}
 	WRITE_ONCE(rdp->qlen, rdp->qlen + 1);
-	if (lazy)
+	if (__is_kfree_rcu_offset((unsigned long)func))
 		rdp->qlen_lazy++;
 	else
 		rcu_idle_count_callbacks_posted();
@@ -3261,10 +3266,8 @@ EXPORT_SYMBOL_GPL(call_rcu_bh);
 
 /*
  * Queue an RCU callback for lazy invocation after a grace period.
- * This will likely be later named something like "call_rcu_lazy()",
- * but this change will require some way of tagging the lazy RCU
- * callbacks in the list of pending callbacks. Until then, this
- * function may only be called from __kfree_rcu().
+ * This function may only be called from __kfree_rcu(), other lazy
+ * callbacks go through call_rcu_lazy().
  */
 void kfree_call_rcu(struct rcu_head *head,
 		    rcu_callback_t func)
@@ -3273,6 +3276,23 @@ void kfree_call_rcu(struct rcu_head *head,
 }
 EXPORT_SYMBOL_GPL(kfree_call_rcu);
 
+/**
+ * call_rcu_lazy() - Queue an RCU callback that is in no hurry.
+ * @head: structure to be used for queueing the RCU updates.
+ * @func: actual callback function to be invoked after the grace period
+ *
+ * Same guarantees as call_rcu(), but the callback may be held back for
+ * a while (seconds) before its grace period is even requested, so that
+ * it shares that grace period and the rcuo kthread wakeup with others.
+ * Use it for callbacks that only free memory.  rcu_barrier() still
+ * waits for lazy callbacks.
+ */
+void call_rcu_lazy(struct rcu_head *head, rcu_callback_t func)
+{
+	__call_rcu(head, func, rcu_state_p, -1, 1);
+}
+EXPORT_SYMBOL_GPL(call_rcu_lazy);
+
 /*
  * Because a context switch is a grace period for RCU-sched and RCU-bh,
  * any blocking grace-period wait automatically implies a grace period
@@ -303,6 +303,13 @@ union rcu_noqs {
 #define RCU_NEXT_TAIL		3
 #define RCU_NEXT_SIZE		4
 
+/* Index values for n_nocb_lazy_flush array in struct rcu_data. */
+#define RCU_LAZY_FLUSH_SIZE	0	/* rcu_lazy_batch CBs queued. */
+#define RCU_LAZY_FLUSH_TIME	1	/* Oldest CB rcu_lazy_jiffies old. */
+#define RCU_LAZY_FLUSH_NONLAZY	2	/* Non-lazy CB or rcu_barrier(). */
+#define RCU_LAZY_FLUSH_SHRINK	3	/* Memory pressure. */
+#define RCU_LAZY_FLUSH_NR	4
+
 /* Per-CPU data for read-copy update. */
 struct rcu_data {
 	/* 1) quiescent-state and grace-period handling : */
@@ -402,6 +409,18 @@ struct rcu_data {
 	struct swait_queue_head nocb_wq; /* For nocb kthreads to sleep on. */
 	struct task_struct *nocb_kthread;
 	int nocb_defer_wakeup;		/* Defer wakeup of nocb_kthread. */
+#ifdef CONFIG_RCU_LAZY
+	raw_spinlock_t nocb_lazy_lock;	/* Orders lazy list handover. */
+	struct rcu_head *nocb_lazy_head; /* Lazy CBs not yet handed */
+	struct rcu_head **nocb_lazy_tail; /*  to the rcuo kthread. */
+	long nocb_lazy_count;		/* # CBs on the lazy list, */
+	long nocb_lazy_count_kfree;	/*  of which kfree_rcu(). */
+	unsigned long nocb_lazy_first;	/* jiffies of oldest lazy CB. */
+	unsigned long n_nocb_lazy;	/* # CBs that went lazy. */
+	unsigned long n_nocb_lazy_flush[RCU_LAZY_FLUSH_NR];
+					/* # handovers, by reason. */
+	unsigned long n_nocb_wakes;	/* # rcuo kthread wakeups. */
+#endif /* #ifdef CONFIG_RCU_LAZY */
 
 	/* The following fields are used by the leader, hence own cacheline. */
 	struct rcu_head *nocb_gp_head ____cacheline_internodealigned_in_smp;
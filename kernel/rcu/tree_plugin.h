@@ -1788,6 +1788,8 @@ static void wake_nocb_leader(struct rcu_data *rdp, bool force)
 	}
 }
 
+static long rcu_nocb_lazy_pending(struct rcu_data *rdp);
+
 /*
  * Does the specified CPU need an RCU callback for the specified flavor
  * of rcu_barrier()?
@@ -1810,9 +1812,11 @@ static bool rcu_nocb_cpu_needs_barrier(struct rcu_state *rsp, int cpu)
 	 * getting the concurrency design right!).  There must also be
 	 * a barrier between the following load an posting of a callback
 	 * (if a callback is in fact needed).  This is associated with an
-	 * atomic_inc() in the caller.
+	 * atomic_inc() in the caller.  Lazy CBs are looked at first: they
+	 * move to ->nocb_q_count under ->nocb_lazy_lock.
 	 */
-	ret = atomic_long_read(&rdp->nocb_q_count);
+	ret = rcu_nocb_lazy_pending(rdp);
+	ret += atomic_long_read(&rdp->nocb_q_count);
 
 #ifdef CONFIG_PROVE_RCU
 	rhp = READ_ONCE(rdp->nocb_head);
@@ -1898,6 +1902,300 @@ static void __call_rcu_nocb_enqueue(struct rcu_data *rdp,
 	return;
 }
 
+#ifdef CONFIG_RCU_LAZY
+
+/*
+ * Lazy callbacks posted on a no-CBs CPU wait on its ->nocb_lazy_head list
+ * until the whole list is handed to __call_rcu_nocb_enqueue(), which
+ * happens once rcu_lazy_batch of them are queued, once the oldest is
+ * rcu_lazy_jiffies old (checked by the leader rcuo kthread), when a
+ * non-lazy or rcu_barrier() callback is posted for the CPU, and when the
+ * shrinker asks for memory.  Handover is done under ->nocb_lazy_lock so
+ * that a callback posted after a lazy one is never queued ahead of it.
+ */
+static long rcu_lazy_batch = 256;
+module_param(rcu_lazy_batch, long, 0644);
+static ulong rcu_lazy_jiffies = 10 * HZ;
+module_param(rcu_lazy_jiffies, ulong, 0644);
+
+/* Hand the lazy list of rdp to the rcuo kthreads, irqs disabled. */
+static void rcu_nocb_lazy_flush_locked(struct rcu_data *rdp, int why,
+				       unsigned long flags)
+{
+	if (!rdp->nocb_lazy_count)
+		return;
+	__call_rcu_nocb_enqueue(rdp, rdp->nocb_lazy_head, rdp->nocb_lazy_tail,
+				rdp->nocb_lazy_count,
+				rdp->nocb_lazy_count_kfree, flags);
+	rdp->nocb_lazy_head = NULL;
+	rdp->nocb_lazy_tail = &rdp->nocb_lazy_head;
+	WRITE_ONCE(rdp->nocb_lazy_count, 0);
+	rdp->nocb_lazy_count_kfree = 0;
+	rdp->n_nocb_lazy_flush[why]++;
+	trace_rcu_nocb_wake(rdp->rsp->name, rdp->cpu, TPS("LazyFlush"));
+}
+
+/*
+ * Queue a lazy callback for this CPU, irqs disabled.  Returns false if
+ * lazy batching is off, in which case the caller queues it as usual.
+ */
+static bool rcu_nocb_lazy_enqueue(struct rcu_data *rdp, struct rcu_head *rhp,
+				  unsigned long flags)
+{
+	long batch = READ_ONCE(rcu_lazy_batch);
+	bool first;
+
+	if (batch <= 1)
+		return false;
+
+	raw_spin_lock(&rdp->nocb_lazy_lock);
+	first = !rdp->nocb_lazy_count;
+	if (first)
+		rdp->nocb_lazy_first = jiffies;
+	*rdp->nocb_lazy_tail = rhp;
+	rdp->nocb_lazy_tail = &rhp->next;
+	WRITE_ONCE(rdp->nocb_lazy_count, rdp->nocb_lazy_count + 1);
+	if (__is_kfree_rcu_offset((unsigned long)rhp->func))
+		rdp->nocb_lazy_count_kfree++;
+	rdp->n_nocb_lazy++;
+	if (rdp->nocb_lazy_count >= batch) {
+		rcu_nocb_lazy_flush_locked(rdp, RCU_LAZY_FLUSH_SIZE, flags);
+		first = false;
+	}
+	raw_spin_unlock(&rdp->nocb_lazy_lock);
+
+	/*
+	 * A new batch was started, let the leader know when it is due.
+	 * This is the only wakeup a batch costs until it is handed over.
+	 */
+	if (first && !rcu_nocb_poll) {
+		smp_mb(); /* ->nocb_lazy_count before _sleep test. */
+		if (!irqs_disabled_flags(flags)) {
+			wake_nocb_leader(rdp, false);
+			trace_rcu_nocb_wake(rdp->rsp->name, rdp->cpu,
+					    TPS("WakeLazy"));
+		} else if (!rdp->nocb_defer_wakeup) {
+			rdp->nocb_defer_wakeup = RCU_NOGP_WAKE;
+			trace_rcu_nocb_wake(rdp->rsp->name, rdp->cpu,
+					    TPS("WakeLazyIsDeferred"));
+		}
+	}
+	return true;
+}
+
+/*
+ * A non-lazy callback is about to be queued for rdp, irqs disabled.  Hand
+ * the lazy ones over first, and keep the lock so they stay ahead of it.
+ * Returns true if the caller must rcu_nocb_lazy_unlock() after queueing.
+ */
+static bool rcu_nocb_lazy_lock_flush(struct rcu_data *rdp, unsigned long flags)
+{
+	if (!READ_ONCE(rdp->nocb_lazy_count))
+		return false;
+	raw_spin_lock(&rdp->nocb_lazy_lock);
+	rcu_nocb_lazy_flush_locked(rdp, RCU_LAZY_FLUSH_NONLAZY, flags);
+	return true;
+}
+
+static void rcu_nocb_lazy_unlock(struct rcu_data *rdp)
+{
+	raw_spin_unlock(&rdp->nocb_lazy_lock);
+}
+
+/* Number of lazy CBs not handed over yet, for rcu_barrier(). */
+static long rcu_nocb_lazy_pending(struct rcu_data *rdp)
+{
+	unsigned long flags;
+	long ret;
+
+	raw_spin_lock_irqsave(&rdp->nocb_lazy_lock, flags);
+	ret = rdp->nocb_lazy_count;
+	raw_spin_unlock_irqrestore(&rdp->nocb_lazy_lock, flags);
+	return ret;
+}
+
+/*
+ * Leaders come here before sleeping: hand over the lazy lists of the
+ * followers that are due and return how long until the next one is.
+ */
+static long rcu_nocb_lazy_expire(struct rcu_data *my_rdp)
+{
+	long tmo = MAX_SCHEDULE_TIMEOUT;
+	unsigned long deadline, now;
+	unsigned long flags;
+	struct rcu_data *rdp;
+
+	for (rdp = my_rdp; rdp; rdp = rdp->nocb_next_follower) {
+		if (!READ_ONCE(rdp->nocb_lazy_count))
+			continue;
+		raw_spin_lock_irqsave(&rdp->nocb_lazy_lock, flags);
+		deadline = rdp->nocb_lazy_first + READ_ONCE(rcu_lazy_jiffies);
+		now = jiffies;
+		if (time_after_eq(now, deadline) ||
+		    READ_ONCE(rcu_lazy_batch) <= 1)
+			rcu_nocb_lazy_flush_locked(rdp, RCU_LAZY_FLUSH_TIME,
+						   flags);
+		else if (rdp->nocb_lazy_count)
+			tmo = clamp_t(long, deadline - now, 1, tmo);
+		raw_spin_unlock_irqrestore(&rdp->nocb_lazy_lock, flags);
+	}
+	return tmo;
+}
+
+/* An rcuo kthread is about to sleep, so will be woken up. */
+static void rcu_nocb_note_wake(struct rcu_data *rdp)
+{
+	rdp->n_nocb_wakes++;
+}
+
+/*
+ * Memory is short: hand all lazy callbacks over so that they free what
+ * they hold after the next grace period instead of seconds later.
+ */
+static unsigned long rcu_lazy_shrink_count(struct shrinker *shrink,
+					   struct shrink_control *sc)
+{
+	unsigned long count = 0;
+	struct rcu_state *rsp;
+	int cpu;
+
+	for_each_rcu_flavor(rsp)
+		for_each_cpu(cpu, rcu_nocb_mask)
+			count += READ_ONCE(per_cpu_ptr(rsp->rda,
+						       cpu)->nocb_lazy_count);
+	return count;
+}
+
+static unsigned long rcu_lazy_shrink_scan(struct shrinker *shrink,
+					  struct shrink_control *sc)
+{
+	unsigned long count = 0;
+	unsigned long flags;
+	struct rcu_state *rsp;
+	struct rcu_data *rdp;
+	int cpu;
+
+	for_each_rcu_flavor(rsp) {
+		for_each_cpu(cpu, rcu_nocb_mask) {
+			rdp = per_cpu_ptr(rsp->rda, cpu);
+			if (!READ_ONCE(rdp->nocb_lazy_count))
+				continue;
+			raw_spin_lock_irqsave(&rdp->nocb_lazy_lock, flags);
+			count += rdp->nocb_lazy_count;
+			rcu_nocb_lazy_flush_locked(rdp, RCU_LAZY_FLUSH_SHRINK,
+						   flags);
+			raw_spin_unlock_irqrestore(&rdp->nocb_lazy_lock, flags);
+		}
+	}
+	return count ? count : SHRINK_STOP;
+}
+
+static struct shrinker rcu_lazy_shrinker = {
+	.count_objects = rcu_lazy_shrink_count,
+	.scan_objects = rcu_lazy_shrink_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
+static void __init rcu_nocb_lazy_init(void)
+{
+	if (register_shrinker(&rcu_lazy_shrinker))
+		pr_err("RCU: lazy callback shrinker registration failed.\n");
+}
+
+static void __init rcu_boot_init_nocb_lazy(struct rcu_data *rdp)
+{
+	raw_spin_lock_init(&rdp->nocb_lazy_lock);
+	rdp->nocb_lazy_tail = &rdp->nocb_lazy_head;
+}
+
+/*
+ * Confine the rcuo kthreads to the CPUs of the lowest capacity, so that
+ * invoking callbacks does not wake the big cores of asymmetric systems.
+ */
+static bool rcu_nocb_little = true;
+module_param(rcu_nocb_little, bool, 0444);
+static struct cpumask rcu_nocb_little_mask;
+
+#ifndef arch_scale_cpu_capacity
+#define arch_scale_cpu_capacity(sd, cpu)	SCHED_CAPACITY_SCALE
+#endif
+
+static void __init rcu_nocb_little_init(void)
+{
+	unsigned long min_cap = ULONG_MAX;
+	int cpu;
+
+	if (!rcu_nocb_little)
+		return;
+	for_each_possible_cpu(cpu)
+		min_cap = min_t(unsigned long, min_cap,
+				arch_scale_cpu_capacity(NULL, cpu));
+	for_each_possible_cpu(cpu)
+		if (arch_scale_cpu_capacity(NULL, cpu) == min_cap)
+			cpumask_set_cpu(cpu, &rcu_nocb_little_mask);
+	if (cpumask_equal(&rcu_nocb_little_mask, cpu_possible_mask)) {
+		cpumask_clear(&rcu_nocb_little_mask);
+		return;
+	}
+	pr_info("\tConfine rcuo kthreads to CPUs: %*pbl.\n",
+		cpumask_pr_args(&rcu_nocb_little_mask));
+}
+
+static void rcu_nocb_little_bind(struct task_struct *t)
+{
+	if (!cpumask_empty(&rcu_nocb_little_mask))
+		set_cpus_allowed_ptr(t, &rcu_nocb_little_mask);
+}
+
+#else /* #ifdef CONFIG_RCU_LAZY */
+
+static bool rcu_nocb_lazy_enqueue(struct rcu_data *rdp, struct rcu_head *rhp,
+				  unsigned long flags)
+{
+	return false;
+}
+
+static bool rcu_nocb_lazy_lock_flush(struct rcu_data *rdp, unsigned long flags)
+{
+	return false;
+}
+
+static void rcu_nocb_lazy_unlock(struct rcu_data *rdp)
+{
+}
+
+static long rcu_nocb_lazy_pending(struct rcu_data *rdp)
+{
+	return 0;
+}
+
+static long rcu_nocb_lazy_expire(struct rcu_data *my_rdp)
+{
+	return MAX_SCHEDULE_TIMEOUT;
+}
+
+static void rcu_nocb_note_wake(struct rcu_data *rdp)
+{
+}
+
+static void __init rcu_nocb_lazy_init(void)
+{
+}
+
+static void __init rcu_boot_init_nocb_lazy(struct rcu_data *rdp)
+{
+}
+
+static void __init rcu_nocb_little_init(void)
+{
+}
+
+static void rcu_nocb_little_bind(struct task_struct *t)
+{
+}
+
+#endif /* #else #ifdef CONFIG_RCU_LAZY */
+
 /*
  * This is a helper for __call_rcu(), which invokes this when the normal
  * callback queue is inoperable.  If this is not a no-CBs CPU, this
@@ -1910,11 +2208,19 @@ static void __call_rcu_nocb_enqueue(struct rcu_data *rdp,
 static bool __call_rcu_nocb(struct rcu_data *rdp, struct rcu_head *rhp,
 			    bool lazy, unsigned long flags)
 {
+	bool is_kfree = __is_kfree_rcu_offset((unsigned long)rhp->func);
 
 	if (!rcu_is_nocb_cpu(rdp->cpu))
 		return false;
-	__call_rcu_nocb_enqueue(rdp, rhp, &rhp->next, 1, lazy, flags);
-	if (__is_kfree_rcu_offset((unsigned long)rhp->func))
+	if (!lazy || !rcu_nocb_lazy_enqueue(rdp, rhp, flags)) {
+		bool locked = rcu_nocb_lazy_lock_flush(rdp, flags);
+
+		__call_rcu_nocb_enqueue(rdp, rhp, &rhp->next, 1, is_kfree,
+					flags);
+		if (locked)
+			rcu_nocb_lazy_unlock(rdp);
+	}
+	if (is_kfree)
 		trace_rcu_kfree_callback(rdp->rsp->name, rhp,
 					 (unsigned long)rhp->func,
 					 -atomic_long_read(&rdp->nocb_q_count_lazy),
@@ -2017,16 +2323,23 @@ static void nocb_leader_wait(struct rcu_data *my_rdp)
 {
 	bool firsttime = true;
 	bool gotcbs;
+	long tmo;
 	struct rcu_data *rdp;
 	struct rcu_head **tail;
 
 wait_again:
 
+	/* Hand over due lazy CBs, sleep no longer than until the next. */
+	tmo = rcu_nocb_lazy_expire(my_rdp);
+
 	/* Wait for callbacks to appear. */
 	if (!rcu_nocb_poll) {
 		trace_rcu_nocb_wake(my_rdp->rsp->name, my_rdp->cpu, "Sleep");
-		swait_event_interruptible(my_rdp->nocb_wq,
-				!READ_ONCE(my_rdp->nocb_leader_sleep));
+		if (READ_ONCE(my_rdp->nocb_leader_sleep))
+			rcu_nocb_note_wake(my_rdp);
+		if (!swait_event_interruptible_timeout(my_rdp->nocb_wq,
+				!READ_ONCE(my_rdp->nocb_leader_sleep), tmo))
+			goto wait_again;
 		/* Memory barrier handled by smp_mb() calls below and repoll. */
 	} else if (firsttime) {
 		firsttime = false; /* Don't drown trace log with "Poll"! */
@@ -2121,6 +2434,8 @@ static void nocb_follower_wait(struct rcu_data *rdp)
 		if (!rcu_nocb_poll) {
 			trace_rcu_nocb_wake(rdp->rsp->name, rdp->cpu,
 					    "FollowerSleep");
+			if (!READ_ONCE(rdp->nocb_follower_head))
+				rcu_nocb_note_wake(rdp);
 			swait_event_interruptible(rdp->nocb_wq,
 						 READ_ONCE(rdp->nocb_follower_head));
 		} else if (firsttime) {
@@ -2283,6 +2598,7 @@ static void __init rcu_boot_init_nocb_percpu_data(struct rcu_data *rdp)
 	rdp->nocb_tail = &rdp->nocb_head;
 	init_swait_queue_head(&rdp->nocb_wq);
 	rdp->nocb_follower_tail = &rdp->nocb_follower_head;
+	rcu_boot_init_nocb_lazy(rdp);
 }
 
 /*
@@ -2331,6 +2647,7 @@ static void rcu_spawn_one_nocb_kthread(struct rcu_state *rsp, int cpu)
 			"rcuo%c/%d", rsp->abbr, cpu);
 
 	BUG_ON(IS_ERR(t));
+	rcu_nocb_little_bind(t);
 	WRITE_ONCE(rdp_spawn->nocb_kthread, t);
 }
 
@@ -2357,6 +2674,10 @@ static void __init rcu_spawn_nocb_kthreads(void)
 {
 	int cpu;
 
+	if (have_rcu_nocb_mask) {
+		rcu_nocb_little_init();
+		rcu_nocb_lazy_init();
+	}
 	for_each_online_cpu(cpu)
 		rcu_spawn_all_nocb_kthreads(cpu);
 }
@@ -181,6 +181,49 @@ static const struct file_operations rcudata_fops = {
 	.release = seq_release,
 };
 
+#ifdef CONFIG_RCU_LAZY
+static int show_rculazy(struct seq_file *m, void *v)
+{
+	struct rcu_data *rdp = (struct rcu_data *)v;
+
+	if (!rdp->beenonline)
+		return 0;
+	seq_printf(m, "%3d%clq=%ld/%ld lp=%lu",
+		   rdp->cpu,
+		   cpu_is_offline(rdp->cpu) ? '!' : ' ',
+		   READ_ONCE(rdp->nocb_lazy_count_kfree),
+		   READ_ONCE(rdp->nocb_lazy_count),
+		   rdp->n_nocb_lazy);
+	seq_printf(m, " fs=%lu ft=%lu fn=%lu fm=%lu wk=%lu\n",
+		   rdp->n_nocb_lazy_flush[RCU_LAZY_FLUSH_SIZE],
+		   rdp->n_nocb_lazy_flush[RCU_LAZY_FLUSH_TIME],
+		   rdp->n_nocb_lazy_flush[RCU_LAZY_FLUSH_NONLAZY],
+		   rdp->n_nocb_lazy_flush[RCU_LAZY_FLUSH_SHRINK],
+		   rdp->n_nocb_wakes);
+	return 0;
+}
+
+static const struct seq_operations rculazy_op = {
+	.start = r_start,
+	.next  = r_next,
+	.stop  = r_stop,
+	.show  = show_rculazy,
+};
+
+static int rculazy_open(struct inode *inode, struct file *file)
+{
+	return r_open(inode, file, &rculazy_op);
+}
+
+static const struct file_operations rculazy_fops = {
+	.owner = THIS_MODULE,
+	.open = rculazy_open,
+	.read = seq_read,
+	.llseek = no_llseek,
+	.release = seq_release,
+};
+#endif /* #ifdef CONFIG_RCU_LAZY */
+
 static int show_rcuexp(struct seq_file *m, void *v)
 {
 	struct rcu_state *rsp = (struct rcu_state *)m->private;
@@ -458,6 +501,13 @@ static int __init rcutree_trace_init(void)
 		if (!retval)
 			goto free_out;
 
+#ifdef CONFIG_RCU_LAZY
+		retval = debugfs_create_file("rculazy", 0444,
+				rspdir, rsp, &rculazy_fops);
+		if (!retval)
+			goto free_out;
+#endif
+
 #ifdef CONFIG_RCU_BOOST
 		if (rsp == &rcu_preempt_state) {
 			retval = debugfs_create_file("rcuboost", 0444,
@@ -7,6 +7,8 @@
 #include <linux/rcupdate.h>
 #include <linux/kernel_stat.h>
 #include <linux/err.h>
+#include <linux/cpufreq_times.h>
+#include <linux/sched_energy.h>
 
 #include "sched.h"
 
@@ -25,12 +27,26 @@ enum cpuacct_stat_index {
 	CPUACCT_STAT_NSTATS,
 };
 
+/*
+ * Frequencies tracked per cpu, entries past this in a cpufreq table are
+ * not accounted.
+ */
+#define CPUACCT_FREQ_STATES	32
+
+/* cputime spent at each index of the cpu's cpufreq table */
+struct cpuacct_freq {
+	u64 time[CPUACCT_FREQ_STATES];
+};
+
 /* track cpu usage of a group of tasks and its child groups */
 struct cpuacct {
 	struct cgroup_subsys_state css;
 	/* cpuusage holds pointer to a u64-type object on every cpu */
 	u64 __percpu *cpuusage;
 	struct kernel_cpustat __percpu *cpustat;
+#ifdef CONFIG_CPU_FREQ_TIMES
+	struct cpuacct_freq __percpu *freq;
+#endif
 };
 
 static inline struct cpuacct *css_ca(struct cgroup_subsys_state *css)
@@ -50,9 +66,15 @@ static inline struct cpuacct *parent_ca(struct cpuacct *ca)
 }
 
 static DEFINE_PER_CPU(u64, root_cpuacct_cpuusage);
+#ifdef CONFIG_CPU_FREQ_TIMES
+static DEFINE_PER_CPU(struct cpuacct_freq, root_cpuacct_freq);
+#endif
 static struct cpuacct root_cpuacct = {
 	.cpustat	= &kernel_cpustat,
 	.cpuusage	= &root_cpuacct_cpuusage,
+#ifdef CONFIG_CPU_FREQ_TIMES
+	.freq		= &root_cpuacct_freq,
+#endif
 };
 
 /* create a new cpu accounting group */
@@ -76,8 +98,18 @@ cpuacct_css_alloc(struct cgroup_subsys_state *parent_css)
 	if (!ca->cpustat)
 		goto out_free_cpuusage;
 
+#ifdef CONFIG_CPU_FREQ_TIMES
+	ca->freq = alloc_percpu(struct cpuacct_freq);
+	if (!ca->freq)
+		goto out_free_cpustat;
+#endif
+
 	return &ca->css;
 
+#ifdef CONFIG_CPU_FREQ_TIMES
+out_free_cpustat:
+	free_percpu(ca->cpustat);
+#endif
 out_free_cpuusage:
 	free_percpu(ca->cpuusage);
 out_free_ca:
@@ -91,6 +123,9 @@ static void cpuacct_css_free(struct cgroup_subsys_state *css)
 {
 	struct cpuacct *ca = css_ca(css);
 
+#ifdef CONFIG_CPU_FREQ_TIMES
+	free_percpu(ca->freq);
+#endif
 	free_percpu(ca->cpustat);
 	free_percpu(ca->cpuusage);
 	kfree(ca);
@@ -210,6 +245,127 @@ static int cpuacct_stats_show(struct seq_file *sf, void *v)
 	return 0;
 }
 
+#ifdef CONFIG_CPU_FREQ_TIMES
+static u64 cpuacct_freq_read(struct cpuacct *ca, int cpu, unsigned int index)
+{
+	u64 *time = &per_cpu_ptr(ca->freq, cpu)->time[index];
+	u64 data;
+
+#ifndef CONFIG_64BIT
+	raw_spin_lock_irq(&cpu_rq(cpu)->lock);
+	data = *time;
+	raw_spin_unlock_irq(&cpu_rq(cpu)->lock);
+#else
+	data = *time;
+#endif
+
+	return data;
+}
+
+static unsigned int cpuacct_freq_states(int cpu)
+{
+	return min_t(unsigned int, cpufreq_times_cpu_states(cpu),
+		     CPUACCT_FREQ_STATES);
+}
+
+/* same layout as /proc/<pid>/time_in_state, but for every cpu */
+static int cpuacct_time_in_state_show(struct seq_file *m, void *v)
+{
+	struct cpuacct *ca = css_ca(seq_css(m));
+	unsigned int i, freq;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		if (!cpuacct_freq_states(cpu))
+			continue;
+
+		seq_printf(m, "cpu%d\n", cpu);
+		for (i = 0; i < cpuacct_freq_states(cpu); i++) {
+			freq = cpufreq_times_cpu_freq(cpu, i);
+			if (!freq)
+				continue;
+			seq_printf(m, "%u %llu\n", freq, (unsigned long long)
+				   cputime64_to_clock_t(cpuacct_freq_read(ca, cpu, i)));
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Power of @cpu running at @freq, from the busy costs of its core in the
+ * energy model: the first capacity state that covers the capacity @freq
+ * gives, assuming capacity scales with frequency up to the last state.
+ */
+#ifdef CONFIG_SMP
+static unsigned long cpuacct_freq_power(int cpu, unsigned int freq,
+					unsigned int max_freq)
+{
+	struct sched_group_energy *sge = sge_array[cpu][SD_LEVEL0];
+	unsigned long cap;
+	int i;
+
+	if (!sge || !sge->nr_cap_states || !max_freq)
+		return 0;
+
+	cap = sge->cap_states[sge->nr_cap_states - 1].cap * freq / max_freq;
+	for (i = 0; i < sge->nr_cap_states - 1; i++)
+		if (sge->cap_states[i].cap >= cap)
+			break;
+
+	return sge->cap_states[i].power;
+}
+#else
+static inline unsigned long cpuacct_freq_power(int cpu, unsigned int freq,
+					       unsigned int max_freq)
+{
+	return 0;
+}
+#endif
+
+/*
+ * Energy spent by the group in the busy states of each cpu, estimated
+ * from the time at each frequency and the energy model. Idle and cluster
+ * level costs are not attributed to groups. In the power units of the
+ * energy model times ms, i.e. uJ for a model in mW.
+ */
+static int cpuacct_energy_show(struct seq_file *m, void *v)
+{
+	struct cpuacct *ca = css_ca(seq_css(m));
+	u64 total = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		unsigned int i, max_freq = 0;
+		u64 energy = 0;
+
+		if (!cpuacct_freq_states(cpu))
+			continue;
+
+		for (i = 0; i < cpufreq_times_cpu_states(cpu); i++)
+			max_freq = max(max_freq, cpufreq_times_cpu_freq(cpu, i));
+
+		for (i = 0; i < cpuacct_freq_states(cpu); i++) {
+			unsigned int freq = cpufreq_times_cpu_freq(cpu, i);
+			u64 ns;
+
+			if (!freq)
+				continue;
+			ns = cputime_to_nsecs(cpuacct_freq_read(ca, cpu, i));
+			energy += div_u64(ns, NSEC_PER_USEC) *
+				  cpuacct_freq_power(cpu, freq, max_freq);
+		}
+
+		energy = div_u64(energy, USEC_PER_MSEC);
+		seq_printf(m, "cpu%d %llu\n", cpu, (unsigned long long)energy);
+		total += energy;
+	}
+	seq_printf(m, "total %llu\n", (unsigned long long)total);
+
+	return 0;
+}
+#endif
+
 static struct cftype files[] = {
 	{
 		.name = "usage",
@@ -224,6 +380,16 @@ static struct cftype files[] = {
 		.name = "stat",
 		.seq_show = cpuacct_stats_show,
 	},
+#ifdef CONFIG_CPU_FREQ_TIMES
+	{
+		.name = "time_in_state",
+		.seq_show = cpuacct_time_in_state_show,
+	},
+	{
+		.name = "energy",
+		.seq_show = cpuacct_energy_show,
+	},
+#endif
 	{ }	/* terminate */
 };
 
@@ -275,6 +441,27 @@ void cpuacct_account_field(struct task_struct *p, int index, u64 val)
 	rcu_read_unlock();
 }
 
+#ifdef CONFIG_CPU_FREQ_TIMES
+/*
+ * Add cputime to the current frequency of the cpu, for the group of @p
+ * and all its parents, root included. Called next to
+ * cpufreq_acct_update_power(), on the cpu @p runs on.
+ */
+void cpuacct_account_freq(struct task_struct *p, u64 cputime)
+{
+	int index = cpufreq_times_cpu_index(task_cpu(p));
+	struct cpuacct *ca;
+
+	if (index < 0 || index >= CPUACCT_FREQ_STATES)
+		return;
+
+	rcu_read_lock();
+	for (ca = task_ca(p); ca; ca = parent_ca(ca))
+		this_cpu_ptr(ca->freq)->time[index] += cputime;
+	rcu_read_unlock();
+}
+#endif
+
 struct cgroup_subsys cpuacct_cgrp_subsys = {
 	.css_alloc	= cpuacct_css_alloc,
 	.css_free	= cpuacct_css_free,
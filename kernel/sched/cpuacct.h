@@ -2,6 +2,13 @@
 
 extern void cpuacct_charge(struct task_struct *tsk, u64 cputime);
 extern void cpuacct_account_field(struct task_struct *p, int index, u64 val);
+#ifdef CONFIG_CPU_FREQ_TIMES
+extern void cpuacct_account_freq(struct task_struct *p, u64 cputime);
+#else
+static inline void cpuacct_account_freq(struct task_struct *p, u64 cputime)
+{
+}
+#endif
 
 #else
 
@@ -14,4 +21,8 @@ cpuacct_account_field(struct task_struct *p, int index, u64 val)
 {
 }
 
+static inline void cpuacct_account_freq(struct task_struct *p, u64 cputime)
+{
+}
+
 #endif
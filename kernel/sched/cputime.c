@@ -6,6 +6,7 @@
 #include <linux/static_key.h>
 #include <linux/context_tracking.h>
 #include <linux/cpufreq_times.h>
+#include <linux/uid_sys_stats.h>
 #include "sched.h"
 #include "walt.h"
 
@@ -173,6 +174,10 @@ void account_user_time(struct task_struct *p, cputime_t cputime,
 
 	/* Account power usage for system time */
 	cpufreq_acct_update_power(p, cputime);
+	cpuacct_account_freq(p, (__force u64) cputime);
+
+	/* Account user time to the uid */
+	uid_sys_stats_account_cputime(p, cputime, true);
 }
 
 /*
@@ -229,6 +234,10 @@ void __account_system_time(struct task_struct *p, cputime_t cputime,
 
 	/* Account power usage for system time */
 	cpufreq_acct_update_power(p, cputime);
+	cpuacct_account_freq(p, (__force u64) cputime);
+
+	/* Account system time to the uid */
+	uid_sys_stats_account_cputime(p, cputime, false);
 }
 
 /*
@@ -659,6 +659,20 @@ void proc_sched_show_task(struct task_struct *p, struct seq_file *m)
 	P(migrate_disable);
 #endif
 	P(nr_cpus_allowed);
+#ifdef CONFIG_UCLAMP_TASK
+	P(uclamp_req[UCLAMP_MIN].value);
+	P(uclamp_req[UCLAMP_MAX].value);
+	__P(uclamp_eff_value(p, UCLAMP_MIN));
+	__P(uclamp_eff_value(p, UCLAMP_MAX));
+#endif
+#ifdef CONFIG_SCHED_TASK_PMU
+	P(pmu.cycles);
+	P(pmu.instructions);
+	P(pmu.refills);
+	P(pmu.nr_samples);
+	P(pmu.ipc_avg);
+	P(pmu.mpki_avg);
+#endif
 #undef PN
 #undef __PN
 #undef P
@@ -2645,6 +2645,13 @@ struct hmp_global_attr {
 #endif
 #endif
 
+#ifdef CONFIG_SCHED_TASK_PMU
+/* pmu_mpki_threshold and pmu_ipc_floor */
+#define HMP_DATA_SYSFS_TASK_PMU 2
+#else
+#define HMP_DATA_SYSFS_TASK_PMU 0
+#endif
+
 struct hmp_data_struct {
 #ifdef CONFIG_HMP_FREQUENCY_INVARIANT_SCALE
 	int freqinvar_load_scale_enabled;
@@ -2653,8 +2660,8 @@ struct hmp_data_struct {
 	int semiboost_multiplier;
 	int rq_multiplier;
 	struct attribute_group attr_group;
-	struct attribute *attributes[HMP_DATA_SYSFS_MAX + 1];
-	struct hmp_global_attr attr[HMP_DATA_SYSFS_MAX];
+	struct attribute *attributes[HMP_DATA_SYSFS_MAX + HMP_DATA_SYSFS_TASK_PMU + 1];
+	struct hmp_global_attr attr[HMP_DATA_SYSFS_MAX + HMP_DATA_SYSFS_TASK_PMU];
 } hmp_data = {.multiplier = 1 << HMP_VARIABLE_SCALE_SHIFT,
 	      .semiboost_multiplier = 2 << HMP_VARIABLE_SCALE_SHIFT,
 	      .rq_multiplier = 4 << HMP_VARIABLE_SCALE_SHIFT};
@@ -2756,6 +2763,32 @@ u64 hmp_down_compst_ratio = 2048; /* HMP DOWN COMPENSATION RATIO */
 unsigned int hmp_packing_enabled = 1;
 unsigned int hmp_packing_threshold = 460;	/* 45% of the NICE_0_LOAD */
 
+#ifdef CONFIG_SCHED_TASK_PMU
+/*
+ * A task is memory bound while it refills the cache more than
+ * hmp_pmu_mpki_threshold times per 1000 instructions and retires fewer
+ * than hmp_pmu_ipc_floor / 1024 instructions per cycle.  Such a task is
+ * not moved up for its load alone and moves down at the up threshold.
+ */
+unsigned int hmp_pmu_mpki_threshold = 10;
+unsigned int hmp_pmu_ipc_floor = 512;
+
+static bool hmp_task_mem_bound(struct task_struct *p)
+{
+	if (!task_pmu_valid(p))
+		return false;
+
+	return (READ_ONCE(p->pmu.mpki_avg) >> SCHED_CAPACITY_SHIFT) >=
+			hmp_pmu_mpki_threshold &&
+	       READ_ONCE(p->pmu.ipc_avg) < hmp_pmu_ipc_floor;
+}
+#else
+static inline bool hmp_task_mem_bound(struct task_struct *p)
+{
+	return false;
+}
+#endif
+
 #ifdef CONFIG_SCHED_HMP_TASK_BASED_SOFTLANDING
 #include <linux/pm_qos.h>
 #include <linux/irq_work.h>
@@ -2898,7 +2931,7 @@ boosted_task_util(struct task_struct *task)
 	unsigned long util = task_util(task);
 	unsigned long margin = schedtune_task_margin(task);
 
-	return util + margin;
+	return uclamp_task_util(task, util + margin);
 }
 
 /*
@@ -3185,7 +3218,8 @@ static inline void cfs_rq_util_change(struct cfs_rq *cfs_rq)
 
 	if (cpu == smp_processor_id() && &rq->cfs == cfs_rq) {
 		unsigned long max = rq->cpu_capacity_orig;
-		unsigned long req_cap = boosted_cpu_util(cfs_rq->avg.util_avg, cpu);
+		unsigned long req_cap =
+			uclamp_util(rq, boosted_cpu_util(cfs_rq->avg.util_avg, cpu));
 
 		/*
 		 * There are a few boundary cases this might miss but it should
@@ -6436,6 +6470,27 @@ static int hmp_packing_threshold_from_sysfs(int value)
 	return value;
 }
 
+#ifdef CONFIG_SCHED_TASK_PMU
+static int hmp_pmu_mpki_threshold_from_sysfs(int value)
+{
+	if (value < 0 || value > 1000)
+		return -1;
+
+	hmp_pmu_mpki_threshold = value;
+	return value;
+}
+
+/* 0 keeps every task off the memory bound path */
+static int hmp_pmu_ipc_floor_from_sysfs(int value)
+{
+	if (value < 0 || value > 8192)
+		return -1;
+
+	hmp_pmu_ipc_floor = value;
+	return value;
+}
+#endif
+
 #ifdef CONFIG_SCHED_HMP_SELECTIVE_BOOST_WITH_NITP
 int set_hmp_selective_boost(int enable)
 {
@@ -6466,7 +6521,7 @@ static void hmp_attr_add(
 	int i = 0;
 	while (hmp_data.attributes[i] != NULL) {
 		i++;
-		if (i >= HMP_DATA_SYSFS_MAX)
+		if (i >= HMP_DATA_SYSFS_MAX + HMP_DATA_SYSFS_TASK_PMU)
 			return;
 	}
 	hmp_data.attr[i].attr.mode = 0644;
@@ -6593,6 +6648,17 @@ static int hmp_attr_init(void)
 		NULL,
 		hmp_packing_threshold_from_sysfs);
 
+#ifdef CONFIG_SCHED_TASK_PMU
+	hmp_attr_add("pmu_mpki_threshold",
+		&hmp_pmu_mpki_threshold,
+		NULL,
+		hmp_pmu_mpki_threshold_from_sysfs);
+	hmp_attr_add("pmu_ipc_floor",
+		&hmp_pmu_ipc_floor,
+		NULL,
+		hmp_pmu_ipc_floor_from_sysfs);
+#endif
+
 #ifdef CONFIG_HMP_FREQUENCY_INVARIANT_SCALE
 	/* default frequency-invariant scaling ON */
 	hmp_data.freqinvar_load_scale_enabled = 1;
@@ -10177,7 +10243,12 @@ static unsigned int hmp_up_migration(int cpu, int *target_cpu, struct sched_enti
 			else
 				up_threshold = hmp_up_threshold;
 
-			if (se->avg.hmp_load_avg < up_threshold)
+			if (uclamp_task_util(p, se->avg.hmp_load_avg) < up_threshold)
+				return 0;
+
+			/* A faster core would mostly wait on memory */
+			if (hmp_task_mem_bound(p) &&
+			    !uclamp_task_util(p, 0))
 				return 0;
 #ifdef CONFIG_SCHED_HMP_SELECTIVE_BOOST_WITH_NITP
 		}
@@ -10259,7 +10330,11 @@ static unsigned int hmp_down_migration(int cpu, struct sched_entity *se)
 		else
 			down_threshold = hmp_down_threshold;
 
-		if (se->avg.hmp_load_avg < down_threshold)
+		if (hmp_task_mem_bound(p) && !uclamp_task_util(p, 0))
+			down_threshold = hmp_semiboost() ?
+				hmp_semiboost_up_threshold : hmp_up_threshold;
+
+		if (uclamp_task_util(p, se->avg.hmp_load_avg) < down_threshold)
 			return 1;
 	}
 	return 0;
@@ -66,6 +66,15 @@ SCHED_FEAT(RT_PUSH_IPI, true)
 
 SCHED_FEAT(FORCE_SD_OVERLAP, false)
 SCHED_FEAT(RT_RUNTIME_SHARE, false)
+
+#ifdef CONFIG_SCHED_RT_CAS
+/*
+ * Place waking RT tasks on the smallest CPU they fit on, shallowest idle
+ * state first, see find_lowest_rq().
+ */
+SCHED_FEAT(RT_CAS, true)
+#endif
+
 SCHED_FEAT(LB_MIN, false)
 SCHED_FEAT(ATTACH_AGE_LOAD, true)
 
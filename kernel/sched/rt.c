@@ -7,6 +7,7 @@
 
 #include <linux/slab.h>
 #include <linux/irq_work.h>
+#include <linux/cpuidle.h>
 #include <trace/events/sched.h>
 
 int sched_rr_timeslice = RR_TIMESLICE;
@@ -1658,6 +1659,128 @@ static void yield_task_rt(struct rq *rq)
 #ifdef CONFIG_SMP
 static int find_lowest_rq(struct task_struct *task);
 
+#ifdef CONFIG_SCHED_RT_CAS
+/* Share of a CPU an RT task may use there without HMP, as capacity_margin */
+#define RT_CAS_THRESHOLD	819
+
+static inline unsigned long rt_task_util(struct task_struct *p)
+{
+	return uclamp_task_util(p, p->rt.avg.util_avg);
+}
+
+static inline unsigned long rt_cas_threshold(void)
+{
+#ifdef CONFIG_SCHED_HMP
+	/* The load at which hmp_up_migration() moves CFS tasks up */
+	if (get_hmp_semiboost())
+		return hmp_semiboost_up_threshold;
+	return hmp_up_threshold;
+#else
+	return RT_CAS_THRESHOLD;
+#endif
+}
+
+/*
+ * An RT task fits a CPU while it would use less than rt_cas_threshold()
+ * of it. The utilization of the task is invariant, it is scaled to the
+ * biggest CPU, while the threshold is a share of @cpu.
+ */
+static bool rt_task_fits_capacity(struct task_struct *p, int cpu)
+{
+	unsigned long capacity = cpu_rq(cpu)->cpu_capacity_orig;
+
+	return rt_task_util(p) * SCHED_CAPACITY_SCALE <
+	       rt_cas_threshold() * capacity;
+}
+
+/* Wakeup latency of @cpu, in us. Must be called under rcu_read_lock(). */
+static inline unsigned int rt_cpu_exit_latency(int cpu)
+{
+	struct cpuidle_state *idle;
+
+	if (!idle_cpu(cpu))
+		return 0;
+
+	idle = idle_get_state(cpu_rq(cpu));
+	return idle ? idle->exit_latency : 0;
+}
+
+/*
+ * Pick a CPU of @lowest_mask for @p: the smallest CPU the task fits on, or
+ * the biggest one if it fits on none, then the one in the shallowest idle
+ * state, then the CPU the task last ran on.
+ */
+static int rt_cas_select(struct task_struct *p, struct cpumask *lowest_mask)
+{
+	unsigned long best_cap = 0;
+	unsigned int best_lat = 0;
+	int prev_cpu = task_cpu(p);
+	int best_cpu = -1;
+	bool fits = false;
+	int cpu;
+
+	for_each_cpu(cpu, lowest_mask) {
+		unsigned long cap = cpu_rq(cpu)->cpu_capacity_orig;
+		unsigned int lat = rt_cpu_exit_latency(cpu);
+		bool cpu_fits = rt_task_fits_capacity(p, cpu);
+
+		if (best_cpu != -1) {
+			if (fits && !cpu_fits)
+				continue;
+			if (fits == cpu_fits && cap != best_cap &&
+			    (cap > best_cap) == fits)
+				continue;
+			if (fits == cpu_fits && cap == best_cap &&
+			    (lat > best_lat ||
+			     (lat == best_lat && cpu != prev_cpu)))
+				continue;
+		}
+
+		best_cpu = cpu;
+		best_cap = cap;
+		best_lat = lat;
+		fits = cpu_fits;
+	}
+
+	if (best_cpu != -1)
+		trace_sched_rt_cas_select(p, rt_task_util(p), best_cpu,
+					  best_cap, best_lat, fits);
+
+	return best_cpu;
+}
+
+/*
+ * Look for a CPU on every wakeup, not only when @p would have to wait
+ * behind another RT task: the CPU it last ran on may be too small for it,
+ * bigger than it needs, or in a deep idle state.
+ */
+static int select_task_rq_rt_cas(struct task_struct *p, int cpu, bool test)
+{
+	bool prev_fits = rt_task_fits_capacity(p, cpu);
+	int target = find_lowest_rq(p);
+
+	/*
+	 * Don't trade a CPU the task fits on for one it does not fit on,
+	 * unless the task would have to wait where it is.
+	 */
+	if (!test && prev_fits && target != -1 &&
+	    !rt_task_fits_capacity(p, target))
+		target = -1;
+
+	/*
+	 * Don't bother moving it if the destination CPU is
+	 * not running a lower priority task.
+	 */
+	if (target != -1 &&
+	    p->prio >= cpu_rq(target)->rt.highest_prio.curr)
+		target = -1;
+
+	trace_sched_rt_cas_wakeup(p, cpu, target, prev_fits);
+
+	return target != -1 ? target : cpu;
+}
+#endif /* CONFIG_SCHED_RT_CAS */
+
 #ifdef CONFIG_SCHED_USE_FLUID_RT
 static int
 select_task_rq_rt_fluid(struct task_struct *p, int cpu, int sd_flag, int flags)
@@ -1697,6 +1820,7 @@ select_task_rq_rt(struct task_struct *p, int cpu, int sd_flag, int flags)
 {
 	struct task_struct *curr;
 	struct rq *rq;
+	bool test;
 
 	/* For anything but wake ups, just return the task_cpu */
 	if (sd_flag != SD_BALANCE_WAKE && sd_flag != SD_BALANCE_FORK)
@@ -1729,9 +1853,17 @@ select_task_rq_rt(struct task_struct *p, int cpu, int sd_flag, int flags)
 	 * This test is optimistic, if we get it wrong the load-balancer
 	 * will have to sort it out.
 	 */
-	if (curr && unlikely(rt_task(curr)) &&
-	    (tsk_nr_cpus_allowed(curr) < 2 ||
-	     curr->prio <= p->prio)) {
+	test = curr && unlikely(rt_task(curr)) &&
+	       (tsk_nr_cpus_allowed(curr) < 2 || curr->prio <= p->prio);
+
+#ifdef CONFIG_SCHED_RT_CAS
+	if (sched_feat(RT_CAS)) {
+		cpu = select_task_rq_rt_cas(p, cpu, test);
+		goto out_unlock;
+	}
+#endif
+
+	if (test) {
 		int target = find_lowest_rq(p);
 
 		/*
@@ -1742,6 +1874,10 @@ select_task_rq_rt(struct task_struct *p, int cpu, int sd_flag, int flags)
 		    p->prio < cpu_rq(target)->rt.highest_prio.curr)
 			cpu = target;
 	}
+
+#ifdef CONFIG_SCHED_RT_CAS
+out_unlock:
+#endif
 	rcu_read_unlock();
 
 out:
@@ -2492,6 +2628,20 @@ static int find_lowest_rq(struct task_struct *task)
 	if (tsk_nr_cpus_allowed(task) == 1)
 		return -1; /* No other targets possible */
 
+#ifdef CONFIG_SCHED_RT_CAS
+	if (sched_feat(RT_CAS)) {
+		if (!cpupri_find_fitness(&task_rq(task)->rd->cpupri, task,
+					 lowest_mask, rt_task_fits_capacity))
+			return -1; /* No targets found */
+
+		rcu_read_lock();
+		cpu = rt_cas_select(task, lowest_mask);
+		rcu_read_unlock();
+
+		return cpu;
+	}
+#endif
+
 	if (!cpupri_find(&task_rq(task)->rd->cpupri, task, lowest_mask))
 		return -1; /* No targets found */
 
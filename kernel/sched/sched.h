@@ -611,6 +611,48 @@ extern void rto_push_irq_work_func(struct irq_work *work);
  * (such as the load balancing or the thread migration code), lock
  * acquire operations must be ordered by ascending &runqueue.
  */
+#ifdef CONFIG_UCLAMP_TASK
+/*
+ * struct uclamp_bucket - Utilization clamp bucket
+ * @value: utilization clamp value for tasks on this clamp bucket
+ * @tasks: number of RUNNABLE tasks on this clamp bucket
+ *
+ * Keep track of how many tasks are RUNNABLE for a given utilization
+ * clamp value.
+ */
+struct uclamp_bucket {
+	unsigned long value : 11;
+	unsigned long tasks : BITS_PER_LONG - 11;
+};
+
+/*
+ * struct uclamp_rq - rq's utilization clamp
+ * @value: currently active clamp values for a rq
+ * @bucket: utilization clamp buckets affecting a rq
+ *
+ * Keep track of RUNNABLE tasks on a rq to aggregate their clamp values.
+ * A clamp value is affecting a rq when there is at least one task RUNNABLE
+ * (or actually running) with that value.
+ *
+ * There are up to UCLAMP_CNT possible different clamp values, currently there
+ * are only two: minimum utilization and maximum utilization.
+ *
+ * All utilization clamping values are MAX aggregated, since:
+ * - for util_min: we want to run the CPU at least at the max of the minimum
+ *   utilization required by its currently RUNNABLE tasks.
+ * - for util_max: we want to allow the CPU to run up to the max of the
+ *   maximum utilization allowed by its currently RUNNABLE tasks.
+ *
+ * Since on each system we expect only a limited number of different
+ * utilization clamp values (UCLAMP_BUCKETS), use a simple array to track
+ * the metrics required to compute all the per-rq utilization clamp values.
+ */
+struct uclamp_rq {
+	unsigned int value;
+	struct uclamp_bucket bucket[UCLAMP_BUCKETS];
+};
+#endif /* CONFIG_UCLAMP_TASK */
+
 struct rq {
 	/* runqueue lock: */
 	raw_spinlock_t lock;
@@ -639,6 +681,13 @@ struct rq {
 	unsigned long nr_load_updates;
 	u64 nr_switches;
 
+#ifdef CONFIG_UCLAMP_TASK
+	/* Utilization clamp values based on CPU's RUNNABLE tasks */
+	struct uclamp_rq uclamp[UCLAMP_CNT] ____cacheline_aligned;
+	unsigned int uclamp_flags;
+#define UCLAMP_FLAG_IDLE 0x01
+#endif
+
 	struct cfs_rq cfs;
 	struct rt_rq rt;
 	struct dl_rq dl;
@@ -978,6 +1027,8 @@ extern void flush_smp_call_function_from_idle(void);
 extern struct list_head hmp_domains;
 DECLARE_PER_CPU(struct hmp_domain *, hmp_cpu_domain);
 #define hmp_cpu_domain(cpu)	(per_cpu(hmp_cpu_domain, (cpu)))
+extern unsigned int hmp_up_threshold;
+extern unsigned int hmp_semiboost_up_threshold;
 #endif /* CONFIG_SCHED_HMP */
 
 #else /* !CONFIG_SMP: */
@@ -1971,6 +2022,91 @@ static inline void cpufreq_update_util(u64 time, unsigned long util, unsigned lo
 static inline void cpufreq_trigger_update(u64 time) {}
 #endif /* CONFIG_CPU_FREQ */
 
+#ifdef CONFIG_UCLAMP_TASK
+DECLARE_STATIC_KEY_FALSE(sched_uclamp_used);
+
+unsigned int uclamp_eff_value(struct task_struct *p, enum uclamp_id clamp_id);
+void uclamp_update_active(struct task_struct *p);
+#ifdef CONFIG_UCLAMP_TASK_GROUP
+void schedtune_uclamp_range(struct task_struct *p,
+			    unsigned int *min, unsigned int *max);
+#endif
+
+/**
+ * uclamp_util - Clamp a CPU utilization with its RUNNABLE tasks' clamps.
+ * @rq: The rq to clamp against.
+ * @util: The utilization to clamp.
+ *
+ * The rq clamps are the max of the min and of the max clamps of the tasks
+ * RUNNABLE on it.  If a task asks for a floor above another's ceiling, the
+ * floor wins: we would rather run the ceiling-capped task too fast than
+ * the boosted one too slow.
+ *
+ * Returns util unchanged until a clamp is set anywhere in the system.
+ */
+static inline unsigned long uclamp_util(struct rq *rq, unsigned long util)
+{
+	unsigned long min_util, max_util;
+
+	if (!static_branch_unlikely(&sched_uclamp_used))
+		return util;
+
+	min_util = READ_ONCE(rq->uclamp[UCLAMP_MIN].value);
+	max_util = READ_ONCE(rq->uclamp[UCLAMP_MAX].value);
+	if (unlikely(min_util >= max_util))
+		return min_util;
+
+	return clamp(util, min_util, max_util);
+}
+
+/* Clamp a utilization of p, e.g. for placement, with its own clamps. */
+static inline unsigned long uclamp_task_util(struct task_struct *p,
+					     unsigned long util)
+{
+	unsigned long min_util, max_util;
+
+	if (!static_branch_unlikely(&sched_uclamp_used))
+		return util;
+
+	min_util = uclamp_eff_value(p, UCLAMP_MIN);
+	max_util = uclamp_eff_value(p, UCLAMP_MAX);
+
+	return clamp(util, min_util, max(min_util, max_util));
+}
+#else
+static inline unsigned long uclamp_util(struct rq *rq, unsigned long util)
+{
+	return util;
+}
+
+static inline unsigned long uclamp_task_util(struct task_struct *p,
+					     unsigned long util)
+{
+	return util;
+}
+#endif /* CONFIG_UCLAMP_TASK */
+
+#ifdef CONFIG_SCHED_TASK_PMU
+DECLARE_STATIC_KEY_FALSE(sched_task_pmu_used);
+
+void __task_pmu_sched_out(struct task_struct *prev);
+
+/* Charge the counters of this CPU since the last switch to @prev */
+static inline void task_pmu_sched_out(struct task_struct *prev)
+{
+	if (static_branch_unlikely(&sched_task_pmu_used))
+		__task_pmu_sched_out(prev);
+}
+
+/* The averages of @p are backed by enough hardware samples */
+static inline bool task_pmu_valid(struct task_struct *p)
+{
+	return READ_ONCE(p->pmu.nr_samples) >= 8;
+}
+#else
+static inline void task_pmu_sched_out(struct task_struct *prev) { }
+#endif
+
 #ifdef arch_scale_freq_capacity
 #ifndef arch_scale_freq_invariant
 #define arch_scale_freq_invariant()	(true)
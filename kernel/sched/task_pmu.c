@@ -0,0 +1,267 @@
+/*
+ * Per-task hardware counter feed for task placement
+ *
+ * Every CPU runs three pinned, CPU-wide kernel counters: cycles,
+ * instructions and cache refills.  At each context switch the counters are
+ * read locally and the deltas charged to the task being switched out, which
+ * keeps decayed averages of its IPC and of its refills per 1000
+ * instructions (MPKI).  A low IPC with a high MPKI marks a memory bound
+ * task: a big core mostly waits on the same memory faster and burns more
+ * power doing so, which the HMP migration code in fair.c takes into account.
+ *
+ * Where the hardware events are missing, as on QEMU without a PMU, the
+ * software cpu-clock and page-fault events stand in for cycles and refills.
+ * The totals then still move and the plumbing can be checked through
+ * /proc/<pid>/sched, but the averages, and so placement, are left alone.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#define pr_fmt(fmt) "sched-pmu: " fmt
+
+#include <linux/cpu.h>
+#include <linux/err.h>
+#include <linux/init.h>
+#include <linux/percpu.h>
+#include <linux/perf_event.h>
+#include <linux/printk.h>
+
+#include "sched.h"
+
+enum task_pmu_event {
+	TASK_PMU_CYCLES,
+	TASK_PMU_INSTRUCTIONS,
+	TASK_PMU_REFILLS,
+	TASK_PMU_NR_EVENTS,
+};
+
+/* ARMv8 common event L2D_CACHE_REFILL */
+#define ARMV8_L2D_CACHE_REFILL	0x17
+
+/* Slices shorter than this are too noisy to move the averages */
+#define TASK_PMU_MIN_CYCLES	100000
+/* Weight of a new sample in the averages: 1/8 */
+#define TASK_PMU_EWMA_SHIFT	3
+#define TASK_PMU_IPC_MAX	(8 << SCHED_CAPACITY_SHIFT)
+#define TASK_PMU_MPKI_MAX	(1000 << SCHED_CAPACITY_SHIFT)
+
+struct task_pmu_attr {
+	const char *name;
+	u32 type;
+	u64 config;
+	bool hw;
+};
+
+/* Events tried in order for each counter, the first one that opens wins */
+static const struct task_pmu_attr task_pmu_attrs[TASK_PMU_NR_EVENTS][3] = {
+	[TASK_PMU_CYCLES] = {
+		{ "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, true },
+		{ "cpu-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_CLOCK, false },
+	},
+	[TASK_PMU_INSTRUCTIONS] = {
+		{ "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, true },
+	},
+	[TASK_PMU_REFILLS] = {
+		{ "l2d-refill", PERF_TYPE_RAW, ARMV8_L2D_CACHE_REFILL, true },
+		{ "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, true },
+		{ "page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, false },
+	},
+};
+
+struct task_pmu_cpu {
+	struct perf_event *event[TASK_PMU_NR_EVENTS];
+	u64 last[TASK_PMU_NR_EVENTS];
+	/* last[] holds a reading taken on this CPU */
+	bool primed;
+	/* All three events are hardware events */
+	bool hw;
+	/* The fields above are set up and the switch path may use them */
+	bool ready;
+};
+
+static DEFINE_PER_CPU(struct task_pmu_cpu, task_pmu_cpu);
+static DEFINE_MUTEX(task_pmu_mutex);
+
+DEFINE_STATIC_KEY_FALSE(sched_task_pmu_used);
+
+static struct perf_event *task_pmu_create(int cpu, int e, bool *hw)
+{
+	struct perf_event_attr attr = {
+		.size		= sizeof(attr),
+		.pinned		= 1,
+	};
+	struct perf_event *event;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(task_pmu_attrs[e]); i++) {
+		const struct task_pmu_attr *a = &task_pmu_attrs[e][i];
+
+		if (!a->name)
+			break;
+		attr.type = a->type;
+		attr.config = a->config;
+		event = perf_event_create_kernel_counter(&attr, cpu, NULL,
+							 NULL, NULL);
+		if (!IS_ERR(event)) {
+			pr_debug("cpu%d: %s\n", cpu, a->name);
+			*hw = *hw && a->hw;
+			return event;
+		}
+	}
+
+	*hw = false;
+	return NULL;
+}
+
+static bool task_pmu_cpu_up(int cpu)
+{
+	struct task_pmu_cpu *tpc = per_cpu_ptr(&task_pmu_cpu, cpu);
+	struct perf_event *event[TASK_PMU_NR_EVENTS];
+	bool hw = true, any = false;
+	int e;
+
+	for (e = 0; e < TASK_PMU_NR_EVENTS; e++) {
+		event[e] = task_pmu_create(cpu, e, &hw);
+		any |= !!event[e];
+	}
+
+	/* The switch path of @cpu skips accounting until all this is set */
+	for (e = 0; e < TASK_PMU_NR_EVENTS; e++) {
+		tpc->event[e] = event[e];
+		tpc->last[e] = 0;
+	}
+	tpc->primed = false;
+	tpc->hw = hw;
+	smp_store_release(&tpc->ready, true);
+
+	return any;
+}
+
+static void task_pmu_cpu_down(int cpu)
+{
+	struct task_pmu_cpu *tpc = per_cpu_ptr(&task_pmu_cpu, cpu);
+	int e;
+
+	WRITE_ONCE(tpc->ready, false);
+
+	/* The switch path runs with interrupts off */
+	synchronize_sched();
+
+	for (e = 0; e < TASK_PMU_NR_EVENTS; e++) {
+		if (tpc->event[e])
+			perf_event_release_kernel(tpc->event[e]);
+		tpc->event[e] = NULL;
+	}
+}
+
+/*
+ * Called from __schedule() with interrupts disabled, before @prev is
+ * switched out.
+ */
+void __task_pmu_sched_out(struct task_struct *prev)
+{
+	struct task_pmu_cpu *tpc = this_cpu_ptr(&task_pmu_cpu);
+	struct task_pmu *tp = &prev->pmu;
+	u64 delta[TASK_PMU_NR_EVENTS];
+	unsigned int ipc, mpki;
+	int e;
+
+	if (!smp_load_acquire(&tpc->ready))
+		return;
+
+	for (e = 0; e < TASK_PMU_NR_EVENTS; e++) {
+		struct perf_event *event = tpc->event[e];
+		u64 val;
+
+		if (!event) {
+			delta[e] = 0;
+			continue;
+		}
+		val = perf_event_read_local(event);
+		delta[e] = val - tpc->last[e];
+		tpc->last[e] = val;
+	}
+
+	if (!tpc->primed) {
+		tpc->primed = true;
+		return;
+	}
+
+	if (is_idle_task(prev))
+		return;
+
+	tp->cycles += delta[TASK_PMU_CYCLES];
+	tp->instructions += delta[TASK_PMU_INSTRUCTIONS];
+	tp->refills += delta[TASK_PMU_REFILLS];
+
+	if (!tpc->hw || delta[TASK_PMU_CYCLES] < TASK_PMU_MIN_CYCLES ||
+	    !delta[TASK_PMU_INSTRUCTIONS])
+		return;
+
+	ipc = min_t(u64, div64_u64(delta[TASK_PMU_INSTRUCTIONS] <<
+				   SCHED_CAPACITY_SHIFT,
+				   delta[TASK_PMU_CYCLES]),
+		    TASK_PMU_IPC_MAX);
+	mpki = min_t(u64, div64_u64((delta[TASK_PMU_REFILLS] * 1000) <<
+				    SCHED_CAPACITY_SHIFT,
+				    delta[TASK_PMU_INSTRUCTIONS]),
+		     TASK_PMU_MPKI_MAX);
+
+	if (!tp->nr_samples++) {
+		tp->ipc_avg = ipc;
+		tp->mpki_avg = mpki;
+		return;
+	}
+	tp->ipc_avg += (int)(ipc - tp->ipc_avg) >> TASK_PMU_EWMA_SHIFT;
+	tp->mpki_avg += (int)(mpki - tp->mpki_avg) >> TASK_PMU_EWMA_SHIFT;
+}
+
+static int task_pmu_cpu_notify(struct notifier_block *nb,
+			       unsigned long action, void *hcpu)
+{
+	int cpu = (long)hcpu;
+
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_ONLINE:
+	case CPU_DOWN_FAILED:
+		mutex_lock(&task_pmu_mutex);
+		task_pmu_cpu_up(cpu);
+		mutex_unlock(&task_pmu_mutex);
+		break;
+	case CPU_DOWN_PREPARE:
+		mutex_lock(&task_pmu_mutex);
+		task_pmu_cpu_down(cpu);
+		mutex_unlock(&task_pmu_mutex);
+		break;
+	}
+
+	return NOTIFY_OK;
+}
+
+/* After the PMU drivers have registered */
+static int __init task_pmu_init(void)
+{
+	bool any = false, hw = true;
+	int cpu;
+
+	cpu_notifier_register_begin();
+	mutex_lock(&task_pmu_mutex);
+	for_each_online_cpu(cpu) {
+		any |= task_pmu_cpu_up(cpu);
+		hw &= per_cpu(task_pmu_cpu, cpu).hw;
+	}
+	mutex_unlock(&task_pmu_mutex);
+	__hotcpu_notifier(task_pmu_cpu_notify, 0);
+	cpu_notifier_register_done();
+
+	if (!any) {
+		pr_info("no usable perf events\n");
+		return 0;
+	}
+
+	pr_info("%s events\n", hw ? "hardware" : "software");
+	static_branch_enable(&sched_task_pmu_used);
+	return 0;
+}
+late_initcall(task_pmu_init);
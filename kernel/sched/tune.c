@@ -29,6 +29,13 @@ struct schedtune {
 	/* Boost value for tasks on that SchedTune CGroup */
 	int boost;
 
+	/* Minimum timer slack of the tasks in that SchedTune CGroup */
+	unsigned long timer_slack_ns;
+
+#ifdef CONFIG_UCLAMP_TASK_GROUP
+	/* Utilization clamps of the tasks in that SchedTune CGroup */
+	unsigned int uclamp[UCLAMP_CNT];
+#endif
 };
 
 static inline struct schedtune *css_st(struct cgroup_subsys_state *css)
@@ -58,6 +65,9 @@ static inline struct schedtune *parent_st(struct schedtune *st)
 static struct schedtune
 root_schedtune = {
 	.boost	= 0,
+#ifdef CONFIG_UCLAMP_TASK_GROUP
+	.uclamp	= { 0, SCHED_CAPACITY_SCALE },
+#endif
 };
 
 /*
@@ -349,6 +359,121 @@ boost_write(struct cgroup_subsys_state *css, struct cftype *cft,
 	return 0;
 }
 
+unsigned long schedtune_timer_slack(struct task_struct *p)
+{
+	struct schedtune *st;
+	unsigned long slack;
+
+	if (!unlikely(schedtune_initialized))
+		return 0;
+
+	rcu_read_lock();
+	st = task_schedtune(p);
+	slack = READ_ONCE(st->timer_slack_ns);
+	rcu_read_unlock();
+
+	return slack;
+}
+
+static u64
+timer_slack_read(struct cgroup_subsys_state *css, struct cftype *cft)
+{
+	struct schedtune *st = css_st(css);
+
+	return st->timer_slack_ns;
+}
+
+static int
+timer_slack_write(struct cgroup_subsys_state *css, struct cftype *cft,
+		  u64 slack_ns)
+{
+	struct schedtune *st = css_st(css);
+
+	if (slack_ns > ULONG_MAX)
+		return -EINVAL;
+
+	WRITE_ONCE(st->timer_slack_ns, slack_ns);
+
+	return 0;
+}
+
+#ifdef CONFIG_UCLAMP_TASK_GROUP
+/*
+ * The group clamps restrict the clamps requested by its tasks: a task
+ * utilization request is raised to uclamp.min and lowered to uclamp.max.
+ * Tasks which requested nothing thus get the group range.
+ */
+void schedtune_uclamp_range(struct task_struct *p,
+			    unsigned int *min, unsigned int *max)
+{
+	struct schedtune *st;
+
+	if (!unlikely(schedtune_initialized)) {
+		*min = 0;
+		*max = SCHED_CAPACITY_SCALE;
+		return;
+	}
+
+	rcu_read_lock();
+	st = task_schedtune(p);
+	*min = READ_ONCE(st->uclamp[UCLAMP_MIN]);
+	*max = READ_ONCE(st->uclamp[UCLAMP_MAX]);
+	rcu_read_unlock();
+
+	/* A group max below its min wins, as a task max does */
+	if (*min > *max)
+		*min = *max;
+}
+
+static void schedtune_uclamp_update(struct schedtune *st)
+{
+	struct css_task_iter it;
+	struct task_struct *p;
+
+	css_task_iter_start(&st->css, &it);
+	while ((p = css_task_iter_next(&it)))
+		uclamp_update_active(p);
+	css_task_iter_end(&it);
+}
+
+static u64
+uclamp_read(struct cgroup_subsys_state *css, struct cftype *cft)
+{
+	struct schedtune *st = css_st(css);
+
+	return READ_ONCE(st->uclamp[cft->private]);
+}
+
+static int
+uclamp_write(struct cgroup_subsys_state *css, struct cftype *cft,
+	     u64 value)
+{
+	struct schedtune *st = css_st(css);
+
+	if (value > SCHED_CAPACITY_SCALE)
+		return -ERANGE;
+
+	/* Writing back the defaults does not need clamping to be on */
+	if (value != (cft->private == UCLAMP_MIN ? 0 : SCHED_CAPACITY_SCALE))
+		static_branch_enable(&sched_uclamp_used);
+
+	WRITE_ONCE(st->uclamp[cft->private], value);
+	schedtune_uclamp_update(st);
+
+	return 0;
+}
+
+static void
+schedtune_attach(struct cgroup_taskset *tset)
+{
+	struct cgroup_subsys_state *css;
+	struct task_struct *p;
+
+	cgroup_taskset_for_each(p, css, tset)
+		uclamp_update_active(p);
+}
+#endif /* CONFIG_UCLAMP_TASK_GROUP */
+
 static u64 prefer_high_cap_read(struct cgroup_subsys_state *css,
 				struct cftype *cft)
 {
@@ -372,6 +497,25 @@ static struct cftype files[] = {
 		.read_u64 = prefer_high_cap_read,
 		.write_u64 = prefer_high_cap_write,
 	},
+	{
+		.name = "timer_slack_ns",
+		.read_u64 = timer_slack_read,
+		.write_u64 = timer_slack_write,
+	},
+#ifdef CONFIG_UCLAMP_TASK_GROUP
+	{
+		.name = "uclamp.min",
+		.private = UCLAMP_MIN,
+		.read_u64 = uclamp_read,
+		.write_u64 = uclamp_write,
+	},
+	{
+		.name = "uclamp.max",
+		.private = UCLAMP_MAX,
+		.read_u64 = uclamp_read,
+		.write_u64 = uclamp_write,
+	},
+#endif
 	{ }	/* terminate */
 };
 
@@ -447,6 +591,9 @@ schedtune_css_alloc(struct cgroup_subsys_state *parent_css)
 
 	/* Initialize per CPUs boost group support */
 	st->idx = idx;
+#ifdef CONFIG_UCLAMP_TASK_GROUP
+	st->uclamp[UCLAMP_MAX] = SCHED_CAPACITY_SCALE;
+#endif
 	if (schedtune_boostgroup_init(st))
 		goto release;
 
@@ -480,6 +627,9 @@ schedtune_css_free(struct cgroup_subsys_state *css)
 struct cgroup_subsys schedtune_cgrp_subsys = {
 	.css_alloc	= schedtune_css_alloc,
 	.css_free	= schedtune_css_free,
+#ifdef CONFIG_UCLAMP_TASK_GROUP
+	.attach		= schedtune_attach,
+#endif
 	.legacy_cftypes	= files,
 	.early_init	= 1,
 };
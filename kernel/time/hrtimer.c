@@ -52,6 +52,7 @@
 #include <linux/freezer.h>
 #include <linux/exynos-ss.h>
 #include <linux/delay.h>
+#include <linux/moduleparam.h>
 
 #include <asm/uaccess.h>
 
@@ -1121,6 +1122,65 @@ static inline ktime_t hrtimer_update_lowres(struct hrtimer *timer, ktime_t tim,
 	return tim;
 }
 
+#ifdef CONFIG_HIGH_RES_TIMERS
+/*
+ * Wakeup coalescing window in ns, 0 disables coalescing.
+ */
+static unsigned int hrtimer_coalesce_ns;
+module_param_named(coalesce_ns, hrtimer_coalesce_ns, uint, 0644);
+
+/*
+ * A timer with slack may expire anywhere between its soft and its hard
+ * expiry. Pull the hard expiry back to the event the CPU is already
+ * programmed for when that falls in the range, so the timer rides on that
+ * wakeup. Otherwise pull it back to a multiple of hrtimer_coalesce_ns, so
+ * that timers started at different times but with overlapping ranges
+ * share one wakeup in that window.
+ *
+ * Called with the base locked.
+ */
+static void hrtimer_coalesce(struct hrtimer *timer,
+			     struct hrtimer_clock_base *base)
+{
+	struct hrtimer_cpu_base *cpu_base = base->cpu_base;
+	unsigned int window = READ_ONCE(hrtimer_coalesce_ns);
+	ktime_t soft, hard, next;
+	u32 rem;
+	s64 ns;
+
+	if (!window || !cpu_base->hres_active)
+		return;
+
+	soft = hrtimer_get_softexpires(timer);
+	hard = hrtimer_get_expires(timer);
+	if (hard.tv64 <= soft.tv64)
+		return;
+
+	next = cpu_base->expires_next;
+	if (next.tv64 != KTIME_MAX) {
+		next = ktime_add(next, base->offset);
+		if (next.tv64 >= soft.tv64 && next.tv64 < hard.tv64) {
+			timer->node.expires = next;
+			cpu_base->nr_coalesced++;
+			return;
+		}
+	}
+
+	if (hard.tv64 <= 0)
+		return;
+
+	div_u64_rem(hard.tv64, window, &rem);
+	ns = hard.tv64 - rem;
+	if (rem && ns >= soft.tv64) {
+		timer->node.expires = ns_to_ktime(ns);
+		cpu_base->nr_aligned++;
+	}
+}
+#else
+static inline void hrtimer_coalesce(struct hrtimer *timer,
+				    struct hrtimer_clock_base *base) { }
+#endif
+
 /**
  * hrtimer_start_range_ns - (re)start an hrtimer on the current CPU
  * @timer:	the timer to be added
@@ -1151,6 +1211,8 @@ void hrtimer_start_range_ns(struct hrtimer *timer, ktime_t tim,
 	/* Switch the timer base, if necessary: */
 	new_base = switch_hrtimer_base(timer, base, mode & HRTIMER_MODE_PINNED);
 
+	hrtimer_coalesce(timer, new_base);
+
 	timer_stats_hrtimer_set_start_info(timer);
 #ifdef CONFIG_MISSED_TIMER_OFFSETS_HIST
 	{
@@ -1845,7 +1907,7 @@ __hrtimer_nanosleep(struct timespec *rqtp, struct timespec __user *rmtp,
 	int ret = 0;
 	u64 slack;
 
-	slack = current->timer_slack_ns;
+	slack = task_timer_slack(current);
 	if (dl_task(current) || rt_task(current))
 		slack = 0;
 
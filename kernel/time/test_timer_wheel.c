@@ -0,0 +1,290 @@
+/*
+ * Timer wheel stress test kernel module
+ *
+ * Test is executed by writing and reading to /sys/kernel/debug/timer_wheel_test
+ * Tests are configured by writing: NR_TIMERS SECONDS
+ * Tests are executed by reading from the same file.
+ *
+ * NR_TIMERS timers are spread over the online CPUs with a mix of short
+ * (1-16 jiffies), medium (HZ/8-HZ) and long (8-64s) timeouts, like the
+ * retransmit, driver watchdog and keepalive timers of a busy system.
+ * Expired timers re-arm themselves and the long ones are modified over and
+ * over from the reading task, as network timeouts are, so that most of them
+ * never expire. The test reports the time spent in softirq context and how
+ * late the timers fired past their expiry, per class.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/cpu.h>
+#include <linux/debugfs.h>
+#include <linux/kernel_stat.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+#include <linux/timer.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#define DEFAULT_TIMERS 10000
+#define DEFAULT_SECONDS 10
+
+#define DEBUGFS_FILENAME "timer_wheel_test"
+
+enum {
+	TWT_SHORT,
+	TWT_MEDIUM,
+	TWT_LONG,
+	TWT_NR_CLASSES,
+};
+
+static const char * const twt_class_name[TWT_NR_CLASSES] = {
+	"short", "medium", "long",
+};
+
+struct twt_timer {
+	struct timer_list timer;
+	unsigned long timeout;
+	u64 expires_ns;
+	int class;
+};
+
+struct twt_stats {
+	unsigned long fired;
+	unsigned long max_late_jiffies;
+	u64 max_late_ns;
+};
+
+static DEFINE_MUTEX(twt_lock);
+static struct dentry *twt_debugfs_file;
+static int twt_nr_timers = DEFAULT_TIMERS;
+static int twt_seconds = DEFAULT_SECONDS;
+
+static struct twt_timer *twt_timers;
+static bool twt_running;
+static DEFINE_PER_CPU(struct twt_stats, twt_stats[TWT_NR_CLASSES]);
+
+static unsigned long twt_timeout(int class)
+{
+	u32 rnd = prandom_u32();
+
+	switch (class) {
+	case TWT_SHORT:
+		return 1 + rnd % 16;
+	case TWT_MEDIUM:
+		return HZ / 8 + rnd % (HZ - HZ / 8 + 1);
+	default:
+		return 8 * HZ + rnd % (56 * HZ);
+	}
+}
+
+static void twt_arm(struct twt_timer *t)
+{
+	t->timeout = twt_timeout(t->class);
+	t->expires_ns = ktime_get_ns() + jiffies_to_nsecs(t->timeout);
+	mod_timer_pinned(&t->timer, jiffies + t->timeout);
+}
+
+static void twt_fn(unsigned long data)
+{
+	struct twt_timer *t = (struct twt_timer *)data;
+	struct twt_stats *st = this_cpu_ptr(&twt_stats[t->class]);
+	long late = (long)(jiffies - t->timer.expires);
+	u64 now = ktime_get_ns();
+
+	st->fired++;
+	if (late > 0 && late > st->max_late_jiffies)
+		st->max_late_jiffies = late;
+	if (now > t->expires_ns && now - t->expires_ns > st->max_late_ns)
+		st->max_late_ns = now - t->expires_ns;
+
+	if (READ_ONCE(twt_running))
+		twt_arm(t);
+}
+
+static u64 twt_softirq_ns(void)
+{
+	u64 sum = 0;
+	int cpu;
+
+	for_each_online_cpu(cpu)
+		sum += cputime_to_nsecs(kcpustat_cpu(cpu).cpustat[CPUTIME_SOFTIRQ]);
+	return sum;
+}
+
+static int twt_run(struct seq_file *s, int nr, int seconds)
+{
+	unsigned long end, mods = 0;
+	u64 softirq, elapsed;
+	int cpu, i, c;
+
+	twt_timers = vzalloc(nr * sizeof(*twt_timers));
+	if (!twt_timers)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(&twt_stats, cpu), 0, sizeof(twt_stats));
+
+	WRITE_ONCE(twt_running, true);
+	softirq = twt_softirq_ns();
+	elapsed = ktime_get_ns();
+
+	get_online_cpus();
+	cpu = cpumask_first(cpu_online_mask);
+	for (i = 0; i < nr; i++) {
+		struct twt_timer *t = &twt_timers[i];
+
+		/* One long timeout in two, the rest split evenly */
+		t->class = i & 1 ? TWT_LONG : (i & 2 ? TWT_MEDIUM : TWT_SHORT);
+		setup_timer(&t->timer, twt_fn, (unsigned long)t);
+		t->timeout = twt_timeout(t->class);
+		t->expires_ns = ktime_get_ns() + jiffies_to_nsecs(t->timeout);
+		t->timer.expires = jiffies + t->timeout;
+		add_timer_on(&t->timer, cpu);
+
+		cpu = cpumask_next(cpu, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_online_mask);
+	}
+	put_online_cpus();
+
+	end = jiffies + seconds * HZ;
+	while (time_before(jiffies, end) && !signal_pending(current)) {
+		for (i = 1; i < nr; i += 2) {
+			struct twt_timer *t = &twt_timers[i];
+
+			t->expires_ns = ktime_get_ns() +
+					jiffies_to_nsecs(t->timeout);
+			mod_timer(&t->timer, jiffies + t->timeout);
+			mods++;
+		}
+		schedule_timeout_interruptible(1);
+	}
+
+	WRITE_ONCE(twt_running, false);
+	for (i = 0; i < nr; i++)
+		del_timer_sync(&twt_timers[i].timer);
+
+	elapsed = ktime_get_ns() - elapsed;
+	softirq = twt_softirq_ns() - softirq;
+
+	seq_printf(s, "%d timers x %d s: %lu modifications, softirq %llu ms (%llu us/s)\n",
+		   nr, seconds, mods, softirq / NSEC_PER_MSEC,
+		   div64_u64(softirq * USEC_PER_SEC, max_t(u64, elapsed, 1)));
+
+	for (c = 0; c < TWT_NR_CLASSES; c++) {
+		unsigned long fired = 0, late_j = 0;
+		u64 late_ns = 0;
+
+		for_each_possible_cpu(cpu) {
+			struct twt_stats *st = per_cpu_ptr(&twt_stats[c], cpu);
+
+			fired += st->fired;
+			late_j = max(late_j, st->max_late_jiffies);
+			late_ns = max(late_ns, st->max_late_ns);
+		}
+		seq_printf(s, "%-6s fired=%lu max_late=%lu jiffies (%llu us)\n",
+			   twt_class_name[c], fired, late_j,
+			   late_ns / NSEC_PER_USEC);
+	}
+
+	vfree(twt_timers);
+	twt_timers = NULL;
+	return 0;
+}
+
+static int twt_show(struct seq_file *s, void *v)
+{
+	int nr, seconds;
+	int ret;
+
+	mutex_lock(&twt_lock);
+	nr = twt_nr_timers;
+	seconds = twt_seconds;
+
+	if (nr > 0 && seconds > 0) {
+		ret = twt_run(s, nr, seconds);
+	} else {
+		seq_puts(s, "usage:\n");
+		seq_puts(s, "echo NR_TIMERS [SECONDS] > " DEBUGFS_FILENAME "\n");
+		seq_puts(s, "cat " DEBUGFS_FILENAME "\n");
+		ret = 0;
+	}
+	mutex_unlock(&twt_lock);
+
+	return ret;
+}
+
+static int twt_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, twt_show, inode->i_private);
+}
+
+static ssize_t twt_write(struct file *file, const char __user *buf,
+		size_t count, loff_t *pos)
+{
+	char lbuf[32];
+	int ret;
+	int nr;
+	int seconds;
+
+	if (count >= sizeof(lbuf))
+		return -EINVAL;
+
+	if (copy_from_user(lbuf, buf, count))
+		return -EFAULT;
+	lbuf[count] = '\0';
+
+	ret = sscanf(lbuf, "%d %d", &nr, &seconds);
+	if (ret < 1)
+		return -EINVAL;
+	else if (ret < 2)
+		seconds = DEFAULT_SECONDS;
+
+	mutex_lock(&twt_lock);
+	twt_nr_timers = nr;
+	twt_seconds = seconds;
+	mutex_unlock(&twt_lock);
+
+	return count;
+}
+
+static const struct file_operations twt_debugfs_ops = {
+	.owner = THIS_MODULE,
+	.open = twt_open,
+	.read = seq_read,
+	.write = twt_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init twt_init(void)
+{
+	mutex_lock(&twt_lock);
+	twt_debugfs_file = debugfs_create_file(DEBUGFS_FILENAME,
+			S_IRUSR | S_IWUSR, NULL, NULL, &twt_debugfs_ops);
+	mutex_unlock(&twt_lock);
+
+	return 0;
+}
+
+module_init(twt_init);
+
+static void __exit twt_exit(void)
+{
+	mutex_lock(&twt_lock);
+	debugfs_remove(twt_debugfs_file);
+	mutex_unlock(&twt_lock);
+}
+
+module_exit(twt_exit);
+
+MODULE_LICENSE("GPL");
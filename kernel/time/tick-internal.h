@@ -156,11 +156,16 @@ extern unsigned long tick_nohz_active;
 #endif
 
 #if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ_COMMON)
-extern void timers_update_migration(bool update_nohz);
+extern void timers_update_migration(void);
 #else
-static inline void timers_update_migration(bool update_nohz) { }
+static inline void timers_update_migration(void) { }
+#endif
+
+#ifdef CONFIG_NO_HZ_COMMON
+extern void timers_update_nohz(void);
 #endif
 
 DECLARE_PER_CPU(struct hrtimer_cpu_base, hrtimer_bases);
 
 extern u64 get_next_timer_interrupt(unsigned long basej, u64 basem);
+void timer_clear_idle(void);
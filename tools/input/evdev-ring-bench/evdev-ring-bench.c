@@ -0,0 +1,431 @@
+/*
+ * evdev-ring-bench: compare the read() and mmap'ed ring (EVIOCSRING) paths
+ * of evdev.
+ *
+ * A uinput touch device is created and a writer thread injects packets of
+ * ABS_X, ABS_Y and SYN_REPORT at a fixed rate. ABS_X carries a sequence
+ * number, so the reader can compute the delay from the write() into
+ * uinput to the moment it sees the SYN_REPORT. The reader runs in one of
+ * three modes:
+ *
+ *   read   blocking read() of the event node
+ *   ring   poll() and consume the ring, the way an event loop would
+ *   spin   busy-poll the ring without any system call
+ *
+ * Reported are the latency distribution, the CPU time of the reader thread
+ * and the number of system calls it made, per packet.
+ *
+ * Build after "make headers_install" so that <linux/input.h> has
+ * EVIOCSRING. Needs access to /dev/uinput and the event nodes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include <linux/input.h>
+#include <linux/uinput.h>
+
+enum mode { MODE_READ, MODE_RING, MODE_SPIN };
+
+static const char * const mode_names[] = { "read", "ring", "spin" };
+
+static unsigned int nr_packets = 10000;
+static unsigned int rate = 240;
+static unsigned int ring_events = 256;
+
+static unsigned long long *sent_ns;
+static unsigned long long *latency_ns;
+static volatile int writer_done;
+
+struct reader_result {
+	unsigned long long cpu_ns;
+	unsigned long long syscalls;
+	unsigned int received;
+	unsigned int dropped;
+};
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned long long thread_cpu_ns(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_THREAD, &ru);
+	return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ULL +
+	       (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+}
+
+static int uinput_create(void)
+{
+	struct uinput_user_dev dev;
+	int fd;
+
+	fd = open("/dev/uinput", O_WRONLY);
+	if (fd < 0) {
+		perror("/dev/uinput");
+		return -1;
+	}
+
+	ioctl(fd, UI_SET_EVBIT, EV_KEY);
+	ioctl(fd, UI_SET_KEYBIT, BTN_TOUCH);
+	ioctl(fd, UI_SET_EVBIT, EV_ABS);
+	ioctl(fd, UI_SET_ABSBIT, ABS_X);
+	ioctl(fd, UI_SET_ABSBIT, ABS_Y);
+	ioctl(fd, UI_SET_PROPBIT, INPUT_PROP_DIRECT);
+
+	memset(&dev, 0, sizeof(dev));
+	snprintf(dev.name, UINPUT_MAX_NAME_SIZE, "evdev-ring-bench");
+	dev.id.bustype = BUS_VIRTUAL;
+	dev.absmax[ABS_X] = 0x7fffffff;
+	dev.absmax[ABS_Y] = 4095;
+
+	if (write(fd, &dev, sizeof(dev)) != sizeof(dev) ||
+	    ioctl(fd, UI_DEV_CREATE) < 0) {
+		perror("uinput");
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+/* find /dev/input/eventN of the uinput device and open it */
+static int evdev_open(int ufd)
+{
+	char sysname[64], path[300];
+	struct dirent *de;
+	DIR *dir;
+	int fd = -1, tries;
+
+	if (ioctl(ufd, UI_GET_SYSNAME(sizeof(sysname)), sysname) < 0) {
+		perror("UI_GET_SYSNAME");
+		return -1;
+	}
+
+	snprintf(path, sizeof(path), "/sys/devices/virtual/input/%s", sysname);
+	dir = opendir(path);
+	if (!dir) {
+		perror(path);
+		return -1;
+	}
+
+	while ((de = readdir(dir))) {
+		if (strncmp(de->d_name, "event", 5))
+			continue;
+		snprintf(path, sizeof(path), "/dev/input/%s", de->d_name);
+		/* give ueventd/udev time to create the node */
+		for (tries = 0; tries < 100; tries++) {
+			fd = open(path, O_RDONLY);
+			if (fd >= 0 || errno != ENOENT)
+				break;
+			usleep(10000);
+		}
+		break;
+	}
+	closedir(dir);
+
+	if (fd < 0)
+		perror("event node");
+	return fd;
+}
+
+static void emit(int fd, int type, int code, int value)
+{
+	struct input_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.type = type;
+	ev.code = code;
+	ev.value = value;
+	if (write(fd, &ev, sizeof(ev)) != sizeof(ev))
+		perror("uinput write");
+}
+
+static void *writer(void *arg)
+{
+	int ufd = *(int *)arg;
+	unsigned long long period_ns = 1000000000ULL / rate;
+	unsigned long long next = now_ns();
+	struct timespec ts;
+	unsigned int i;
+
+	for (i = 0; i < nr_packets; i++) {
+		next += period_ns;
+		ts.tv_sec = next / 1000000000ULL;
+		ts.tv_nsec = next % 1000000000ULL;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+
+		sent_ns[i] = now_ns();
+		emit(ufd, EV_ABS, ABS_X, i);
+		emit(ufd, EV_ABS, ABS_Y, i & 4095);
+		emit(ufd, EV_SYN, SYN_REPORT, 0);
+	}
+
+	/* let the reader drain, then stop it */
+	usleep(100000);
+	writer_done = 1;
+	return NULL;
+}
+
+static unsigned int seq;
+
+/* returns 1 once the last packet was seen */
+static int handle(int type, int code, int value, struct reader_result *res)
+{
+	if (type == EV_ABS && code == ABS_X) {
+		seq = value;
+	} else if (type == EV_SYN && code == SYN_REPORT) {
+		if (seq < nr_packets && !latency_ns[seq]) {
+			latency_ns[seq] = now_ns() - sent_ns[seq];
+			res->received++;
+		}
+		return seq == nr_packets - 1;
+	} else if (type == EV_SYN && code == SYN_DROPPED) {
+		res->dropped++;
+	}
+	return 0;
+}
+
+static void read_loop(int fd, struct reader_result *res)
+{
+	struct input_event ev[64];
+	ssize_t len;
+	int i;
+
+	while (!writer_done) {
+		struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+		/* poll with a timeout so that a lost packet cannot hang us */
+		res->syscalls++;
+		if (poll(&pfd, 1, 100) <= 0)
+			continue;
+
+		res->syscalls++;
+		len = read(fd, ev, sizeof(ev));
+		if (len < 0) {
+			perror("read");
+			return;
+		}
+		for (i = 0; i < len / (ssize_t)sizeof(ev[0]); i++)
+			if (handle(ev[i].type, ev[i].code, ev[i].value, res))
+				return;
+	}
+}
+
+static void ring_loop(int fd, int spin, struct reader_result *res)
+{
+	struct input_event_ring *ring;
+	struct input_ring_event *events;
+	unsigned int head, tail, mask;
+	size_t len;
+
+	if (ioctl(fd, EVIOCSRING, &ring_events) < 0) {
+		perror("EVIOCSRING");
+		return;
+	}
+
+	/* the header tells the real size, map its first page to read it */
+	ring = mmap(NULL, getpagesize(), PROT_READ, MAP_SHARED, fd, 0);
+	if (ring == MAP_FAILED) {
+		perror("mmap");
+		return;
+	}
+	len = ring->data_offset + (size_t)ring->size * ring->event_size;
+	munmap(ring, getpagesize());
+
+	ring = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ring == MAP_FAILED) {
+		perror("mmap");
+		return;
+	}
+	events = (void *)ring + ring->data_offset;
+	mask = ring->size - 1;
+	tail = ring->tail;
+
+	while (!writer_done) {
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		if (head == tail) {
+			if (!spin) {
+				struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+				res->syscalls++;
+				poll(&pfd, 1, 100);
+			}
+			continue;
+		}
+
+		for (; tail != head; tail++) {
+			struct input_ring_event *ev = &events[tail & mask];
+
+			if (handle(ev->type, ev->code, ev->value, res)) {
+				__atomic_store_n(&ring->tail, tail + 1,
+						 __ATOMIC_RELEASE);
+				goto out;
+			}
+		}
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+	}
+out:
+	munmap(ring, len);
+}
+
+static int cmp_ull(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void report(enum mode mode, const struct reader_result *res)
+{
+	unsigned long long *lat, sum = 0;
+	unsigned int i, n = 0;
+
+	lat = calloc(nr_packets, sizeof(*lat));
+	if (!lat)
+		return;
+	for (i = 0; i < nr_packets; i++)
+		if (latency_ns[i])
+			lat[n++] = latency_ns[i];
+	qsort(lat, n, sizeof(*lat), cmp_ull);
+	for (i = 0; i < n; i++)
+		sum += lat[i];
+
+	printf("%-6s %8u %6u %9.1f %9.1f %9.1f %9.1f %10.2f %10.2f\n",
+	       mode_names[mode], n, res->dropped,
+	       n ? sum / n / 1000.0 : 0,
+	       n ? lat[n / 2] / 1000.0 : 0,
+	       n ? lat[n * 99 / 100] / 1000.0 : 0,
+	       n ? lat[n - 1] / 1000.0 : 0,
+	       n ? res->cpu_ns / 1000.0 / n : 0,
+	       n ? (double)res->syscalls / n : 0);
+	free(lat);
+}
+
+static int run(enum mode mode)
+{
+	struct reader_result res;
+	unsigned long long cpu;
+	pthread_t thread;
+	int ufd, fd;
+
+	ufd = uinput_create();
+	if (ufd < 0)
+		return -1;
+	fd = evdev_open(ufd);
+	if (fd < 0) {
+		close(ufd);
+		return -1;
+	}
+
+	memset(&res, 0, sizeof(res));
+	memset(latency_ns, 0, nr_packets * sizeof(*latency_ns));
+	writer_done = 0;
+	seq = 0;
+
+	pthread_create(&thread, NULL, writer, &ufd);
+
+	cpu = thread_cpu_ns();
+	if (mode == MODE_READ)
+		read_loop(fd, &res);
+	else
+		ring_loop(fd, mode == MODE_SPIN, &res);
+	res.cpu_ns = thread_cpu_ns() - cpu;
+
+	pthread_join(thread, NULL);
+	report(mode, &res);
+
+	close(fd);
+	ioctl(ufd, UI_DEV_DESTROY);
+	close(ufd);
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options] [read|ring|spin]...\n"
+		"  -n <packets>  packets to inject (default %u)\n"
+		"  -r <hz>       packet rate (default %u)\n"
+		"  -s <events>   ring size for EVIOCSRING (default %u)\n",
+		prog, nr_packets, rate, ring_events);
+}
+
+int main(int argc, char **argv)
+{
+	int opt, i, m;
+
+	while ((opt = getopt(argc, argv, "n:r:s:h")) != -1) {
+		switch (opt) {
+		case 'n':
+			nr_packets = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			rate = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			ring_events = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (!nr_packets || !rate) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	sent_ns = calloc(nr_packets, sizeof(*sent_ns));
+	latency_ns = calloc(nr_packets, sizeof(*latency_ns));
+	if (!sent_ns || !latency_ns)
+		return 1;
+
+	printf("%-6s %8s %6s %9s %9s %9s %9s %10s %10s\n", "mode", "packets",
+	       "drops", "avg_us", "p50_us", "p99_us", "max_us", "cpu_us/pkt",
+	       "sysc/pkt");
+
+	if (optind == argc) {
+		for (m = MODE_READ; m <= MODE_SPIN; m++)
+			run(m);
+		return 0;
+	}
+
+	for (i = optind; i < argc; i++) {
+		for (m = MODE_READ; m <= MODE_SPIN; m++)
+			if (!strcmp(argv[i], mode_names[m]))
+				break;
+		if (m > MODE_SPIN) {
+			usage(argv[0]);
+			return 1;
+		}
+		run(m);
+	}
+
+	return 0;
+}
@@ -0,0 +1,94 @@
+#!/bin/sh
+#
+# Interrupt and softirq load with and without the in-kernel irq balancer.
+#
+# Runs a workload once with irq_balance.enabled=0 and once with it set to
+# 1, and for each run prints the time the workload took, and per cpu the
+# share of time spent in hard irqs, in softirqs and idle.  With the
+# balancer on, /proc/irq/hot is printed at the end of the run.
+#
+#   irq-balance-bench.sh [-t seconds] [-s settle] [-w "workload"]
+#
+# The default workload is a loopback iperf3 TCP stream, which keeps
+# NET_RX softirqs busy; a stream over Wi-Fi or a UFS read load also
+# exercises the device interrupts the balancer moves, e.g.
+#
+#   irq-balance-bench.sh -w "iperf3 -c <server> -R -t 30"
+#   irq-balance-bench.sh -w "dd if=/dev/block/sda of=/dev/null bs=1M count=2048"
+#
+# Needs root and a kernel with CONFIG_IRQ_BALANCE.  The balancer only
+# moves interrupts still on the default affinity; reset the affinity of
+# the ones to test, or echo auto > /proc/irq/<irq>/balance.
+
+secs=30
+settle=5
+workload=
+
+param=/sys/module/irq_balance/parameters/enabled
+
+while getopts "t:s:w:" opt; do
+	case $opt in
+	t) secs=$OPTARG ;;
+	s) settle=$OPTARG ;;
+	w) workload=$OPTARG ;;
+	*) exit 1 ;;
+	esac
+done
+
+if [ ! -w "$param" ]; then
+	echo "$param not writable, is CONFIG_IRQ_BALANCE set?" >&2
+	exit 1
+fi
+
+loopback=
+if [ -z "$workload" ]; then
+	command -v iperf3 >/dev/null || { echo "iperf3 missing" >&2; exit 1; }
+	loopback=1
+	workload="iperf3 -c 127.0.0.1 -t $secs"
+fi
+
+# cpuN user nice system idle iowait irq softirq ...
+cpu_times()
+{
+	grep '^cpu[0-9]' /proc/stat
+}
+
+report()
+{
+	# $1: before, $2: after
+	printf "%-6s %8s %8s %8s\n" cpu irq% softirq% idle%
+	echo "$1" | while read -r cpu user nice sys idle iowait irq sirq rest; do
+		set -- $(echo "$2" | grep "^$cpu ")
+		total=$(( ($2 + $3 + $4 + $5 + $6 + $7 + $8) -
+			  (user + nice + sys + idle + iowait + irq + sirq) ))
+		[ "$total" -gt 0 ] || total=1
+		printf "%-6s %8d %8d %8d\n" "$cpu" \
+			$(( ($7 - irq) * 100 / total )) \
+			$(( ($8 - sirq) * 100 / total )) \
+			$(( ($5 + $6 - idle - iowait) * 100 / total ))
+	done
+}
+
+for enabled in 0 1; do
+	echo "$enabled" > "$param"
+	# let the balancer settle the interrupts first
+	[ "$enabled" -eq 0 ] || sleep "$settle"
+
+	if [ -n "$loopback" ]; then
+		iperf3 -s -D -1 >/dev/null 2>&1
+		sleep 1
+	fi
+
+	before=$(cpu_times)
+	start=$(date +%s%N)
+	sh -c "$workload" | tail -n 4
+	end=$(date +%s%N)
+	after=$(cpu_times)
+
+	echo "balancer $enabled: $(( (end - start) / 1000000 )) ms"
+	report "$before" "$after"
+	[ "$enabled" -eq 0 ] || cat /proc/irq/hot
+	echo
+done
+
+echo 0 > "$param"
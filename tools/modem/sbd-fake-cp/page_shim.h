@@ -0,0 +1,85 @@
+/*
+ * The kernel page helpers used by sbd_rx_pool.c, on top of malloc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef __PAGE_SHIM_H__
+#define __PAGE_SHIM_H__
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PAGE_SIZE		4096
+#define SMP_CACHE_BYTES		64
+#define GFP_KERNEL		0
+
+#define ALIGN(x, a)		(((x) + (a) - 1) & ~((a) - 1))
+#define unlikely(x)		__builtin_expect(!!(x), 0)
+
+struct page {
+	int count;
+	void *addr;
+};
+
+static inline unsigned int roundup_pow_of_two(unsigned int n)
+{
+	unsigned int r = 1;
+
+	while (r < n)
+		r <<= 1;
+	return r;
+}
+
+static inline void *kcalloc(size_t n, size_t size, int flags)
+{
+	return calloc(n, size);
+}
+
+static inline void kfree(void *p)
+{
+	free(p);
+}
+
+static inline struct page *dev_alloc_page(void)
+{
+	struct page *page = malloc(sizeof(*page));
+
+	if (!page)
+		return NULL;
+	if (posix_memalign(&page->addr, PAGE_SIZE, PAGE_SIZE)) {
+		free(page);
+		return NULL;
+	}
+	page->count = 1;
+	return page;
+}
+
+static inline void *page_address(struct page *page)
+{
+	return page->addr;
+}
+
+static inline int page_count(struct page *page)
+{
+	return page->count;
+}
+
+static inline void get_page(struct page *page)
+{
+	page->count++;
+}
+
+static inline void put_page(struct page *page)
+{
+	if (--page->count)
+		return;
+	free(page->addr);
+	free(page);
+}
+
+#endif
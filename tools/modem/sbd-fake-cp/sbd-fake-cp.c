@@ -0,0 +1,310 @@
+/*
+ * sbd-fake-cp: run the SBD downlink receive path against a software CP.
+ *
+ * A child process plays the CP: it fills the slots of one SBD ring buffer
+ * in shared memory with numbered packets and advances the WP, waiting for
+ * the AP to free slots when the ring is full, as the CP does. The parent
+ * drains the ring as the NAPI poll of the link device would, budget frames
+ * at a time, with one of two receive paths:
+ *
+ *   copy  the old path: each packet is copied to a buffer of its own (the
+ *         skb of dev_alloc_skb()) and the RP is written back per packet;
+ *   pool  the new path: the headers are copied to a small buffer and the
+ *         payload to a fragment of the DL page pool
+ *         (drivers/misc/modem_v1/sbd_rx_pool.c, built as is), and the RP
+ *         is written back once per batch.
+ *
+ * Received packets are held in a queue of -H packets standing in for the
+ * stack, GRO and the socket buffers, and freed when they leave it, so that
+ * pages of the pool are busy for a while as on a device. Every packet is
+ * checked against its sequence number.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "sbd_rx_pool.h"
+
+#define BUFF_SIZE	2048
+
+struct ring {
+	uint16_t rp;
+	uint16_t wp;
+	uint32_t size_v[];
+	/* followed by the data buffers */
+};
+
+static unsigned int qlen = 512;
+static unsigned long packets = 1000000;
+static unsigned int size = 1400;
+static unsigned int budget = 64;
+static unsigned int hold = 256;
+static unsigned int pool_pages = 256;
+
+static struct ring *ring;
+static uint8_t *buffs;
+
+struct held {
+	void *head;
+	struct page *page;
+};
+
+struct result {
+	double secs;
+	unsigned long rp_writes;
+	unsigned long errors;
+	struct sbd_rx_pool pool;
+};
+
+static inline uint8_t *slot(unsigned int i)
+{
+	return buffs + (size_t)i * BUFF_SIZE;
+}
+
+static unsigned int usage(unsigned int in, unsigned int out)
+{
+	return in >= out ? in - out : qlen - out + in;
+}
+
+static void fake_cp(void)
+{
+	unsigned long seq;
+
+	for (seq = 0; seq < packets; seq++) {
+		unsigned int in = ring->wp;
+		unsigned int len = size - (seq % 7) * 64;
+		uint8_t *p = slot(in);
+
+		/* one slot stays empty, as with circ_get_space() */
+		while (usage(in, __atomic_load_n(&ring->rp, __ATOMIC_ACQUIRE)) ==
+		       qlen - 1)
+			sched_yield();
+
+		memcpy(p, &seq, sizeof(seq));
+		memset(p + sizeof(seq), (uint8_t)seq, len - sizeof(seq));
+		ring->size_v[in] = len;
+
+		__atomic_store_n(&ring->wp, (in + 1) % qlen, __ATOMIC_RELEASE);
+	}
+}
+
+static int check(const uint8_t *head, unsigned int hlen, const uint8_t *frag,
+		 unsigned int flen, unsigned long seq)
+{
+	unsigned long got;
+	uint8_t c = (uint8_t)seq;
+
+	memcpy(&got, head, sizeof(got));
+	if (got != seq)
+		return -1;
+	if (hlen > sizeof(got) && head[hlen - 1] != c)
+		return -1;
+	if (flen && (frag[0] != c || frag[flen - 1] != c))
+		return -1;
+
+	return 0;
+}
+
+static void release(struct held *h)
+{
+	free(h->head);
+	if (h->page)
+		put_page(h->page);
+	h->head = NULL;
+	h->page = NULL;
+}
+
+static void fake_ap(int use_pool, struct result *res)
+{
+	struct held *held = calloc(hold, sizeof(*held));
+	unsigned long seq = 0;
+	unsigned int h = 0;
+
+	while (seq < packets) {
+		unsigned int in = __atomic_load_n(&ring->wp, __ATOMIC_ACQUIRE);
+		unsigned int out = ring->rp;
+		unsigned int n = usage(in, out), i;
+
+		if (!n) {
+			sched_yield();
+			continue;
+		}
+		if (n > budget)
+			n = budget;
+
+		for (i = 0; i < n; i++, seq++) {
+			unsigned int len = ring->size_v[out];
+			const uint8_t *src = slot(out);
+			struct held *e = &held[h];
+			unsigned int offset;
+			int err;
+
+			release(e);
+
+			if (use_pool && len > SBD_RX_HDR_LEN &&
+			    (e->page = sbd_rx_pool_get(&res->pool,
+						       len - SBD_RX_HDR_LEN,
+						       &offset))) {
+				uint8_t *frag = (uint8_t *)page_address(e->page) +
+						offset;
+
+				e->head = malloc(SBD_RX_HDR_LEN);
+				memcpy(e->head, src, SBD_RX_HDR_LEN);
+				memcpy(frag, src + SBD_RX_HDR_LEN,
+				       len - SBD_RX_HDR_LEN);
+				err = check(e->head, SBD_RX_HDR_LEN, frag,
+					    len - SBD_RX_HDR_LEN, seq);
+			} else {
+				e->head = malloc(len);
+				memcpy(e->head, src, len);
+				err = check(e->head, len, NULL, 0, seq);
+			}
+			if (err)
+				res->errors++;
+
+			h = (h + 1) % hold;
+			out = (out + 1) % qlen;
+
+			if (!use_pool) {
+				__atomic_store_n(&ring->rp, out,
+						 __ATOMIC_RELEASE);
+				res->rp_writes++;
+			}
+		}
+
+		if (use_pool) {
+			__atomic_store_n(&ring->rp, out, __ATOMIC_RELEASE);
+			res->rp_writes++;
+		}
+	}
+
+	for (h = 0; h < hold; h++)
+		release(&held[h]);
+	free(held);
+}
+
+static int run(int use_pool, struct result *res)
+{
+	struct timespec start, end;
+	int status;
+	pid_t pid;
+
+	memset(res, 0, sizeof(*res));
+	ring->rp = ring->wp = 0;
+
+	if (use_pool && sbd_rx_pool_init(&res->pool, pool_pages))
+		return -ENOMEM;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	pid = fork();
+	if (pid < 0)
+		return -errno;
+	if (!pid) {
+		fake_cp();
+		_exit(0);
+	}
+
+	fake_ap(use_pool, res);
+	waitpid(pid, &status, 0);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	res->secs = (end.tv_sec - start.tv_sec) +
+		    (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	return 0;
+}
+
+static void usage_exit(const char *prog, int ret)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -n <packets>  packets sent by the CP (default 1000000)\n"
+		"  -s <bytes>    largest packet, sizes cycle below it (default 1400)\n"
+		"  -q <slots>    ring length (default 512)\n"
+		"  -b <frames>   NAPI budget (default 64)\n"
+		"  -H <packets>  packets held by the stack (default 256)\n"
+		"  -p <pages>    DL page pool size (default 256)\n",
+		prog);
+	exit(ret);
+}
+
+int main(int argc, char **argv)
+{
+	static const char * const names[] = { "copy", "pool" };
+	struct result res;
+	size_t shm_size;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "n:s:q:b:H:p:h")) != -1) {
+		switch (opt) {
+		case 'n':
+			packets = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			size = strtoul(optarg, NULL, 0);
+			break;
+		case 'q':
+			qlen = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			budget = strtoul(optarg, NULL, 0);
+			break;
+		case 'H':
+			hold = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			pool_pages = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage_exit(argv[0], opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if (qlen < 2 || qlen > 65535 || !budget || !hold || !pool_pages ||
+	    size < 6 * 64 + sizeof(unsigned long) || size > BUFF_SIZE)
+		usage_exit(argv[0], 1);
+
+	shm_size = sizeof(*ring) + qlen * sizeof(ring->size_v[0]);
+	shm_size = ALIGN(shm_size, SMP_CACHE_BYTES);
+	ring = mmap(NULL, shm_size + (size_t)qlen * BUFF_SIZE,
+		    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (ring == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	buffs = (uint8_t *)ring + shm_size;
+
+	printf("%lu packets of up to %u bytes, ring %u, budget %u\n", packets,
+	       size, qlen, budget);
+	printf("%-6s %9s %9s %10s %7s %9s %9s %7s\n", "path", "secs", "kpps",
+	       "rp_writes", "errors", "recycled", "allocated", "busy");
+
+	for (i = 0; i < 2; i++) {
+		if (run(i, &res)) {
+			fprintf(stderr, "%s: setup failed\n", names[i]);
+			return 1;
+		}
+		printf("%-6s %9.3f %9.0f %10lu %7lu %9lu %9lu %7lu\n", names[i],
+		       res.secs, packets / res.secs / 1000, res.rp_writes,
+		       res.errors, res.pool.recycled, res.pool.allocated,
+		       res.pool.busy);
+		if (i)
+			sbd_rx_pool_destroy(&res.pool);
+	}
+
+	return 0;
+}
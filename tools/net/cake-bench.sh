@@ -0,0 +1,174 @@
+#!/bin/bash
+# cake-bench: compare sch_cake with an htb + fq_codel stack on an emulated
+# tethering uplink.
+#
+# Three network namespaces are joined by veth pairs:
+#
+#   cb-cli (hotspot clients) -- cb-rtr (phone) -- cb-srv (internet)
+#
+# The uplink is the egress of cb-rtr towards cb-srv, where the qdisc under
+# test shapes to the given rate. netem on the way back adds the path RTT.
+# Two client hosts share the uplink, one with a single bulk flow and one
+# with many, while a third address pings the server. For each qdisc the
+# script prints the goodput of each host and the ping RTT under load: with
+# per host fairness both hosts get about half, and the RTT stays near the
+# netem delay.
+#
+# Needs root, iperf3, and an iproute2 that knows the cake qdisc.
+
+RATE=10mbit
+RTT=40ms
+FLOWS=8
+DURATION=20
+NAT=0
+ACK_FILTER=0
+
+NS_CLI=cb-cli
+NS_RTR=cb-rtr
+NS_SRV=cb-srv
+SRV=10.9.2.2
+
+usage_exit()
+{
+	cat >&2 <<EOF
+usage: $0 [options]
+  -r <rate>   uplink rate, tc syntax (default $RATE)
+  -d <delay>  path RTT added by netem (default $RTT)
+  -p <flows>  bulk flows of the busy host (default $FLOWS)
+  -t <secs>   duration of each run (default $DURATION)
+  -n          masquerade on the uplink, and use cake's nat mode
+  -a          enable cake's ACK filter
+EOF
+	exit "$1"
+}
+
+while getopts "r:d:p:t:nah" opt; do
+	case $opt in
+	r) RATE=$OPTARG ;;
+	d) RTT=$OPTARG ;;
+	p) FLOWS=$OPTARG ;;
+	t) DURATION=$OPTARG ;;
+	n) NAT=1 ;;
+	a) ACK_FILTER=1 ;;
+	h) usage_exit 0 ;;
+	*) usage_exit 1 ;;
+	esac
+done
+
+# ping runs from 2s after the start to 2s before the end
+[ "$DURATION" -ge 5 ] 2>/dev/null || usage_exit 1
+
+for tool in ip tc iperf3 ping; do
+	if ! command -v $tool >/dev/null; then
+		echo "$tool not found" >&2
+		exit 1
+	fi
+done
+
+cleanup()
+{
+	ip netns del $NS_CLI 2>/dev/null
+	ip netns del $NS_RTR 2>/dev/null
+	ip netns del $NS_SRV 2>/dev/null
+}
+trap cleanup EXIT
+
+setup()
+{
+	cleanup
+	ip netns add $NS_CLI || exit 1
+	ip netns add $NS_RTR
+	ip netns add $NS_SRV
+
+	ip link add c0 netns $NS_CLI type veth peer name r0 netns $NS_RTR
+	ip link add r1 netns $NS_RTR type veth peer name s0 netns $NS_SRV
+
+	# .2 is the single flow host, .3 the busy one, .4 pings
+	ip -n $NS_CLI addr add 10.9.1.2/24 dev c0
+	ip -n $NS_CLI addr add 10.9.1.3/24 dev c0
+	ip -n $NS_CLI addr add 10.9.1.4/24 dev c0
+	ip -n $NS_CLI link set c0 up
+	ip -n $NS_CLI link set lo up
+	ip -n $NS_CLI route add default via 10.9.1.1
+
+	ip -n $NS_RTR addr add 10.9.1.1/24 dev r0
+	ip -n $NS_RTR addr add 10.9.2.1/24 dev r1
+	ip -n $NS_RTR link set r0 up
+	ip -n $NS_RTR link set r1 up
+	ip netns exec $NS_RTR sysctl -q -w net.ipv4.ip_forward=1
+
+	ip -n $NS_SRV addr add $SRV/24 dev s0
+	ip -n $NS_SRV link set s0 up
+	ip -n $NS_SRV link set lo up
+	ip -n $NS_SRV route add default via 10.9.2.1
+
+	if [ $NAT = 1 ]; then
+		ip netns exec $NS_RTR iptables -t nat -A POSTROUTING \
+			-o r1 -j MASQUERADE || exit 1
+	fi
+
+	# the whole RTT on the return path, out of the way of the uplink
+	tc -n $NS_SRV qdisc add dev s0 root netem delay $RTT limit 100000
+
+	ip netns exec $NS_SRV iperf3 -s -D -p 5201
+	ip netns exec $NS_SRV iperf3 -s -D -p 5202
+	sleep 1
+}
+
+qdisc_htb()
+{
+	tc -n $NS_RTR qdisc add dev r1 root handle 1: htb default 1
+	tc -n $NS_RTR class add dev r1 parent 1: classid 1:1 htb rate $RATE
+	tc -n $NS_RTR qdisc add dev r1 parent 1:1 fq_codel
+}
+
+qdisc_cake()
+{
+	local opts="bandwidth $RATE triple-isolate"
+
+	[ $NAT = 1 ] && opts="$opts nat"
+	[ $ACK_FILTER = 1 ] && opts="$opts ack-filter"
+	tc -n $NS_RTR qdisc add dev r1 root cake $opts
+}
+
+# Mbit/s sent, from the last sender line of an iperf3 report
+goodput()
+{
+	grep sender "$1" | tail -1 | awk '{ print $(NF - 3) }'
+}
+
+run()
+{
+	local name=$1 tmp
+
+	tc -n $NS_RTR qdisc del dev r1 root 2>/dev/null
+	if ! qdisc_$name; then
+		echo "$name: cannot set up the qdisc" >&2
+		return 1
+	fi
+
+	tmp=$(mktemp -d)
+	ip netns exec $NS_CLI iperf3 -c $SRV -p 5201 -B 10.9.1.2 -f m \
+		-t $DURATION > $tmp/single &
+	ip netns exec $NS_CLI iperf3 -c $SRV -p 5202 -B 10.9.1.3 -f m \
+		-t $DURATION -P $FLOWS > $tmp/busy &
+	sleep 2
+	ip netns exec $NS_CLI ping -q -I 10.9.1.4 -i 0.2 \
+		-c $(( (DURATION - 4) * 5 )) $SRV > $tmp/ping
+	wait
+
+	printf "%-12s single %6s Mbit/s  busy (%d flows) %6s Mbit/s  ping %s ms\n" \
+		$name "$(goodput $tmp/single)" $FLOWS "$(goodput $tmp/busy)" \
+		"$(awk -F'[/ ]+' '/^rtt/ { print $7 "/" $8 "/" $9 }' $tmp/ping)"
+	rm -rf $tmp
+
+	if [ $name = cake ]; then
+		tc -n $NS_RTR -s qdisc show dev r1
+	fi
+}
+
+setup
+echo "uplink $RATE, rtt $RTT, $FLOWS + 1 flows, ${DURATION}s," \
+     "ping min/avg/max"
+run htb
+run cake
@@ -0,0 +1,366 @@
+/*
+ * mali-dvfs-replay: replay recorded Mali utilization and frame traces
+ * through the exynos GPU DVFS governors without a GPU.
+ *
+ * The frame governor is the in-kernel decision core
+ * (drivers/gpu/arm/b_r26p0/platform/exynos/gpu_dvfs_frame_gov.c) built as
+ * is. The default and interactive governors are models of the ones in
+ * gpu_dvfs_governor.c operating on the same table.
+ *
+ * Trace format, one record per line, '#' starts a comment:
+ *
+ *   level <clock_khz> <voltage_uv> <min_threshold> <max_threshold> <down_staycount>
+ *   sample <window_us> <utilization> <frames> <clock_khz>
+ *
+ * Levels are listed from the highest clock down, as in the DT dvfs table.
+ * A sample is one DVFS polling window as recorded on a device, e.g. by
+ * reading /sys/devices/.../utilization, clock and the frames_total line of
+ * frame_governor every polling_speed ms.
+ *
+ * Each sample is turned into an amount of GPU work (busy time times clock)
+ * that every governor then has to run at the clock it picked. Frames whose
+ * share of the work does not fit in the window are counted as missed.
+ * Energy is reported as sum(V^2 * f * busy_time) in arbitrary units.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "gpu_dvfs_frame_gov.h"
+
+#define MAX_SAMPLES	(1 << 20)
+
+struct level {
+	unsigned int clock;
+	unsigned int voltage;
+	int min_threshold;
+	int max_threshold;
+	int down_staycount;
+};
+
+static struct level table[GPU_FRAME_GOV_MAX_LEVELS];
+static int nr_levels;
+static struct gpu_frame_gov_sample *samples;
+static int nr_samples;
+
+static unsigned int highspeed_clock;
+static int highspeed_load = 100;
+static int highspeed_delay;
+
+struct governor;
+
+struct result {
+	double energy;
+	double busy_s;
+	unsigned long long frames;
+	unsigned long long missed;
+	unsigned long long changes;
+};
+
+struct governor {
+	const char *name;
+	void (*reset)(struct governor *gov, int step);
+	int (*next)(struct governor *gov, const struct gpu_frame_gov_sample *s,
+		    int step);
+	int down_requirement;
+	int delay_count;
+	struct gpu_frame_gov frame;
+};
+
+static int level_of(unsigned int clock)
+{
+	int i;
+
+	for (i = 0; i < nr_levels; i++)
+		if (table[i].clock <= clock)
+			return i;
+
+	return nr_levels - 1;
+}
+
+/* gpu_dvfs_governor_default() */
+static void default_reset(struct governor *gov, int step)
+{
+	gov->down_requirement = 1;
+}
+
+static int default_next(struct governor *gov,
+			const struct gpu_frame_gov_sample *s, int step)
+{
+	int util = s->utilization;
+
+	if (step > 0 && util > table[step].max_threshold) {
+		step--;
+		gov->down_requirement = table[step].down_staycount;
+	} else if (step < nr_levels - 1 && util < table[step].min_threshold) {
+		if (--gov->down_requirement <= 0) {
+			step++;
+			gov->down_requirement = table[step].down_staycount;
+		}
+	} else {
+		gov->down_requirement = table[step].down_staycount;
+	}
+
+	return step;
+}
+
+/* gpu_dvfs_governor_interactive() */
+static void interactive_reset(struct governor *gov, int step)
+{
+	gov->down_requirement = 1;
+	gov->delay_count = 0;
+}
+
+static int interactive_next(struct governor *gov,
+			    const struct gpu_frame_gov_sample *s, int step)
+{
+	int util = s->utilization;
+	int highspeed_level = highspeed_clock ? level_of(highspeed_clock) : 0;
+
+	if (step > 0 && (util > table[step].max_threshold ||
+			 util > highspeed_load)) {
+		if (highspeed_level > 0 && step > highspeed_level &&
+		    util > highspeed_load) {
+			if (gov->delay_count == highspeed_delay) {
+				step = highspeed_level;
+				gov->delay_count = 0;
+			} else {
+				gov->delay_count++;
+			}
+		} else if (util > table[step].max_threshold) {
+			step--;
+			gov->delay_count = 0;
+		}
+		if (step == highspeed_level && table[step].down_staycount < 3)
+			gov->down_requirement = 3;
+		else
+			gov->down_requirement = table[step].down_staycount;
+	} else if (step < nr_levels - 1 && util < table[step].min_threshold) {
+		gov->delay_count = 0;
+		if (--gov->down_requirement <= 0) {
+			step++;
+			gov->down_requirement = table[step].down_staycount;
+		}
+	} else {
+		gov->delay_count = 0;
+		gov->down_requirement = table[step].down_staycount;
+	}
+
+	return step;
+}
+
+static unsigned int target_frame_us;
+static unsigned int headroom = GPU_FRAME_GOV_DEFAULT_HEADROOM;
+
+static void frame_reset(struct governor *gov, int step)
+{
+	unsigned int clock[GPU_FRAME_GOV_MAX_LEVELS];
+	int i;
+
+	for (i = 0; i < nr_levels; i++)
+		clock[i] = table[i].clock;
+
+	gpu_frame_gov_init(&gov->frame);
+	gpu_frame_gov_set_table(&gov->frame, clock, nr_levels);
+	gov->frame.target_frame_us = target_frame_us;
+	gov->frame.headroom = headroom;
+}
+
+static int frame_next(struct governor *gov,
+		      const struct gpu_frame_gov_sample *s, int step)
+{
+	int mif_step;
+
+	return gpu_frame_gov_next_step(&gov->frame, s, step, 0, nr_levels - 1,
+				       &mif_step);
+}
+
+static struct governor governors[] = {
+	{ .name = "Default", .reset = default_reset, .next = default_next },
+	{ .name = "Interactive", .reset = interactive_reset,
+	  .next = interactive_next },
+	{ .name = "Frame", .reset = frame_reset, .next = frame_next },
+};
+
+static void replay(struct governor *gov, int start_step, struct result *res)
+{
+	int step = start_step;
+	int i;
+
+	memset(res, 0, sizeof(*res));
+	gov->reset(gov, step);
+
+	for (i = 0; i < nr_samples; i++) {
+		const struct gpu_frame_gov_sample *rec = &samples[i];
+		struct gpu_frame_gov_sample sim = *rec;
+		double demand, capacity, busy, volt;
+		unsigned int done;
+		int next;
+
+		/* work of the recorded window in kHz*us */
+		demand = (double)rec->utilization * rec->window_us *
+			 rec->clock / 100.0;
+		capacity = (double)table[step].clock * rec->window_us;
+
+		done = rec->frames;
+		if (demand > capacity) {
+			done = (unsigned int)(rec->frames * capacity / demand);
+			busy = rec->window_us;
+		} else {
+			busy = capacity > 0 ? rec->window_us * demand / capacity : 0;
+		}
+
+		sim.clock = table[step].clock;
+		sim.utilization = (unsigned int)(busy * 100 / rec->window_us);
+		sim.frames = done;
+
+		volt = table[step].voltage / 1000000.0;
+		res->energy += volt * volt * (table[step].clock / 1000.0) *
+			       (busy / 1000000.0);
+		res->busy_s += busy / 1000000.0;
+		res->frames += rec->frames;
+		res->missed += rec->frames - done;
+
+		next = gov->next(gov, &sim, step);
+		if (next != step)
+			res->changes++;
+		step = next;
+	}
+}
+
+static int parse_trace(FILE *fp)
+{
+	char line[256];
+	int lineno = 0;
+
+	while (fgets(line, sizeof(line), fp)) {
+		struct gpu_frame_gov_sample s;
+		struct level l;
+		char *p = line;
+
+		lineno++;
+		while (*p == ' ' || *p == '\t')
+			p++;
+		if (*p == '#' || *p == '\n' || *p == '\0')
+			continue;
+
+		if (sscanf(p, "level %u %u %d %d %d", &l.clock, &l.voltage,
+			   &l.min_threshold, &l.max_threshold,
+			   &l.down_staycount) == 5) {
+			if (nr_levels == GPU_FRAME_GOV_MAX_LEVELS) {
+				fprintf(stderr, "%d: too many levels\n", lineno);
+				return -EINVAL;
+			}
+			table[nr_levels++] = l;
+		} else if (sscanf(p, "sample %u %u %u %u", &s.window_us,
+				  &s.utilization, &s.frames, &s.clock) == 4) {
+			if (nr_samples == MAX_SAMPLES) {
+				fprintf(stderr, "%d: too many samples\n", lineno);
+				return -EINVAL;
+			}
+			if (!s.window_us)
+				continue;
+			if (s.utilization > 100)
+				s.utilization = 100;
+			samples[nr_samples++] = s;
+		} else {
+			fprintf(stderr, "%d: malformed record\n", lineno);
+			return -EINVAL;
+		}
+	}
+
+	if (!nr_levels || !nr_samples) {
+		fprintf(stderr, "trace needs at least one level and one sample\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options] <trace>\n"
+		"  -t <us>   frame governor target frame time (0: follow trace)\n"
+		"  -r <%%>    frame governor headroom (default %d)\n"
+		"  -H <khz>  interactive highspeed_clock\n"
+		"  -L <%%>    interactive highspeed_load (default 100)\n"
+		"  -D <n>    interactive highspeed_delay (default 0)\n",
+		prog, GPU_FRAME_GOV_DEFAULT_HEADROOM);
+}
+
+int main(int argc, char **argv)
+{
+	struct result base, res;
+	FILE *fp;
+	int opt, i, ret;
+
+	while ((opt = getopt(argc, argv, "t:r:H:L:D:h")) != -1) {
+		switch (opt) {
+		case 't':
+			target_frame_us = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			headroom = strtoul(optarg, NULL, 0);
+			break;
+		case 'H':
+			highspeed_clock = strtoul(optarg, NULL, 0);
+			break;
+		case 'L':
+			highspeed_load = strtol(optarg, NULL, 0);
+			break;
+		case 'D':
+			highspeed_delay = strtol(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (optind != argc - 1 || !headroom || headroom > 100) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	fp = fopen(argv[optind], "r");
+	if (!fp) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	samples = calloc(MAX_SAMPLES, sizeof(*samples));
+	if (!samples) {
+		fclose(fp);
+		return 1;
+	}
+
+	ret = parse_trace(fp);
+	fclose(fp);
+	if (ret)
+		return 1;
+
+	printf("%-12s %12s %10s %10s %10s %8s %8s\n", "governor", "energy",
+	       "rel", "busy_s", "frames", "missed", "changes");
+
+	for (i = 0; i < (int)(sizeof(governors) / sizeof(governors[0])); i++) {
+		replay(&governors[i], level_of(samples[0].clock), &res);
+		if (!i)
+			base = res;
+		printf("%-12s %12.3f %9.1f%% %10.3f %10llu %8llu %8llu\n",
+		       governors[i].name, res.energy,
+		       base.energy > 0 ? 100.0 * res.energy / base.energy : 0,
+		       res.busy_s, res.frames, res.missed, res.changes);
+	}
+
+	free(samples);
+
+	return 0;
+}
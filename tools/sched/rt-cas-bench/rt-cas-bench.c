@@ -0,0 +1,314 @@
+/*
+ * rt-cas-bench: periodic RT load in the style of rt-app, to compare RT task
+ * placement with and without CONFIG_SCHED_RT_CAS.
+ *
+ * Each thread is SCHED_FIFO and wakes up every period on an absolute timer,
+ * then spins for its run time, like an audio or display pipeline stage.
+ * The threads run with staggered run times so that some fit the little
+ * CPUs and some do not. For every wakeup the tool records:
+ *
+ *   latency  time from the timer expiry to the thread running;
+ *   cpu      CPU the thread ran on, grouped by cpu_capacity.
+ *
+ * Energy is read from a cumulative counter in microjoules when one is given
+ * with -e (e.g. an ODPM or fuel gauge energy file). Without one, the
+ * busy time weighted by CPU capacity is printed as a rough proxy.
+ *
+ * With -f the run is done twice, with the RT_CAS scheduler feature off then
+ * on, through /sys/kernel/debug/sched_features.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_CPUS	64
+#define NSEC_PER_SEC	1000000000LL
+#define NSEC_PER_USEC	1000LL
+
+#define SCHED_FEATURES	"/sys/kernel/debug/sched_features"
+
+static unsigned int nr_threads = 4;
+static unsigned int period_us = 16667;
+static unsigned int run_us = 4000;
+static unsigned int duration = 10;
+static int prio = 50;
+static const char *energy_file;
+
+static unsigned int capacity[MAX_CPUS];
+static int nr_cpus;
+
+struct thread {
+	pthread_t tid;
+	unsigned int run_us;
+	unsigned long nr;
+	uint64_t *lat;
+	unsigned long cpu_wakeups[MAX_CPUS];
+	uint64_t cpu_busy_ns[MAX_CPUS];
+};
+
+static inline uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void read_capacities(void)
+{
+	char path[128];
+	FILE *f;
+	int cpu;
+
+	nr_cpus = sysconf(_SC_NPROCESSORS_CONF);
+	if (nr_cpus > MAX_CPUS)
+		nr_cpus = MAX_CPUS;
+
+	for (cpu = 0; cpu < nr_cpus; cpu++) {
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu%d/cpu_capacity", cpu);
+		capacity[cpu] = 1024;
+		f = fopen(path, "r");
+		if (!f)
+			continue;
+		if (fscanf(f, "%u", &capacity[cpu]) != 1)
+			capacity[cpu] = 1024;
+		fclose(f);
+	}
+}
+
+static int read_energy(unsigned long long *uj)
+{
+	FILE *f;
+	int ret;
+
+	if (!energy_file)
+		return -1;
+	f = fopen(energy_file, "r");
+	if (!f)
+		return -1;
+	ret = fscanf(f, "%llu", uj) == 1 ? 0 : -1;
+	fclose(f);
+	return ret;
+}
+
+static int set_feature(const char *feat)
+{
+	FILE *f = fopen(SCHED_FEATURES, "w");
+	int ret;
+
+	if (!f)
+		return -1;
+	ret = fputs(feat, f) < 0 ? -1 : 0;
+	if (fclose(f))
+		ret = -1;
+	return ret;
+}
+
+static void *periodic(void *arg)
+{
+	struct thread *t = arg;
+	unsigned long loops = (unsigned long long)duration * 1000000 / period_us;
+	struct sched_param param = { .sched_priority = prio };
+	struct timespec next;
+	uint64_t wake, start, end;
+
+	if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param))
+		fprintf(stderr, "SCHED_FIFO: %s\n", strerror(errno));
+
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	for (t->nr = 0; t->nr < loops; t->nr++) {
+		int cpu;
+
+		next.tv_nsec += period_us * NSEC_PER_USEC;
+		while (next.tv_nsec >= NSEC_PER_SEC) {
+			next.tv_nsec -= NSEC_PER_SEC;
+			next.tv_sec++;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+		start = now_ns();
+		wake = next.tv_sec * NSEC_PER_SEC + next.tv_nsec;
+		t->lat[t->nr] = start > wake ? start - wake : 0;
+
+		cpu = sched_getcpu();
+		if (cpu < 0 || cpu >= MAX_CPUS)
+			cpu = 0;
+		t->cpu_wakeups[cpu]++;
+
+		do
+			end = now_ns();
+		while (end - start < t->run_us * NSEC_PER_USEC);
+		t->cpu_busy_ns[cpu] += end - start;
+	}
+
+	return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int run(const char *name)
+{
+	unsigned long loops = (unsigned long long)duration * 1000000 / period_us;
+	unsigned long long e0 = 0, e1 = 0;
+	unsigned long wakeups[MAX_CPUS] = { 0 };
+	uint64_t busy[MAX_CPUS] = { 0 };
+	uint64_t *all, sum = 0;
+	struct thread *threads;
+	unsigned long n = 0, i;
+	double proxy = 0;
+	int have_energy;
+	unsigned int j;
+	int cpu;
+
+	threads = calloc(nr_threads, sizeof(*threads));
+	all = calloc(loops * nr_threads, sizeof(*all));
+	if (!threads || !all)
+		return -ENOMEM;
+
+	have_energy = !read_energy(&e0);
+
+	for (j = 0; j < nr_threads; j++) {
+		struct thread *t = &threads[j];
+
+		/* From a quarter of run_us up to run_us */
+		t->run_us = run_us / 4 + (run_us - run_us / 4) * j /
+			    (nr_threads > 1 ? nr_threads - 1 : 1);
+		t->lat = all + loops * j;
+		if (pthread_create(&t->tid, NULL, periodic, t))
+			return -errno;
+	}
+
+	for (j = 0; j < nr_threads; j++) {
+		struct thread *t = &threads[j];
+
+		pthread_join(t->tid, NULL);
+		memmove(all + n, t->lat, t->nr * sizeof(*all));
+		n += t->nr;
+		for (cpu = 0; cpu < nr_cpus; cpu++) {
+			wakeups[cpu] += t->cpu_wakeups[cpu];
+			busy[cpu] += t->cpu_busy_ns[cpu];
+		}
+	}
+
+	have_energy = have_energy && !read_energy(&e1);
+
+	if (!n) {
+		fprintf(stderr, "%s: no wakeups\n", name);
+		return -EINVAL;
+	}
+
+	qsort(all, n, sizeof(*all), cmp_u64);
+	for (i = 0; i < n; i++)
+		sum += all[i];
+
+	printf("%s: %lu wakeups, latency us min %.1f avg %.1f p99 %.1f max %.1f\n",
+	       name, n, all[0] / 1e3, sum / 1e3 / n, all[n * 99 / 100] / 1e3,
+	       all[n - 1] / 1e3);
+
+	for (cpu = 0; cpu < nr_cpus; cpu++) {
+		if (!wakeups[cpu])
+			continue;
+		printf("  cpu%-3d capacity %4u wakeups %7lu busy %8.1f ms\n",
+		       cpu, capacity[cpu], wakeups[cpu], busy[cpu] / 1e6);
+		proxy += busy[cpu] / 1e6 * capacity[cpu] / 1024;
+	}
+
+	if (have_energy)
+		printf("  energy %.3f J\n", (e1 - e0) / 1e6);
+	else
+		printf("  capacity weighted busy time %.1f ms\n", proxy);
+
+	free(all);
+	free(threads);
+	return 0;
+}
+
+static void usage_exit(const char *prog, int ret)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -t <threads>  periodic threads (default 4)\n"
+		"  -p <us>       period (default 16667)\n"
+		"  -r <us>       run time of the longest thread (default 4000)\n"
+		"  -d <secs>     duration (default 10)\n"
+		"  -P <prio>     SCHED_FIFO priority (default 50)\n"
+		"  -e <file>     cumulative energy counter, in uJ\n"
+		"  -f            run with RT_CAS off, then on\n",
+		prog);
+	exit(ret);
+}
+
+int main(int argc, char **argv)
+{
+	int feature = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:p:r:d:P:e:fh")) != -1) {
+		switch (opt) {
+		case 't':
+			nr_threads = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			period_us = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			run_us = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			duration = strtoul(optarg, NULL, 0);
+			break;
+		case 'P':
+			prio = strtol(optarg, NULL, 0);
+			break;
+		case 'e':
+			energy_file = optarg;
+			break;
+		case 'f':
+			feature = 1;
+			break;
+		default:
+			usage_exit(argv[0], opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if (!nr_threads || !period_us || !run_us || run_us >= period_us ||
+	    !duration || prio < 1 || prio > 99)
+		usage_exit(argv[0], 1);
+
+	read_capacities();
+	printf("%u threads, period %u us, run %u..%u us, %u s\n", nr_threads,
+	       period_us, run_us / 4, run_us, duration);
+
+	if (!feature)
+		return run("current") ? 1 : 0;
+
+	if (set_feature("NO_RT_CAS")) {
+		fprintf(stderr, "%s: %s, no CONFIG_SCHED_RT_CAS?\n",
+			SCHED_FEATURES, strerror(errno));
+		return 1;
+	}
+	if (run("NO_RT_CAS"))
+		return 1;
+
+	set_feature("RT_CAS");
+	return run("RT_CAS") ? 1 : 0;
+}
@@ -0,0 +1,196 @@
+/*
+ * task-pmu-stat: check the per-task counter feed of CONFIG_SCHED_TASK_PMU.
+ *
+ * Runs a compute bound thread, which spins on registers, next to a memory
+ * bound thread, which chases pointers through a buffer larger than the
+ * caches, then prints the pmu.* fields of /proc/<pid>/task/<tid>/sched of
+ * both and the CPU each of them was last seen on:
+ *
+ *   ipc   decayed instructions per cycle
+ *   mpki  decayed cache refills per 1000 instructions
+ *
+ * On hardware the compute thread should show a high IPC and a MPKI near
+ * zero, and the memory thread the opposite, so HMP keeps the latter off the
+ * big cores. Under QEMU without a PMU the kernel counts cpu-clock
+ * nanoseconds and page faults instead: the averages stay at zero but the
+ * totals still grow, which checks the context switch path.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+static unsigned int duration = 5;
+static size_t buf_mb = 64;
+
+static volatile int stop;
+
+struct thread {
+	const char *name;
+	void *(*fn)(void *);
+	pthread_t tid;
+	pid_t pid;
+	int cpu;
+	unsigned long loops;
+};
+
+static void *compute(void *arg)
+{
+	struct thread *t = arg;
+	uint64_t a = 1, b = 2;
+
+	t->pid = syscall(__NR_gettid);
+	while (!stop) {
+		int i;
+
+		for (i = 0; i < 100000; i++) {
+			a = a * 6364136223846793005ULL + b;
+			b ^= a >> 17;
+		}
+		t->loops++;
+		t->cpu = sched_getcpu();
+	}
+	return (void *)(uintptr_t)(a ^ b);
+}
+
+static void *memory(void *arg)
+{
+	struct thread *t = arg;
+	size_t n = buf_mb * 1024 * 1024 / sizeof(void *), i;
+	void **buf = malloc(n * sizeof(void *));
+	size_t *order = malloc(n * sizeof(size_t));
+	void **p;
+
+	t->pid = syscall(__NR_gettid);
+	if (!buf || !order) {
+		fprintf(stderr, "%s: %s\n", t->name, strerror(ENOMEM));
+		exit(1);
+	}
+
+	/* One random cycle through the whole buffer */
+	for (i = 0; i < n; i++)
+		order[i] = i;
+	for (i = n - 1; i > 0; i--) {
+		size_t j = random() % (i + 1), tmp = order[i];
+
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+	for (i = 0; i < n; i++)
+		buf[order[i]] = &buf[order[(i + 1) % n]];
+	free(order);
+
+	p = buf;
+	while (!stop) {
+		for (i = 0; i < 100000; i++)
+			p = *p;
+		t->loops++;
+		t->cpu = sched_getcpu();
+	}
+	return p;
+}
+
+static int print_stats(struct thread *t)
+{
+	char path[64], line[256];
+	unsigned long long cycles = 0, instr = 0, refills = 0, samples = 0;
+	unsigned long long ipc = 0, mpki = 0;
+	int found = 0;
+	FILE *f;
+
+	snprintf(path, sizeof(path), "/proc/%d/task/%d/sched", getpid(), t->pid);
+	f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		found += sscanf(line, " pmu.cycles : %llu", &cycles);
+		found += sscanf(line, " pmu.instructions : %llu", &instr);
+		found += sscanf(line, " pmu.refills : %llu", &refills);
+		found += sscanf(line, " pmu.nr_samples : %llu", &samples);
+		found += sscanf(line, " pmu.ipc_avg : %llu", &ipc);
+		found += sscanf(line, " pmu.mpki_avg : %llu", &mpki);
+	}
+	fclose(f);
+
+	if (!found) {
+		fprintf(stderr, "%s: no pmu fields, no CONFIG_SCHED_TASK_PMU?\n",
+			path);
+		return -1;
+	}
+
+	printf("%-8s cpu%-3d loops %9lu cycles %14llu instr %14llu refills %11llu samples %7llu ipc %5.2f mpki %7.2f\n",
+	       t->name, t->cpu, t->loops, cycles, instr, refills, samples,
+	       ipc / 1024.0, mpki / 1024.0);
+	return 0;
+}
+
+static void usage_exit(const char *prog, int ret)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -d <secs>     duration (default 5)\n"
+		"  -m <MiB>      buffer of the memory thread (default 64)\n",
+		prog);
+	exit(ret);
+}
+
+int main(int argc, char **argv)
+{
+	struct thread threads[] = {
+		{ .name = "compute", .fn = compute },
+		{ .name = "memory", .fn = memory },
+	};
+	unsigned int i;
+	int opt, ret = 0;
+
+	while ((opt = getopt(argc, argv, "d:m:h")) != -1) {
+		switch (opt) {
+		case 'd':
+			duration = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			buf_mb = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage_exit(argv[0], opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if (!duration || !buf_mb)
+		usage_exit(argv[0], 1);
+
+	for (i = 0; i < 2; i++) {
+		if (pthread_create(&threads[i].tid, NULL, threads[i].fn,
+				   &threads[i])) {
+			perror("pthread_create");
+			return 1;
+		}
+	}
+
+	sleep(duration);
+
+	/* Read the stats while the threads are still alive */
+	for (i = 0; i < 2; i++)
+		ret |= print_stats(&threads[i]);
+
+	stop = 1;
+	for (i = 0; i < 2; i++)
+		pthread_join(threads[i].tid, NULL);
+
+	return ret ? 1 : 0;
+}
@@ -0,0 +1,202 @@
+/*
+ * uclamp-bench: measure the cost of utilization clamping on the scheduler
+ * hot path.
+ *
+ * Two threads bounce a byte over a pair of pipes, so every round trip is
+ * two wakeups, each an enqueue and a dequeue on a runqueue. The bounce is
+ * timed three times:
+ *
+ *   off      before any clamp is set, clamping is compiled in but its
+ *            static key is still off;
+ *   default  after a thread has set and reset its clamps, the key is on
+ *            and the tasks carry the default 0..1024 range;
+ *   clamped  both threads run with the -m/-M clamps.
+ *
+ * The first run is only meaningful on a freshly booted system where no
+ * task or schedtune group has used clamps yet. Pin the threads with -c to
+ * keep migrations out of the numbers.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#ifndef SCHED_FLAG_UTIL_CLAMP_MIN
+#define SCHED_FLAG_UTIL_CLAMP_MIN	0x20
+#define SCHED_FLAG_UTIL_CLAMP_MAX	0x40
+#endif
+#define SCHED_FLAG_UTIL_CLAMP	(SCHED_FLAG_UTIL_CLAMP_MIN | \
+				 SCHED_FLAG_UTIL_CLAMP_MAX)
+
+/* include/linux/sched.h, SCHED_ATTR_SIZE_VER1 */
+struct sched_attr_v1 {
+	uint32_t size;
+	uint32_t sched_policy;
+	uint64_t sched_flags;
+	int32_t sched_nice;
+	uint32_t sched_priority;
+	uint64_t sched_runtime;
+	uint64_t sched_deadline;
+	uint64_t sched_period;
+	uint32_t sched_util_min;
+	uint32_t sched_util_max;
+};
+
+static unsigned long loops = 200000;
+static unsigned int util_min = 512;
+static unsigned int util_max = 1024;
+static int cpu = -1;
+
+static int ping[2], pong[2];
+static unsigned int clamp_min, clamp_max;
+
+static int set_clamps(unsigned int min, unsigned int max)
+{
+	struct sched_attr_v1 attr = {
+		.size		= sizeof(attr),
+		.sched_policy	= SCHED_OTHER,
+		.sched_flags	= SCHED_FLAG_UTIL_CLAMP,
+		.sched_util_min	= min,
+		.sched_util_max	= max,
+	};
+
+	return syscall(__NR_sched_setattr, 0, &attr, 0);
+}
+
+static void pin(void)
+{
+	cpu_set_t set;
+
+	if (cpu < 0)
+		return;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	sched_setaffinity(0, sizeof(set), &set);
+}
+
+static void *ponger(void *arg)
+{
+	unsigned long i;
+	char c;
+
+	pin();
+	if (clamp_min || clamp_max != 1024)
+		set_clamps(clamp_min, clamp_max);
+
+	for (i = 0; i < loops; i++) {
+		if (read(ping[0], &c, 1) != 1 || write(pong[1], &c, 1) != 1)
+			break;
+	}
+
+	return NULL;
+}
+
+static double bounce(unsigned int min, unsigned int max)
+{
+	struct timespec start, end;
+	pthread_t thread;
+	unsigned long i;
+	char c = 0;
+
+	clamp_min = min;
+	clamp_max = max;
+	if (pthread_create(&thread, NULL, ponger, NULL))
+		return -1;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < loops; i++) {
+		if (write(ping[1], &c, 1) != 1 || read(pong[0], &c, 1) != 1)
+			break;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	pthread_join(thread, NULL);
+
+	return ((end.tv_sec - start.tv_sec) * 1e9 +
+		(end.tv_nsec - start.tv_nsec)) / loops;
+}
+
+static void usage_exit(const char *prog, int ret)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -n <loops>   round trips per run (default 200000)\n"
+		"  -m <util>    util_min of the clamped run (default 512)\n"
+		"  -M <util>    util_max of the clamped run (default 1024)\n"
+		"  -c <cpu>     pin both threads to a CPU\n",
+		prog);
+	exit(ret);
+}
+
+int main(int argc, char **argv)
+{
+	double off, def, clamped;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:m:M:c:h")) != -1) {
+		switch (opt) {
+		case 'n':
+			loops = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			util_min = strtoul(optarg, NULL, 0);
+			break;
+		case 'M':
+			util_max = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			cpu = strtol(optarg, NULL, 0);
+			break;
+		default:
+			usage_exit(argv[0], opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if (!loops || util_min > util_max || util_max > 1024)
+		usage_exit(argv[0], 1);
+
+	if (pipe(ping) || pipe(pong)) {
+		perror("pipe");
+		return 1;
+	}
+	pin();
+
+	off = bounce(0, 1024);
+
+	/* Turns the static key on, then goes back to the defaults */
+	if (set_clamps(0, 1024)) {
+		fprintf(stderr, "sched_setattr: %s, no utilization clamping?\n",
+			strerror(errno));
+		return 1;
+	}
+	def = bounce(0, 1024);
+
+	if (set_clamps(util_min, util_max)) {
+		fprintf(stderr, "sched_setattr: %s\n", strerror(errno));
+		return 1;
+	}
+	clamped = bounce(util_min, util_max);
+
+	printf("%lu round trips%s\n", loops, cpu < 0 ? "" : ", pinned");
+	printf("%-8s %10s %8s\n", "run", "ns/trip", "delta");
+	printf("%-8s %10.0f %8s\n", "off", off, "-");
+	printf("%-8s %10.0f %+7.1f%%\n", "default", def,
+	       (def - off) * 100 / off);
+	printf("%-8s %10.0f %+7.1f%%\n", "clamped", clamped,
+	       (clamped - off) * 100 / off);
+
+	return 0;
+}
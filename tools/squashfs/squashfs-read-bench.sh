@@ -0,0 +1,66 @@
+#!/bin/sh
+#
+# Cold-cache sequential read throughput of squashfs images.
+#
+# Builds one image of <source dir> per compressor with mksquashfs,
+# loop-mounts it, drops the caches and reads every file back once.
+#
+#   squashfs-read-bench.sh [-b block_size] [-c "zstd lz4 ..."] <source dir>
+#
+# Needs root, mksquashfs with the requested compressors, and a kernel with
+# the matching CONFIG_SQUASHFS_* options.  Readahead of several datablocks
+# at once needs CONFIG_SQUASHFS_FILE_DIRECT, and parallel decompression
+# CONFIG_SQUASHFS_DECOMP_MULTI or CONFIG_SQUASHFS_DECOMP_MULTI_PERCPU.
+
+block_size=131072
+comps="gzip lz4 xz zstd"
+
+while getopts "b:c:" opt; do
+	case $opt in
+	b) block_size=$OPTARG ;;
+	c) comps=$OPTARG ;;
+	*) exit 1 ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+src=$1
+if [ -z "$src" ] || [ ! -d "$src" ]; then
+	echo "usage: $0 [-b block_size] [-c compressors] <source dir>" >&2
+	exit 1
+fi
+
+work=$(mktemp -d)
+trap 'umount "$work/mnt" 2>/dev/null; rm -rf "$work"' EXIT
+mkdir "$work/mnt"
+
+printf "%-6s %12s %10s %10s\n" comp image_kB read_kB MB/s
+
+for comp in $comps; do
+	img=$work/$comp.sqfs
+
+	if ! mksquashfs "$src" "$img" -comp "$comp" -b "$block_size" \
+			-noappend -no-progress >/dev/null 2>&1; then
+		echo "$comp: mksquashfs failed" >&2
+		continue
+	fi
+	if ! mount -t squashfs -o loop,ro "$img" "$work/mnt"; then
+		echo "$comp: mount failed" >&2
+		continue
+	fi
+
+	sync
+	echo 3 > /proc/sys/vm/drop_caches
+
+	start=$(date +%s%N)
+	bytes=$(find "$work/mnt" -type f -exec cat {} + | wc -c)
+	end=$(date +%s%N)
+
+	umount "$work/mnt"
+
+	ms=$(( (end - start) / 1000000 ))
+	[ "$ms" -gt 0 ] || ms=1
+	printf "%-6s %12d %10d %10d\n" "$comp" $(( $(stat -c %s "$img") / 1024 )) \
+		$(( bytes / 1024 )) $(( bytes / 1000 / ms ))
+	rm -f "$img"
+done
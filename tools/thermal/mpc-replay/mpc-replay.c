@@ -0,0 +1,404 @@
+/*
+ * mpc-replay: replay temperature and power traces through the thermal
+ * model of the model_predictive governor without a device.
+ *
+ * The model is the in-kernel one (drivers/thermal/mpc_model.c) built as
+ * is. Two kinds of trace are understood, and may be mixed in one file.
+ * One record per line, '#' starts a comment:
+ *
+ *   trip <control_mC>
+ *   sample <time_ms> <temp_mC> <power_mW>
+ *   plant <tau_ms> <mC_per_W> <ambient_mC>
+ *   demand <time_ms> <power_mW>
+ *
+ * Samples are readings taken on a device, e.g. the zone's temp and the
+ * requested power of its cooling devices. They are fed to the model as
+ * the governor would, and every forecast made over the horizon is checked
+ * against the temperature actually recorded at its end.
+ *
+ * Demand records describe the power a workload asks for from that time
+ * on. It is run in closed loop against a first order plant, once under
+ * the model predictive governor and once under a reactive cap that steps
+ * power down by a tenth while the plant is above the trip and back up
+ * while it is below, as step_wise does with a cooling device. Work is
+ * reported as delivered energy against requested energy, and overshoot
+ * as the time spent more than a margin above the trip.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "mpc_model.h"
+
+#define MAX_RECORDS	(1 << 20)
+
+struct sample {
+	unsigned int time_ms;
+	int temp;
+	unsigned int power;
+};
+
+struct demand {
+	unsigned int time_ms;
+	unsigned int power;
+};
+
+static struct sample *samples;
+static int nr_samples;
+static struct demand *demands;
+static int nr_demands;
+
+static int control_temp;
+static unsigned int plant_tau_ms, plant_mC_per_W;
+static int plant_ambient;
+
+static unsigned int horizon_ms = 3000;
+static unsigned int period_ms = MPC_STEP_MS;
+static unsigned int prior_tau_ms = 20000;
+static int prior_ambient = 25000;
+static unsigned int sustainable_power;
+static int margin = 1000;
+static int verbose;
+
+struct result {
+	double requested;
+	double delivered;
+	int max_temp;
+	unsigned int over_ms;
+};
+
+static void init_model(struct mpc_model *model)
+{
+	mpc_model_init(model, prior_tau_ms, prior_ambient, control_temp,
+		       sustainable_power);
+}
+
+/* temperature recorded at @time_ms, interpolated between samples */
+static int temp_at(int from, unsigned int time_ms, int *temp)
+{
+	int i;
+
+	for (i = from; i < nr_samples - 1; i++) {
+		const struct sample *s = &samples[i], *n = &samples[i + 1];
+
+		if (n->time_ms < time_ms)
+			continue;
+		if (n->time_ms == s->time_ms) {
+			*temp = n->temp;
+			return 0;
+		}
+		*temp = s->temp + (long long)(n->temp - s->temp) *
+			(time_ms - s->time_ms) / (n->time_ms - s->time_ms);
+		return 0;
+	}
+
+	return -1;
+}
+
+static void replay_samples(void)
+{
+	struct mpc_model model;
+	unsigned int steps = (horizon_ms + MPC_STEP_MS - 1) / MPC_STEP_MS;
+	unsigned long long forecasts = 0;
+	double abs_err = 0;
+	int max_err = 0;
+	int i, temp;
+
+	init_model(&model);
+
+	for (i = 0; i < nr_samples; i++) {
+		const struct sample *s = &samples[i];
+		int forecast, err;
+
+		mpc_model_add_sample(&model, s->temp, s->power,
+				     i ? s->time_ms - samples[i - 1].time_ms : 0);
+		mpc_model_fit(&model);
+
+		if (temp_at(i, s->time_ms + horizon_ms, &temp))
+			continue;
+
+		forecast = mpc_model_forecast(&model, s->temp, s->power, steps);
+		err = forecast - temp;
+		if (verbose)
+			printf("%10u %8d %8u %8d %8d\n", s->time_ms, s->temp,
+			       s->power, forecast, temp);
+
+		forecasts++;
+		abs_err += err < 0 ? -err : err;
+		if ((err < 0 ? -err : err) > (max_err < 0 ? -max_err : max_err))
+			max_err = err;
+	}
+
+	printf("samples %d, forecasts %llu over %u ms\n", nr_samples,
+	       forecasts, horizon_ms);
+	if (forecasts)
+		printf("mean abs error %.0f mC, worst %d mC\n",
+		       abs_err / forecasts, max_err);
+	printf("fitted tau %u ms, ambient %d mC, fits %u, rejected %u\n",
+	       mpc_model_tau_ms(&model), mpc_model_ambient(&model),
+	       model.fits, model.rejected);
+}
+
+struct governor {
+	const char *name;
+	void (*reset)(struct governor *gov);
+	unsigned int (*budget)(struct governor *gov, int temp,
+			       unsigned int power, unsigned int dt_ms);
+	struct mpc_model model;
+	unsigned int cap;
+};
+
+static unsigned int max_power;
+
+static void mpc_reset(struct governor *gov)
+{
+	init_model(&gov->model);
+}
+
+/* allocate_power() of drivers/thermal/model_predictive.c */
+static unsigned int mpc_budget(struct governor *gov, int temp,
+			       unsigned int power, unsigned int dt_ms)
+{
+	unsigned int steps = (horizon_ms + MPC_STEP_MS - 1) / MPC_STEP_MS;
+	int forecast;
+
+	mpc_model_add_sample(&gov->model, temp, power, dt_ms);
+	mpc_model_fit(&gov->model);
+
+	forecast = mpc_model_forecast(&gov->model, temp, power, steps);
+	if (forecast <= control_temp && temp < control_temp)
+		return max_power;
+
+	return mpc_model_power_budget(&gov->model, temp, control_temp, steps,
+				      max_power);
+}
+
+static void reactive_reset(struct governor *gov)
+{
+	gov->cap = max_power;
+}
+
+static unsigned int reactive_budget(struct governor *gov, int temp,
+				    unsigned int power, unsigned int dt_ms)
+{
+	unsigned int step = max_power / 10;
+
+	if (temp >= control_temp)
+		gov->cap = gov->cap > step ? gov->cap - step : 0;
+	else if (gov->cap < max_power)
+		gov->cap = gov->cap + step < max_power ?
+			   gov->cap + step : max_power;
+
+	return gov->cap;
+}
+
+static struct governor governors[] = {
+	{ .name = "Reactive", .reset = reactive_reset,
+	  .budget = reactive_budget },
+	{ .name = "Predictive", .reset = mpc_reset, .budget = mpc_budget },
+};
+
+static void replay_demand(struct governor *gov, struct result *res)
+{
+	struct mpc_model plant;
+	unsigned int end = demands[nr_demands - 1].time_ms;
+	unsigned int t, budget = max_power, power = 0;
+	int temp = plant_ambient;
+	int d = 0;
+
+	memset(res, 0, sizeof(*res));
+	res->max_temp = temp;
+	gov->reset(gov);
+
+	/* the plant, in the model's own terms */
+	mpc_model_init(&plant, plant_tau_ms, plant_ambient,
+		       plant_ambient + plant_mC_per_W, 1000);
+
+	for (t = 0; t <= end; t += period_ms) {
+		unsigned int want;
+
+		while (d < nr_demands - 1 && demands[d + 1].time_ms <= t)
+			d++;
+		want = demands[d].power;
+
+		budget = gov->budget(gov, temp, power, t ? period_ms : 0);
+		power = want < budget ? want : budget;
+
+		res->requested += (double)want * period_ms / 1000000.0;
+		res->delivered += (double)power * period_ms / 1000000.0;
+
+		temp = mpc_model_forecast(&plant, temp, power,
+					  period_ms / MPC_STEP_MS);
+		if (temp > res->max_temp)
+			res->max_temp = temp;
+		if (temp > control_temp + margin)
+			res->over_ms += period_ms;
+	}
+}
+
+static int parse_trace(FILE *fp)
+{
+	char line[256];
+	int lineno = 0;
+
+	while (fgets(line, sizeof(line), fp)) {
+		struct sample s;
+		struct demand dm;
+		char *p = line;
+
+		lineno++;
+		while (*p == ' ' || *p == '\t')
+			p++;
+		if (*p == '#' || *p == '\n' || *p == '\0')
+			continue;
+
+		if (sscanf(p, "trip %d", &control_temp) == 1) {
+			continue;
+		} else if (sscanf(p, "plant %u %u %d", &plant_tau_ms,
+				  &plant_mC_per_W, &plant_ambient) == 3) {
+			continue;
+		} else if (sscanf(p, "sample %u %d %u", &s.time_ms, &s.temp,
+				  &s.power) == 3) {
+			if (nr_samples == MAX_RECORDS) {
+				fprintf(stderr, "%d: too many samples\n", lineno);
+				return -EINVAL;
+			}
+			if (nr_samples &&
+			    s.time_ms <= samples[nr_samples - 1].time_ms)
+				continue;
+			samples[nr_samples++] = s;
+		} else if (sscanf(p, "demand %u %u", &dm.time_ms,
+				  &dm.power) == 2) {
+			if (nr_demands == MAX_RECORDS) {
+				fprintf(stderr, "%d: too many demands\n", lineno);
+				return -EINVAL;
+			}
+			if (dm.power > max_power)
+				max_power = dm.power;
+			demands[nr_demands++] = dm;
+		} else {
+			fprintf(stderr, "%d: malformed record\n", lineno);
+			return -EINVAL;
+		}
+	}
+
+	if (!control_temp) {
+		fprintf(stderr, "trace needs a trip\n");
+		return -EINVAL;
+	}
+	if (nr_demands && (!plant_tau_ms || !plant_mC_per_W)) {
+		fprintf(stderr, "demand records need a plant\n");
+		return -EINVAL;
+	}
+	if (!nr_samples && !nr_demands) {
+		fprintf(stderr, "trace needs samples or demands\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options] <trace>\n"
+		"  -H <ms>   forecast horizon (default 3000)\n"
+		"  -p <ms>   governor polling period, a multiple of %d (default %d)\n"
+		"  -t <ms>   prior time constant (default 20000)\n"
+		"  -a <mC>   prior ambient temperature (default 25000)\n"
+		"  -s <mW>   sustainable power of the prior (default 1000)\n"
+		"  -m <mC>   overshoot margin above the trip (default 1000)\n"
+		"  -v        print every forecast\n",
+		prog, MPC_STEP_MS, MPC_STEP_MS);
+}
+
+int main(int argc, char **argv)
+{
+	struct result res;
+	FILE *fp;
+	int opt, i, ret;
+
+	while ((opt = getopt(argc, argv, "H:p:t:a:s:m:vh")) != -1) {
+		switch (opt) {
+		case 'H':
+			horizon_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			period_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			prior_tau_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'a':
+			prior_ambient = strtol(optarg, NULL, 0);
+			break;
+		case 's':
+			sustainable_power = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			margin = strtol(optarg, NULL, 0);
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (optind != argc - 1 || !period_ms || period_ms % MPC_STEP_MS) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	fp = fopen(argv[optind], "r");
+	if (!fp) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	samples = calloc(MAX_RECORDS, sizeof(*samples));
+	demands = calloc(MAX_RECORDS, sizeof(*demands));
+	if (!samples || !demands) {
+		fclose(fp);
+		return 1;
+	}
+
+	ret = parse_trace(fp);
+	fclose(fp);
+	if (ret)
+		return 1;
+
+	if (nr_samples)
+		replay_samples();
+
+	if (nr_demands) {
+		if (nr_samples)
+			printf("\n");
+		printf("%-12s %10s %10s %8s %10s %10s\n", "governor",
+		       "requested", "delivered", "rel", "max_mC", "over_ms");
+
+		for (i = 0; i < (int)(sizeof(governors) / sizeof(governors[0]));
+		     i++) {
+			replay_demand(&governors[i], &res);
+			printf("%-12s %9.1fJ %9.1fJ %7.1f%% %10d %10u\n",
+			       governors[i].name, res.requested, res.delivered,
+			       res.requested > 0 ?
+			       100.0 * res.delivered / res.requested : 0,
+			       res.max_temp, res.over_ms);
+		}
+	}
+
+	free(demands);
+	free(samples);
+
+	return 0;
+}
@@ -0,0 +1,467 @@
+/*
+ * ess-decode: rebuild the irq, hrtimer and frequency timelines that
+ * exynos-snapshot wrote with CONFIG_EXYNOS_SNAPSHOT_COMPACT.
+ *
+ * The input is a ramdump holding the kevents region: a dump of the whole
+ * DRAM or of the exynos-snapshot reserved memory only. The rings of the
+ * CPUs are found by their header (drivers/trace/exynos-ss-compact.h, used
+ * as is), wherever they are in the file. The blocks of each ring are put
+ * back in order by their sequence number and decoded, and the events of
+ * all CPUs are printed merged by time:
+ *
+ *   [    12.345678901][CPU2] irq:    45  fn:exynos_mct_tick_isr+0x0      IN
+ *
+ * With -m, handlers are resolved against the System.map of the kernel
+ * that wrote the dump; they are stored relative to _text, so this works
+ * whatever the KASLR offset was.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "exynos-ss-compact.h"
+
+#define MAX_RINGS	64
+
+/* enum esslog_flag */
+#define ESS_FLAG_IN	1
+#define ESS_FLAG_ON	2
+#define ESS_FLAG_OUT	3
+
+struct event {
+	struct ess_compact_event ev;
+	unsigned int cpu;
+	size_t order;
+};
+
+struct symbol {
+	unsigned long long addr;
+	char *name;
+};
+
+static const char * const freq_names[] = {
+	"APL", "ATL", "INT", "MIF", "ISP", "DISP", "INTCAM", "AUD", "FSYS",
+};
+
+static struct event *events;
+static size_t nr_events, max_events;
+
+static struct symbol *symbols;
+static size_t nr_symbols;
+static unsigned long long map_text;
+
+static int only_cpu = -1;
+static int only_type;
+static int summary;
+
+static int cmp_symbol(const void *a, const void *b)
+{
+	const struct symbol *x = a, *y = b;
+
+	return x->addr < y->addr ? -1 : x->addr > y->addr;
+}
+
+static int load_map(const char *path)
+{
+	char line[512], type, name[256];
+	unsigned long long addr;
+	size_t max = 0;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (!fp) {
+		perror(path);
+		return -errno;
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "%llx %c %255s", &addr, &type, name) != 3)
+			continue;
+		if (!strcmp(name, "_text"))
+			map_text = addr;
+		if (type != 't' && type != 'T')
+			continue;
+		if (nr_symbols == max) {
+			max = max ? max * 2 : 4096;
+			symbols = realloc(symbols, max * sizeof(*symbols));
+			if (!symbols) {
+				fclose(fp);
+				return -ENOMEM;
+			}
+		}
+		symbols[nr_symbols].addr = addr;
+		symbols[nr_symbols].name = strdup(name);
+		nr_symbols++;
+	}
+	fclose(fp);
+
+	if (!map_text) {
+		fprintf(stderr, "%s: no _text\n", path);
+		return -EINVAL;
+	}
+	qsort(symbols, nr_symbols, sizeof(*symbols), cmp_symbol);
+
+	return 0;
+}
+
+/* @off is relative to _text */
+static const char *symbolize(s64 off, char *buf, size_t sz)
+{
+	unsigned long long addr = map_text + off;
+	size_t lo = 0, hi = nr_symbols;
+
+	if (!nr_symbols) {
+		snprintf(buf, sz, "_text%+lld", (long long)off);
+		return buf;
+	}
+
+	while (hi - lo > 1) {
+		size_t mid = (lo + hi) / 2;
+
+		if (symbols[mid].addr <= addr)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	if (symbols[lo].addr > addr)
+		snprintf(buf, sz, "0x%llx", addr);
+	else
+		snprintf(buf, sz, "%s+0x%llx", symbols[lo].name,
+			 addr - symbols[lo].addr);
+	return buf;
+}
+
+static const char *en_name(int en, char *buf, size_t sz)
+{
+	switch (en) {
+	case ESS_FLAG_IN:
+		return "IN";
+	case ESS_FLAG_ON:
+		return "ON";
+	case ESS_FLAG_OUT:
+		return "OUT";
+	}
+	snprintf(buf, sz, "%d", en);
+	return buf;
+}
+
+static int add_event(const struct ess_compact_event *ev, unsigned int cpu)
+{
+	if (nr_events == max_events) {
+		max_events = max_events ? max_events * 2 : 65536;
+		events = realloc(events, max_events * sizeof(*events));
+		if (!events)
+			return -ENOMEM;
+	}
+	events[nr_events].ev = *ev;
+	events[nr_events].cpu = cpu;
+	events[nr_events].order = nr_events;
+	nr_events++;
+
+	return 0;
+}
+
+static int valid_hdr(const struct ess_compact_hdr *hdr, size_t room)
+{
+	return hdr->magic == ESS_COMPACT_MAGIC &&
+	       hdr->version == ESS_COMPACT_VERSION &&
+	       hdr->block_size == ESS_COMPACT_BLOCK_SZ &&
+	       hdr->size > hdr->block_size && hdr->size <= room &&
+	       !(hdr->size % hdr->block_size) &&
+	       hdr->cur < hdr->size / hdr->block_size - 1;
+}
+
+struct block_ref {
+	const struct ess_compact_block *blk;
+};
+
+static int cmp_block(const void *a, const void *b)
+{
+	const struct block_ref *x = a, *y = b;
+
+	return x->blk->seq < y->blk->seq ? -1 : x->blk->seq > y->blk->seq;
+}
+
+/* Returns the number of records decoded, or a negative error */
+static long decode_ring(const struct ess_compact_hdr *hdr,
+			unsigned long *bytes, unsigned long *cut)
+{
+	unsigned int nr_blocks = hdr->size / hdr->block_size - 1;
+	struct block_ref *ref;
+	unsigned int i, n = 0;
+	long records = 0;
+
+	ref = calloc(nr_blocks, sizeof(*ref));
+	if (!ref)
+		return -ENOMEM;
+
+	for (i = 0; i < nr_blocks; i++) {
+		const struct ess_compact_block *blk = (const void *)
+			((const u8 *)hdr + (i + 1) * hdr->block_size);
+
+		if (blk->seq && blk->used <= ESS_COMPACT_BLOCK_DATA)
+			ref[n++].blk = blk;
+	}
+	qsort(ref, n, sizeof(*ref), cmp_block);
+
+	for (i = 0; i < n; i++) {
+		const u8 *p = (const u8 *)(ref[i].blk + 1);
+		const u8 *end = p + ref[i].blk->used;
+		u64 time = ref[i].blk->time;
+		struct ess_compact_event ev;
+
+		*bytes += ref[i].blk->used;
+		while (p < end) {
+			p = ess_compact_decode(p, end, &time, &ev);
+			if (!p) {
+				(*cut)++;
+				break;
+			}
+			records++;
+			if (only_type && ev.type != only_type)
+				continue;
+			if (add_event(&ev, hdr->cpu)) {
+				free(ref);
+				return -ENOMEM;
+			}
+		}
+	}
+
+	free(ref);
+	return records;
+}
+
+static int scan(const u8 *base, size_t size)
+{
+	int nr_rings = 0;
+	size_t off;
+
+	for (off = 0; off + sizeof(struct ess_compact_hdr) <= size; off += 8) {
+		const struct ess_compact_hdr *hdr = (const void *)(base + off);
+		unsigned long bytes = 0, cut = 0;
+		long records;
+
+		if (!valid_hdr(hdr, size - off))
+			continue;
+		if (only_cpu >= 0 && hdr->cpu != only_cpu) {
+			off += hdr->size - 8;
+			continue;
+		}
+
+		records = decode_ring(hdr, &bytes, &cut);
+		if (records < 0)
+			return records;
+
+		fprintf(stderr,
+			"ring at 0x%zx: cpu %u, %u KB, %ld records, %.1f bytes/record%s\n",
+			off, hdr->cpu, hdr->size / 1024, records,
+			records ? (double)bytes / records : 0.0,
+			cut ? ", cut blocks" : "");
+
+		if (++nr_rings == MAX_RINGS)
+			break;
+		off += hdr->size - 8;
+	}
+
+	return nr_rings;
+}
+
+static int cmp_event(const void *a, const void *b)
+{
+	const struct event *x = a, *y = b;
+
+	if (x->ev.time != y->ev.time)
+		return x->ev.time < y->ev.time ? -1 : 1;
+	if (x->cpu != y->cpu)
+		return x->cpu < y->cpu ? -1 : 1;
+	return x->order < y->order ? -1 : x->order > y->order;
+}
+
+static void print_event(const struct event *e)
+{
+	const struct ess_compact_event *ev = &e->ev;
+	char sym[256], en[16];
+
+	printf("[%8llu.%09llu][CPU%u] ",
+	       (unsigned long long)(ev->time / 1000000000ULL),
+	       (unsigned long long)(ev->time % 1000000000ULL), e->cpu);
+
+	switch (ev->type) {
+	case ESS_COMPACT_IRQ:
+		printf("irq:%6d  fn:%-40s preempt:%#8x  val:%6u  %s\n",
+		       ev->irq.irq, symbolize(ev->irq.fn, sym, sizeof(sym)),
+		       ev->irq.preempt, ev->irq.val,
+		       en_name(ev->en, en, sizeof(en)));
+		break;
+	case ESS_COMPACT_FREQ:
+		printf("freq:%-6s  old:%10llu  target:%10llu  %s\n",
+		       ev->freq.domain < sizeof(freq_names) / sizeof(freq_names[0]) ?
+		       freq_names[ev->freq.domain] : "?",
+		       (unsigned long long)ev->freq.old_freq,
+		       (unsigned long long)ev->freq.target_freq,
+		       en_name(ev->en, en, sizeof(en)));
+		break;
+	case ESS_COMPACT_HRTIMER:
+		printf("hrtimer:0x%016llx  fn:%-40s now:%llu  %s\n",
+		       (unsigned long long)ev->hrtimer.timer,
+		       symbolize(ev->hrtimer.fn, sym, sizeof(sym)),
+		       (unsigned long long)ev->hrtimer.now,
+		       en_name(ev->en, en, sizeof(en)));
+		break;
+	}
+}
+
+static void print_summary(void)
+{
+	static const struct {
+		int type;
+		const char *name;
+	} types[] = {
+		{ ESS_COMPACT_IRQ, "irq" },
+		{ ESS_COMPACT_HRTIMER, "hrtimer" },
+		{ ESS_COMPACT_FREQ, "freq" },
+	};
+	unsigned int cpu, t, max_cpu = 0;
+	size_t i;
+
+	for (i = 0; i < nr_events; i++)
+		if (events[i].cpu > max_cpu)
+			max_cpu = events[i].cpu;
+
+	printf("%-4s %-8s %10s %18s %18s\n", "cpu", "type", "events",
+	       "first", "last");
+	for (cpu = 0; cpu <= max_cpu; cpu++) {
+		for (t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+			u64 first = 0, last = 0;
+			unsigned long n = 0;
+
+			for (i = 0; i < nr_events; i++) {
+				const struct event *e = &events[i];
+
+				if (e->cpu != cpu || e->ev.type != types[t].type)
+					continue;
+				if (!n++)
+					first = e->ev.time;
+				last = e->ev.time;
+			}
+			if (!n)
+				continue;
+			printf("%-4u %-8s %10lu %8llu.%09llu %8llu.%09llu\n",
+			       cpu, types[t].name, n,
+			       (unsigned long long)(first / 1000000000ULL),
+			       (unsigned long long)(first % 1000000000ULL),
+			       (unsigned long long)(last / 1000000000ULL),
+			       (unsigned long long)(last % 1000000000ULL));
+		}
+	}
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options] <ramdump>\n"
+		"  -m <System.map>  resolve handlers against this map\n"
+		"  -c <cpu>         only this cpu\n"
+		"  -t <type>        only irq, hrtimer or freq events\n"
+		"  -s               print a summary instead of the events\n",
+		prog);
+}
+
+int main(int argc, char **argv)
+{
+	const char *map = NULL;
+	struct stat st;
+	size_t i;
+	void *base;
+	int opt, fd, ret;
+
+	while ((opt = getopt(argc, argv, "m:c:t:sh")) != -1) {
+		switch (opt) {
+		case 'm':
+			map = optarg;
+			break;
+		case 'c':
+			only_cpu = strtol(optarg, NULL, 0);
+			break;
+		case 't':
+			if (!strcmp(optarg, "irq"))
+				only_type = ESS_COMPACT_IRQ;
+			else if (!strcmp(optarg, "hrtimer"))
+				only_type = ESS_COMPACT_HRTIMER;
+			else if (!strcmp(optarg, "freq"))
+				only_type = ESS_COMPACT_FREQ;
+			else {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 's':
+			summary = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (optind != argc - 1) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (map && load_map(map))
+		return 1;
+
+	fd = open(argv[optind], O_RDONLY);
+	if (fd < 0 || fstat(fd, &st)) {
+		perror(argv[optind]);
+		return 1;
+	}
+	if (!st.st_size) {
+		fprintf(stderr, "%s: empty\n", argv[optind]);
+		close(fd);
+		return 1;
+	}
+
+	base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+
+	ret = scan(base, st.st_size);
+	if (ret < 0) {
+		fprintf(stderr, "decoding failed: %s\n", strerror(-ret));
+		return 1;
+	}
+	if (!ret) {
+		fprintf(stderr, "no compact ring found, was the kernel built "
+			"with CONFIG_EXYNOS_SNAPSHOT_COMPACT?\n");
+		return 1;
+	}
+
+	qsort(events, nr_events, sizeof(*events), cmp_event);
+
+	if (summary)
+		print_summary();
+	else
+		for (i = 0; i < nr_events; i++)
+			print_event(&events[i]);
+
+	munmap(base, st.st_size);
+	free(events);
+
+	return 0;
+}
@@ -0,0 +1,217 @@
+/*
+ * dpu-bts-replay: replay recorded DECON window configurations through the
+ * DPU BTS planner without a display.
+ *
+ * The planner and the demand calculation are the in-kernel ones
+ * (drivers/video/fbdev/exynos/dpu_7885/bts_plan.c) built as is.
+ *
+ * The trace is the kernel log of a device running with
+ * decon.dpu_bts_log_level=7, which logs every window of every frame:
+ *
+ *   [<win>] DPP[<dma>] (<bpp>) (<src_w> <src_h>)	(<x1> <y1> <x2> <y2>) <bw>
+ *   BW(KB/s): type<id> bw <peak>p <total>r, ...
+ *
+ * Any other line is ignored, a BW line ends a frame.
+ *
+ * Each frame is planned twice: once requesting its own demand, as the
+ * driver did before the planner, and once through the planner. For both,
+ * QoS changes are frames whose request differs from the previous one,
+ * late raises are frames whose demand the previous request did not cover
+ * (the QoS had to be raised right before the update), and the cost is the
+ * average bandwidth requested above the demand.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "bts_plan.h"
+
+#define MAX_FRAMES	(1 << 20)
+
+struct frame {
+	struct dpu_bts_layer layers[DPU_BTS_MAX_LAYERS];
+	int nr_layers;
+};
+
+static struct frame *frames;
+static int nr_frames;
+
+static unsigned int xres = 1080, yres = 2220, fps = 63;
+static unsigned int disp_freq_minlock;
+static unsigned int hold = DPU_BTS_DEFAULT_HOLD;
+
+struct result {
+	unsigned long long changes;
+	unsigned long long late;
+	double demand_bw;
+	double granted_bw;
+};
+
+static int covers(const struct dpu_bts_demand *grant,
+		  const struct dpu_bts_demand *demand)
+{
+	return grant->total_bw >= demand->total_bw &&
+	       grant->peak >= demand->peak &&
+	       grant->disp_freq >= demand->disp_freq;
+}
+
+static void replay(int planned, struct result *res)
+{
+	u32 resol_clock = dpu_bts_resol_clock(xres, yres, fps);
+	struct dpu_bts_demand demand, grant, prev = { 0, };
+	struct dpu_bts_plan plan;
+	int i;
+
+	memset(res, 0, sizeof(*res));
+	dpu_bts_plan_init(&plan);
+	plan.hold = hold;
+
+	for (i = 0; i < nr_frames; i++) {
+		dpu_bts_calc_demand(frames[i].layers, frames[i].nr_layers,
+				    xres, resol_clock, disp_freq_minlock,
+				    &demand);
+
+		if (planned)
+			dpu_bts_plan_next(&plan, &demand, &grant);
+		else
+			grant = demand;
+
+		if (i && !covers(&prev, &demand))
+			res->late++;
+		if (i && memcmp(&grant, &prev, sizeof(grant)))
+			res->changes++;
+
+		res->demand_bw += demand.total_bw;
+		res->granted_bw += grant.total_bw;
+		prev = grant;
+	}
+}
+
+static int parse_trace(FILE *fp)
+{
+	struct frame cur = { .nr_layers = 0 };
+	char line[512];
+
+	while (fgets(line, sizeof(line), fp)) {
+		struct dpu_bts_layer l;
+		unsigned int bpp, x1, y1, x2, y2;
+		char *p;
+
+		p = strstr(line, "DPP[");
+		if (p && sscanf(p, "DPP[%u] (%u) (%u %u) (%u %u %u %u) %u",
+				&l.dma, &bpp, &l.src_w, &l.src_h, &x1, &y1,
+				&x2, &y2, &l.bw) == 9) {
+			if (cur.nr_layers == DPU_BTS_MAX_LAYERS)
+				continue;
+			l.dst_w = x2 > x1 ? x2 - x1 : 0;
+			l.dst_h = y2 > y1 ? y2 - y1 : 0;
+			cur.layers[cur.nr_layers++] = l;
+			continue;
+		}
+
+		if (!strstr(line, "BW(KB/s):"))
+			continue;
+
+		if (nr_frames == MAX_FRAMES) {
+			fprintf(stderr, "too many frames\n");
+			return -EINVAL;
+		}
+		frames[nr_frames++] = cur;
+		cur.nr_layers = 0;
+	}
+
+	if (!nr_frames) {
+		fprintf(stderr, "no frames found, was dpu_bts_log_level >= 7?\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options] <kernel log>\n"
+		"  -x <px>   panel width (default 1080)\n"
+		"  -y <px>   panel height (default 2220)\n"
+		"  -f <hz>   refresh rate (default 63)\n"
+		"  -m <khz>  DISP frequency min lock (default 0)\n"
+		"  -H <n>    planner hold frames (default %d)\n",
+		prog, DPU_BTS_DEFAULT_HOLD);
+}
+
+int main(int argc, char **argv)
+{
+	static const char * const names[] = { "Immediate", "Planned" };
+	struct result res;
+	FILE *fp;
+	int opt, i, ret;
+
+	while ((opt = getopt(argc, argv, "x:y:f:m:H:h")) != -1) {
+		switch (opt) {
+		case 'x':
+			xres = strtoul(optarg, NULL, 0);
+			break;
+		case 'y':
+			yres = strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			fps = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			disp_freq_minlock = strtoul(optarg, NULL, 0);
+			break;
+		case 'H':
+			hold = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (optind != argc - 1 || !xres || !yres || !fps) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	fp = fopen(argv[optind], "r");
+	if (!fp) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	frames = calloc(MAX_FRAMES, sizeof(*frames));
+	if (!frames) {
+		fclose(fp);
+		return 1;
+	}
+
+	ret = parse_trace(fp);
+	fclose(fp);
+	if (ret)
+		return 1;
+
+	printf("%d frames\n", nr_frames);
+	printf("%-10s %10s %10s %10s\n", "policy", "changes", "late",
+	       "over_bw");
+
+	for (i = 0; i < 2; i++) {
+		replay(i, &res);
+		printf("%-10s %10llu %10llu %9.1f%%\n", names[i], res.changes,
+		       res.late, res.demand_bw > 0 ?
+		       100.0 * (res.granted_bw - res.demand_bw) /
+		       res.demand_bw : 0);
+	}
+
+	free(frames);
+
+	return 0;
+}